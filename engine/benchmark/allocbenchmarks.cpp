@@ -0,0 +1,467 @@
+// allocbenchmarks.cpp times the pool, frame and small object allocators (the
+// pool through both the static and the old lazy Singleton::get()), walking
+// a churned pool, and walking components in a SlotMap against a std::set of
+// pointers. The contention benchmarks run
+// 1 to 32 threads that each allocate a few blocks and free them again, over and
+// over, all on the same pool. One op is one Allocate plus one Free, and ns/op
+// is wall clock time over the ops of all threads together, so a pool that
+// scales perfectly gets faster as threads are added (up to the core count).
+//
+// The threads are started and waiting before the clock starts, and it stops
+// when the last one finishes its loop, so thread start up and join aren't timed.
+#include "benchmark.h"
+#include "../core/poolalloc.h"
+#include "../core/framealloc.h"
+#include "../core/smallalloc.h"
+#include "../core/memresource.h"
+#include "../core/slotmap.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace ITP485
+{
+
+namespace
+{
+
+// Blocks each thread holds at once
+const size_t kHeld = 4;
+
+typedef PoolAllocator<64, 4096> BenchPool;
+typedef PoolAllocator<64, 4096, LockFreeFreeList> BenchSharedPool;
+
+// The single threaded pool behind a mutex, the simplest way to share it
+struct MutexPool
+{
+	static void* Allocate(size_t size)
+	{
+		std::lock_guard<std::mutex> lock(GetMutex());
+		return BenchPool::get().Allocate(size);
+	}
+	static void Free(void* ptr)
+	{
+		std::lock_guard<std::mutex> lock(GetMutex());
+		BenchPool::get().Free(ptr);
+	}
+	static std::mutex& GetMutex()
+	{
+		static std::mutex s_Mutex;
+		return s_Mutex;
+	}
+};
+
+struct LockFreePool
+{
+	static void* Allocate(size_t size) { return BenchSharedPool::get().Allocate(size); }
+	static void Free(void* ptr) { BenchSharedPool::get().Free(ptr); }
+};
+
+// The general purpose heap, for reference
+struct HeapAlloc
+{
+	static void* Allocate(size_t size) { return ::operator new(size); }
+	static void Free(void* ptr) { ::operator delete(ptr); }
+};
+
+// Starts the allocators once, the benchmarks only allocate and free
+struct PoolStartUp
+{
+	PoolStartUp()
+	{
+		// This runs during static initialization, the singletons may not be created yet
+		BenchPool::Create();
+		BenchSharedPool::Create();
+		FrameAllocator::Create();
+		SmallObjectAllocator::Create();
+
+		BenchPool::get().StartUp();
+		BenchSharedPool::get().StartUp();
+		FrameAllocator::get().StartUp(64 * 1024);
+		SmallObjectAllocator::get().StartUp();
+	}
+	~PoolStartUp()
+	{
+		BenchPool::get().ShutDown();
+		BenchSharedPool::get().ShutDown();
+		FrameAllocator::get().ShutDown();
+		SmallObjectAllocator::get().ShutDown();
+	}
+};
+
+PoolStartUp s_PoolStartUp;
+
+template <class Alloc>
+size_t AllocFreeLoop(size_t iterations)
+{
+	size_t sum = 0;
+	void* held[kHeld];
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		for (size_t j = 0; j < kHeld; ++j)
+		{
+			held[j] = Alloc::Allocate(64);
+			*static_cast<size_t*>(held[j]) = i;
+		}
+		for (size_t j = 0; j < kHeld; ++j)
+		{
+			sum += *static_cast<size_t*>(held[j]);
+			Alloc::Free(held[j]);
+		}
+	}
+	return sum;
+}
+
+// The single threaded pool with no lock, the best case
+float PoolSingleThread(size_t iterations)
+{
+	struct NoLockPool
+	{
+		static void* Allocate(size_t size) { return BenchPool::get().Allocate(size); }
+		static void Free(void* ptr) { BenchPool::get().Free(ptr); }
+	};
+	return float(AllocFreeLoop<NoLockPool>(iterations));
+}
+
+// Where LazyGetPool keeps the pool
+BenchPool* s_pLazyBenchPool = 0;
+
+// The same pool through a get() like Singleton's used to be, which checks
+// if the instance exists yet on every call
+float PoolSingleThreadLazyGet(size_t iterations)
+{
+	struct LazyGetPool
+	{
+		static BenchPool& get()
+		{
+			if (!s_pLazyBenchPool)
+			{
+				s_pLazyBenchPool = &BenchPool::get();
+			}
+			return *s_pLazyBenchPool;
+		}
+		static void* Allocate(size_t size) { return get().Allocate(size); }
+		static void Free(void* ptr) { get().Free(ptr); }
+	};
+	return float(AllocFreeLoop<LazyGetPool>(iterations));
+}
+
+// The same rounds from the frame allocator, which frees a whole round at once
+float FrameAllocatorSingleThread(size_t iterations)
+{
+	FrameAllocator& frame = FrameAllocator::get();
+	size_t sum = 0;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		FrameMarker marker = frame.GetMarker();
+		for (size_t j = 0; j < kHeld; ++j)
+		{
+			size_t* pValue = static_cast<size_t*>(frame.Allocate(64));
+			*pValue = i;
+			sum += *pValue;
+		}
+		frame.FreeToMarker(marker);
+	}
+	return float(sum);
+}
+
+// The same rounds through the size class lookup of the small object allocator
+float SmallObjectSingleThread(size_t iterations)
+{
+	struct SmallObjectAlloc
+	{
+		static void* Allocate(size_t size) { return SmallObjectAllocator::get().Allocate(size); }
+		static void Free(void* ptr) { SmallObjectAllocator::get().Free(ptr, 64); }
+	};
+	return float(AllocFreeLoop<SmallObjectAlloc>(iterations));
+}
+
+// Nodes a std::set holds in the set benchmarks
+const size_t kSetSize = 64;
+
+// Fills a set and empties it again, once per iteration. An op is one insert
+// plus one erase.
+template <class Set>
+float SetChurn(Set& values, size_t iterations)
+{
+	size_t sum = 0;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		for (size_t j = 0; j < kSetSize; ++j)
+		{
+			values.insert(j * 7919 % kSetSize + i);
+		}
+		sum += *values.begin();
+		values.clear();
+	}
+	return float(sum);
+}
+
+float SetDefaultAllocator(size_t iterations)
+{
+	std::set<size_t> values;
+	return SetChurn(values, iterations);
+}
+
+float SetSmallObjectResource(size_t iterations)
+{
+	typedef std::set<size_t, std::less<size_t>, ResourceStlAllocator<size_t> > PooledSet;
+	PooledSet::allocator_type allocator(GetSmallObjectResource());
+	PooledSet values(allocator);
+	return SetChurn(values, iterations);
+}
+
+// Components walked in the component benchmarks
+const size_t kComponents = 4096;
+
+// About the size of a MeshComponent
+struct BenchComponent
+{
+	float m_Transform[12];
+	float m_Value;
+	char m_Padding[12];
+
+	BenchComponent(float value) : m_Value(value) { }
+};
+
+// Walks components in a std::set of pointers, the way GraphicsDevice used to.
+// Every component has its own heap block, with something else allocated
+// between them like in a real level. An op is one component.
+float ComponentSet(size_t iterations)
+{
+	std::set<BenchComponent*> components;
+	std::vector<char*> others;
+	for (size_t i = 0; i < kComponents; ++i)
+	{
+		components.insert(new BenchComponent(float(i)));
+		others.push_back(new char[48]);
+	}
+
+	float sum = 0.0f;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		for (BenchComponent* pComponent : components)
+		{
+			pComponent->m_Value += 1.0f;
+			sum += pComponent->m_Value;
+		}
+	}
+
+	for (BenchComponent* pComponent : components)
+	{
+		delete pComponent;
+	}
+	for (size_t i = 0; i < others.size(); ++i)
+	{
+		delete[] others[i];
+	}
+	return sum;
+}
+
+// Walks the same components packed in a SlotMap
+float ComponentSlotMap(size_t iterations)
+{
+	SlotMap<BenchComponent> components;
+	for (size_t i = 0; i < kComponents; ++i)
+	{
+		components.Insert(float(i));
+	}
+
+	float sum = 0.0f;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		for (BenchComponent& component : components)
+		{
+			component.m_Value += 1.0f;
+			sum += component.m_Value;
+		}
+	}
+	return sum;
+}
+
+// Objects in the pool walk benchmarks, and how many are left after the churn
+const size_t kWalkObjects = 65536;
+const size_t kWalkLive = 49152;
+
+// Separate pools for the walk benchmarks, so compacting one leaves the other churned
+typedef PoolAllocator<64, 2048> WalkPool;
+typedef PoolAllocator<64, 1024> CompactWalkPool;
+
+// An object in a walk pool. m_Index is where its pointer is in ChurnedPool::m_Objects.
+struct WalkObject
+{
+	size_t m_Index;
+	size_t m_Value;
+};
+
+// Fills Pool with kWalkObjects objects, frees half of them in random order and
+// allocates some back, like a level that's been running for a while. The
+// free list hands those out in LIFO order, so m_Objects jumps all over the pool.
+template <class Pool>
+struct ChurnedPool
+{
+	std::vector<WalkObject*> m_Objects;
+
+	ChurnedPool(bool bCompact)
+	{
+		// Also runs during static initialization
+		Pool::Create();
+		Pool::get().StartUp(kPoolNoLimit);
+		for (size_t i = 0; i < kWalkObjects; ++i)
+		{
+			m_Objects.push_back(static_cast<WalkObject*>(Pool::get().Allocate(sizeof(WalkObject))));
+		}
+		std::minstd_rand random(1234);
+		std::shuffle(m_Objects.begin(), m_Objects.end(), random);
+		for (size_t i = kWalkObjects / 2; i < kWalkObjects; ++i)
+		{
+			Pool::get().Free(m_Objects[i]);
+		}
+		m_Objects.resize(kWalkObjects / 2);
+		while (m_Objects.size() < kWalkLive)
+		{
+			m_Objects.push_back(static_cast<WalkObject*>(Pool::get().Allocate(sizeof(WalkObject))));
+		}
+		for (size_t i = 0; i < m_Objects.size(); ++i)
+		{
+			m_Objects[i]->m_Index = i;
+			m_Objects[i]->m_Value = i;
+		}
+
+		if (bCompact)
+		{
+			Pool::get().Compact(MoveObject, this);
+		}
+	}
+	~ChurnedPool()
+	{
+		for (size_t i = 0; i < m_Objects.size(); ++i)
+		{
+			Pool::get().Free(m_Objects[i]);
+		}
+		Pool::get().ShutDown();
+	}
+
+	// Compact's move callback, fixes up m_Objects
+	static void MoveObject(void* pUser, void* pFrom, void* pTo)
+	{
+		ChurnedPool* pPool = static_cast<ChurnedPool*>(pUser);
+		WalkObject* pObject = new (pTo) WalkObject(*static_cast<WalkObject*>(pFrom));
+		pPool->m_Objects[pObject->m_Index] = pObject;
+	}
+};
+
+ChurnedPool<WalkPool> s_ChurnedPool(false);
+ChurnedPool<CompactWalkPool> s_CompactedPool(true);
+
+// Walks the churned pool through the pointers, in the order they were allocated
+float PoolWalkPointers(size_t iterations)
+{
+	size_t sum = 0;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		for (size_t j = 0; j < s_ChurnedPool.m_Objects.size(); ++j)
+		{
+			sum += ++s_ChurnedPool.m_Objects[j]->m_Value;
+		}
+	}
+	return float(sum);
+}
+
+// Walks the churned pool in address order
+float PoolWalkForEachLive(size_t iterations)
+{
+	size_t sum = 0;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		WalkPool::get().ForEachLive([&sum](void* ptr) { sum += ++static_cast<WalkObject*>(ptr)->m_Value; });
+	}
+	return float(sum);
+}
+
+// Walks the compacted pool in address order, where there are no holes
+float PoolWalkCompacted(size_t iterations)
+{
+	size_t sum = 0;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		CompactWalkPool::get().ForEachLive([&sum](void* ptr) { sum += ++static_cast<WalkObject*>(ptr)->m_Value; });
+	}
+	return float(sum);
+}
+
+// Splits iterations over num_threads threads. Only the loops are timed: every
+// thread waits on bGo until all of them are running, and each one notes when
+// its loop ends.
+template <class Alloc, int num_threads>
+float Contention(size_t iterations)
+{
+	size_t perThread = (iterations + num_threads - 1) / num_threads;
+	std::vector<size_t> sums(num_threads);
+	std::vector<double> ends(num_threads);
+	std::atomic<int> numReady(0);
+	std::atomic<bool> bGo(false);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; ++t)
+	{
+		threads.push_back(std::thread([perThread, t, &sums, &ends, &numReady, &bGo]()
+		{
+			numReady.fetch_add(1);
+			while (!bGo.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+			sums[t] = AllocFreeLoop<Alloc>(perThread);
+			ends[t] = GetBenchmarkSeconds();
+		}));
+	}
+	while (numReady.load() < num_threads)
+	{
+		std::this_thread::yield();
+	}
+
+	double start = GetBenchmarkSeconds();
+	bGo.store(true, std::memory_order_release);
+	size_t sum = 0;
+	double end = start;
+	for (int t = 0; t < num_threads; ++t)
+	{
+		threads[t].join();
+		sum += sums[t];
+		end = std::max(end, ends[t]);
+	}
+	ReportBenchmarkSeconds(end - start);
+	return float(sum);
+}
+
+} // anonymous namespace
+
+REGISTER_BENCHMARK("PoolAllocator single thread", PoolSingleThread, kHeld);
+REGISTER_BENCHMARK("PoolAllocator single thread, lazy get()", PoolSingleThreadLazyGet, kHeld);
+REGISTER_BENCHMARK("FrameAllocator single thread", FrameAllocatorSingleThread, kHeld);
+REGISTER_BENCHMARK("SmallObjectAllocator single thread", SmallObjectSingleThread, kHeld);
+REGISTER_BENCHMARK("std::set insert/erase, default allocator", SetDefaultAllocator, kSetSize);
+REGISTER_BENCHMARK("std::set insert/erase, small object resource", SetSmallObjectResource, kSetSize);
+REGISTER_BENCHMARK("Pool walk after churn, pointer list", PoolWalkPointers, kWalkLive);
+REGISTER_BENCHMARK("Pool walk after churn, ForEachLive", PoolWalkForEachLive, kWalkLive);
+REGISTER_BENCHMARK("Pool walk after Compact, ForEachLive", PoolWalkCompacted, kWalkLive);
+REGISTER_BENCHMARK("Component walk, std::set of pointers", ComponentSet, kComponents);
+REGISTER_BENCHMARK("Component walk, SlotMap", ComponentSlotMap, kComponents);
+
+#define REGISTER_CONTENTION_BENCHMARKS(num_threads) \
+	REGISTER_BENCHMARK("PoolAllocator + mutex x" #num_threads " threads", (Contention<MutexPool, num_threads>), kHeld); \
+	REGISTER_BENCHMARK("PoolAllocator<LockFreeFreeList> x" #num_threads " threads", (Contention<LockFreePool, num_threads>), kHeld); \
+	REGISTER_BENCHMARK("operator new/delete x" #num_threads " threads", (Contention<HeapAlloc, num_threads>), kHeld)
+
+REGISTER_CONTENTION_BENCHMARKS(1);
+REGISTER_CONTENTION_BENCHMARKS(2);
+REGISTER_CONTENTION_BENCHMARKS(4);
+REGISTER_CONTENTION_BENCHMARKS(8);
+REGISTER_CONTENTION_BENCHMARKS(16);
+REGISTER_CONTENTION_BENCHMARKS(32);
+
+} // namespace ITP485
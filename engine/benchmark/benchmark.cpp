@@ -0,0 +1,315 @@
+// benchmark.cpp is the entry point of the benchmark executable. It runs every
+// registered benchmark without any input, prints a table of ns/op, and can
+// write the results as JSON for tracking regressions between builds.
+//
+// Usage: benchmark [--filter text] [--reps n] [--warmup n] [--min-time ms] [--json file] [--list]
+//
+// Besides the Visual Studio project, it builds with any x86 compiler, e.g.
+// g++ -O2 -std=c++11 -I.. benchmark/*.cpp core/fastmath.cpp core/slowmath.cpp
+//     core/simd.cpp core/bounds.cpp core/dualquat.cpp core/quantize.cpp
+//     core/framealloc.cpp core/smallalloc.cpp core/allocstats.cpp core/vmarena.cpp
+//     core/memresource.cpp core/subsystem.cpp -lpthread -o bench
+// (from the engine directory).
+#include "benchmark.h"
+#include "../core/simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+using namespace ITP485;
+
+namespace ITP485
+{
+
+std::vector<BenchmarkInfo>& GetBenchmarks()
+{
+	static std::vector<BenchmarkInfo> benchmarks;
+	return benchmarks;
+}
+
+// Time reported by the running benchmark, or negative if it didn't report one
+static double s_ReportedSeconds = -1.0;
+
+void ReportBenchmarkSeconds(double seconds)
+{
+	s_ReportedSeconds = seconds;
+}
+
+// Returns the current time in seconds. std::chrono's clocks only have
+// millisecond resolution in some versions of MSVC, so use the performance
+// counter there.
+double GetBenchmarkSeconds()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq = { 0 };
+	if (freq.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&freq);
+	}
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return double(now.QuadPart) / double(freq.QuadPart);
+#else
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+} // namespace ITP485
+
+namespace
+{
+
+// Command line settings
+struct Options
+{
+	const char* szFilter;
+	const char* szJsonFile;
+	int repetitions;
+	int warmup;
+	double minSeconds;
+	bool bList;
+};
+
+// Statistics for one benchmark, all in ns/op
+struct Result
+{
+	std::string name;
+	size_t iterations;
+	size_t opsPerIteration;
+	double median;
+	double mean;
+	double stddev;
+	double min;
+};
+
+// Keeps every benchmark's return value alive
+volatile float g_Sink;
+
+// Runs pFunc iterations times and returns the elapsed seconds, or the time
+// the benchmark reported if it timed itself
+double TimeRun(BenchmarkFunc pFunc, size_t iterations)
+{
+	s_ReportedSeconds = -1.0;
+	double start = GetBenchmarkSeconds();
+	g_Sink = pFunc(iterations);
+	double elapsed = GetBenchmarkSeconds() - start;
+	return (s_ReportedSeconds >= 0.0) ? s_ReportedSeconds : elapsed;
+}
+
+// Finds an iteration count where one repetition takes at least minSeconds,
+// which also warms up the caches and the branch predictors
+size_t Calibrate(BenchmarkFunc pFunc, double minSeconds)
+{
+	size_t iterations = 1;
+	while (iterations < (size_t(1) << 40))
+	{
+		double elapsed = TimeRun(pFunc, iterations);
+		if (elapsed >= minSeconds)
+		{
+			break;
+		}
+		// Jump close to the target when there's a usable measurement
+		size_t scale = (elapsed > minSeconds * 0.01) ? size_t(minSeconds * 1.2 / elapsed) + 1 : 10;
+		iterations *= std::max<size_t>(scale, 2);
+	}
+	return iterations;
+}
+
+Result RunBenchmark(const BenchmarkInfo& info, const std::string& name, const Options& options)
+{
+	Result result;
+	result.name = name;
+	result.opsPerIteration = info.opsPerIteration;
+	result.iterations = Calibrate(info.pFunc, options.minSeconds);
+
+	for (int i = 0; i < options.warmup; ++i)
+	{
+		TimeRun(info.pFunc, result.iterations);
+	}
+
+	double ops = double(result.iterations) * double(info.opsPerIteration);
+	std::vector<double> samples;
+	for (int i = 0; i < options.repetitions; ++i)
+	{
+		samples.push_back(TimeRun(info.pFunc, result.iterations) * 1.0e9 / ops);
+	}
+
+	std::sort(samples.begin(), samples.end());
+	size_t count = samples.size();
+	result.median = (count % 2) ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+	result.min = samples[0];
+
+	double sum = 0.0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		sum += samples[i];
+	}
+	result.mean = sum / double(count);
+
+	double sumSq = 0.0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		sumSq += (samples[i] - result.mean) * (samples[i] - result.mean);
+	}
+	result.stddev = (count > 1) ? std::sqrt(sumSq / double(count - 1)) : 0.0;
+	return result;
+}
+
+// Writes s as a JSON string, benchmark names only need quotes escaped
+void WriteJsonString(FILE* pFile, const std::string& s)
+{
+	fputc('"', pFile);
+	for (size_t i = 0; i < s.size(); ++i)
+	{
+		if (s[i] == '"' || s[i] == '\\')
+		{
+			fputc('\\', pFile);
+		}
+		fputc(s[i], pFile);
+	}
+	fputc('"', pFile);
+}
+
+bool WriteJson(const char* szFileName, const std::vector<Result>& results, const Options& options)
+{
+	FILE* pFile = fopen(szFileName, "w");
+	if (pFile == nullptr)
+	{
+		return false;
+	}
+
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "  \"simd_level\": \"%s\",\n", GetSimdLevelName(GetSimdLevel()));
+	fprintf(pFile, "  \"repetitions\": %d,\n", options.repetitions);
+	fprintf(pFile, "  \"warmup\": %d,\n", options.warmup);
+	fprintf(pFile, "  \"unit\": \"ns/op\",\n");
+	fprintf(pFile, "  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const Result& r = results[i];
+		fprintf(pFile, "    {\"name\": ");
+		WriteJsonString(pFile, r.name);
+		fprintf(pFile, ", \"iterations\": %llu, \"ops_per_iteration\": %llu, "
+				"\"median\": %.4f, \"mean\": %.4f, \"stddev\": %.4f, \"min\": %.4f}%s\n",
+				(unsigned long long)r.iterations, (unsigned long long)r.opsPerIteration,
+				r.median, r.mean, r.stddev, r.min, (i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(pFile, "  ]\n");
+	fprintf(pFile, "}\n");
+	fclose(pFile);
+	return true;
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options)
+{
+	options.szFilter = nullptr;
+	options.szJsonFile = nullptr;
+	options.repetitions = 15;
+	options.warmup = 3;
+	options.minSeconds = 0.005;
+	options.bList = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool bHasValue = (i + 1 < argc);
+		if (strcmp(argv[i], "--filter") == 0 && bHasValue)
+		{
+			options.szFilter = argv[++i];
+		}
+		else if (strcmp(argv[i], "--json") == 0 && bHasValue)
+		{
+			options.szJsonFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--reps") == 0 && bHasValue)
+		{
+			options.repetitions = std::max(1, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && bHasValue)
+		{
+			options.warmup = std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--min-time") == 0 && bHasValue)
+		{
+			options.minSeconds = std::max(0.1, atof(argv[++i])) / 1000.0;
+		}
+		else if (strcmp(argv[i], "--list") == 0)
+		{
+			options.bList = true;
+		}
+		else
+		{
+			printf("Usage: %s [--filter text] [--reps n] [--warmup n] [--min-time ms] [--json file] [--list]\n", argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	SimdLevel hardware = DetectSimdLevel();
+	printf("SIMD level: %s, %d repetitions after %d warmup runs\n\n", GetSimdLevelName(hardware), options.repetitions, options.warmup);
+	printf("%-52s %12s %12s %12s %12s\n", "Benchmark", "median ns/op", "mean ns/op", "stddev", "min ns/op");
+
+	std::vector<Result> results;
+	const std::vector<BenchmarkInfo>& benchmarks = GetBenchmarks();
+	for (size_t i = 0; i < benchmarks.size(); ++i)
+	{
+		const BenchmarkInfo& info = benchmarks[i];
+		int lastLevel = info.bPerSimdLevel ? hardware : SIMD_SSE2;
+		for (int level = SIMD_SSE2; level <= lastLevel; ++level)
+		{
+			std::string name = info.szName;
+			if (info.bPerSimdLevel)
+			{
+				name += " [";
+				name += GetSimdLevelName(static_cast<SimdLevel>(level));
+				name += "]";
+			}
+			if (options.szFilter != nullptr && name.find(options.szFilter) == std::string::npos)
+			{
+				continue;
+			}
+			if (options.bList)
+			{
+				printf("%s\n", name.c_str());
+				continue;
+			}
+
+			SetSimdLevel(info.bPerSimdLevel ? static_cast<SimdLevel>(level) : hardware);
+			Result result = RunBenchmark(info, name, options);
+			printf("%-52s %12.3f %12.3f %12.3f %12.3f\n", result.name.c_str(), result.median, result.mean, result.stddev, result.min);
+			fflush(stdout);
+			results.push_back(result);
+		}
+	}
+	SetSimdLevel(hardware);
+
+	if (options.szJsonFile != nullptr)
+	{
+		if (!WriteJson(options.szJsonFile, results, options))
+		{
+			printf("Couldn't write %s\n", options.szJsonFile);
+			return 1;
+		}
+		printf("\nWrote %s\n", options.szJsonFile);
+	}
+	return 0;
+}
@@ -0,0 +1,63 @@
+// benchmark.h defines a small, portable micro benchmark harness.
+// Benchmarks register themselves at static init time with REGISTER_BENCHMARK,
+// and benchmark.cpp times every registered one and reports ns/op.
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace ITP485
+{
+
+// Runs the body of a benchmark iterations times. Returns a value computed from
+// the results so the compiler can't throw the work away.
+typedef float (*BenchmarkFunc)(size_t iterations);
+
+// One registered benchmark
+struct BenchmarkInfo
+{
+	const char* szName;
+	BenchmarkFunc pFunc;
+	// How many operations one iteration does, used to report ns/op
+	size_t opsPerIteration;
+	// If true, this is run once per SIMD level the CPU supports
+	bool bPerSimdLevel;
+};
+
+// Returns every registered benchmark, in registration order
+std::vector<BenchmarkInfo>& GetBenchmarks();
+
+// Returns the current time in seconds, from the same clock the harness uses
+double GetBenchmarkSeconds();
+
+// A benchmark that has to do setup inside its function (like starting threads)
+// can time the part it wants measured and report it here. The harness then uses
+// seconds for this run instead of the time of the whole call.
+void ReportBenchmarkSeconds(double seconds);
+
+// Adds a benchmark at static init time. Use REGISTER_BENCHMARK instead of this.
+class BenchmarkRegistrar
+{
+public:
+	BenchmarkRegistrar(const char* szName, BenchmarkFunc pFunc, size_t opsPerIteration, bool bPerSimdLevel)
+	{
+		BenchmarkInfo info = { szName, pFunc, opsPerIteration, bPerSimdLevel };
+		GetBenchmarks().push_back(info);
+	}
+};
+
+#define BENCHMARK_CONCAT2(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT2(a, b)
+
+// Registers func under name. ops is the number of operations per iteration.
+#define REGISTER_BENCHMARK(name, func, ops) \
+	static ITP485::BenchmarkRegistrar BENCHMARK_CONCAT(s_BenchmarkRegistrar, __COUNTER__)(name, func, ops, false)
+
+// Same as REGISTER_BENCHMARK, but runs once per SIMD level (for dispatched kernels)
+#define REGISTER_SIMD_BENCHMARK(name, func, ops) \
+	static ITP485::BenchmarkRegistrar BENCHMARK_CONCAT(s_BenchmarkRegistrar, __COUNTER__)(name, func, ops, true)
+
+} // namespace ITP485
+
+#endif // _BENCHMARK_H_
@@ -0,0 +1,1235 @@
+// mathbenchmarks.cpp times every FastMath/SlowMath operation and every batch
+// kernel. The scalar operations are templated on the library so the fast and
+// slow versions run the exact same loop.
+//
+// Each loop walks arrays of kCount inputs and writes into arrays of results,
+// so it measures throughput and nothing gets hoisted out of the loop.
+#include "benchmark.h"
+#include "../core/fastmath.h"
+#include "../core/slowmath.h"
+#include "../core/bounds.h"
+#include "../core/dualquat.h"
+#include "../core/quantize.h"
+#include <new>
+
+namespace ITP485
+{
+
+namespace
+{
+
+const size_t kCount = 256;
+const size_t kMask = kCount - 1;
+
+// Type sets for the templated benchmarks
+struct FastLib
+{
+	typedef FastVector3 Vector3;
+	typedef FastMatrix4 Matrix4;
+	typedef FastAffine3x4 Affine3x4;
+	typedef FastQuaternion Quaternion;
+};
+
+// FastMatrix4 in the other storage layout, for comparing the two
+struct FastOtherLayoutLib
+{
+	typedef FastVector3 Vector3;
+#if FASTMATH_COLUMN_MAJOR
+	typedef FastMatrix4T<MatrixRowMajor> Matrix4;
+#else
+	typedef FastMatrix4T<MatrixColumnMajor> Matrix4;
+#endif
+	typedef FastAffine3x4 Affine3x4;
+	typedef FastQuaternion Quaternion;
+};
+
+struct SlowLib
+{
+	typedef SlowVector3 Vector3;
+	typedef SlowMatrix4 Matrix4;
+	typedef SlowAffine3x4 Affine3x4;
+	typedef SlowQuaternion Quaternion;
+};
+
+// Returns a pseudo random float in [lo, hi), always the same sequence
+float RandomFloat(unsigned int& seed, float lo, float hi)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * float(seed >> 8) * (1.0f / 16777216.0f);
+}
+
+// Inputs and outputs for one library, built on first use
+template <class Lib>
+struct MathData
+{
+	typedef typename Lib::Vector3 Vector3;
+	typedef typename Lib::Matrix4 Matrix4;
+	typedef typename Lib::Affine3x4 Affine3x4;
+	typedef typename Lib::Quaternion Quaternion;
+
+	Vector3 vectors[kCount];
+	Vector3 others[kCount];
+	float scalars[kCount];
+	// rotation * scale * translation, invertible but not orthonormal
+	Matrix4 matrices[kCount];
+	Affine3x4 affines[kCount];
+	// rotation * translation only
+	Matrix4 rigidMatrices[kCount];
+	Affine3x4 rigids[kCount];
+	Quaternion quats[kCount];
+	Quaternion otherQuats[kCount];
+
+	Vector3 vectorResults[kCount];
+	Vector3 scaleResults[kCount];
+	float floatResults[kCount];
+	Matrix4 matrixResults[kCount];
+	Affine3x4 affineResults[kCount];
+	Quaternion quatResults[kCount];
+
+	// Interleaved VERTEX_P_N_S_T style vertices, 16 floats each
+	static const size_t kVertexFloats = 16;
+	float vertices[kCount * kVertexFloats];
+	float vertexResults[kCount * kVertexFloats];
+
+	MathData()
+	{
+		unsigned int seed = 485;
+		for (size_t i = 0; i < kCount; ++i)
+		{
+			vectors[i] = Vector3(RandomFloat(seed, -10.0f, 10.0f), RandomFloat(seed, -10.0f, 10.0f), RandomFloat(seed, -10.0f, 10.0f));
+			others[i] = Vector3(RandomFloat(seed, -10.0f, 10.0f), RandomFloat(seed, -10.0f, 10.0f), RandomFloat(seed, -10.0f, 10.0f));
+			scalars[i] = RandomFloat(seed, 0.0f, 1.0f);
+
+			Vector3 axis(RandomFloat(seed, -1.0f, 1.0f), RandomFloat(seed, -1.0f, 1.0f), RandomFloat(seed, 0.1f, 1.0f));
+			axis.Normalize();
+			quats[i] = Quaternion(axis, RandomFloat(seed, -Pi, Pi));
+			otherQuats[i] = Quaternion(axis, RandomFloat(seed, -Pi, Pi));
+
+			Matrix4 temp;
+			rigidMatrices[i].CreateTranslation(others[i]);
+			temp.CreateFromQuaternion(quats[i]);
+			rigidMatrices[i].Multiply(temp);
+			matrices[i] = rigidMatrices[i];
+			temp.CreateScale(RandomFloat(seed, 0.5f, 2.0f));
+			matrices[i].Multiply(temp);
+
+			rigids[i].CreateFromQuaternion(quats[i], others[i]);
+			affines[i] = rigids[i];
+			Affine3x4 scale;
+			scale.CreateScale(RandomFloat(seed, 0.5f, 2.0f));
+			affines[i].Multiply(scale);
+		}
+		for (size_t i = 0; i < kCount * kVertexFloats; ++i)
+		{
+			vertices[i] = RandomFloat(seed, -1.0f, 1.0f);
+			vertexResults[i] = 0.0f;
+		}
+	}
+
+	// The fast types need 16 byte alignment, which the heap doesn't guarantee everywhere
+	static MathData& Get()
+	{
+		static MathData* s_pData = nullptr;
+		if (s_pData == nullptr)
+		{
+			s_pData = new (_mm_malloc(sizeof(MathData), 32)) MathData();
+		}
+		return *s_pData;
+	}
+};
+
+// Vector3
+
+template <class Lib>
+float VectorAdd(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].Add(d.others[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorSub(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].Sub(d.others[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorMultiply(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].Multiply(d.scalars[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorDot(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.floatResults[k] = d.vectors[k].Dot(d.others[k]);
+	}
+	return d.floatResults[0];
+}
+
+template <class Lib>
+float VectorCross(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = Cross(d.vectors[k], d.others[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorLength(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.floatResults[k] = d.vectors[k].Length();
+	}
+	return d.floatResults[0];
+}
+
+template <class Lib>
+float VectorLengthSquared(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.floatResults[k] = d.vectors[k].LengthSquared();
+	}
+	return d.floatResults[0];
+}
+
+template <class Lib>
+float VectorNormalize(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].Normalize();
+	}
+	return d.vectorResults[0].GetX();
+}
+
+// FastVector3 only, at each accuracy tier
+template <SimdAccuracy accuracy>
+float VectorNormalizeTier(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].Normalize<accuracy>();
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <SimdAccuracy accuracy>
+float VectorLengthTier(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.floatResults[k] = d.vectors[k].Length<accuracy>();
+	}
+	return d.floatResults[0];
+}
+
+template <class Lib>
+float VectorLerp(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = Lerp(d.vectors[k], d.others[k], d.scalars[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorBlend(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		size_t k2 = (i + 1) & kMask;
+		d.vectorResults[k] = Blend(d.vectors[k], d.others[k], d.vectors[k2], d.others[k2],
+								   0.1f, 0.2f, 0.3f);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorTransform(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].Transform(d.matrices[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorTransformAsVector(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].TransformAsVector(d.matrices[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorTransformAffine(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].Transform(d.affines[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+template <class Lib>
+float VectorRotate(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.vectorResults[k] = d.vectors[k];
+		d.vectorResults[k].Rotate(d.quats[k]);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+// Matrix4
+
+// Returns m's element at row, col the way D3D sees it. Goes through StoreD3D,
+// so it's the same element whichever layout FASTMATH_COLUMN_MAJOR picks.
+template <class Matrix>
+float D3DElement(const Matrix& m, int row, int col)
+{
+	D3DMATRIX out;
+	m.StoreD3D(out);
+	return out.m[row][col];
+}
+
+template <class Lib>
+float MatrixMultiply(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k] = d.matrices[k];
+		d.matrixResults[k].Multiply(d.rigidMatrices[k]);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixAdd(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k] = d.matrices[k];
+		d.matrixResults[k].Add(d.rigidMatrices[k]);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixLerp(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k] = Lerp(d.matrices[k], d.rigidMatrices[k], d.scalars[k]);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixCreateScale(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k].CreateScale(d.scalars[k]);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixCreateRotationX(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k].CreateRotationX(d.scalars[k]);
+	}
+	return D3DElement(d.matrixResults[0], 1, 1);
+}
+
+template <class Lib>
+float MatrixCreateRotationY(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k].CreateRotationY(d.scalars[k]);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixCreateRotationZ(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k].CreateRotationZ(d.scalars[k]);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixCreateTranslation(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k].CreateTranslation(d.vectors[k]);
+	}
+	return D3DElement(d.matrixResults[0], 0, 3);
+}
+
+template <class Lib>
+float MatrixCreateFromQuaternion(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k].CreateFromQuaternion(d.quats[k]);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixCreateLookAt(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k].CreateLookAt(d.vectors[k], d.others[k], Lib::Vector3::UnitY);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixCreatePerspectiveFOV(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k].CreatePerspectiveFOV(0.5f + d.scalars[k], 1.333f, 1.0f, 1000.0f);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixInvert(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k] = d.matrices[k];
+		d.matrixResults[k].Invert();
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixInvertAffine(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k] = d.matrices[k];
+		d.matrixResults[k].InvertAffine();
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixInvertOrthonormal(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.matrixResults[k] = d.rigidMatrices[k];
+		d.matrixResults[k].InvertOrthonormal();
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+// Affine3x4
+
+template <class Lib>
+float AffineMultiply(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.affineResults[k] = d.affines[k];
+		d.affineResults[k].Multiply(d.rigids[k]);
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+template <class Lib>
+float AffineLerp(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.affineResults[k] = Lerp(d.affines[k], d.rigids[k], d.scalars[k]);
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+template <class Lib>
+float AffineCreateTranslation(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.affineResults[k].CreateTranslation(d.vectors[k]);
+	}
+	return d.affineResults[0].ToFloats()[3];
+}
+
+template <class Lib>
+float AffineCreateFromQuaternion(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.affineResults[k].CreateFromQuaternion(d.quats[k]);
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+template <class Lib>
+float AffineCreateFromQuaternionTranslation(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.affineResults[k].CreateFromQuaternion(d.quats[k], d.vectors[k]);
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+template <class Lib>
+float AffineInvert(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.affineResults[k] = d.affines[k];
+		d.affineResults[k].Invert();
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+template <class Lib>
+float AffineInvertOrthonormal(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.affineResults[k] = d.rigids[k];
+		d.affineResults[k].InvertOrthonormal();
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+// Quaternion
+
+template <class Lib>
+float QuaternionMultiply(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.quatResults[k] = d.quats[k];
+		d.quatResults[k].Multiply(d.otherQuats[k]);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionConjugate(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.quatResults[k] = d.quats[k];
+		d.quatResults[k].Conjugate();
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionLength(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.floatResults[k] = d.quats[k].Length();
+	}
+	return d.floatResults[0];
+}
+
+template <class Lib>
+float QuaternionNormalize(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.quatResults[k] = d.quats[k];
+		d.quatResults[k].Normalize();
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionAxisAngle(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.quatResults[k] = typename Lib::Quaternion(Lib::Vector3::UnitY, d.scalars[k]);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionLerp(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.quatResults[k] = Lerp(d.quats[k], d.otherQuats[k], d.scalars[k]);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionBlend(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		size_t k2 = (i + 1) & kMask;
+		d.quatResults[k] = Blend(d.quats[k], d.otherQuats[k], d.quats[k2], d.otherQuats[k2],
+								 0.1f, 0.2f, 0.3f);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionSlerp(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.quatResults[k] = Slerp(d.quats[k], d.otherQuats[k], d.scalars[k]);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionNLerp(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.quatResults[k] = NLerp(d.quats[k], d.otherQuats[k], d.scalars[k]);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionCreateFromMatrix(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		d.quatResults[k].CreateFromMatrix(d.rigids[k]);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+// Batches. One iteration runs the whole batch, so ops per iteration is kCount.
+
+template <class Lib>
+float MatrixMultiplyBatch(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Matrix4::MultiplyBatch(d.matrices, d.rigidMatrices, d.matrixResults, kCount);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float MatrixMultiplyBroadcast(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Matrix4::MultiplyBroadcast(d.matrices[i & kMask], d.rigidMatrices, d.matrixResults, kCount);
+	}
+	return D3DElement(d.matrixResults[0], 0, 0);
+}
+
+template <class Lib>
+float AffineMultiplyBatch(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Affine3x4::MultiplyBatch(d.affines, d.rigids, d.affineResults, kCount);
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+template <class Lib>
+float AffineInvertMany(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Affine3x4::InvertMany(d.affines, d.affineResults, kCount);
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+template <class Lib>
+float AffineDecomposeBatch(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Affine3x4::DecomposeBatch(d.affines, d.vectorResults, d.quatResults, d.scaleResults, kCount);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float AffineComposeBatch(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Affine3x4::ComposeBatch(d.vectors, d.quats, d.others, d.affineResults, kCount);
+	}
+	return d.affineResults[0].ToFloats()[0];
+}
+
+template <class Lib>
+float AffineTransformPoints(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	const size_t stride = MathData<Lib>::kVertexFloats * sizeof(float);
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		d.affines[i & kMask].TransformPoints(d.vertices, stride, d.vertexResults, stride, kCount);
+	}
+	return d.vertexResults[0];
+}
+
+template <class Lib>
+float AffineTransformNormals(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	const size_t stride = MathData<Lib>::kVertexFloats * sizeof(float);
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		d.affines[i & kMask].TransformNormals(d.vertices + 3, stride, d.vertexResults + 3, stride, kCount);
+	}
+	return d.vertexResults[3];
+}
+
+// Points for the streaming benchmarks, packed 3 floats apart. 12MB in and
+// 12MB out is more than the caches hold, which is when streaming pays off.
+const size_t kStreamPoints = 1024 * 1024;
+
+struct StreamData
+{
+	float* pPoints;
+	float* pResults;
+
+	StreamData()
+	{
+		pPoints = static_cast<float*>(_mm_malloc(kStreamPoints * 3 * sizeof(float), 16));
+		pResults = static_cast<float*>(_mm_malloc(kStreamPoints * 3 * sizeof(float), 16));
+		for (size_t i = 0; i < kStreamPoints * 3; ++i)
+		{
+			pPoints[i] = float(i % 23) * 0.37f - 3.0f;
+			pResults[i] = 0.0f;
+		}
+	}
+
+	static StreamData& Get()
+	{
+		static StreamData* s_pData = nullptr;
+		if (s_pData == nullptr)
+		{
+			s_pData = new StreamData();
+		}
+		return *s_pData;
+	}
+};
+
+// Transforms kStreamPoints packed points into a packed, aligned buffer,
+// where bStream really streams
+template <bool bStream>
+float AffineTransformPointsPacked(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	StreamData& s = StreamData::Get();
+	const size_t stride = 3 * sizeof(float);
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		d.affines[i & kMask].TransformPoints(s.pPoints, stride, s.pResults, stride, kStreamPoints, bStream);
+	}
+	return s.pResults[0];
+}
+
+template <class Lib>
+float QuaternionNormalizeBatch(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Quaternion::NormalizeBatch(d.quats, d.quatResults, kCount);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionMultiplyBatch(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Quaternion::MultiplyBatch(d.quats, d.otherQuats, d.quatResults, kCount);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+template <class Lib>
+float QuaternionSlerpBatch(size_t iterations)
+{
+	MathData<Lib>& d = MathData<Lib>::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		Lib::Quaternion::SlerpBatch(d.quats, d.otherQuats, d.scalars, d.quatResults, kCount);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+// Fast only
+
+template <SimdAccuracy accuracy>
+float SinCosBatch(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	float* sines = d.floatResults;
+	float* cosines = d.vertexResults;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		SinCos(d.vertices, sines, cosines, kCount, accuracy);
+	}
+	return sines[0] + cosines[0];
+}
+
+// Skinning palette to dual quaternions, one at a time vs. one batch
+FastDualQuaternion* GetDualQuatResults()
+{
+	static FastDualQuaternion s_Results[kCount];
+	return s_Results;
+}
+
+float DualQuatFromAffine(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	FastDualQuaternion* results = GetDualQuatResults();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		results[k].CreateFromAffine(d.rigids[k]);
+	}
+	return results[0].ToFloats()[0];
+}
+
+float DualQuatFromAffineBatch(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	FastDualQuaternion* results = GetDualQuatResults();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		FastDualQuaternion::CreateFromAffineBatch(d.rigids, results, kCount);
+	}
+	return results[0].ToFloats()[0];
+}
+
+// Quantization, one value at a time vs. batches
+struct QuantizeData
+{
+	PackedQuaternion packedQuats[kCount];
+	OctahedralNormal packedNormals[kCount];
+	unsigned short halves[kCount * 4];
+
+	static QuantizeData& Get()
+	{
+		static QuantizeData s_Data;
+		return s_Data;
+	}
+};
+
+float PackQuaternionSingle(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	QuantizeData& q = QuantizeData::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		size_t k = i & kMask;
+		q.packedQuats[k] = PackQuaternion(d.quats[k]);
+	}
+	return q.packedQuats[0].data[0];
+}
+
+float PackQuaternionBatch(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	QuantizeData& q = QuantizeData::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		PackQuaternions(d.quats, q.packedQuats, kCount);
+	}
+	return q.packedQuats[0].data[0];
+}
+
+float UnpackQuaternionBatch(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	QuantizeData& q = QuantizeData::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		UnpackQuaternions(q.packedQuats, d.quatResults, kCount);
+	}
+	return d.quatResults[0].GetScalar();
+}
+
+float PackNormalBatch(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	QuantizeData& q = QuantizeData::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		PackNormals(d.vectors, q.packedNormals, kCount);
+	}
+	return q.packedNormals[0].x;
+}
+
+float UnpackNormalBatch(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	QuantizeData& q = QuantizeData::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		UnpackNormals(q.packedNormals, d.vectorResults, kCount);
+	}
+	return d.vectorResults[0].GetX();
+}
+
+// The vertex array as halves, kCount * 4 floats
+float FloatsToHalvesBatch(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	QuantizeData& q = QuantizeData::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		FloatsToHalves(d.vertices, q.halves, kCount * 4);
+	}
+	return q.halves[0];
+}
+
+float HalvesToFloatsBatch(size_t iterations)
+{
+	MathData<FastLib>& d = MathData<FastLib>::Get();
+	QuantizeData& q = QuantizeData::Get();
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		HalvesToFloats(q.halves, d.vertexResults, kCount * 4);
+	}
+	return d.vertexResults[0];
+}
+
+// Frustum culling of 16 boxes, one at a time vs. one batch
+struct CullData
+{
+	Frustum frustum;
+	Aabb boxes[AabbBatch::kCapacity];
+	AabbBatch batch;
+
+	CullData()
+	{
+		FastMatrix4 view, proj;
+		view.CreateLookAt(FastVector3(0.0f, 0.0f, -10.0f), FastVector3::Zero, FastVector3::UnitY);
+		proj.CreatePerspectiveFOV(PiOver2, 1.0f, 1.0f, 100.0f);
+		proj.Multiply(view);
+		// Extract wants D3D's row major layout, like GraphicsDevice::Render
+		D3DMATRIX viewProj;
+		proj.StoreD3D(viewProj);
+		frustum.Extract(viewProj);
+
+		// Spread around the frustum, so some are in and some are out
+		for (int i = 0; i < AabbBatch::kCapacity; ++i)
+		{
+			float x = float(i % 4) * 12.0f - 18.0f;
+			float z = float(i / 4) * 40.0f - 25.0f;
+			boxes[i] = Aabb(x - 1.0f, -1.0f, z - 1.0f, x + 1.0f, 1.0f, z + 1.0f);
+			batch.Set(i, boxes[i]);
+		}
+	}
+
+	static CullData& Get()
+	{
+		static CullData* s_pData = nullptr;
+		if (s_pData == nullptr)
+		{
+			s_pData = new (_mm_malloc(sizeof(CullData), 32)) CullData();
+		}
+		return *s_pData;
+	}
+};
+
+float FrustumClassify(size_t iterations)
+{
+	CullData& d = CullData::Get();
+	unsigned int visible = 0;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		for (int j = 0; j < AabbBatch::kCapacity; ++j)
+		{
+			visible += (d.frustum.Classify(d.boxes[j]) != CULL_OUTSIDE) ? 1 : 0;
+		}
+	}
+	return float(visible);
+}
+
+float FrustumTestVisible(size_t iterations)
+{
+	CullData& d = CullData::Get();
+	unsigned int visible = 0;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		visible += d.frustum.TestVisible(d.batch, AabbBatch::kCapacity) & 1;
+	}
+	return float(visible);
+}
+
+} // anonymous namespace
+
+// Registers the fast and slow versions of a templated benchmark
+#define REGISTER_MATH_BENCHMARK(type, op, func) \
+	REGISTER_BENCHMARK("Fast" type "::" op, func<FastLib>, 1); \
+	REGISTER_BENCHMARK("Slow" type "::" op, func<SlowLib>, 1)
+
+REGISTER_MATH_BENCHMARK("Vector3", "Add", VectorAdd);
+REGISTER_MATH_BENCHMARK("Vector3", "Sub", VectorSub);
+REGISTER_MATH_BENCHMARK("Vector3", "Multiply", VectorMultiply);
+REGISTER_MATH_BENCHMARK("Vector3", "Dot", VectorDot);
+REGISTER_MATH_BENCHMARK("Vector3", "Cross", VectorCross);
+REGISTER_MATH_BENCHMARK("Vector3", "Length", VectorLength);
+REGISTER_MATH_BENCHMARK("Vector3", "LengthSquared", VectorLengthSquared);
+REGISTER_MATH_BENCHMARK("Vector3", "Normalize", VectorNormalize);
+REGISTER_BENCHMARK("FastVector3::Normalize (precise)", VectorNormalizeTier<SIMD_PRECISE>, 1);
+REGISTER_BENCHMARK("FastVector3::Normalize (fast)", VectorNormalizeTier<SIMD_FAST>, 1);
+REGISTER_BENCHMARK("FastVector3::Normalize (estimate)", VectorNormalizeTier<SIMD_ESTIMATE>, 1);
+REGISTER_BENCHMARK("FastVector3::Length (fast)", VectorLengthTier<SIMD_FAST>, 1);
+REGISTER_BENCHMARK("FastVector3::Length (estimate)", VectorLengthTier<SIMD_ESTIMATE>, 1);
+REGISTER_MATH_BENCHMARK("Vector3", "Lerp", VectorLerp);
+REGISTER_MATH_BENCHMARK("Vector3", "Blend", VectorBlend);
+REGISTER_MATH_BENCHMARK("Vector3", "Transform(Matrix4)", VectorTransform);
+REGISTER_MATH_BENCHMARK("Vector3", "TransformAsVector(Matrix4)", VectorTransformAsVector);
+REGISTER_MATH_BENCHMARK("Vector3", "Transform(Affine3x4)", VectorTransformAffine);
+REGISTER_MATH_BENCHMARK("Vector3", "Rotate", VectorRotate);
+
+// Matrix4::Multiply goes through the dispatch table
+REGISTER_SIMD_BENCHMARK("FastMatrix4::Multiply", MatrixMultiply<FastLib>, 1);
+REGISTER_BENCHMARK("SlowMatrix4::Multiply", MatrixMultiply<SlowLib>, 1);
+
+// The same operations with FastMatrix4 stored the other way
+#if FASTMATH_COLUMN_MAJOR
+#define OTHER_LAYOUT_NAME "row major"
+#else
+#define OTHER_LAYOUT_NAME "column major"
+#endif
+REGISTER_SIMD_BENCHMARK("FastMatrix4 (" OTHER_LAYOUT_NAME ")::Multiply", MatrixMultiply<FastOtherLayoutLib>, 1);
+REGISTER_BENCHMARK("FastVector3::Transform(Matrix4, " OTHER_LAYOUT_NAME ")", VectorTransform<FastOtherLayoutLib>, 1);
+REGISTER_BENCHMARK("FastVector3::TransformAsVector(Matrix4, " OTHER_LAYOUT_NAME ")", VectorTransformAsVector<FastOtherLayoutLib>, 1);
+REGISTER_MATH_BENCHMARK("Matrix4", "Add", MatrixAdd);
+REGISTER_MATH_BENCHMARK("Matrix4", "Lerp", MatrixLerp);
+REGISTER_MATH_BENCHMARK("Matrix4", "CreateScale", MatrixCreateScale);
+REGISTER_MATH_BENCHMARK("Matrix4", "CreateRotationX", MatrixCreateRotationX);
+REGISTER_MATH_BENCHMARK("Matrix4", "CreateRotationY", MatrixCreateRotationY);
+REGISTER_MATH_BENCHMARK("Matrix4", "CreateRotationZ", MatrixCreateRotationZ);
+REGISTER_MATH_BENCHMARK("Matrix4", "CreateTranslation", MatrixCreateTranslation);
+REGISTER_MATH_BENCHMARK("Matrix4", "CreateFromQuaternion", MatrixCreateFromQuaternion);
+REGISTER_MATH_BENCHMARK("Matrix4", "CreateLookAt", MatrixCreateLookAt);
+REGISTER_MATH_BENCHMARK("Matrix4", "CreatePerspectiveFOV", MatrixCreatePerspectiveFOV);
+REGISTER_MATH_BENCHMARK("Matrix4", "Invert", MatrixInvert);
+REGISTER_MATH_BENCHMARK("Matrix4", "InvertAffine", MatrixInvertAffine);
+REGISTER_MATH_BENCHMARK("Matrix4", "InvertOrthonormal", MatrixInvertOrthonormal);
+
+REGISTER_SIMD_BENCHMARK("FastAffine3x4::Multiply", AffineMultiply<FastLib>, 1);
+REGISTER_BENCHMARK("SlowAffine3x4::Multiply", AffineMultiply<SlowLib>, 1);
+REGISTER_MATH_BENCHMARK("Affine3x4", "Lerp", AffineLerp);
+REGISTER_MATH_BENCHMARK("Affine3x4", "CreateTranslation", AffineCreateTranslation);
+REGISTER_MATH_BENCHMARK("Affine3x4", "CreateFromQuaternion", AffineCreateFromQuaternion);
+REGISTER_MATH_BENCHMARK("Affine3x4", "CreateFromQuaternion(q, t)", AffineCreateFromQuaternionTranslation);
+REGISTER_MATH_BENCHMARK("Affine3x4", "Invert", AffineInvert);
+REGISTER_MATH_BENCHMARK("Affine3x4", "InvertOrthonormal", AffineInvertOrthonormal);
+
+REGISTER_MATH_BENCHMARK("Quaternion", "Multiply", QuaternionMultiply);
+REGISTER_MATH_BENCHMARK("Quaternion", "Conjugate", QuaternionConjugate);
+REGISTER_MATH_BENCHMARK("Quaternion", "Length", QuaternionLength);
+REGISTER_MATH_BENCHMARK("Quaternion", "Normalize", QuaternionNormalize);
+REGISTER_MATH_BENCHMARK("Quaternion", "Quaternion(axis, angle)", QuaternionAxisAngle);
+REGISTER_MATH_BENCHMARK("Quaternion", "Lerp", QuaternionLerp);
+REGISTER_MATH_BENCHMARK("Quaternion", "Blend", QuaternionBlend);
+REGISTER_MATH_BENCHMARK("Quaternion", "Slerp", QuaternionSlerp);
+REGISTER_MATH_BENCHMARK("Quaternion", "NLerp", QuaternionNLerp);
+REGISTER_MATH_BENCHMARK("Quaternion", "CreateFromMatrix", QuaternionCreateFromMatrix);
+
+// Registers the fast batch at every SIMD level and the slow loop once
+#define REGISTER_BATCH_BENCHMARK(type, op, func) \
+	REGISTER_SIMD_BENCHMARK("Fast" type "::" op, func<FastLib>, kCount); \
+	REGISTER_BENCHMARK("Slow" type "::" op, func<SlowLib>, kCount)
+
+REGISTER_BATCH_BENCHMARK("Matrix4", "MultiplyBatch", MatrixMultiplyBatch);
+REGISTER_SIMD_BENCHMARK("FastMatrix4 (" OTHER_LAYOUT_NAME ")::MultiplyBatch", MatrixMultiplyBatch<FastOtherLayoutLib>, kCount);
+REGISTER_SIMD_BENCHMARK("FastMatrix4 (" OTHER_LAYOUT_NAME ")::MultiplyBroadcast", MatrixMultiplyBroadcast<FastOtherLayoutLib>, kCount);
+REGISTER_BATCH_BENCHMARK("Matrix4", "MultiplyBroadcast", MatrixMultiplyBroadcast);
+REGISTER_BATCH_BENCHMARK("Affine3x4", "MultiplyBatch", AffineMultiplyBatch);
+REGISTER_BATCH_BENCHMARK("Affine3x4", "InvertMany", AffineInvertMany);
+REGISTER_BATCH_BENCHMARK("Affine3x4", "DecomposeBatch", AffineDecomposeBatch);
+REGISTER_BATCH_BENCHMARK("Affine3x4", "ComposeBatch", AffineComposeBatch);
+REGISTER_SIMD_BENCHMARK("FastAffine3x4::TransformPoints", AffineTransformPoints<FastLib>, kCount);
+REGISTER_BENCHMARK("SlowAffine3x4::TransformPoints", AffineTransformPoints<SlowLib>, kCount);
+REGISTER_SIMD_BENCHMARK("FastAffine3x4::TransformPoints 1M", AffineTransformPointsPacked<false>, kStreamPoints);
+REGISTER_SIMD_BENCHMARK("FastAffine3x4::TransformPoints 1M stream", AffineTransformPointsPacked<true>, kStreamPoints);
+REGISTER_SIMD_BENCHMARK("FastAffine3x4::TransformNormals", AffineTransformNormals<FastLib>, kCount);
+REGISTER_BENCHMARK("SlowAffine3x4::TransformNormals", AffineTransformNormals<SlowLib>, kCount);
+REGISTER_BATCH_BENCHMARK("Quaternion", "NormalizeBatch", QuaternionNormalizeBatch);
+REGISTER_BATCH_BENCHMARK("Quaternion", "MultiplyBatch", QuaternionMultiplyBatch);
+REGISTER_BATCH_BENCHMARK("Quaternion", "SlerpBatch", QuaternionSlerpBatch);
+
+REGISTER_SIMD_BENCHMARK("SinCos batch (precise)", SinCosBatch<SIMD_PRECISE>, kCount);
+REGISTER_SIMD_BENCHMARK("SinCos batch (fast)", SinCosBatch<SIMD_FAST>, kCount);
+
+REGISTER_BENCHMARK("FastDualQuaternion::CreateFromAffine", DualQuatFromAffine, 1);
+REGISTER_SIMD_BENCHMARK("FastDualQuaternion::CreateFromAffineBatch", DualQuatFromAffineBatch, kCount);
+
+REGISTER_BENCHMARK("PackQuaternion", PackQuaternionSingle, 1);
+REGISTER_SIMD_BENCHMARK("PackQuaternions", PackQuaternionBatch, kCount);
+REGISTER_SIMD_BENCHMARK("UnpackQuaternions", UnpackQuaternionBatch, kCount);
+REGISTER_SIMD_BENCHMARK("PackNormals", PackNormalBatch, kCount);
+REGISTER_SIMD_BENCHMARK("UnpackNormals", UnpackNormalBatch, kCount);
+REGISTER_SIMD_BENCHMARK("FloatsToHalves", FloatsToHalvesBatch, kCount * 4);
+REGISTER_SIMD_BENCHMARK("HalvesToFloats", HalvesToFloatsBatch, kCount * 4);
+
+REGISTER_BENCHMARK("Frustum::Classify(Aabb) x16", FrustumClassify, AabbBatch::kCapacity);
+REGISTER_SIMD_BENCHMARK("Frustum::TestVisible(AabbBatch)", FrustumTestVisible, AabbBatch::kCapacity);
+
+} // namespace ITP485
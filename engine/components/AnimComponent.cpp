@@ -7,6 +7,19 @@
 namespace ITP485
 {
 
+namespace
+{
+
+// Negates the z axis, used to put the reflection back on mirrored joints
+float s_MirrorZ[3][4] =
+{
+	{ 1.0f, 0.0f, 0.0f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f, 0.0f },
+	{ 0.0f, 0.0f, -1.0f, 0.0f },
+};
+
+} // anonymous namespace
+
 AnimComponent::AnimComponent( const char* szFileName )
 : m_Palette(nullptr)
 {
@@ -14,6 +27,20 @@ AnimComponent::AnimComponent( const char* szFileName )
 	InitializeData();
 }
 
+// Takes other's arrays, and leaves it with nothing to delete
+AnimComponent::AnimComponent(AnimComponent&& other)
+: m_Skeleton(other.m_Skeleton)
+, m_Pose(other.m_Pose)
+, m_CurrAnimation(std::move(other.m_CurrAnimation))
+, m_Palette(other.m_Palette)
+{
+	other.m_Skeleton = Skeleton();
+	other.m_Skeleton.m_iNumJoints = 0;
+	other.m_Pose = SkeletonPose();
+	other.m_CurrAnimation.m_pKeyFrames = nullptr;
+	other.m_Palette = nullptr;
+}
+
 void AnimComponent::InitializeData()
 {
 	// Error check.
@@ -21,37 +48,27 @@ void AnimComponent::InitializeData()
 
 	// Calculate the inverse bind pose matrix for each joint.
 	// For the first joint (root), we just invert local pose.
-	m_Skeleton.m_pJoints[0].inv_bindPose = m_Skeleton.m_pJoints[0].localPose;
+	m_Skeleton.m_pInvBindPoses[0] = m_Skeleton.m_pJoints[0].localPose;
 	// For every other joint, we multiply up the chain.
 	for (short i = 1; i < m_Skeleton.m_iNumJoints; ++i)
 	{
-		m_Skeleton.m_pJoints[i].inv_bindPose = m_Skeleton.m_pJoints[m_Skeleton.m_pJoints[i].m_ParentIndex].inv_bindPose;
-		m_Skeleton.m_pJoints[i].inv_bindPose.Multiply(m_Skeleton.m_pJoints[i].localPose);
-	}
-	// Do all inversions at the end.
-	for (short i = 0; i < m_Skeleton.m_iNumJoints; ++i)
-	{
-		m_Skeleton.m_pJoints[i].inv_bindPose.Invert();
+		m_Skeleton.m_pInvBindPoses[i] = m_Skeleton.m_pInvBindPoses[m_Skeleton.m_pJoints[i].m_ParentIndex];
+		m_Skeleton.m_pInvBindPoses[i].Multiply(m_Skeleton.m_pJoints[i].localPose);
 	}
+	// Do all inversions at the end, several joints at a time.
+	Affine3x4::InvertMany(m_Skeleton.m_pInvBindPoses, m_Skeleton.m_pInvBindPoses, m_Skeleton.m_iNumJoints);
 
 	// Set up the initial pose.
 	for (short i = 0; i < m_Skeleton.m_iNumJoints; ++i)
 	{
-		m_Pose.m_pPoses[i].localPose = m_CurrAnimation.m_pKeyFrames[i][0].localPose;
+		KeyFrame* first = m_CurrAnimation.m_pKeyFrames[i];
+		m_Pose.m_pRotations[i] = first->m_Rotation;
+		m_Pose.m_pTranslations[i] = first->m_Translation;
+		m_Pose.m_pMirrored[i] = first->m_bMirrored;
 	}
 
 	// Set up the matrix pallette.
-	m_Palette[0] = m_Pose.m_pPoses[0].localPose;
-	for (short i = 1; i < m_Skeleton.m_iNumJoints; ++i)
-	{
-		m_Palette[i] = m_Palette[m_Skeleton.m_pJoints[i].m_ParentIndex];
-		m_Palette[i].Multiply(m_Pose.m_pPoses[i].localPose);
-	}
-	// Multiply by inverse bind pose at the end.
-	for (short i = 0; i < m_Skeleton.m_iNumJoints; ++i)
-	{
-		m_Palette[i].Multiply(m_Skeleton.m_pJoints[i].inv_bindPose);
-	}
+	CalculatePalette();
 }
 
 AnimComponent::~AnimComponent()
@@ -70,15 +87,29 @@ AnimComponent::~AnimComponent()
 	}
 	delete[] m_CurrAnimation.m_pKeyFrames;
 
+	_aligned_free(m_Skeleton.m_pInvBindPoses);
 	_aligned_free(m_Palette);
+
+	_aligned_free(m_Pose.m_pRotations);
+	_aligned_free(m_Pose.m_pNextRotations);
+	_aligned_free(m_Pose.m_pTranslations);
+	delete[] m_Pose.m_pBlend;
+	delete[] m_Pose.m_pMirrored;
 }
 
 void AnimComponent::CalculatePose(short joint, KeyFrame* frame1, KeyFrame* frame2)
 {
-	// Local current pose matrix for that joint.
+	// Rotations are slerped in Update, so just store both ends and the blend.
+	m_Pose.m_pRotations[joint] = frame1->m_Rotation;
+	m_Pose.m_pNextRotations[joint] = frame2->m_Rotation;
+	// Both keys have the same flag, Parse asserts it once per track, so the
+	// slerp never has to blend a mirrored rotation with an unmirrored one.
+	m_Pose.m_pMirrored[joint] = frame1->m_bMirrored;
+
 	if (frame1 == frame2)
 	{
-		m_Pose.m_pPoses[joint].localPose = frame1->localPose;
+		m_Pose.m_pBlend[joint] = 0.0f;
+		m_Pose.m_pTranslations[joint] = frame1->m_Translation;
 	}
 	else
 	{
@@ -96,24 +127,42 @@ void AnimComponent::CalculatePose(short joint, KeyFrame* frame1, KeyFrame* frame
 			time2 = float(frame2->m_FrameNum) / 24.0f;
 		}
 
-		m_Pose.m_pPoses[joint].localPose = Lerp(
-			frame1->localPose,
-			frame2->localPose,
-			((m_CurrAnimation.m_Time - time1) / (time2 - time1)));
+		float blend = (m_CurrAnimation.m_Time - time1) / (time2 - time1);
+		m_Pose.m_pBlend[joint] = blend;
+		m_Pose.m_pTranslations[joint] = Lerp(frame1->m_Translation, frame2->m_Translation, blend);
 	}
+}
+
+void AnimComponent::CalculatePalette()
+{
+	static const Affine3x4 mirror(s_MirrorZ);
 
 	// Update matrix palette with global current pose.
-	if (m_Skeleton.m_pJoints[joint].m_ParentIndex == -1)
-	{
-		m_Palette[joint] = m_Pose.m_pPoses[joint].localPose;
-	}
-	else
+	// Parents always come before their children, so one pass is enough.
+	for (short i = 0; i < m_Skeleton.m_iNumJoints; ++i)
 	{
-		m_Palette[joint] = m_Palette[m_Skeleton.m_pJoints[joint].m_ParentIndex];
-		m_Palette[joint].Multiply(m_Pose.m_pPoses[joint].localPose);
+		Affine3x4 localPose;
+		localPose.CreateFromQuaternion(m_Pose.m_pRotations[i], m_Pose.m_pTranslations[i]);
+		if (m_Pose.m_pMirrored[i])
+		{
+			localPose.Multiply(mirror);
+		}
+
+		short parent = m_Skeleton.m_pJoints[i].m_ParentIndex;
+		if (parent == -1)
+		{
+			m_Palette[i] = localPose;
+		}
+		else
+		{
+			m_Palette[i] = m_Palette[parent];
+			m_Palette[i].Multiply(localPose);
+		}
 	}
 
-	// Multiply by inverse bind pose at the very end, after all joints are calculated.
+	// Multiply matrix palette by each inverse bind pose.
+	// Every joint is independent here, so this goes through the batch kernel.
+	Affine3x4::MultiplyBatch(m_Palette, m_Skeleton.m_pInvBindPoses, m_Palette, m_Skeleton.m_iNumJoints);
 }
 
 void AnimComponent::Update( float fDelta )
@@ -155,17 +204,20 @@ void AnimComponent::Update( float fDelta )
 		}
 	}
 
-	// Multiply matrix palette by each inverse bind pose.
-	for (short i = 0; i < m_Skeleton.m_iNumJoints; ++i)
-	{
-		m_Palette[i].Multiply(m_Skeleton.m_pJoints[i].inv_bindPose);
-	}
+	// Interpolate the rotation of every joint at once.
+	Quaternion::SlerpBatch(m_Pose.m_pRotations, m_Pose.m_pNextRotations, m_Pose.m_pBlend,
+						   m_Pose.m_pRotations, m_Skeleton.m_iNumJoints);
+
+	CalculatePalette();
 }
 
 // Set the matrix palette.
 void AnimComponent::StoreMatrixPalette( ID3DXEffect* pEffect )
 {
-	pEffect->SetMatrixArray("gPalette", static_cast<D3DXMATRIX*>(m_Palette->ToD3D()), 32);
+	// gPalette is row_major float3x4, so the transforms go up as-is, 12 floats each.
+	// Never more than the shader's array holds, Parse asserts on bigger skeletons.
+	int numJoints = (m_Skeleton.m_iNumJoints < MAX_PALETTE_JOINTS) ? m_Skeleton.m_iNumJoints : MAX_PALETTE_JOINTS;
+	pEffect->SetFloatArray("gPalette", m_Palette->ToFloats(), 12 * numJoints);
 }
 
 void AnimComponent::Parse( const char* szFileName )
@@ -189,14 +241,26 @@ void AnimComponent::Parse( const char* szFileName )
 			// Initialize the bones array
 			strValue = child->GetAttribute("count");
 			m_Skeleton.m_iNumJoints = atoi(strValue.c_str());
+			Dbg_Assert(m_Skeleton.m_iNumJoints <= MAX_PALETTE_JOINTS, "Skeleton has more joints than gPalette in skinned.fx holds.");
 			m_Skeleton.m_pJoints = new Joint[m_Skeleton.m_iNumJoints];
 
 			// Skeleton pose
-			m_Pose.m_pPoses = new JointPose[m_Skeleton.m_iNumJoints];
+			void* buf = _aligned_malloc(sizeof(Quaternion) * m_Skeleton.m_iNumJoints, 16);
+			m_Pose.m_pRotations = new (buf) Quaternion[m_Skeleton.m_iNumJoints];
+			buf = _aligned_malloc(sizeof(Quaternion) * m_Skeleton.m_iNumJoints, 16);
+			m_Pose.m_pNextRotations = new (buf) Quaternion[m_Skeleton.m_iNumJoints];
+			buf = _aligned_malloc(sizeof(Vector3) * m_Skeleton.m_iNumJoints, 16);
+			m_Pose.m_pTranslations = new (buf) Vector3[m_Skeleton.m_iNumJoints];
+			m_Pose.m_pBlend = new float[m_Skeleton.m_iNumJoints];
+			m_Pose.m_pMirrored = new bool[m_Skeleton.m_iNumJoints];
+
+			// Inverse bind poses
+			buf = _aligned_malloc(sizeof(Affine3x4) * m_Skeleton.m_iNumJoints, 16);
+			m_Skeleton.m_pInvBindPoses = new (buf) Affine3x4[m_Skeleton.m_iNumJoints];
 
 			// Matrix palette
-			void* buf = _aligned_malloc(sizeof(Matrix4) * m_Skeleton.m_iNumJoints, 16);
-			m_Palette = new (buf) Matrix4[m_Skeleton.m_iNumJoints];
+			buf = _aligned_malloc(sizeof(Affine3x4) * m_Skeleton.m_iNumJoints, 16);
+			m_Palette = new (buf) Affine3x4[m_Skeleton.m_iNumJoints];
 
 			// Now get every joint
 			ticpp::Iterator<ticpp::Element> joint;
@@ -290,10 +354,21 @@ void AnimComponent::Parse( const char* szFileName )
 									&mat[1][0], &mat[1][1], &mat[1][2], &mat[1][3],
 									&mat[2][0], &mat[2][1], &mat[2][2], &mat[2][3],
 									&mat[3][0], &mat[3][1], &mat[3][2], &mat[3][3]);
-								CurrKey->localPose.Set(mat);
+								// Split the matrix into rotation and translation so
+								// the rotations can be slerped. Decompose puts a
+								// reflection in scale.z, and the keys don't keep scale.
+								Affine3x4 pose;
+								pose.Set(mat);
+								Vector3 scale;
+								pose.Decompose(CurrKey->m_Translation, CurrKey->m_Rotation, scale);
+								CurrKey->m_bMirrored = (scale.GetZ() < 0.0f);
 							}
 						}
 
+						// CalculatePose only keeps one flag per joint, so a track can't switch.
+						Dbg_Assert(PrevKey == nullptr || PrevKey->m_bMirrored == CurrKey->m_bMirrored,
+							"Joint track switches between mirrored and unmirrored keys.");
+
 						PrevKey = CurrKey;
 					}
 				}
@@ -3,6 +3,8 @@
 
 #include "../core/math.h"
 #include "../core/poolalloc.h"
+#include "../core/smallalloc.h"
+#include "../core/slotmap.h"
 #include <string>
 
 struct ID3DXEffect;
@@ -13,14 +15,15 @@ namespace ITP485
 // Maximum joints
 const int MAX_JOINTS = 64;
 
+// Size of the gPalette array in skinned.fx, where it's MAX_PALETTE_JOINTS too.
+// Change both together. A skeleton can't have more joints than this.
+const int MAX_PALETTE_JOINTS = 32;
+
 // Joint structure
 struct Joint
 {
-	// inverse bind pose (global) matrix
-	Matrix4 inv_bindPose;
-
 	// local bind pose for this joint
-	Matrix4 localPose;
+	Affine3x4 localPose;
 
 	// Name of the joint
 	std::string m_Name;
@@ -28,15 +31,8 @@ struct Joint
 	// parent index or -1 if root
 	short m_ParentIndex;
 
-	// Overloads of array new/delete to ensure the array is 16-byte aligned
-	void* operator new[] (size_t size)
-	{
-		return _aligned_malloc(size, 16);
-	}
-	void operator delete[] (void* ptr)
-	{
-		_aligned_free(ptr);
-	}
+	// Joint arrays come from the small object allocator, which is 16-byte aligned
+	DECLARE_SMALL_OBJECT_NEW_DELETE();
 };
 
 // Skeleton structure
@@ -45,32 +41,45 @@ struct Skeleton
 	// Array of joints
 	Joint* m_pJoints;
 
+	// Inverse bind pose (global) matrix for each joint.
+	// Kept in its own contiguous array so it can be fed to Affine3x4::MultiplyBatch.
+	Affine3x4* m_pInvBindPoses;
+
 	// Number of joints
 	short m_iNumJoints;
 
 	Skeleton()
 	: m_pJoints(nullptr)
+	, m_pInvBindPoses(nullptr)
 	{
 
 	}
 };
 
-typedef PoolAllocator<80, 1024> KeyFramePool;
+typedef PoolAllocator<64, 1024> KeyFramePool;
 
 // Key Frame structure
 struct KeyFrame
 {
-	// Local pose at this joint at this keyframe
-	Matrix4 localPose;
+	// Local rotation at this joint at this keyframe
+	Quaternion m_Rotation;
+
+	// Local translation at this joint at this keyframe
+	Vector3 m_Translation;
 
 	// Frame number where this occurs
 	int m_FrameNum;
 
+	// True if the key's matrix had a reflection. A quaternion can't hold one,
+	// so m_Rotation has the z axis flipped back and the pose flips it again.
+	bool m_bMirrored;
+
 	// Next key frame (if any)
 	KeyFrame* m_Next;
 
 	KeyFrame()
-	: m_Next(nullptr)
+	: m_bMirrored(false)
+	, m_Next(nullptr)
 	{
 
 	}
@@ -105,42 +114,49 @@ struct Animation
 	}
 };
 
-// For calculating the current pose
-struct JointPose
+// Skeleton's current pose.
+// Each channel has its own array, so every joint's rotation can be
+// interpolated with one call to Quaternion::SlerpBatch.
+struct SkeletonPose
 {
-	// local pose for this joint
-	Matrix4 localPose;
+	// Rotation of each joint. Holds the first key frame's rotation until
+	// the batch slerp overwrites it.
+	Quaternion* m_pRotations;
 
-	// Overloads of array new/delete to ensure the array is 16-byte aligned
-	void* operator new[] (size_t size)
-	{
-		return _aligned_malloc(size, 16);
-	}
-	void operator delete[] (void* ptr)
-	{
-		_aligned_free(ptr);
-	}
-};
+	// Rotation of the second key frame for each joint
+	Quaternion* m_pNextRotations;
 
-// Skeleton's current pose
-struct SkeletonPose
-{
-	// Array of joint poses
-	JointPose* m_pPoses;
+	// How far each joint is between its two key frames
+	float* m_pBlend;
+
+	// Translation of each joint
+	Vector3* m_pTranslations;
+
+	// Whether each joint's pose needs to be mirrored (see KeyFrame)
+	bool* m_pMirrored;
 
 	SkeletonPose()
-	: m_pPoses(nullptr)
+	: m_pRotations(nullptr)
+	, m_pNextRotations(nullptr)
+	, m_pBlend(nullptr)
+	, m_pTranslations(nullptr)
+	, m_pMirrored(nullptr)
 	{
 
 	}
 };
 
+// AnimComponents live in GameWorld's slot map, use GameWorld's
+// CreateAnimComponent and DestroyAnimComponent instead of new and delete.
 class AnimComponent
 {
 public:
 	// Constructor takes the name of the anim file
 	AnimComponent(const char* szFileName);
 
+	// Takes other's arrays, the slot map uses this when it moves components
+	AnimComponent(AnimComponent&& other);
+
 	// Destructor
 	~AnimComponent();
 
@@ -162,7 +178,7 @@ private:
 	Animation m_CurrAnimation;
 
 	// Matrix palette (array) for this anim component
-	Matrix4* m_Palette;
+	Affine3x4* m_Palette;
 
 	// Initialize the animation data as needed
 	void InitializeData();
@@ -170,8 +186,16 @@ private:
 	// Parses in the file information
 	void Parse(const char* szFileName);
 
-	// Helper function to calculate the pose given two frames.
+	// Helper function to set up the pose given two frames.
+	// The rotations are interpolated later, all joints at once.
 	void CalculatePose(short joint, KeyFrame* frame1, KeyFrame* frame2);
+
+	// Builds the matrix palette from the current pose
+	void CalculatePalette();
+
+	// Not copyable, the arrays would be deleted twice
+	AnimComponent(const AnimComponent&);
+	AnimComponent& operator=(const AnimComponent&);
 };
 
 } // end namespace
@@ -1,8 +1,8 @@
 #include "MeshComponent.h"
 #include "AnimComponent.h"
 #include "../graphics/MeshManager.h"
-#include "../graphics/GraphicsDevice.h"
 #include "../graphics/MeshData.h"
+#include "../game/GameWorld.h"
 
 namespace ITP485
 {
@@ -11,18 +11,33 @@ namespace ITP485
 // It will then request MeshData from the MeshManager, and save off that pointer.
 // It also should set the WorldTransform matrix to Matrix4::Identity.
 // Sets m_bIsVisible to true.
-// Once the MeshComponent is ready, it should add itself to the GraphicsDevice's
-// MeshComponentSet.
 MeshComponent::MeshComponent(const char* szFileName)
 {
 	m_pMeshData = MeshManager::get().GetMeshData(szFileName);
-	m_pAnimComponent = nullptr;
-	m_WorldTransform = Matrix4::Identity;
+	m_WorldTransform = Affine3x4::Identity;
 	m_Quaternion = Quaternion::Identity;
 	m_TranslationVector = Vector3::Zero;
 	m_Scale = 1.0f;
 	m_bIsVisible = true;
-	GraphicsDevice::get().m_MeshComponentSet.insert(this);
+}
+
+// Rebuilds m_WorldTransform from the translation, rotation and scale.
+void MeshComponent::UpdateWorldTransform()
+{
+	Affine3x4 tempMatrix;
+	m_WorldTransform.CreateTranslation(m_TranslationVector);
+	tempMatrix.CreateFromQuaternion(m_Quaternion);
+	m_WorldTransform.Multiply(tempMatrix);
+	tempMatrix.CreateScale(m_Scale);
+	m_WorldTransform.Multiply(tempMatrix);
+}
+
+// Returns the world space box around the mesh
+Aabb MeshComponent::GetWorldBounds() const
+{
+	Aabb bounds = m_pMeshData->GetBounds();
+	bounds.Transform(m_WorldTransform.ToFloats());
+	return bounds;
 }
 
 // Makes the appropriate Direct3D calls to Draw this MeshComponent
@@ -31,27 +46,20 @@ void MeshComponent::Draw()
 {
 	if (m_bIsVisible)
 	{
-		Matrix4 tempMatrix;
-		m_WorldTransform.CreateTranslation(m_TranslationVector);
-		tempMatrix.CreateFromQuaternion(m_Quaternion);
-		m_WorldTransform.Multiply(tempMatrix);
-		tempMatrix.CreateScale(m_Scale);
-		m_WorldTransform.Multiply(tempMatrix);
-
-		m_pEffectData->SetMatrix("gWorld", static_cast<D3DXMATRIX*>(m_WorldTransform.ToD3D()));
+		// gWorld is a float4x4 in every effect, so expand it for the upload
+		Matrix4 world;
+		m_WorldTransform.ToMatrix4(world);
+		D3DXMATRIX d3dWorld;
+		world.StoreD3D(d3dWorld);
+		m_pEffectData->SetMatrix("gWorld", &d3dWorld);
 		D3DXHANDLE hTechnique = m_pEffectData->GetTechniqueByName("DefaultTechnique");
-		if (m_pAnimComponent != nullptr)
+		AnimComponent* pAnimComponent = GameWorld::get().GetAnimComponent(m_AnimComponent);
+		if (pAnimComponent != nullptr)
 		{
-			m_pAnimComponent->StoreMatrixPalette(m_pEffectData);
+			pAnimComponent->StoreMatrixPalette(m_pEffectData);
 		}
 		m_pMeshData->Draw(m_pEffectData, hTechnique);
 	}
 }
 
-// Removes this MeshComponent from GraphicsDevice's MeshComponentSet
-MeshComponent::~MeshComponent()
-{
-	GraphicsDevice::get().m_MeshComponentSet.erase(this);
-}
-
 }
@@ -1,40 +1,45 @@
 // The mesh component is used by any game objects which have a renderable mesh.
 #ifndef _MESHCOMPONENT_H_
 #define _MESHCOMPONENT_H_
-#include "../core/poolalloc.h"
 #include "../core/math.h"
+#include "../core/bounds.h"
+#include "../core/slotmap.h"
 #include <d3dx9effect.h>
 
 namespace ITP485
 {
 
-typedef PoolAllocator<128, 1024> MeshComponentPool;
 struct MeshData;
 class AnimComponent;
 
+// MeshComponents live in GraphicsDevice's slot map, use GraphicsDevice's
+// CreateMeshComponent and DestroyMeshComponent instead of new and delete.
 class MeshComponent
 {
 public:
-	// This ensures that we use the mesh component pool on new/delete
-	DECLARE_POOL_NEW_DELETE(MeshComponentPool);
-
 	// Constructor takes the filename of the mesh.
 	// It will then request MeshData from the MeshManager, and save off that pointer.
 	// It also should set the WorldTransform matrix to Matrix4::Identity.
 	// Sets m_bIsVisible to true.
-	// Once the MeshComponent is ready, it should add itself to the GraphicsDevice's
-	// MeshComponentSet.
 	MeshComponent(const char* szFileName);
 
+	// Rebuilds m_WorldTransform from the translation, rotation and scale.
+	// GraphicsDevice calls this every frame before culling and drawing.
+	void UpdateWorldTransform();
+
+	// Returns the world space box around the mesh, from the mesh's bounds
+	// and m_WorldTransform
+	Aabb GetWorldBounds() const;
+
+	// Skinned meshes only have bounds for the bind pose, so they're never culled
+	bool IsCullable() const { return m_AnimComponent.IsNull(); }
+
 	// Makes the appropriate Direct3D calls to Draw this MeshComponent
-	// if m_bIsVisible is true.
+	// if m_bIsVisible is true. Uses the last m_WorldTransform from UpdateWorldTransform.
 	void Draw();
 
-	// Removes this MeshComponent from GraphicsDevice's MeshComponentSet
-	~MeshComponent();
-
 	// Returns m_WorldTransform by reference, so you can modify it.
-	Matrix4& GetWorldTransform() { return m_WorldTransform; }
+	Affine3x4& GetWorldTransform() { return m_WorldTransform; }
 
 	// Returns m_Quaternion by reference, so you can modify it.
 	Quaternion& GetQuaternion() { return m_Quaternion; }
@@ -45,7 +50,7 @@ public:
 	LPD3DXEFFECT GetEffectData() const { return m_pEffectData; }
 	void SetEffectData(LPD3DXEFFECT value) { m_pEffectData = value; }
 
-	void SetAnimComponent(AnimComponent* anim) { m_pAnimComponent = anim; }
+	void SetAnimComponent(SlotHandle<AnimComponent> anim) { m_AnimComponent = anim; }
 
 	float GetScale() const { return m_Scale; }
 	void SetScale(float value) { m_Scale = value; }
@@ -57,15 +62,15 @@ private:
 	// Disallow default constructor
 	MeshComponent() { }
 	// World Transform Matrix
-	Matrix4 m_WorldTransform;
+	Affine3x4 m_WorldTransform;
 	// Quaternion (for rotation)
 	Quaternion m_Quaternion;
 	// Vector3 (for translation)
 	Vector3 m_TranslationVector;
 	// Our particular model information
 	MeshData* m_pMeshData;
-	// Our animation information
-	AnimComponent* m_pAnimComponent;
+	// Our animation information, in GameWorld's AnimComponents
+	SlotHandle<AnimComponent> m_AnimComponent;
 	// Our effect information
 	LPD3DXEFFECT m_pEffectData;
 	// float (for uniform scale)
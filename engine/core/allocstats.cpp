@@ -0,0 +1,212 @@
+// allocstats.cpp implements the allocator stats registry and its reports
+#include "allocstats.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <chrono>
+#include <cstdio>
+#endif
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace ITP485
+{
+
+namespace
+{
+
+// Most live blocks listed for one pool, the rest are only counted
+const unsigned int kMaxLiveBlocksListed = 32;
+
+// What ReportLiveBlocks passes to its LiveBlockCallback
+struct LiveBlockReport
+{
+	std::ostringstream m_Text;
+	unsigned int m_NumBlocks;
+};
+
+void ListLiveBlock(void* pUser, const void* ptr, unsigned long long allocId, double age)
+{
+	LiveBlockReport* pReport = static_cast<LiveBlockReport*>(pUser);
+	if (pReport->m_NumBlocks++ < kMaxLiveBlocksListed)
+	{
+		pReport->m_Text << "    " << ptr << "  allocation #" << allocId
+			<< ", allocated " << std::fixed << std::setprecision(3) << age << "s ago\n";
+	}
+}
+
+void WriteName(std::ostream& out, const PoolStats& stats)
+{
+	if (stats.m_szName)
+	{
+		out << stats.m_szName;
+	}
+	else
+	{
+		out << "Pool of " << stats.m_BlockSize << " byte blocks";
+	}
+}
+
+} // anonymous namespace
+
+#ifdef _WIN32
+unsigned long long GetAllocStatsTicks()
+{
+	LARGE_INTEGER ticks;
+	QueryPerformanceCounter(&ticks);
+	return ticks.QuadPart;
+}
+
+double GetAllocStatsTicksPerSecond()
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return double(frequency.QuadPart);
+}
+#else
+unsigned long long GetAllocStatsTicks()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double GetAllocStatsTicksPerSecond()
+{
+	return 1.0e9;
+}
+#endif // _WIN32
+
+// Sets everything back to 0
+void PoolCounters::Reset()
+{
+	m_BlocksInUse = 0;
+	m_PeakBlocksInUse = 0;
+	m_NumAllocs = 0;
+	m_NumFrees = 0;
+	m_NumFailed = 0;
+	m_LifetimeTicks = 0;
+}
+
+// Copies the counters into stats
+void PoolCounters::Fill(PoolStats& stats) const
+{
+	stats.m_BlocksInUse = m_BlocksInUse.load(std::memory_order_relaxed);
+	stats.m_PeakBlocksInUse = m_PeakBlocksInUse.load(std::memory_order_relaxed);
+	stats.m_NumAllocs = m_NumAllocs.load(std::memory_order_relaxed);
+	stats.m_NumFrees = m_NumFrees.load(std::memory_order_relaxed);
+	stats.m_NumFailed = m_NumFailed.load(std::memory_order_relaxed);
+
+	unsigned long long lifetimeTicks = m_LifetimeTicks.load(std::memory_order_relaxed);
+	stats.m_AverageLifetime = (stats.m_NumFrees > 0) ?
+		double(lifetimeTicks) / double(stats.m_NumFrees) / GetAllocStatsTicksPerSecond() : 0.0;
+}
+
+void AllocStatsRegistry::Register(PoolStatsSource* pSource)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (std::find(m_Sources.begin(), m_Sources.end(), pSource) == m_Sources.end())
+	{
+		m_Sources.push_back(pSource);
+	}
+}
+
+void AllocStatsRegistry::Unregister(PoolStatsSource* pSource)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Sources.erase(std::remove(m_Sources.begin(), m_Sources.end(), pSource), m_Sources.end());
+}
+
+unsigned int AllocStatsRegistry::GetNumPools()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return static_cast<unsigned int>(m_Sources.size());
+}
+
+bool AllocStatsRegistry::GetPoolStats(unsigned int index, PoolStats& stats)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (index >= m_Sources.size())
+	{
+		return false;
+	}
+	m_Sources[index]->GetStats(stats);
+	return true;
+}
+
+// Writes a table with a line for every registered pool into report
+void AllocStatsRegistry::GetReport(std::string& report)
+{
+	std::ostringstream out;
+#if ALLOC_STATS
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	out << "Pool                        Block  Blocks  In use    Peak      Allocs       Frees  Failed  Avg life (s)\n";
+	for (size_t i = 0; i < m_Sources.size(); ++i)
+	{
+		PoolStats stats;
+		m_Sources[i]->GetStats(stats);
+
+		std::ostringstream name;
+		WriteName(name, stats);
+		out << std::left << std::setw(26) << name.str().substr(0, 26) << std::right
+			<< std::setw(7) << stats.m_BlockSize
+			<< std::setw(8) << stats.m_NumBlocks
+			<< std::setw(8) << stats.m_BlocksInUse
+			<< std::setw(8) << stats.m_PeakBlocksInUse
+			<< std::setw(12) << stats.m_NumAllocs
+			<< std::setw(12) << stats.m_NumFrees
+			<< std::setw(8) << stats.m_NumFailed
+			<< std::setw(14) << std::fixed << std::setprecision(3) << stats.m_AverageLifetime << "\n";
+	}
+	out << m_Sources.size() << " pools\n";
+#else
+	out << "Allocator stats are off, build with ALLOC_STATS 1 to turn them on.\n";
+#endif
+	report = out.str();
+}
+
+// Writes the report to the debugger output (stderr outside of Windows)
+void AllocStatsRegistry::Dump()
+{
+	std::string report;
+	GetReport(report);
+	Output(report);
+}
+
+// Writes every block pSource still has allocated to the debugger output
+unsigned int AllocStatsRegistry::ReportLiveBlocks(PoolStatsSource* pSource)
+{
+	PoolStats stats;
+	pSource->GetStats(stats);
+	if (stats.m_BlocksInUse == 0)
+	{
+		return 0;
+	}
+
+	LiveBlockReport report;
+	report.m_NumBlocks = 0;
+	pSource->ForEachLiveBlock(ListLiveBlock, &report);
+
+	std::ostringstream out;
+	WriteName(out, stats);
+	out << " shut down with " << report.m_NumBlocks << " blocks still allocated:\n" << report.m_Text.str();
+	if (report.m_NumBlocks > kMaxLiveBlocksListed)
+	{
+		out << "    ... and " << (report.m_NumBlocks - kMaxLiveBlocksListed) << " more\n";
+	}
+	Output(out.str());
+	return report.m_NumBlocks;
+}
+
+// Writes text to the debugger output (stderr outside of Windows)
+void AllocStatsRegistry::Output(const std::string& text)
+{
+#ifdef _WIN32
+	OutputDebugStringA(text.c_str());
+#else
+	fputs(text.c_str(), stderr);
+#endif
+}
+
+} // namespace ITP485
@@ -0,0 +1,169 @@
+// Defines allocator telemetry. With ALLOC_STATS on, every PoolAllocator
+// counts how it's used and registers itself with AllocStatsRegistry, so the
+// game can dump a table of every pool while it runs, and pools report the
+// blocks that are still allocated when they shut down.
+#ifndef _ALLOCSTATS_H_
+#define _ALLOCSTATS_H_
+#include "singleton.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ALLOC_STATS is on in debug builds by default. Define it to 0 or 1 to choose.
+// When it's off the pools have no counters at all, not even a branch.
+#ifndef ALLOC_STATS
+#ifdef _DEBUG
+#define ALLOC_STATS 1
+#else
+#define ALLOC_STATS 0
+#endif
+#endif
+
+namespace ITP485
+{
+
+// Returns the current time in ticks, for block lifetimes
+unsigned long long GetAllocStatsTicks();
+
+// Returns the number of ticks in a second
+double GetAllocStatsTicksPerSecond();
+
+// A copy of one pool's stats, from PoolStatsSource::GetStats
+struct PoolStats
+{
+	// Name from SetStatsName, or 0
+	const char* m_szName;
+	size_t m_BlockSize;
+	// Blocks in all the pool's chunks
+	unsigned int m_NumBlocks;
+	unsigned int m_BlocksInUse;
+	// Most blocks that were in use at once since StartUp
+	unsigned int m_PeakBlocksInUse;
+	unsigned long long m_NumAllocs;
+	unsigned long long m_NumFrees;
+	// Allocates that returned 0, because the pool was at its cap or size was too big
+	unsigned long long m_NumFailed;
+	// Average time between Allocate and Free of the blocks freed so far, in seconds
+	double m_AverageLifetime;
+};
+
+// Called for every block still allocated. allocId is the block's allocation
+// number in its pool (1 for the first Allocate after StartUp), age is in seconds.
+typedef void (*LiveBlockCallback)(void* pUser, const void* ptr, unsigned long long allocId, double age);
+
+// Counters a pool updates on every Allocate and Free. They're atomic so a pool
+// shared between threads counts correctly too.
+class PoolCounters
+{
+public:
+	PoolCounters() { Reset(); }
+
+	// Sets everything back to 0
+	void Reset();
+
+	// Counts an allocation, and returns its allocation number
+	unsigned long long OnAllocate()
+	{
+		unsigned int inUse = m_BlocksInUse.fetch_add(1, std::memory_order_relaxed) + 1;
+		unsigned int peak = m_PeakBlocksInUse.load(std::memory_order_relaxed);
+		while (inUse > peak && !m_PeakBlocksInUse.compare_exchange_weak(peak, inUse, std::memory_order_relaxed)) {}
+		return m_NumAllocs.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	// Counts a free of a block that was allocated for lifetimeTicks
+	void OnFree(unsigned long long lifetimeTicks)
+	{
+		m_BlocksInUse.fetch_sub(1, std::memory_order_relaxed);
+		m_NumFrees.fetch_add(1, std::memory_order_relaxed);
+		m_LifetimeTicks.fetch_add(lifetimeTicks, std::memory_order_relaxed);
+	}
+
+	// Counts an Allocate that returned 0
+	void OnFailed() { m_NumFailed.fetch_add(1, std::memory_order_relaxed); }
+
+	// Copies the counters into stats
+	void Fill(PoolStats& stats) const;
+
+private:
+	std::atomic<unsigned int> m_BlocksInUse;
+	std::atomic<unsigned int> m_PeakBlocksInUse;
+	std::atomic<unsigned long long> m_NumAllocs;
+	std::atomic<unsigned long long> m_NumFrees;
+	std::atomic<unsigned long long> m_NumFailed;
+	// Sum of the lifetimes of every freed block
+	std::atomic<unsigned long long> m_LifetimeTicks;
+};
+
+// What the registry knows about a pool. PoolAllocator implements it when
+// ALLOC_STATS is on.
+class PoolStatsSource
+{
+public:
+	// Names the pool in reports. szName must outlive the pool.
+	void SetStatsName(const char* szName) { m_szStatsName = szName; }
+
+	// Fills stats with the pool's current numbers
+	virtual void GetStats(PoolStats& stats) = 0;
+
+	// Calls callback for every block that's allocated, in chunk order.
+	// Other threads must not be using the pool at the same time.
+	virtual void ForEachLiveBlock(LiveBlockCallback callback, void* pUser) = 0;
+
+protected:
+	PoolStatsSource() : m_szStatsName(0) {}
+	~PoolStatsSource() {}
+
+	const char* m_szStatsName;
+	PoolCounters m_Counters;
+};
+
+#if ALLOC_STATS
+typedef PoolStatsSource PoolStatsBase;
+#else
+// Without stats a pool only keeps the name setter, so calls to it still compile
+class PoolStatsBase
+{
+public:
+	void SetStatsName(const char*) {}
+};
+#endif
+
+// AllocStatsRegistry keeps track of every pool that's started up, so their
+// stats can be looked up or dumped at any time. It's always there, but with
+// ALLOC_STATS off no pools register, and the report says so.
+class AllocStatsRegistry : public Singleton<AllocStatsRegistry>
+{
+	DECLARE_SINGLETON(AllocStatsRegistry);
+public:
+	// PoolAllocator::StartUp and ShutDown call these
+	void Register(PoolStatsSource* pSource);
+	void Unregister(PoolStatsSource* pSource);
+
+	// Returns the number of registered pools, and each one's stats
+	unsigned int GetNumPools();
+	bool GetPoolStats(unsigned int index, PoolStats& stats);
+
+	// Writes a table with a line for every registered pool into report
+	void GetReport(std::string& report);
+
+	// Writes the report to the debugger output (stderr outside of Windows)
+	void Dump();
+
+	// Writes every block pSource still has allocated to the debugger output,
+	// if there are any. Pools call this from ShutDown, it returns the number of blocks.
+	unsigned int ReportLiveBlocks(PoolStatsSource* pSource);
+
+	// Writes text to the debugger output (stderr outside of Windows)
+	static void Output(const std::string& text);
+
+protected:
+	AllocStatsRegistry() {}
+
+	std::vector<PoolStatsSource*> m_Sources;
+	std::mutex m_Mutex;
+};
+
+} // namespace ITP485
+
+#endif // _ALLOCSTATS_H_
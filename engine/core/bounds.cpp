@@ -0,0 +1,248 @@
+// bounds.cpp implements frustum extraction and the culling tests
+#include "bounds.h"
+#include "dbg_assert.h"
+#include <cmath>
+
+namespace ITP485
+{
+
+namespace
+{
+
+// Batch kernels. planes holds the 6 planes as 24 floats. cx, cy, cz are the
+// centers; for boxes ex, ey, ez are the half extents, for spheres ex is the
+// radius. Sets bit i of outside if bound i is outside any plane, and bit i of
+// inside if it's inside every plane.
+typedef void (*CullKernel)(const float* planes, const float* cx, const float* cy, const float* cz,
+						   const float* ex, const float* ey, const float* ez, int count,
+						   unsigned int& outside, unsigned int& inside);
+
+template <bool bSphere>
+void CullSSE2(const float* planes, const float* cx, const float* cy, const float* cz,
+			  const float* ex, const float* ey, const float* ez, int count,
+			  unsigned int& outside, unsigned int& inside)
+{
+	unsigned int outMask = 0;
+	unsigned int partialMask = 0;
+	for (int i = 0; i < count; i += 4)
+	{
+		__m128 x = _mm_load_ps(cx + i);
+		__m128 y = _mm_load_ps(cy + i);
+		__m128 z = _mm_load_ps(cz + i);
+		__m128 out = _mm_setzero_ps();
+		__m128 partial = _mm_setzero_ps();
+		for (int p = 0; p < Frustum::NUM_PLANES; ++p)
+		{
+			const float* plane = planes + p * 4;
+			__m128 d = _mm_add_ps(_mm_mul_ps(_mm_set_ps1(plane[0]), x), _mm_mul_ps(_mm_set_ps1(plane[1]), y));
+			d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(_mm_set_ps1(plane[2]), z), _mm_set_ps1(plane[3])));
+
+			// how far the bound reaches along the plane normal
+			__m128 r;
+			if (bSphere)
+			{
+				r = _mm_load_ps(ex + i);
+			}
+			else
+			{
+				r = _mm_mul_ps(_mm_set_ps1(fabsf(plane[0])), _mm_load_ps(ex + i));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set_ps1(fabsf(plane[1])), _mm_load_ps(ey + i)));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_set_ps1(fabsf(plane[2])), _mm_load_ps(ez + i)));
+			}
+
+			out = _mm_or_ps(out, _mm_cmplt_ps(d, _mm_sub_ps(_mm_setzero_ps(), r)));
+			partial = _mm_or_ps(partial, _mm_cmplt_ps(d, r));
+		}
+		outMask |= _mm_movemask_ps(out) << i;
+		partialMask |= _mm_movemask_ps(partial) << i;
+	}
+
+	unsigned int valid = (1u << count) - 1;
+	outside = outMask & valid;
+	inside = ~partialMask & valid;
+}
+
+template <bool bSphere>
+SIMD_TARGET_AVX2 void CullAVX2(const float* planes, const float* cx, const float* cy, const float* cz,
+							   const float* ex, const float* ey, const float* ez, int count,
+							   unsigned int& outside, unsigned int& inside)
+{
+	unsigned int outMask = 0;
+	unsigned int partialMask = 0;
+	for (int i = 0; i < count; i += 8)
+	{
+		__m256 x = _mm256_load_ps(cx + i);
+		__m256 y = _mm256_load_ps(cy + i);
+		__m256 z = _mm256_load_ps(cz + i);
+		__m256 out = _mm256_setzero_ps();
+		__m256 partial = _mm256_setzero_ps();
+		for (int p = 0; p < Frustum::NUM_PLANES; ++p)
+		{
+			const float* plane = planes + p * 4;
+			__m256 d = _mm256_fmadd_ps(_mm256_set1_ps(plane[0]), x, _mm256_set1_ps(plane[3]));
+			d = _mm256_fmadd_ps(_mm256_set1_ps(plane[1]), y, d);
+			d = _mm256_fmadd_ps(_mm256_set1_ps(plane[2]), z, d);
+
+			__m256 r;
+			if (bSphere)
+			{
+				r = _mm256_load_ps(ex + i);
+			}
+			else
+			{
+				r = _mm256_mul_ps(_mm256_set1_ps(fabsf(plane[0])), _mm256_load_ps(ex + i));
+				r = _mm256_fmadd_ps(_mm256_set1_ps(fabsf(plane[1])), _mm256_load_ps(ey + i), r);
+				r = _mm256_fmadd_ps(_mm256_set1_ps(fabsf(plane[2])), _mm256_load_ps(ez + i), r);
+			}
+
+			out = _mm256_or_ps(out, _mm256_cmp_ps(d, _mm256_sub_ps(_mm256_setzero_ps(), r), _CMP_LT_OQ));
+			partial = _mm256_or_ps(partial, _mm256_cmp_ps(d, r, _CMP_LT_OQ));
+		}
+		outMask |= _mm256_movemask_ps(out) << i;
+		partialMask |= _mm256_movemask_ps(partial) << i;
+	}
+
+	unsigned int valid = (1u << count) - 1;
+	outside = outMask & valid;
+	inside = ~partialMask & valid;
+}
+
+const CullKernel s_CullBoxKernels[SIMD_NUM_LEVELS] =
+{
+	CullSSE2<false>,
+	CullSSE2<false>,
+	CullAVX2<false>,
+};
+
+const CullKernel s_CullSphereKernels[SIMD_NUM_LEVELS] =
+{
+	CullSSE2<true>,
+	CullSSE2<true>,
+	CullAVX2<true>,
+};
+
+// Turns the masks from a kernel into one CullResult per bound
+void StoreResults(unsigned int outside, unsigned int inside, int count, CullResult* results)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		unsigned int bit = 1u << i;
+		if (outside & bit)
+		{
+			results[i] = CULL_OUTSIDE;
+		}
+		else if (inside & bit)
+		{
+			results[i] = CULL_INSIDE;
+		}
+		else
+		{
+			results[i] = CULL_INTERSECTING;
+		}
+	}
+}
+
+} // anonymous namespace
+
+void Frustum::Extract(const D3DMATRIX& viewProj)
+{
+	// Gribb/Hartmann: clip = M * v, and each clip space test (-w <= x <= w,
+	// -w <= y <= w, 0 <= z <= w) is a plane made from the rows of M.
+	__m128 row0 = _mm_loadu_ps(viewProj.m[0]);
+	__m128 row1 = _mm_loadu_ps(viewProj.m[1]);
+	__m128 row2 = _mm_loadu_ps(viewProj.m[2]);
+	__m128 row3 = _mm_loadu_ps(viewProj.m[3]);
+
+	_planes[PLANE_LEFT] = Plane(_mm_add_ps(row3, row0));
+	_planes[PLANE_RIGHT] = Plane(_mm_sub_ps(row3, row0));
+	_planes[PLANE_BOTTOM] = Plane(_mm_add_ps(row3, row1));
+	_planes[PLANE_TOP] = Plane(_mm_sub_ps(row3, row1));
+	_planes[PLANE_NEAR] = Plane(row2);
+	_planes[PLANE_FAR] = Plane(_mm_sub_ps(row3, row2));
+
+	for (int i = 0; i < NUM_PLANES; ++i)
+	{
+		_planes[i].Normalize();
+	}
+}
+
+CullResult Frustum::Classify(const Aabb& box) const
+{
+	const __m128 signMask = _mm_set_ps1(-0.0f);
+	// w = 1 so the dot product picks up the plane's d
+	__m128 center = SimdSetW(box._center, 1.0f);
+	CullResult result = CULL_INSIDE;
+	for (int i = 0; i < NUM_PLANES; ++i)
+	{
+		__m128 plane = _planes[i]._data;
+		float d = _mm_cvtss_f32(SimdDot4(plane, center));
+		float r = _mm_cvtss_f32(SimdDot3(_mm_andnot_ps(signMask, plane), box._extents));
+		if (d < -r)
+		{
+			return CULL_OUTSIDE;
+		}
+		if (d < r)
+		{
+			result = CULL_INTERSECTING;
+		}
+	}
+	return result;
+}
+
+CullResult Frustum::Classify(const Sphere& sphere) const
+{
+	__m128 center = SimdSetW(sphere._data, 1.0f);
+	float r = sphere.GetRadius();
+	CullResult result = CULL_INSIDE;
+	for (int i = 0; i < NUM_PLANES; ++i)
+	{
+		float d = _mm_cvtss_f32(SimdDot4(_planes[i]._data, center));
+		if (d < -r)
+		{
+			return CULL_OUTSIDE;
+		}
+		if (d < r)
+		{
+			result = CULL_INTERSECTING;
+		}
+	}
+	return result;
+}
+
+void Frustum::Classify(const AabbBatch& boxes, int count, CullResult* results) const
+{
+	Dbg_Assert(count <= AabbBatch::kCapacity, "Too many boxes for one batch.");
+	unsigned int outside, inside;
+	s_CullBoxKernels[GetSimdLevel()](reinterpret_cast<const float*>(_planes), boxes.centerX, boxes.centerY, boxes.centerZ,
+									 boxes.extentX, boxes.extentY, boxes.extentZ, count, outside, inside);
+	StoreResults(outside, inside, count, results);
+}
+
+void Frustum::Classify(const SphereBatch& spheres, int count, CullResult* results) const
+{
+	Dbg_Assert(count <= SphereBatch::kCapacity, "Too many spheres for one batch.");
+	unsigned int outside, inside;
+	s_CullSphereKernels[GetSimdLevel()](reinterpret_cast<const float*>(_planes), spheres.centerX, spheres.centerY, spheres.centerZ,
+										spheres.radius, nullptr, nullptr, count, outside, inside);
+	StoreResults(outside, inside, count, results);
+}
+
+unsigned int Frustum::TestVisible(const AabbBatch& boxes, int count) const
+{
+	Dbg_Assert(count <= AabbBatch::kCapacity, "Too many boxes for one batch.");
+	unsigned int outside, inside;
+	s_CullBoxKernels[GetSimdLevel()](reinterpret_cast<const float*>(_planes), boxes.centerX, boxes.centerY, boxes.centerZ,
+									 boxes.extentX, boxes.extentY, boxes.extentZ, count, outside, inside);
+	return ~outside & ((1u << count) - 1);
+}
+
+unsigned int Frustum::TestVisible(const SphereBatch& spheres, int count) const
+{
+	Dbg_Assert(count <= SphereBatch::kCapacity, "Too many spheres for one batch.");
+	unsigned int outside, inside;
+	s_CullSphereKernels[GetSimdLevel()](reinterpret_cast<const float*>(_planes), spheres.centerX, spheres.centerY, spheres.centerZ,
+										spheres.radius, nullptr, nullptr, count, outside, inside);
+	return ~outside & ((1u << count) - 1);
+}
+
+} // namespace ITP485
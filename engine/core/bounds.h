@@ -0,0 +1,265 @@
+// bounds.h defines the bounding volumes used for culling: axis aligned boxes,
+// spheres, planes and view frustums. Frustums can test one bound at a time, or
+// up to 16 bounds at once from a structure-of-arrays batch.
+//
+// These only depend on the SIMD layer, so they work with either math library.
+// Transforms and matrices are passed as raw floats (Affine3x4::ToFloats(),
+// Matrix4::StoreD3D()).
+#ifndef _BOUNDS_H_
+#define _BOUNDS_H_
+
+#include "simd.h"
+
+// D3DMATRIX for Frustum::Extract, the same fallback as fastmath.h and slowmath.h
+#ifndef D3DMATRIX_DEFINED
+typedef struct _D3DMATRIX {
+	union {
+		struct {
+			float        _11, _12, _13, _14;
+			float        _21, _22, _23, _24;
+			float        _31, _32, _33, _34;
+			float        _41, _42, _43, _44;
+
+		};
+		float m[4][4];
+	};
+} D3DMATRIX;
+#define D3DMATRIX_DEFINED
+#endif
+
+namespace ITP485
+{
+
+// Result of testing a bound against a frustum
+enum CullResult
+{
+	CULL_OUTSIDE = 0,
+	CULL_INTERSECTING,
+	CULL_INSIDE
+};
+
+// Axis aligned bounding box, stored as center and half extents
+class SIMD_ALIGN(16) Aabb
+{
+private:
+	__m128 _center;
+	__m128 _extents;
+public:
+	// Default constructor does nothing
+	__forceinline Aabb() {}
+
+	// Constructs the box from its min and max corners
+	__forceinline Aabb(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+	{
+		__m128 min = _mm_setr_ps(minX, minY, minZ, 0.0f);
+		__m128 max = _mm_setr_ps(maxX, maxY, maxZ, 0.0f);
+		const __m128 half = _mm_set_ps1(0.5f);
+		_center = _mm_mul_ps(_mm_add_ps(min, max), half);
+		_extents = _mm_mul_ps(_mm_sub_ps(max, min), half);
+	}
+
+	// Returns the requested component of the center
+	__forceinline float GetCenterX() const { return SimdGetX(_center); }
+	__forceinline float GetCenterY() const { return SimdGetY(_center); }
+	__forceinline float GetCenterZ() const { return SimdGetZ(_center); }
+
+	// Returns the requested component of the half extents
+	__forceinline float GetExtentX() const { return SimdGetX(_extents); }
+	__forceinline float GetExtentY() const { return SimdGetY(_extents); }
+	__forceinline float GetExtentZ() const { return SimdGetZ(_extents); }
+
+	// Transforms the box by the 3x4 row-major affine transform in rows
+	// (12 floats, e.g. Affine3x4::ToFloats()). The result is the box that
+	// encloses the transformed box, so it can only grow.
+	__forceinline void Transform(const float* rows)
+	{
+		__m128 col0 = _mm_loadu_ps(rows);
+		__m128 col1 = _mm_loadu_ps(rows + 4);
+		__m128 col2 = _mm_loadu_ps(rows + 8);
+		__m128 col3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+
+		__m128 x = _mm_shuffle_ps(_center, _center, _MM_SHUFFLE(0, 0, 0, 0));
+		__m128 y = _mm_shuffle_ps(_center, _center, _MM_SHUFFLE(1, 1, 1, 1));
+		__m128 z = _mm_shuffle_ps(_center, _center, _MM_SHUFFLE(2, 2, 2, 2));
+		__m128 center = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, x), _mm_mul_ps(col1, y)),
+								   _mm_add_ps(_mm_mul_ps(col2, z), col3));
+
+		// new extents = |M| * extents
+		const __m128 signMask = _mm_set_ps1(-0.0f);
+		x = _mm_shuffle_ps(_extents, _extents, _MM_SHUFFLE(0, 0, 0, 0));
+		y = _mm_shuffle_ps(_extents, _extents, _MM_SHUFFLE(1, 1, 1, 1));
+		z = _mm_shuffle_ps(_extents, _extents, _MM_SHUFFLE(2, 2, 2, 2));
+		_extents = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, col0), x),
+										 _mm_mul_ps(_mm_andnot_ps(signMask, col1), y)),
+							  _mm_mul_ps(_mm_andnot_ps(signMask, col2), z));
+		_center = center;
+	}
+
+	friend class Frustum;
+};
+
+// Bounding sphere, center in x, y, z and radius in w
+class SIMD_ALIGN(16) Sphere
+{
+private:
+	__m128 _data;
+public:
+	// Default constructor does nothing
+	__forceinline Sphere() {}
+
+	// Constructs the sphere given the center and radius
+	__forceinline Sphere(float x, float y, float z, float radius)
+	{
+		_data = _mm_setr_ps(x, y, z, radius);
+	}
+
+	__forceinline float GetCenterX() const { return SimdGetX(_data); }
+	__forceinline float GetCenterY() const { return SimdGetY(_data); }
+	__forceinline float GetCenterZ() const { return SimdGetZ(_data); }
+	__forceinline float GetRadius() const { return SimdGetW(_data); }
+
+	friend class Frustum;
+};
+
+// Plane a*x + b*y + c*z + d = 0, with (a, b, c) in x, y, z and d in w.
+// Points on the side the normal points to have a positive distance.
+class SIMD_ALIGN(16) Plane
+{
+private:
+	__m128 _data;
+public:
+	// Default constructor does nothing
+	__forceinline Plane() {}
+
+	// Constructs the plane given the coefficients
+	__forceinline Plane(float a, float b, float c, float d)
+	{
+		_data = _mm_setr_ps(a, b, c, d);
+	}
+
+	// Constructs the plane given an __m128
+	__forceinline Plane(__m128 value)
+	{
+		_data = value;
+	}
+
+	__forceinline float GetA() const { return SimdGetX(_data); }
+	__forceinline float GetB() const { return SimdGetY(_data); }
+	__forceinline float GetC() const { return SimdGetZ(_data); }
+	__forceinline float GetD() const { return SimdGetW(_data); }
+
+	// Scales the plane so the normal is unit length, which makes
+	// Distance return actual distances
+	__forceinline void Normalize()
+	{
+		_data = _mm_div_ps(_data, _mm_sqrt_ps(SimdDot3(_data, _data)));
+	}
+
+	// Returns the signed distance from the plane to the point
+	__forceinline float Distance(float x, float y, float z) const
+	{
+		return _mm_cvtss_f32(SimdDot4(_data, _mm_setr_ps(x, y, z, 1.0f)));
+	}
+
+	friend class Frustum;
+};
+
+// Up to 16 boxes in structure-of-arrays form, for the Frustum batch tests.
+// Unused entries don't need to be initialized.
+struct SIMD_ALIGN(32) AabbBatch
+{
+	static const int kCapacity = 16;
+
+	float centerX[kCapacity];
+	float centerY[kCapacity];
+	float centerZ[kCapacity];
+	float extentX[kCapacity];
+	float extentY[kCapacity];
+	float extentZ[kCapacity];
+
+	// Stores box in entry index
+	__forceinline void Set(int index, const Aabb& box)
+	{
+		centerX[index] = box.GetCenterX();
+		centerY[index] = box.GetCenterY();
+		centerZ[index] = box.GetCenterZ();
+		extentX[index] = box.GetExtentX();
+		extentY[index] = box.GetExtentY();
+		extentZ[index] = box.GetExtentZ();
+	}
+};
+
+// Up to 16 spheres in structure-of-arrays form, for the Frustum batch tests.
+// Unused entries don't need to be initialized.
+struct SIMD_ALIGN(32) SphereBatch
+{
+	static const int kCapacity = 16;
+
+	float centerX[kCapacity];
+	float centerY[kCapacity];
+	float centerZ[kCapacity];
+	float radius[kCapacity];
+
+	// Stores sphere in entry index
+	__forceinline void Set(int index, const Sphere& sphere)
+	{
+		centerX[index] = sphere.GetCenterX();
+		centerY[index] = sphere.GetCenterY();
+		centerZ[index] = sphere.GetCenterZ();
+		radius[index] = sphere.GetRadius();
+	}
+};
+
+// View frustum as 6 planes with the normals pointing inside
+class SIMD_ALIGN(16) Frustum
+{
+public:
+	enum
+	{
+		PLANE_LEFT = 0,
+		PLANE_RIGHT,
+		PLANE_BOTTOM,
+		PLANE_TOP,
+		PLANE_NEAR,
+		PLANE_FAR,
+		NUM_PLANES
+	};
+
+	// Default constructor does nothing
+	Frustum() {}
+
+	// Extracts the planes from the view projection matrix
+	explicit Frustum(const D3DMATRIX& viewProj)
+	{
+		Extract(viewProj);
+	}
+
+	// Extracts the planes from the view projection matrix (projection * view,
+	// column vectors, D3D clip space with 0 <= z <= w). The planes are normalized.
+	void Extract(const D3DMATRIX& viewProj);
+
+	// Returns the requested plane
+	const Plane& GetPlane(int index) const { return _planes[index]; }
+
+	// Tests one bound at a time
+	CullResult Classify(const Aabb& box) const;
+	CullResult Classify(const Sphere& sphere) const;
+
+	// Tests the first count (at most 16) bounds in the batch, storing one
+	// CullResult per bound in results. Uses 4 (or 8 with AVX2) lanes at a time.
+	void Classify(const AabbBatch& boxes, int count, CullResult* results) const;
+	void Classify(const SphereBatch& spheres, int count, CullResult* results) const;
+
+	// Same as above, but only returns a mask with bit i set if bound i
+	// isn't completely outside. This is all a renderer needs.
+	unsigned int TestVisible(const AabbBatch& boxes, int count) const;
+	unsigned int TestVisible(const SphereBatch& spheres, int count) const;
+
+private:
+	Plane _planes[NUM_PLANES];
+};
+
+} // namespace ITP485
+
+#endif // _BOUNDS_H_
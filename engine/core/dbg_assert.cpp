@@ -1,10 +1,16 @@
 // Implements custom assert handler
 #include "dbg_assert.h"
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#else
+#include <cstdio>
+#endif
 #include <cstdlib>
 #include <wchar.h>
-bool DbgAssertFunction(bool expr, wchar_t* expr_string, wchar_t* desc, int line_num, wchar_t* file_name)
+
+#ifdef _WIN32
+bool DbgAssertFunction(bool expr, const wchar_t* expr_string, const wchar_t* desc, int line_num, const wchar_t* file_name)
 {
 	bool bShouldHalt = !expr;
 	if (bShouldHalt)
@@ -30,3 +36,15 @@ bool DbgAssertFunction(bool expr, wchar_t* expr_string, wchar_t* desc, int line_
 
 	return bShouldHalt;
 }
+#else
+// No message box outside of Windows, so print the assert and halt
+bool DbgAssertFunction(bool expr, const wchar_t* expr_string, const wchar_t* desc, int line_num, const wchar_t* file_name)
+{
+	if (!expr)
+	{
+		fwprintf(stderr, L"Assertion Failed!\nDescription: %ls\nExpression: %ls\nFile: %ls\nLine: %d\n",
+				 desc, expr_string, file_name, line_num);
+	}
+	return !expr;
+}
+#endif // _WIN32
@@ -3,14 +3,21 @@
 #define _DBG_ASSERT_H_
 
 #ifdef _DEBUG
-extern bool DbgAssertFunction(bool expr, wchar_t* expr_string, wchar_t* desc, int line_num, wchar_t* file_name);
+extern bool DbgAssertFunction(bool expr, const wchar_t* expr_string, const wchar_t* desc, int line_num, const wchar_t* file_name);
+
+// Breaks into the debugger
+#if defined(_MSC_VER)
+#define DBG_BREAK() __debugbreak()
+#else
+#define DBG_BREAK() __builtin_trap()
+#endif
 
 // These macros convert __FILE__ from char* to wchar_t*
 #define DBG_WIDEN2(x) L##x
 #define DBG_WIDEN(x) DBG_WIDEN2(x)
 #define __WFILE__ DBG_WIDEN(__FILE__)
 
-#define Dbg_Assert(expr, description) {if (DbgAssertFunction((expr), L#expr, L##description, __LINE__, __WFILE__)) {_asm{int 3}}}
+#define Dbg_Assert(expr, description) {if (DbgAssertFunction((expr), DBG_WIDEN(#expr), DBG_WIDEN(description), __LINE__, __WFILE__)) {DBG_BREAK();}}
 #else
 #define Dbg_Assert(expr, description)
 #endif // _DEBUG
@@ -0,0 +1,143 @@
+// dualquat.cpp implements the affine conversions and the batch kernel
+#include "dualquat.h"
+#include "soamath.h"
+
+namespace ITP485
+{
+
+const FastDualQuaternion FastDualQuaternion::Identity(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), _mm_setzero_ps());
+
+namespace
+{
+
+// Palette conversion kernels. in is 12 floats per transform, out is 8.
+typedef void (*FromAffineKernel)(const float*, float*, size_t);
+
+void FromAffineSSE2(const float* in, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		const float* pIn = in + i * 12;
+
+		// m[row][k] = row of transforms i..i+3, transposed so lane j is transform j
+		__m128 m[3][4];
+		for (int row = 0; row < 3; ++row)
+		{
+			m[row][0] = _mm_load_ps(pIn + row * 4);
+			m[row][1] = _mm_load_ps(pIn + 12 + row * 4);
+			m[row][2] = _mm_load_ps(pIn + 24 + row * 4);
+			m[row][3] = _mm_load_ps(pIn + 36 + row * 4);
+			_MM_TRANSPOSE4_PS(m[row][0], m[row][1], m[row][2], m[row][3]);
+		}
+
+		const Vector3x4 cols[3] =
+		{
+			Vector3x4(m[0][0], m[1][0], m[2][0]),
+			Vector3x4(m[0][1], m[1][1], m[2][1]),
+			Vector3x4(m[0][2], m[1][2], m[2][2]),
+		};
+		Quaternionx4 real = Quaternionx4::FromRotationColumns(cols);
+
+		// dual = 0.5 * translation * real
+		const __m128 half = _mm_set_ps1(0.5f);
+		Quaternionx4 dual(real);
+		dual.Multiply(Quaternionx4(_mm_mul_ps(m[0][3], half), _mm_mul_ps(m[1][3], half),
+								   _mm_mul_ps(m[2][3], half), _mm_setzero_ps()));
+
+		_MM_TRANSPOSE4_PS(real.x, real.y, real.z, real.w);
+		_MM_TRANSPOSE4_PS(dual.x, dual.y, dual.z, dual.w);
+		float* pOut = out + i * 8;
+		_mm_store_ps(pOut, real.x);
+		_mm_store_ps(pOut + 4, dual.x);
+		_mm_store_ps(pOut + 8, real.y);
+		_mm_store_ps(pOut + 12, dual.y);
+		_mm_store_ps(pOut + 16, real.z);
+		_mm_store_ps(pOut + 20, dual.z);
+		_mm_store_ps(pOut + 24, real.w);
+		_mm_store_ps(pOut + 28, dual.w);
+	}
+
+	for (; i < n; ++i)
+	{
+		reinterpret_cast<FastDualQuaternion*>(out)[i].CreateFromAffine(reinterpret_cast<const FastAffine3x4*>(in)[i]);
+	}
+}
+
+SIMD_TARGET_AVX2 void FromAffineAVX2(const float* in, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const float* pIn = in + i * 12;
+
+		// transforms i..i+3 in the low halves, i+4..i+7 in the high halves
+		__m256 m[3][4];
+		for (int row = 0; row < 3; ++row)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				m[row][k] = SimdCombine(_mm_load_ps(pIn + k * 12 + row * 4), _mm_load_ps(pIn + (k + 4) * 12 + row * 4));
+			}
+			SimdTranspose8x4(m[row][0], m[row][1], m[row][2], m[row][3]);
+		}
+
+		const Vector3x8 cols[3] =
+		{
+			Vector3x8(m[0][0], m[1][0], m[2][0]),
+			Vector3x8(m[0][1], m[1][1], m[2][1]),
+			Vector3x8(m[0][2], m[1][2], m[2][2]),
+		};
+		Quaternionx8 real = Quaternionx8::FromRotationColumns(cols);
+
+		const __m256 half = _mm256_set1_ps(0.5f);
+		Quaternionx8 dual(real);
+		dual.Multiply(Quaternionx8(_mm256_mul_ps(m[0][3], half), _mm256_mul_ps(m[1][3], half),
+								   _mm256_mul_ps(m[2][3], half), _mm256_setzero_ps()));
+
+		SimdTranspose8x4(real.x, real.y, real.z, real.w);
+		SimdTranspose8x4(dual.x, dual.y, dual.z, dual.w);
+		const __m256 reals[4] = { real.x, real.y, real.z, real.w };
+		const __m256 duals[4] = { dual.x, dual.y, dual.z, dual.w };
+		float* pOut = out + i * 8;
+		for (int k = 0; k < 4; ++k)
+		{
+			_mm_store_ps(pOut + k * 8, _mm256_castps256_ps128(reals[k]));
+			_mm_store_ps(pOut + k * 8 + 4, _mm256_castps256_ps128(duals[k]));
+			_mm_store_ps(pOut + (k + 4) * 8, _mm256_extractf128_ps(reals[k], 1));
+			_mm_store_ps(pOut + (k + 4) * 8 + 4, _mm256_extractf128_ps(duals[k], 1));
+		}
+	}
+
+	// Leftovers go through the 4 wide kernel
+	FromAffineSSE2(in + i * 12, out + i * 8, n - i);
+}
+
+const FromAffineKernel s_FromAffineKernels[SIMD_NUM_LEVELS] =
+{
+	FromAffineSSE2,
+	FromAffineSSE2,
+	FromAffineAVX2,
+};
+
+} // anonymous namespace
+
+void FastDualQuaternion::CreateFromAffine(const FastAffine3x4& mat)
+{
+	FastQuaternion rotation;
+	rotation.CreateFromMatrix(mat);
+	const float* m = mat.ToFloats();
+	Set(rotation, FastVector3(m[3], m[7], m[11]));
+}
+
+void FastDualQuaternion::ToAffine(FastAffine3x4& out) const
+{
+	out.CreateFromQuaternion(GetRotation(), GetTranslation());
+}
+
+void FastDualQuaternion::CreateFromAffineBatch(const FastAffine3x4* in, FastDualQuaternion* out, size_t n)
+{
+	s_FromAffineKernels[GetSimdLevel()](reinterpret_cast<const float*>(in), reinterpret_cast<float*>(out), n);
+}
+
+} // namespace ITP485
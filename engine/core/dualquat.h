@@ -0,0 +1,195 @@
+// dualquat.h defines a unit dual quaternion for rigid transforms (rotation
+// plus translation). It's 32 bytes instead of the 48 of an Affine3x4, and
+// blending dual quaternions doesn't shrink the mesh around twisted joints the
+// way blending matrices does, which makes it a good fit for skinning.
+//
+// Dual quaternions can't hold scale or reflections, so converting a transform
+// that has either loses them.
+#ifndef _DUALQUAT_H_
+#define _DUALQUAT_H_
+
+#include "fastmath.h"
+
+namespace ITP485
+{
+
+// Unit dual quaternion using SIMD. real is the rotation, and
+// dual = 0.5 * translation * real, with translation as a pure quaternion.
+class SIMD_ALIGN(16) FastDualQuaternion
+{
+private:
+	__m128 _real;
+	__m128 _dual;
+public:
+	// Default constructor does nothing
+	__forceinline FastDualQuaternion() {}
+
+	// Constructs the transform that rotates first, then translates
+	__forceinline FastDualQuaternion(const FastQuaternion& rotation, const FastVector3& translation)
+	{
+		Set(rotation, translation);
+	}
+
+	// Constructs the rigid part of mat (see CreateFromAffine)
+	__forceinline explicit FastDualQuaternion(const FastAffine3x4& mat)
+	{
+		CreateFromAffine(mat);
+	}
+
+	// Constructs a dual quaternion given the real and dual parts.
+	// Note this assumes you have already applied the correct formula.
+	__forceinline FastDualQuaternion(__m128 real, __m128 dual)
+	{
+		_real = real;
+		_dual = dual;
+	}
+
+	// Copy constructor
+	__forceinline FastDualQuaternion(const FastDualQuaternion& rhs)
+	{
+		_real = rhs._real;
+		_dual = rhs._dual;
+	}
+
+	// Assignment operator
+	__forceinline FastDualQuaternion& operator=(const FastDualQuaternion& rhs)
+	{
+		_real = rhs._real;
+		_dual = rhs._dual;
+		return *this;
+	}
+
+	// Sets this to the transform that rotates first, then translates.
+	// rotation must be unit length.
+	__forceinline void Set(const FastQuaternion& rotation, const FastVector3& translation)
+	{
+		_real = rotation._data;
+		// translation as a pure quaternion (w = 0)
+		FastQuaternion dual(rotation);
+		dual.Multiply(FastQuaternion(_mm_and_ps(translation._data, SimdMaskXYZ())));
+		_dual = _mm_mul_ps(dual._data, _mm_set_ps1(0.5f));
+	}
+
+	// Returns the real part, which is the rotation
+	__forceinline FastQuaternion GetReal() const
+	{
+		return FastQuaternion(_real);
+	}
+
+	// Returns the dual part
+	__forceinline FastQuaternion GetDual() const
+	{
+		return FastQuaternion(_dual);
+	}
+
+	// Returns the rotation (the real part)
+	__forceinline FastQuaternion GetRotation() const
+	{
+		return FastQuaternion(_real);
+	}
+
+	// Returns the translation, 2 * dual * conjugate(real). w is set to 1.0f
+	__forceinline FastVector3 GetTranslation() const
+	{
+		FastQuaternion conj(_real);
+		conj.Conjugate();
+		conj.Multiply(FastQuaternion(_dual));
+		__m128 t = _mm_add_ps(conj._data, conj._data);
+		return FastVector3(SimdSetW(t, 1.0f));
+	}
+
+	// Transform by THIS dual quaternion, followed by rhs (same order as
+	// FastQuaternion::Multiply). Store result in this dual quaternion.
+	__forceinline void Multiply(const FastDualQuaternion& rhs)
+	{
+		// (rhs.real + e rhs.dual) * (real + e dual)
+		// = rhs.real * real + e (rhs.real * dual + rhs.dual * real)
+		FastQuaternion real(_real);
+		real.Multiply(FastQuaternion(rhs._real));
+		FastQuaternion dual0(_dual);
+		dual0.Multiply(FastQuaternion(rhs._real));
+		FastQuaternion dual1(_real);
+		dual1.Multiply(FastQuaternion(rhs._dual));
+		_real = real._data;
+		_dual = _mm_add_ps(dual0._data, dual1._data);
+	}
+
+	// Calculates the conjugate of this dual quaternion. For unit dual
+	// quaternions this is the inverse transform.
+	__forceinline void Conjugate()
+	{
+		const __m128 sign = _mm_setr_ps(-0.0f, -0.0f, -0.0f, 0.0f);
+		_real = _mm_xor_ps(_real, sign);
+		_dual = _mm_xor_ps(_dual, sign);
+	}
+
+	// Makes the real part unit length and the dual part perpendicular to it,
+	// which is what a blend of unit dual quaternions needs to be rigid again
+	__forceinline void Normalize()
+	{
+		__m128 invLength = _mm_div_ps(_mm_set_ps1(1.0f), _mm_sqrt_ps(SimdDot4(_real, _real)));
+		_real = _mm_mul_ps(_real, invLength);
+		_dual = _mm_mul_ps(_dual, invLength);
+		_dual = _mm_sub_ps(_dual, _mm_mul_ps(_real, SimdDot4(_real, _dual)));
+	}
+
+	// Transforms point p (rotates, then translates), returning the result by value
+	__forceinline FastVector3 TransformPoint(const FastVector3& p) const
+	{
+		FastVector3 result(p);
+		result.Rotate(FastQuaternion(_real));
+		FastVector3 t = GetTranslation();
+		return FastVector3(_mm_add_ps(result._data, _mm_and_ps(t._data, SimdMaskXYZ())));
+	}
+
+	// Does a 4-way dual quaternion linear blend (DLB), normalizing the result.
+	// b, c and d are flipped to the same hemisphere as a first, so the blend
+	// goes the short way around.
+	// result = normalize(a * fa + b * fb + c * fc + d * fd)
+	// fd = 1.0f - fa - fb - fc
+	__forceinline friend FastDualQuaternion Blend(const FastDualQuaternion& a, const FastDualQuaternion& b,
+												  const FastDualQuaternion& c, const FastDualQuaternion& d,
+												  float fa, float fb, float fc)
+	{
+		const __m128 signMask = _mm_set_ps1(-0.0f);
+		__m128 wa = _mm_set_ps1(fa);
+		__m128 wb = _mm_xor_ps(_mm_set_ps1(fb), _mm_and_ps(SimdDot4(a._real, b._real), signMask));
+		__m128 wc = _mm_xor_ps(_mm_set_ps1(fc), _mm_and_ps(SimdDot4(a._real, c._real), signMask));
+		__m128 wd = _mm_xor_ps(_mm_set_ps1(1.0f - fa - fb - fc), _mm_and_ps(SimdDot4(a._real, d._real), signMask));
+
+		__m128 real = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a._real, wa), _mm_mul_ps(b._real, wb)),
+								 _mm_add_ps(_mm_mul_ps(c._real, wc), _mm_mul_ps(d._real, wd)));
+		__m128 dual = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a._dual, wa), _mm_mul_ps(b._dual, wb)),
+								 _mm_add_ps(_mm_mul_ps(c._dual, wc), _mm_mul_ps(d._dual, wd)));
+
+		FastDualQuaternion result(real, dual);
+		result.Normalize();
+		return result;
+	}
+
+	// Sets this to the rotation and translation of mat.
+	// The upper 3x3 of mat must be orthonormal, with no scale or reflection.
+	void CreateFromAffine(const FastAffine3x4& mat);
+
+	// Stores the transform in out. This must be unit length.
+	void ToAffine(FastAffine3x4& out) const;
+
+	// Converts n transforms, out[i] = FastDualQuaternion(in[i]). The same
+	// rules as CreateFromAffine apply. This is the per frame conversion of a
+	// skinning palette, so out is 32 bytes per joint (real, then dual) and
+	// can be uploaded as 2 float4 shader constants per joint.
+	// Works on 4 (or 8 with AVX2) transforms at a time.
+	static void CreateFromAffineBatch(const FastAffine3x4* in, FastDualQuaternion* out, size_t n);
+
+	// Returns the 8 floats of this dual quaternion, real part first
+	__forceinline const float* ToFloats() const
+	{
+		return reinterpret_cast<const float*>(&_real);
+	}
+
+	static const FastDualQuaternion Identity;
+};
+
+} // namespace ITP485
+
+#endif // _DUALQUAT_H_
@@ -1,5 +1,8 @@
 // FastMath.cpp defines statics for the fast math library
 #include "fastmath.h"
+#include "soamath.h"
+#include "dbg_assert.h"
+#include <algorithm>
 
 namespace ITP485
 {
@@ -7,7 +10,9 @@ float _ident[4][4] = {1.0f, 0.0f, 0.0f, 0.0f,
 						0.0f, 1.0f, 0.0f, 0.0f,
 						0.0f, 0.0f, 1.0f, 0.0f,
 						0.0f, 0.0f, 0.0f, 1.0f};
-const FastMatrix4 FastMatrix4::Identity(_ident);
+template <class Layout>
+const FastMatrix4T<Layout> FastMatrix4T<Layout>::Identity(_ident);
+const FastAffine3x4 FastAffine3x4::Identity(_ident);
 
 const FastVector3 FastVector3::Zero(0.0f, 0.0f, 0.0f);
 const FastVector3 FastVector3::UnitX(1.0f, 0.0f, 0.0f);
@@ -19,88 +24,1457 @@ const FastVector3 FastVector3::NegativeUnitZ(0.0f, 0.0f, -1.0f);
 
 const FastQuaternion FastQuaternion::Identity(0.0f, 0.0f, 0.0f, 1.0f);
 
-void FastMatrix4::CreateTranslation(const FastVector3& translation)
+// Matrix multiply kernels, one per SimdLevel.
+// All of them compute out = a * b and allow out to alias a or b.
+namespace
+{
+
+// SSE2: each result row is a linear combination of the rows of b,
+// weighted by the elements of the matching row of a. No transpose needed.
+void MultiplySSE2(const __m128* a, const __m128* b, __m128* out)
+{
+	__m128 result[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		__m128 row = a[i];
+		__m128 temp = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b[0]);
+		temp = _mm_add_ps(temp, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b[1]));
+		temp = _mm_add_ps(temp, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b[2]));
+		temp = _mm_add_ps(temp, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), b[3]));
+		result[i] = temp;
+	}
+
+	out[0] = result[0];
+	out[1] = result[1];
+	out[2] = result[2];
+	out[3] = result[3];
+}
+
+// SSE4.1: transpose b, then one dot product per element.
+SIMD_TARGET_SSE41 void MultiplySSE41(const __m128* a, const __m128* b, __m128* out)
+{
+	__m128 rhs_row0 = b[0];
+	__m128 rhs_row1 = b[1];
+	__m128 rhs_row2 = b[2];
+	__m128 rhs_row3 = b[3];
+
+	// transpose the rhs matrix
+	_MM_TRANSPOSE4_PS(rhs_row0, rhs_row1, rhs_row2, rhs_row3);
+
+	__m128 result[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		__m128 x = _mm_dp_ps(a[i], rhs_row0, 0xF1);
+		__m128 y = _mm_dp_ps(a[i], rhs_row1, 0xF2);
+		__m128 z = _mm_dp_ps(a[i], rhs_row2, 0xF4);
+		__m128 w = _mm_dp_ps(a[i], rhs_row3, 0xF8);
+
+		result[i] = _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w));
+	}
+
+	out[0] = result[0];
+	out[1] = result[1];
+	out[2] = result[2];
+	out[3] = result[3];
+}
+
+// AVX2/FMA: same linear combination as SSE2, but two rows of a per register.
+// The in-lane permute broadcasts element k of each row within its own half,
+// and each row of b is broadcast to both halves.
+SIMD_TARGET_AVX2 __forceinline void MultiplyRowsAVX2(__m256 a01, __m256 a23, const float* pB,
+													  __m256& r01, __m256& r23)
+{
+	__m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB));
+	__m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 4));
+	__m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 8));
+	__m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 12));
+
+	r01 = _mm256_mul_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+	r23 = _mm256_mul_ps(_mm256_permute_ps(a23, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+	r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(1, 1, 1, 1)), b1, r01);
+	r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, _MM_SHUFFLE(1, 1, 1, 1)), b1, r23);
+	r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(2, 2, 2, 2)), b2, r01);
+	r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, _MM_SHUFFLE(2, 2, 2, 2)), b2, r23);
+	r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, _MM_SHUFFLE(3, 3, 3, 3)), b3, r01);
+	r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, _MM_SHUFFLE(3, 3, 3, 3)), b3, r23);
+}
+
+SIMD_TARGET_AVX2 void MultiplyAVX2(const __m128* a, const __m128* b, __m128* out)
+{
+	const float* pA = reinterpret_cast<const float*>(a);
+
+	__m256 r01, r23;
+	MultiplyRowsAVX2(_mm256_loadu_ps(pA), _mm256_loadu_ps(pA + 8), reinterpret_cast<const float*>(b), r01, r23);
+
+	float* pOut = reinterpret_cast<float*>(out);
+	_mm256_storeu_ps(pOut, r01);
+	_mm256_storeu_ps(pOut + 8, r23);
+}
+
+typedef void (*MultiplyKernel)(const __m128*, const __m128*, __m128*);
+const MultiplyKernel s_MultiplyKernels[SIMD_NUM_LEVELS] =
+{
+	MultiplySSE2,
+	MultiplySSE41,
+	MultiplyAVX2,
+};
+
+// Batch kernels. Matrices are 16 floats apart; out[i] may be the same
+// matrix as a[i] or b[i].
+
+// Used for SSE2 and SSE4.1, the single kernels have no cross-matrix work to share
+template <MultiplyKernel kernel>
+void MultiplyBatchLoop(const float* a, const float* b, float* out, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		kernel(reinterpret_cast<const __m128*>(a + i * 16), reinterpret_cast<const __m128*>(b + i * 16),
+			   reinterpret_cast<__m128*>(out + i * 16));
+	}
+}
+
+// Two matrices per iteration. Everything is loaded before anything is
+// stored, so the two independent FMA chains can overlap.
+SIMD_TARGET_AVX2 void MultiplyBatchAVX2(const float* a, const float* b, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		const float* pA = a + i * 16;
+		const float* pB = b + i * 16;
+		__m256 a01_0 = _mm256_loadu_ps(pA);
+		__m256 a23_0 = _mm256_loadu_ps(pA + 8);
+		__m256 a01_1 = _mm256_loadu_ps(pA + 16);
+		__m256 a23_1 = _mm256_loadu_ps(pA + 24);
+
+		__m256 r01_0, r23_0, r01_1, r23_1;
+		MultiplyRowsAVX2(a01_0, a23_0, pB, r01_0, r23_0);
+		MultiplyRowsAVX2(a01_1, a23_1, pB + 16, r01_1, r23_1);
+
+		float* pOut = out + i * 16;
+		_mm256_storeu_ps(pOut, r01_0);
+		_mm256_storeu_ps(pOut + 8, r23_0);
+		_mm256_storeu_ps(pOut + 16, r01_1);
+		_mm256_storeu_ps(pOut + 24, r23_1);
+	}
+
+	if (i < n)
+	{
+		MultiplyAVX2(reinterpret_cast<const __m128*>(a + i * 16), reinterpret_cast<const __m128*>(b + i * 16),
+					 reinterpret_cast<__m128*>(out + i * 16));
+	}
+}
+
+typedef void (*MultiplyBatchKernel)(const float*, const float*, float*, size_t);
+const MultiplyBatchKernel s_MultiplyBatchKernels[SIMD_NUM_LEVELS] =
+{
+	MultiplyBatchLoop<MultiplySSE2>,
+	MultiplyBatchLoop<MultiplySSE41>,
+	MultiplyBatchAVX2,
+};
+
+// Broadcast kernels compute out[i] = a * b[i].
+
+// SSE2: splat all 16 elements of a once, then each result row is four
+// multiply-adds against the rows of b[i].
+void MultiplyBroadcastSSE2(const float* a, const float* b, float* out, size_t n)
+{
+	__m128 coeffs[16];
+	for (int i = 0; i < 16; ++i)
+	{
+		coeffs[i] = _mm_set_ps1(a[i]);
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const float* pB = b + i * 16;
+		__m128 b0 = _mm_load_ps(pB);
+		__m128 b1 = _mm_load_ps(pB + 4);
+		__m128 b2 = _mm_load_ps(pB + 8);
+		__m128 b3 = _mm_load_ps(pB + 12);
+
+		float* pOut = out + i * 16;
+		for (int row = 0; row < 4; ++row)
+		{
+			__m128 temp = _mm_mul_ps(coeffs[row * 4], b0);
+			temp = _mm_add_ps(temp, _mm_mul_ps(coeffs[row * 4 + 1], b1));
+			temp = _mm_add_ps(temp, _mm_mul_ps(coeffs[row * 4 + 2], b2));
+			temp = _mm_add_ps(temp, _mm_mul_ps(coeffs[row * 4 + 3], b3));
+			_mm_store_ps(pOut + row * 4, temp);
+		}
+	}
+}
+
+// AVX2/FMA: the permuted rows of a are computed once and reused for every
+// b[i], two matrices per iteration.
+SIMD_TARGET_AVX2 void MultiplyBroadcastAVX2(const float* a, const float* b, float* out, size_t n)
+{
+	__m256 a01 = _mm256_loadu_ps(a);
+	__m256 a23 = _mm256_loadu_ps(a + 8);
+	const __m256 a01_0 = _mm256_permute_ps(a01, _MM_SHUFFLE(0, 0, 0, 0));
+	const __m256 a01_1 = _mm256_permute_ps(a01, _MM_SHUFFLE(1, 1, 1, 1));
+	const __m256 a01_2 = _mm256_permute_ps(a01, _MM_SHUFFLE(2, 2, 2, 2));
+	const __m256 a01_3 = _mm256_permute_ps(a01, _MM_SHUFFLE(3, 3, 3, 3));
+	const __m256 a23_0 = _mm256_permute_ps(a23, _MM_SHUFFLE(0, 0, 0, 0));
+	const __m256 a23_1 = _mm256_permute_ps(a23, _MM_SHUFFLE(1, 1, 1, 1));
+	const __m256 a23_2 = _mm256_permute_ps(a23, _MM_SHUFFLE(2, 2, 2, 2));
+	const __m256 a23_3 = _mm256_permute_ps(a23, _MM_SHUFFLE(3, 3, 3, 3));
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const __m128* pB = reinterpret_cast<const __m128*>(b + i * 16);
+		__m256 b0 = _mm256_broadcast_ps(pB);
+		__m256 b1 = _mm256_broadcast_ps(pB + 1);
+		__m256 b2 = _mm256_broadcast_ps(pB + 2);
+		__m256 b3 = _mm256_broadcast_ps(pB + 3);
+
+		__m256 r01 = _mm256_mul_ps(a01_0, b0);
+		__m256 r23 = _mm256_mul_ps(a23_0, b0);
+		r01 = _mm256_fmadd_ps(a01_1, b1, r01);
+		r23 = _mm256_fmadd_ps(a23_1, b1, r23);
+		r01 = _mm256_fmadd_ps(a01_2, b2, r01);
+		r23 = _mm256_fmadd_ps(a23_2, b2, r23);
+		r01 = _mm256_fmadd_ps(a01_3, b3, r01);
+		r23 = _mm256_fmadd_ps(a23_3, b3, r23);
+
+		float* pOut = out + i * 16;
+		_mm256_storeu_ps(pOut, r01);
+		_mm256_storeu_ps(pOut + 8, r23);
+	}
+}
+
+const MultiplyBatchKernel s_MultiplyBroadcastKernels[SIMD_NUM_LEVELS] =
+{
+	MultiplyBroadcastSSE2,
+	MultiplyBroadcastSSE2,
+	MultiplyBroadcastAVX2,
+};
+
+// Affine multiply kernels, out = a * b for 3x4 transforms (12 floats each).
+// The implied bottom row of b is (0, 0, 0, 1), so each result row is
+// a.x * b0 + a.y * b1 + a.z * b2 + (0, 0, 0, a.w).
+
+void MultiplyAffineSSE2(const float* a, const float* b, float* out, size_t n)
+{
+	const __m128 maskW = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+	for (size_t i = 0; i < n; ++i)
+	{
+		const float* pA = a + i * 12;
+		const float* pB = b + i * 12;
+		__m128 b0 = _mm_load_ps(pB);
+		__m128 b1 = _mm_load_ps(pB + 4);
+		__m128 b2 = _mm_load_ps(pB + 8);
+
+		__m128 result[3];
+		for (int row = 0; row < 3; ++row)
+		{
+			__m128 r = _mm_load_ps(pA + row * 4);
+			__m128 temp = _mm_and_ps(r, maskW);
+			temp = _mm_add_ps(temp, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)), b0));
+			temp = _mm_add_ps(temp, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+			temp = _mm_add_ps(temp, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+			result[row] = temp;
+		}
+
+		float* pOut = out + i * 12;
+		_mm_store_ps(pOut, result[0]);
+		_mm_store_ps(pOut + 4, result[1]);
+		_mm_store_ps(pOut + 8, result[2]);
+	}
+}
+
+// Two rows per register. Each half is multiplied by the rows of its own b.
+SIMD_TARGET_AVX2 __forceinline __m256 AffineRowsAVX2(__m256 rows, __m256 b0, __m256 b1, __m256 b2, __m256 maskW)
+{
+	__m256 result = _mm256_and_ps(rows, maskW);
+	result = _mm256_fmadd_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(0, 0, 0, 0)), b0, result);
+	result = _mm256_fmadd_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(1, 1, 1, 1)), b1, result);
+	return _mm256_fmadd_ps(_mm256_permute_ps(rows, _MM_SHUFFLE(2, 2, 2, 2)), b2, result);
+}
+
+// AVX2/FMA: two transforms are 24 floats, exactly three ymm registers:
+// (a0.r0, a0.r1), (a0.r2, a1.r0), (a1.r1, a1.r2). The middle register mixes
+// rows of both b matrices.
+SIMD_TARGET_AVX2 void MultiplyAffineAVX2(const float* a, const float* b, float* out, size_t n)
+{
+	const __m256 maskW = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		const float* pA = a + i * 12;
+		const float* pB = b + i * 12;
+		__m256 r0 = _mm256_loadu_ps(pA);
+		__m256 r1 = _mm256_loadu_ps(pA + 8);
+		__m256 r2 = _mm256_loadu_ps(pA + 16);
+
+		__m256 first0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB));
+		__m256 first1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 4));
+		__m256 first2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 8));
+		__m256 second0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 12));
+		__m256 second1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 16));
+		__m256 second2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 20));
+
+		r0 = AffineRowsAVX2(r0, first0, first1, first2, maskW);
+		r1 = AffineRowsAVX2(r1, _mm256_blend_ps(first0, second0, 0xF0), _mm256_blend_ps(first1, second1, 0xF0),
+							_mm256_blend_ps(first2, second2, 0xF0), maskW);
+		r2 = AffineRowsAVX2(r2, second0, second1, second2, maskW);
+
+		float* pOut = out + i * 12;
+		_mm256_storeu_ps(pOut, r0);
+		_mm256_storeu_ps(pOut + 8, r1);
+		_mm256_storeu_ps(pOut + 16, r2);
+	}
+
+	if (i < n)
+	{
+		const float* pA = a + i * 12;
+		const float* pB = b + i * 12;
+		__m256 r01 = _mm256_loadu_ps(pA);
+		__m256 r2 = _mm256_castps128_ps256(_mm_load_ps(pA + 8));
+		__m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB));
+		__m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 4));
+		__m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pB + 8));
+
+		r01 = AffineRowsAVX2(r01, b0, b1, b2, maskW);
+		r2 = AffineRowsAVX2(r2, b0, b1, b2, maskW);
+
+		float* pOut = out + i * 12;
+		_mm256_storeu_ps(pOut, r01);
+		_mm_store_ps(pOut + 8, _mm256_castps256_ps128(r2));
+	}
+}
+
+// dp_ps doesn't help with only 3 rows, so SSE4.1 uses the SSE2 kernel
+const MultiplyBatchKernel s_MultiplyAffineKernels[SIMD_NUM_LEVELS] =
+{
+	MultiplyAffineSSE2,
+	MultiplyAffineSSE2,
+	MultiplyAffineAVX2,
+};
+
+// Affine inverse. With the rows r0, r1, r2 of the upper 3x3, the columns of
+// the inverse are r1 x r2, r2 x r0 and r0 x r1 divided by the determinant,
+// and the new translation is -inverse(A) * t. Building the columns first
+// means one transpose puts both the 3x3 and the translation in place.
+__forceinline void InvertAffineRows(const __m128* in, __m128* out)
+{
+	__m128 c0 = SimdCross3(in[1], in[2]);
+	__m128 c1 = SimdCross3(in[2], in[0]);
+	__m128 c2 = SimdCross3(in[0], in[1]);
+	__m128 det = SimdDot3(in[0], c0);
+	Dbg_Assert(_mm_cvtss_f32(det) != 0.0f, "Affine transform has a zero determinant and can't be inverted.");
+
+	__m128 invDet = _mm_div_ps(_mm_set_ps1(1.0f), det);
+	c0 = _mm_mul_ps(c0, invDet);
+	c1 = _mm_mul_ps(c1, invDet);
+	c2 = _mm_mul_ps(c2, invDet);
+
+	__m128 t = _mm_mul_ps(c0, _mm_shuffle_ps(in[0], in[0], _MM_SHUFFLE(3, 3, 3, 3)));
+	t = _mm_add_ps(t, _mm_mul_ps(c1, _mm_shuffle_ps(in[1], in[1], _MM_SHUFFLE(3, 3, 3, 3))));
+	t = _mm_add_ps(t, _mm_mul_ps(c2, _mm_shuffle_ps(in[2], in[2], _MM_SHUFFLE(3, 3, 3, 3))));
+	t = _mm_sub_ps(_mm_setzero_ps(), t);
+
+	_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+}
+
+// Rigid inverse, same as above but the inverse of the 3x3 is its transpose
+__forceinline void InvertOrthonormalRows(const __m128* in, __m128* out)
+{
+	__m128 c0 = _mm_and_ps(in[0], SimdMaskXYZ());
+	__m128 c1 = _mm_and_ps(in[1], SimdMaskXYZ());
+	__m128 c2 = _mm_and_ps(in[2], SimdMaskXYZ());
+
+	__m128 t = _mm_mul_ps(c0, _mm_shuffle_ps(in[0], in[0], _MM_SHUFFLE(3, 3, 3, 3)));
+	t = _mm_add_ps(t, _mm_mul_ps(c1, _mm_shuffle_ps(in[1], in[1], _MM_SHUFFLE(3, 3, 3, 3))));
+	t = _mm_add_ps(t, _mm_mul_ps(c2, _mm_shuffle_ps(in[2], in[2], _MM_SHUFFLE(3, 3, 3, 3))));
+	t = _mm_sub_ps(_mm_setzero_ps(), t);
+
+	_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+}
+
+bool IsOrthonormalRows(const __m128* rows, float epsilon)
+{
+	float d00 = _mm_cvtss_f32(SimdDot3(rows[0], rows[0]));
+	float d11 = _mm_cvtss_f32(SimdDot3(rows[1], rows[1]));
+	float d22 = _mm_cvtss_f32(SimdDot3(rows[2], rows[2]));
+	float d01 = _mm_cvtss_f32(SimdDot3(rows[0], rows[1]));
+	float d02 = _mm_cvtss_f32(SimdDot3(rows[0], rows[2]));
+	float d12 = _mm_cvtss_f32(SimdDot3(rows[1], rows[2]));
+	return fabsf(d00 - 1.0f) <= epsilon && fabsf(d11 - 1.0f) <= epsilon && fabsf(d22 - 1.0f) <= epsilon
+		&& fabsf(d01) <= epsilon && fabsf(d02) <= epsilon && fabsf(d12) <= epsilon;
+}
+
+// Batched affine inverse kernels, out may be the same array as in.
+// Four (or eight) transforms are transposed into SoA packets so the cross
+// products and dots need no shuffles, then transposed back.
+typedef void (*InvertKernel)(const float*, float*, size_t);
+
+void InvertAffineSSE2(const float* in, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		const float* pIn = in + i * 12;
+
+		// m[row][k] = row of transforms i..i+3, transposed so lane j is transform j
+		__m128 m[3][4];
+		for (int row = 0; row < 3; ++row)
+		{
+			m[row][0] = _mm_load_ps(pIn + row * 4);
+			m[row][1] = _mm_load_ps(pIn + 12 + row * 4);
+			m[row][2] = _mm_load_ps(pIn + 24 + row * 4);
+			m[row][3] = _mm_load_ps(pIn + 36 + row * 4);
+			_MM_TRANSPOSE4_PS(m[row][0], m[row][1], m[row][2], m[row][3]);
+		}
+
+		Vector3x4 r0(m[0][0], m[0][1], m[0][2]);
+		Vector3x4 r1(m[1][0], m[1][1], m[1][2]);
+		Vector3x4 r2(m[2][0], m[2][1], m[2][2]);
+		Vector3x4 t(m[0][3], m[1][3], m[2][3]);
+
+		Vector3x4 c0 = Cross(r1, r2);
+		Vector3x4 c1 = Cross(r2, r0);
+		Vector3x4 c2 = Cross(r0, r1);
+		__m128 det = r0.Dot(c0);
+		Dbg_Assert(_mm_movemask_ps(_mm_cmpeq_ps(det, _mm_setzero_ps())) == 0,
+				   "Affine transform has a zero determinant and can't be inverted.");
+		__m128 invDet = _mm_div_ps(_mm_set_ps1(1.0f), det);
+
+		Vector3x4 inv[3] =
+		{
+			Vector3x4(c0.x, c1.x, c2.x),
+			Vector3x4(c0.y, c1.y, c2.y),
+			Vector3x4(c0.z, c1.z, c2.z),
+		};
+
+		float* pOut = out + i * 12;
+		for (int row = 0; row < 3; ++row)
+		{
+			inv[row].Multiply(invDet);
+			__m128 x = inv[row].x;
+			__m128 y = inv[row].y;
+			__m128 z = inv[row].z;
+			__m128 w = _mm_sub_ps(_mm_setzero_ps(), inv[row].Dot(t));
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_store_ps(pOut + row * 4, x);
+			_mm_store_ps(pOut + 12 + row * 4, y);
+			_mm_store_ps(pOut + 24 + row * 4, z);
+			_mm_store_ps(pOut + 36 + row * 4, w);
+		}
+	}
+
+	for (; i < n; ++i)
+	{
+		InvertAffineRows(reinterpret_cast<const __m128*>(in + i * 12), reinterpret_cast<__m128*>(out + i * 12));
+	}
+}
+
+SIMD_TARGET_AVX2 void InvertAffineAVX2(const float* in, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const float* pIn = in + i * 12;
+
+		// transforms i..i+3 in the low halves, i+4..i+7 in the high halves
+		__m256 m[3][4];
+		for (int row = 0; row < 3; ++row)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				m[row][k] = SimdCombine(_mm_load_ps(pIn + k * 12 + row * 4), _mm_load_ps(pIn + (k + 4) * 12 + row * 4));
+			}
+			SimdTranspose8x4(m[row][0], m[row][1], m[row][2], m[row][3]);
+		}
+
+		Vector3x8 r0(m[0][0], m[0][1], m[0][2]);
+		Vector3x8 r1(m[1][0], m[1][1], m[1][2]);
+		Vector3x8 r2(m[2][0], m[2][1], m[2][2]);
+		Vector3x8 t(m[0][3], m[1][3], m[2][3]);
+
+		Vector3x8 c0 = Cross(r1, r2);
+		Vector3x8 c1 = Cross(r2, r0);
+		Vector3x8 c2 = Cross(r0, r1);
+		__m256 det = r0.Dot(c0);
+		Dbg_Assert(_mm256_movemask_ps(_mm256_cmp_ps(det, _mm256_setzero_ps(), _CMP_EQ_OQ)) == 0,
+				   "Affine transform has a zero determinant and can't be inverted.");
+		__m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+
+		Vector3x8 inv[3] =
+		{
+			Vector3x8(c0.x, c1.x, c2.x),
+			Vector3x8(c0.y, c1.y, c2.y),
+			Vector3x8(c0.z, c1.z, c2.z),
+		};
+
+		float* pOut = out + i * 12;
+		for (int row = 0; row < 3; ++row)
+		{
+			inv[row].Multiply(invDet);
+			__m256 x = inv[row].x;
+			__m256 y = inv[row].y;
+			__m256 z = inv[row].z;
+			__m256 w = _mm256_sub_ps(_mm256_setzero_ps(), inv[row].Dot(t));
+			SimdTranspose8x4(x, y, z, w);
+			__m256 result[4] = { x, y, z, w };
+			for (int k = 0; k < 4; ++k)
+			{
+				_mm_store_ps(pOut + k * 12 + row * 4, _mm256_castps256_ps128(result[k]));
+				_mm_store_ps(pOut + (k + 4) * 12 + row * 4, _mm256_extractf128_ps(result[k], 1));
+			}
+		}
+	}
+
+	// Leftovers go through the 4 wide kernel
+	InvertAffineSSE2(in + i * 12, out + i * 12, n - i);
+}
+
+const InvertKernel s_InvertAffineKernels[SIMD_NUM_LEVELS] =
+{
+	InvertAffineSSE2,
+	InvertAffineSSE2,
+	InvertAffineAVX2,
+};
+
+// TRS decompose/compose kernels. Transforms are 12 floats apart.
+// Decompose: scale is the length of each column of the upper 3x3, with
+// scale.z negated if the 3x3 has a reflection, and the rotation is the
+// quaternion of the 3x3 with the scale divided out.
+typedef void (*DecomposeKernel)(const float*, FastVector3*, FastQuaternion*, FastVector3*, size_t);
+typedef void (*ComposeKernel)(const FastVector3*, const FastQuaternion*, const FastVector3*, float*, size_t);
+
+void DecomposeSSE2(const float* in, FastVector3* translations, FastQuaternion* rotations, FastVector3* scales, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		const float* pIn = in + i * 12;
+
+		// m[row][k] = row of transforms i..i+3, transposed so lane j is transform j
+		__m128 m[3][4];
+		for (int row = 0; row < 3; ++row)
+		{
+			m[row][0] = _mm_load_ps(pIn + row * 4);
+			m[row][1] = _mm_load_ps(pIn + 12 + row * 4);
+			m[row][2] = _mm_load_ps(pIn + 24 + row * 4);
+			m[row][3] = _mm_load_ps(pIn + 36 + row * 4);
+			_MM_TRANSPOSE4_PS(m[row][0], m[row][1], m[row][2], m[row][3]);
+		}
+
+		Vector3x4 cols[3] =
+		{
+			Vector3x4(m[0][0], m[1][0], m[2][0]),
+			Vector3x4(m[0][1], m[1][1], m[2][1]),
+			Vector3x4(m[0][2], m[1][2], m[2][2]),
+		};
+		Vector3x4 scale(cols[0].Length(), cols[1].Length(), cols[2].Length());
+		__m128 det = cols[0].Dot(Cross(cols[1], cols[2]));
+		scale.z = _mm_xor_ps(scale.z, _mm_and_ps(det, _mm_set_ps1(-0.0f)));
+
+		cols[0].Multiply(_mm_div_ps(_mm_set_ps1(1.0f), scale.x));
+		cols[1].Multiply(_mm_div_ps(_mm_set_ps1(1.0f), scale.y));
+		cols[2].Multiply(_mm_div_ps(_mm_set_ps1(1.0f), scale.z));
+
+		Vector3x4(m[0][3], m[1][3], m[2][3]).Scatter(translations + i);
+		Quaternionx4::FromRotationColumns(cols).Scatter(rotations + i);
+		scale.Scatter(scales + i);
+	}
+
+	for (; i < n; ++i)
+	{
+		reinterpret_cast<const FastAffine3x4*>(in)[i].Decompose(translations[i], rotations[i], scales[i]);
+	}
+}
+
+// Builds the rows of each transform in SoA form and transposes them out.
+// rows[r] gets element (r, 0..2) and t[r] in lanes x, y, z, w once transposed.
+__forceinline void ComposeRows(const Vector3x4& t, const Quaternionx4& q, const Vector3x4& s, __m128 rows[3][4])
+{
+	const __m128 one = _mm_set_ps1(1.0f);
+	__m128 x2 = _mm_add_ps(q.x, q.x);
+	__m128 y2 = _mm_add_ps(q.y, q.y);
+	__m128 z2 = _mm_add_ps(q.z, q.z);
+	__m128 xx = _mm_mul_ps(q.x, x2), yy = _mm_mul_ps(q.y, y2), zz = _mm_mul_ps(q.z, z2);
+	__m128 xy = _mm_mul_ps(q.x, y2), xz = _mm_mul_ps(q.x, z2), yz = _mm_mul_ps(q.y, z2);
+	__m128 wx = _mm_mul_ps(q.w, x2), wy = _mm_mul_ps(q.w, y2), wz = _mm_mul_ps(q.w, z2);
+
+	rows[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), s.x);
+	rows[0][1] = _mm_mul_ps(_mm_sub_ps(xy, wz), s.y);
+	rows[0][2] = _mm_mul_ps(_mm_add_ps(xz, wy), s.z);
+	rows[0][3] = t.x;
+	rows[1][0] = _mm_mul_ps(_mm_add_ps(xy, wz), s.x);
+	rows[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), s.y);
+	rows[1][2] = _mm_mul_ps(_mm_sub_ps(yz, wx), s.z);
+	rows[1][3] = t.y;
+	rows[2][0] = _mm_mul_ps(_mm_sub_ps(xz, wy), s.x);
+	rows[2][1] = _mm_mul_ps(_mm_add_ps(yz, wx), s.y);
+	rows[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), s.z);
+	rows[2][3] = t.z;
+}
+
+void ComposeSSE2(const FastVector3* translations, const FastQuaternion* rotations, const FastVector3* scales, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128 rows[3][4];
+		ComposeRows(Vector3x4::Gather(translations + i), Quaternionx4::Gather(rotations + i),
+					Vector3x4::Gather(scales + i), rows);
+
+		float* pOut = out + i * 12;
+		for (int row = 0; row < 3; ++row)
+		{
+			_MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+			_mm_store_ps(pOut + row * 4, rows[row][0]);
+			_mm_store_ps(pOut + 12 + row * 4, rows[row][1]);
+			_mm_store_ps(pOut + 24 + row * 4, rows[row][2]);
+			_mm_store_ps(pOut + 36 + row * 4, rows[row][3]);
+		}
+	}
+
+	for (; i < n; ++i)
+	{
+		reinterpret_cast<FastAffine3x4*>(out)[i].Compose(translations[i], rotations[i], scales[i]);
+	}
+}
+
+// 8 wide versions of the above
+SIMD_TARGET_AVX2 void DecomposeAVX2(const float* in, FastVector3* translations, FastQuaternion* rotations, FastVector3* scales, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		const float* pIn = in + i * 12;
+
+		// transforms i..i+3 in the low halves, i+4..i+7 in the high halves
+		__m256 m[3][4];
+		for (int row = 0; row < 3; ++row)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				m[row][k] = SimdCombine(_mm_load_ps(pIn + k * 12 + row * 4), _mm_load_ps(pIn + (k + 4) * 12 + row * 4));
+			}
+			SimdTranspose8x4(m[row][0], m[row][1], m[row][2], m[row][3]);
+		}
+
+		Vector3x8 cols[3] =
+		{
+			Vector3x8(m[0][0], m[1][0], m[2][0]),
+			Vector3x8(m[0][1], m[1][1], m[2][1]),
+			Vector3x8(m[0][2], m[1][2], m[2][2]),
+		};
+		Vector3x8 scale(cols[0].Length(), cols[1].Length(), cols[2].Length());
+		__m256 det = cols[0].Dot(Cross(cols[1], cols[2]));
+		scale.z = _mm256_xor_ps(scale.z, _mm256_and_ps(det, _mm256_set1_ps(-0.0f)));
+
+		cols[0].Multiply(_mm256_div_ps(_mm256_set1_ps(1.0f), scale.x));
+		cols[1].Multiply(_mm256_div_ps(_mm256_set1_ps(1.0f), scale.y));
+		cols[2].Multiply(_mm256_div_ps(_mm256_set1_ps(1.0f), scale.z));
+
+		Vector3x8(m[0][3], m[1][3], m[2][3]).Scatter(translations + i);
+		Quaternionx8::FromRotationColumns(cols).Scatter(rotations + i);
+		scale.Scatter(scales + i);
+	}
+
+	// Leftovers go through the 4 wide kernel
+	DecomposeSSE2(in + i * 12, translations + i, rotations + i, scales + i, n - i);
+}
+
+SIMD_TARGET_AVX2 void ComposeAVX2(const FastVector3* translations, const FastQuaternion* rotations, const FastVector3* scales, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		Vector3x8 t = Vector3x8::Gather(translations + i);
+		Quaternionx8 q = Quaternionx8::Gather(rotations + i);
+		Vector3x8 s = Vector3x8::Gather(scales + i);
+
+		const __m256 one = _mm256_set1_ps(1.0f);
+		__m256 x2 = _mm256_add_ps(q.x, q.x);
+		__m256 y2 = _mm256_add_ps(q.y, q.y);
+		__m256 z2 = _mm256_add_ps(q.z, q.z);
+		__m256 xx = _mm256_mul_ps(q.x, x2), yy = _mm256_mul_ps(q.y, y2), zz = _mm256_mul_ps(q.z, z2);
+		__m256 xy = _mm256_mul_ps(q.x, y2), xz = _mm256_mul_ps(q.x, z2), yz = _mm256_mul_ps(q.y, z2);
+		__m256 wx = _mm256_mul_ps(q.w, x2), wy = _mm256_mul_ps(q.w, y2), wz = _mm256_mul_ps(q.w, z2);
+
+		__m256 rows[3][4];
+		rows[0][0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), s.x);
+		rows[0][1] = _mm256_mul_ps(_mm256_sub_ps(xy, wz), s.y);
+		rows[0][2] = _mm256_mul_ps(_mm256_add_ps(xz, wy), s.z);
+		rows[0][3] = t.x;
+		rows[1][0] = _mm256_mul_ps(_mm256_add_ps(xy, wz), s.x);
+		rows[1][1] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), s.y);
+		rows[1][2] = _mm256_mul_ps(_mm256_sub_ps(yz, wx), s.z);
+		rows[1][3] = t.y;
+		rows[2][0] = _mm256_mul_ps(_mm256_sub_ps(xz, wy), s.x);
+		rows[2][1] = _mm256_mul_ps(_mm256_add_ps(yz, wx), s.y);
+		rows[2][2] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), s.z);
+		rows[2][3] = t.z;
+
+		float* pOut = out + i * 12;
+		for (int row = 0; row < 3; ++row)
+		{
+			SimdTranspose8x4(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+			for (int k = 0; k < 4; ++k)
+			{
+				_mm_store_ps(pOut + k * 12 + row * 4, _mm256_castps256_ps128(rows[row][k]));
+				_mm_store_ps(pOut + (k + 4) * 12 + row * 4, _mm256_extractf128_ps(rows[row][k], 1));
+			}
+		}
+	}
+
+	ComposeSSE2(translations + i, rotations + i, scales + i, out + i * 12, n - i);
+}
+
+const DecomposeKernel s_DecomposeKernels[SIMD_NUM_LEVELS] =
+{
+	DecomposeSSE2,
+	DecomposeSSE2,
+	DecomposeAVX2,
+};
+
+const ComposeKernel s_ComposeKernels[SIMD_NUM_LEVELS] =
+{
+	ComposeSSE2,
+	ComposeSSE2,
+	ComposeAVX2,
+};
+
+// Quaternion batches. The full packets use the fast gather/scatter, the
+// leftovers go through one partial packet.
+typedef void (*NormalizeQuatKernel)(const FastQuaternion*, FastQuaternion*, size_t);
+typedef void (*MultiplyQuatKernel)(const FastQuaternion*, const FastQuaternion*, FastQuaternion*, size_t);
+typedef void (*SlerpQuatKernel)(const FastQuaternion*, const FastQuaternion*, const float*, FastQuaternion*, size_t);
+
+void NormalizeQuatSSE2(const FastQuaternion* in, FastQuaternion* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Quaternionx4 q = Quaternionx4::Gather(in + i);
+		q.Normalize();
+		q.Scatter(out + i);
+	}
+	if (i < n)
+	{
+		Quaternionx4 q = Quaternionx4::Gather(in + i, int(n - i));
+		q.Normalize();
+		q.Scatter(out + i, int(n - i));
+	}
+}
+
+SIMD_TARGET_AVX2 void NormalizeQuatAVX2(const FastQuaternion* in, FastQuaternion* out, size_t n)
+{
+	for (size_t i = 0; i < n; i += 8)
+	{
+		int count = (n - i < 8) ? int(n - i) : 8;
+		Quaternionx8 q = Quaternionx8::Gather(in + i, count);
+		q.Normalize();
+		q.Scatter(out + i, count);
+	}
+}
+
+void MultiplyQuatSSE2(const FastQuaternion* a, const FastQuaternion* b, FastQuaternion* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Quaternionx4 q = Quaternionx4::Gather(a + i);
+		q.Multiply(Quaternionx4::Gather(b + i));
+		q.Scatter(out + i);
+	}
+	if (i < n)
+	{
+		int count = int(n - i);
+		Quaternionx4 q = Quaternionx4::Gather(a + i, count);
+		q.Multiply(Quaternionx4::Gather(b + i, count));
+		q.Scatter(out + i, count);
+	}
+}
+
+SIMD_TARGET_AVX2 void MultiplyQuatAVX2(const FastQuaternion* a, const FastQuaternion* b, FastQuaternion* out, size_t n)
+{
+	for (size_t i = 0; i < n; i += 8)
+	{
+		int count = (n - i < 8) ? int(n - i) : 8;
+		Quaternionx8 q = Quaternionx8::Gather(a + i, count);
+		q.Multiply(Quaternionx8::Gather(b + i, count));
+		q.Scatter(out + i, count);
+	}
+}
+
+void SlerpQuatSSE2(const FastQuaternion* a, const FastQuaternion* b, const float* f, FastQuaternion* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		Slerp(Quaternionx4::Gather(a + i), Quaternionx4::Gather(b + i), _mm_loadu_ps(f + i)).Scatter(out + i);
+	}
+	if (i < n)
+	{
+		int count = int(n - i);
+		SIMD_ALIGN(16) float pct[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int j = 0; j < count; ++j)
+		{
+			pct[j] = f[i + j];
+		}
+		Slerp(Quaternionx4::Gather(a + i, count), Quaternionx4::Gather(b + i, count), _mm_load_ps(pct)).Scatter(out + i, count);
+	}
+}
+
+SIMD_TARGET_AVX2 void SlerpQuatAVX2(const FastQuaternion* a, const FastQuaternion* b, const float* f, FastQuaternion* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		Slerp(Quaternionx8::Gather(a + i), Quaternionx8::Gather(b + i), _mm256_loadu_ps(f + i)).Scatter(out + i);
+	}
+	if (i < n)
+	{
+		SlerpQuatSSE2(a + i, b + i, f + i, out + i, n - i);
+	}
+}
+
+const NormalizeQuatKernel s_NormalizeQuatKernels[SIMD_NUM_LEVELS] =
+{
+	NormalizeQuatSSE2,
+	NormalizeQuatSSE2,
+	NormalizeQuatAVX2,
+};
+
+const MultiplyQuatKernel s_MultiplyQuatKernels[SIMD_NUM_LEVELS] =
+{
+	MultiplyQuatSSE2,
+	MultiplyQuatSSE2,
+	MultiplyQuatAVX2,
+};
+
+const SlerpQuatKernel s_SlerpQuatKernels[SIMD_NUM_LEVELS] =
+{
+	SlerpQuatSSE2,
+	SlerpQuatSSE2,
+	SlerpQuatAVX2,
+};
+
+typedef void (*SinCosKernel)(const float*, float*, float*, size_t, SimdAccuracy);
+
+void SinCosSSE2(const float* angles, float* sines, float* cosines, size_t n, SimdAccuracy accuracy)
+{
+	__m128 s, c;
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		SimdSinCos(_mm_loadu_ps(angles + i), s, c, accuracy);
+		_mm_storeu_ps(sines + i, s);
+		_mm_storeu_ps(cosines + i, c);
+	}
+	for (; i < n; ++i)
+	{
+		SimdSinCos(_mm_load_ss(angles + i), s, c, accuracy);
+		_mm_store_ss(sines + i, s);
+		_mm_store_ss(cosines + i, c);
+	}
+}
+
+SIMD_TARGET_AVX2 void SinCosAVX2(const float* angles, float* sines, float* cosines, size_t n, SimdAccuracy accuracy)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256 s, c;
+		SimdSinCos8(_mm256_loadu_ps(angles + i), s, c, accuracy);
+		_mm256_storeu_ps(sines + i, s);
+		_mm256_storeu_ps(cosines + i, c);
+	}
+	SinCosSSE2(angles + i, sines + i, cosines + i, n - i, accuracy);
+}
+
+const SinCosKernel s_SinCosKernels[SIMD_NUM_LEVELS] =
+{
+	SinCosSSE2,
+	SinCosSSE2,
+	SinCosAVX2,
+};
+
+// Strided point/normal kernels. Points are 3 floats each, stride bytes
+// apart, so only 12 bytes are read or written per point; the rest of the
+// vertex is left alone.
+//
+// Non-temporal stores only pay off when they fill whole lines. A partly
+// written line flushes its write-combining buffer early, so 12 bytes at a
+// time into an interleaved vertex buffer would be slower than plain stores.
+// The kernels only stream when the output is packed (stride 12) and 16 byte
+// aligned: 4 points are then exactly 3 aligned movntps, one line after another.
+typedef void (*TransformStridedKernel)(const float*, const char*, size_t, char*, size_t, size_t, bool);
+
+__forceinline __m128 LoadFloat3(const char* p)
+{
+	// p is only 4 byte aligned, so load x and y with movlps like StoreFloat3
+	const float* pFloats = reinterpret_cast<const float*>(p);
+	__m128 xy = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(pFloats));
+	return _mm_movelh_ps(xy, _mm_load_ss(pFloats + 2));
+}
+
+__forceinline void StoreFloat3(char* p, __m128 v)
+{
+	_mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+	_mm_store_ss(reinterpret_cast<float*>(p) + 2, _mm_movehl_ps(v, v));
+}
+
+// Interleaves 4 points (x, y and z each hold one component of all 4) into
+// x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 and streams them to p, which must be
+// 16 byte aligned
+__forceinline void StreamPackedFloat3x4(char* p, __m128 x, __m128 y, __m128 z)
+{
+	__m128 xyLo = _mm_unpacklo_ps(x, y);
+	__m128 xyHi = _mm_unpackhi_ps(x, y);
+	__m128 z0x1 = _mm_shuffle_ps(z, xyLo, _MM_SHUFFLE(2, 2, 0, 0));
+	__m128 y1z1 = _mm_shuffle_ps(xyLo, z, _MM_SHUFFLE(1, 1, 3, 3));
+	__m128 z2x3 = _mm_shuffle_ps(z, xyHi, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 y3z3 = _mm_shuffle_ps(xyHi, z, _MM_SHUFFLE(3, 3, 3, 3));
+	float* pFloats = reinterpret_cast<float*>(p);
+	_mm_stream_ps(pFloats, _mm_shuffle_ps(xyLo, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+	_mm_stream_ps(pFloats + 4, _mm_shuffle_ps(y1z1, xyHi, _MM_SHUFFLE(1, 0, 2, 0)));
+	_mm_stream_ps(pFloats + 8, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// Transforms the 4 points at pIn[0..3] and stores them to pOut[0..3].
+// All loads happen before any store, so in place works.
+// With bStream, the output must be packed and aligned, see above.
+template <bool bNormals>
+__forceinline void TransformFloat3x4(const __m128 m[3][4], const char* const pIn[4], char* const pOut[4], bool bStream)
+{
+	__m128 x = LoadFloat3(pIn[0]);
+	__m128 y = LoadFloat3(pIn[1]);
+	__m128 z = LoadFloat3(pIn[2]);
+	__m128 w = LoadFloat3(pIn[3]);
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+
+	__m128 result[4];
+	for (int row = 0; row < 3; ++row)
+	{
+		__m128 temp = _mm_add_ps(_mm_mul_ps(m[row][0], x), _mm_mul_ps(m[row][1], y));
+		temp = _mm_add_ps(temp, _mm_mul_ps(m[row][2], z));
+		result[row] = bNormals ? temp : _mm_add_ps(temp, m[row][3]);
+	}
+	if (bNormals)
+	{
+		__m128 lengthSq = _mm_add_ps(_mm_mul_ps(result[0], result[0]), _mm_mul_ps(result[1], result[1]));
+		lengthSq = _mm_add_ps(lengthSq, _mm_mul_ps(result[2], result[2]));
+		__m128 invLength = SimdRsqrt(lengthSq);
+		result[0] = _mm_mul_ps(result[0], invLength);
+		result[1] = _mm_mul_ps(result[1], invLength);
+		result[2] = _mm_mul_ps(result[2], invLength);
+	}
+	if (bStream)
+	{
+		StreamPackedFloat3x4(pOut[0], result[0], result[1], result[2]);
+		return;
+	}
+	result[3] = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(result[0], result[1], result[2], result[3]);
+	for (int k = 0; k < 4; ++k)
+	{
+		StoreFloat3(pOut[k], result[k]);
+	}
+}
+
+// Returns true if bStream asked for non-temporal stores and the output suits them
+__forceinline bool CanStreamFloat3(const char* out, size_t outStride, bool bStream)
+{
+	return bStream && outStride == 3 * sizeof(float) && (reinterpret_cast<size_t>(out) & 15) == 0;
+}
+
+template <bool bNormals>
+void TransformStridedSSE2(const float* rows, const char* in, size_t inStride, char* out, size_t outStride, size_t n, bool bStream)
+{
+	bStream = CanStreamFloat3(out, outStride, bStream);
+
+	__m128 m[3][4];
+	for (int row = 0; row < 3; ++row)
+	{
+		for (int col = 0; col < 4; ++col)
+		{
+			m[row][col] = _mm_set_ps1(rows[row * 4 + col]);
+		}
+	}
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		const char* pIn[4] = { in, in + inStride, in + inStride * 2, in + inStride * 3 };
+		char* pOut[4] = { out, out + outStride, out + outStride * 2, out + outStride * 3 };
+		TransformFloat3x4<bNormals>(m, pIn, pOut, bStream);
+		in += inStride * 4;
+		out += outStride * 4;
+	}
+
+	if (i < n)
+	{
+		// Pad the last packet by repeating the last point, which just
+		// writes the same result more than once. These are plain stores,
+		// the partial line isn't worth streaming.
+		const char* pIn[4];
+		char* pOut[4];
+		for (size_t k = 0; k < 4; ++k)
+		{
+			size_t index = (i + k < n) ? k : n - 1 - i;
+			pIn[k] = in + inStride * index;
+			pOut[k] = out + outStride * index;
+		}
+		TransformFloat3x4<bNormals>(m, pIn, pOut, false);
+	}
+
+	if (bStream)
+	{
+		_mm_sfence();
+	}
+}
+
+template <bool bNormals>
+SIMD_TARGET_AVX2 void TransformStridedAVX2(const float* rows, const char* in, size_t inStride, char* out, size_t outStride, size_t n, bool bStream)
+{
+	bStream = CanStreamFloat3(out, outStride, bStream);
+
+	__m256 m[3][4];
+	for (int row = 0; row < 3; ++row)
+	{
+		for (int col = 0; col < 4; ++col)
+		{
+			m[row][col] = _mm256_set1_ps(rows[row * 4 + col]);
+		}
+	}
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		// points 0-3 in the low halves, 4-7 in the high halves
+		__m256 x = SimdCombine(LoadFloat3(in), LoadFloat3(in + inStride * 4));
+		__m256 y = SimdCombine(LoadFloat3(in + inStride), LoadFloat3(in + inStride * 5));
+		__m256 z = SimdCombine(LoadFloat3(in + inStride * 2), LoadFloat3(in + inStride * 6));
+		__m256 w = SimdCombine(LoadFloat3(in + inStride * 3), LoadFloat3(in + inStride * 7));
+		SimdTranspose8x4(x, y, z, w);
+
+		__m256 result[4];
+		for (int row = 0; row < 3; ++row)
+		{
+			__m256 temp = bNormals ? _mm256_mul_ps(m[row][0], x) : _mm256_fmadd_ps(m[row][0], x, m[row][3]);
+			temp = _mm256_fmadd_ps(m[row][1], y, temp);
+			result[row] = _mm256_fmadd_ps(m[row][2], z, temp);
+		}
+		if (bNormals)
+		{
+			__m256 lengthSq = _mm256_mul_ps(result[0], result[0]);
+			lengthSq = _mm256_fmadd_ps(result[1], result[1], lengthSq);
+			lengthSq = _mm256_fmadd_ps(result[2], result[2], lengthSq);
+			__m256 invLength = SimdRsqrt8(lengthSq);
+			result[0] = _mm256_mul_ps(result[0], invLength);
+			result[1] = _mm256_mul_ps(result[1], invLength);
+			result[2] = _mm256_mul_ps(result[2], invLength);
+		}
+		if (bStream)
+		{
+			// Points 0-3 then 4-7, 96 packed bytes
+			StreamPackedFloat3x4(out, _mm256_castps256_ps128(result[0]), _mm256_castps256_ps128(result[1]),
+								 _mm256_castps256_ps128(result[2]));
+			StreamPackedFloat3x4(out + 48, _mm256_extractf128_ps(result[0], 1), _mm256_extractf128_ps(result[1], 1),
+								 _mm256_extractf128_ps(result[2], 1));
+		}
+		else
+		{
+			result[3] = _mm256_setzero_ps();
+			SimdTranspose8x4(result[0], result[1], result[2], result[3]);
+			for (int k = 0; k < 4; ++k)
+			{
+				StoreFloat3(out + outStride * k, _mm256_castps256_ps128(result[k]));
+				StoreFloat3(out + outStride * (k + 4), _mm256_extractf128_ps(result[k], 1));
+			}
+		}
+		in += inStride * 8;
+		out += outStride * 8;
+	}
+
+	// Leftovers go through the 4 wide kernel, which also does the sfence
+	TransformStridedSSE2<bNormals>(rows, in, inStride, out, outStride, n - i, bStream);
+}
+
+const TransformStridedKernel s_TransformPointsKernels[SIMD_NUM_LEVELS] =
+{
+	TransformStridedSSE2<false>,
+	TransformStridedSSE2<false>,
+	TransformStridedAVX2<false>,
+};
+
+const TransformStridedKernel s_TransformNormalsKernels[SIMD_NUM_LEVELS] =
+{
+	TransformStridedSSE2<true>,
+	TransformStridedSSE2<true>,
+	TransformStridedAVX2<true>,
+};
+
+} // anonymous namespace
+
+// The kernels above work on rows. A column major matrix is stored exactly like
+// the row major transpose, and (a * b)^T = b^T * a^T, so column major layouts
+// use the same kernels with the operands swapped.
+template <class Layout>
+void FastMatrix4T<Layout>::Multiply(const FastMatrix4T& rhs)
+{
+	if (Layout::bColumnMajor)
+	{
+		s_MultiplyKernels[GetSimdLevel()](rhs._vecs, _vecs, _vecs);
+	}
+	else
+	{
+		s_MultiplyKernels[GetSimdLevel()](_vecs, rhs._vecs, _vecs);
+	}
+}
+
+template <class Layout>
+void FastMatrix4T<Layout>::MultiplyBatch(const FastMatrix4T* a, const FastMatrix4T* b, FastMatrix4T* out, size_t n)
+{
+	if (Layout::bColumnMajor)
+	{
+		std::swap(a, b);
+	}
+	s_MultiplyBatchKernels[GetSimdLevel()](reinterpret_cast<const float*>(a), reinterpret_cast<const float*>(b),
+										   reinterpret_cast<float*>(out), n);
+}
+
+template <class Layout>
+void FastMatrix4T<Layout>::MultiplyBroadcast(const FastMatrix4T& a, const FastMatrix4T* b, FastMatrix4T* out, size_t n)
+{
+	if (Layout::bColumnMajor)
+	{
+		// a ends up on the right, which the broadcast kernels don't do
+		MultiplyKernel kernel = s_MultiplyKernels[GetSimdLevel()];
+		for (size_t i = 0; i < n; ++i)
+		{
+			kernel(b[i]._vecs, a._vecs, out[i]._vecs);
+		}
+	}
+	else
+	{
+		s_MultiplyBroadcastKernels[GetSimdLevel()](reinterpret_cast<const float*>(&a), reinterpret_cast<const float*>(b),
+												   reinterpret_cast<float*>(out), n);
+	}
+}
+
+void FastAffine3x4::Multiply(const FastAffine3x4& rhs)
+{
+	float* pThis = reinterpret_cast<float*>(_rows);
+	s_MultiplyAffineKernels[GetSimdLevel()](pThis, rhs.ToFloats(), pThis, 1);
+}
+
+void FastAffine3x4::MultiplyBatch(const FastAffine3x4* a, const FastAffine3x4* b, FastAffine3x4* out, size_t n)
+{
+	s_MultiplyAffineKernels[GetSimdLevel()](reinterpret_cast<const float*>(a), reinterpret_cast<const float*>(b),
+											reinterpret_cast<float*>(out), n);
+}
+
+void FastAffine3x4::CreateTranslation(const FastVector3& translation)
 {
-	// 1 0 0 temp.x
 	_rows[0] = _mm_setr_ps(1.0f, 0.0f, 0.0f, translation.GetX());
+	_rows[1] = _mm_setr_ps(0.0f, 1.0f, 0.0f, translation.GetY());
+	_rows[2] = _mm_setr_ps(0.0f, 0.0f, 1.0f, translation.GetZ());
+}
+
+void FastAffine3x4::CreateFromQuaternion(const FastQuaternion& q)
+{
+	FastMatrix4 temp;
+	temp.CreateFromQuaternion(q);
+	*this = FastAffine3x4(temp);
+}
+
+void FastAffine3x4::Invert()
+{
+	InvertAffineRows(_rows, _rows);
+}
+
+void FastAffine3x4::InvertOrthonormal()
+{
+	Dbg_Assert(IsOrthonormal(), "InvertOrthonormal called on a transform that isn't orthonormal.");
+	InvertOrthonormalRows(_rows, _rows);
+}
+
+void FastAffine3x4::InvertMany(const FastAffine3x4* in, FastAffine3x4* out, size_t n)
+{
+	s_InvertAffineKernels[GetSimdLevel()](reinterpret_cast<const float*>(in), reinterpret_cast<float*>(out), n);
+}
+
+void FastAffine3x4::TransformPoints(const float* in, size_t inStride, float* out, size_t outStride, size_t n, bool bStream) const
+{
+	s_TransformPointsKernels[GetSimdLevel()](ToFloats(), reinterpret_cast<const char*>(in), inStride,
+											 reinterpret_cast<char*>(out), outStride, n, bStream);
+}
+
+void FastAffine3x4::TransformNormals(const float* in, size_t inStride, float* out, size_t outStride, size_t n, bool bStream) const
+{
+	s_TransformNormalsKernels[GetSimdLevel()](ToFloats(), reinterpret_cast<const char*>(in), inStride,
+											  reinterpret_cast<char*>(out), outStride, n, bStream);
+}
+
+bool FastAffine3x4::IsOrthonormal(float epsilon) const
+{
+	return IsOrthonormalRows(_rows, epsilon);
+}
+
+void FastAffine3x4::CreateFromQuaternion(const FastQuaternion& q, const FastVector3& translation)
+{
+	CreateFromQuaternion(q);
+	_rows[0] = SimdSetW(_rows[0], translation.GetX());
+	_rows[1] = SimdSetW(_rows[1], translation.GetY());
+	_rows[2] = SimdSetW(_rows[2], translation.GetZ());
+}
+
+void FastAffine3x4::Decompose(FastVector3& translation, FastQuaternion& rotation, FastVector3& scale) const
+{
+	// Lane j of the sum of the squared rows is the squared length of column j
+	__m128 scaleSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_rows[0], _rows[0]), _mm_mul_ps(_rows[1], _rows[1])),
+								_mm_mul_ps(_rows[2], _rows[2]));
+	__m128 s = SimdSetW(_mm_sqrt_ps(scaleSq), 1.0f);
+
+	// A reflection shows up as a negative determinant, put it in z
+	__m128 det = SimdDot3(_rows[0], SimdCross3(_rows[1], _rows[2]));
+	s = _mm_xor_ps(s, _mm_and_ps(det, _mm_setr_ps(0.0f, 0.0f, -0.0f, 0.0f)));
+
+	FastAffine3x4 rot;
+	__m128 invScale = _mm_div_ps(_mm_set_ps1(1.0f), s);
+	rot._rows[0] = _mm_mul_ps(_rows[0], invScale);
+	rot._rows[1] = _mm_mul_ps(_rows[1], invScale);
+	rot._rows[2] = _mm_mul_ps(_rows[2], invScale);
+	rotation.CreateFromMatrix(rot);
+
+	// w of each row: r0.w, r1.w, r2.w, r2.w
+	__m128 t = _mm_shuffle_ps(_mm_unpackhi_ps(_rows[0], _rows[1]), _rows[2], _MM_SHUFFLE(3, 3, 3, 2));
+	translation = FastVector3(SimdSetW(t, 1.0f));
+	scale = FastVector3(s);
+}
+
+void FastAffine3x4::Compose(const FastVector3& translation, const FastQuaternion& rotation, const FastVector3& scale)
+{
+	CreateFromQuaternion(rotation, translation);
+	// Scaling first multiplies column j by scale[j], w keeps the translation
+	__m128 s = SimdSetW(scale._data, 1.0f);
+	_rows[0] = _mm_mul_ps(_rows[0], s);
+	_rows[1] = _mm_mul_ps(_rows[1], s);
+	_rows[2] = _mm_mul_ps(_rows[2], s);
+}
+
+void FastAffine3x4::DecomposeBatch(const FastAffine3x4* in, FastVector3* translations, FastQuaternion* rotations,
+								   FastVector3* scales, size_t n)
+{
+	s_DecomposeKernels[GetSimdLevel()](reinterpret_cast<const float*>(in), translations, rotations, scales, n);
+}
+
+void FastAffine3x4::ComposeBatch(const FastVector3* translations, const FastQuaternion* rotations,
+								 const FastVector3* scales, FastAffine3x4* out, size_t n)
+{
+	s_ComposeKernels[GetSimdLevel()](translations, rotations, scales, reinterpret_cast<float*>(out), n);
+}
+
+void FastQuaternion::CreateFromMatrix(const FastAffine3x4& mat)
+{
+	// Only done at load time, so this is the usual scalar version.
+	// Start from the largest of w, x, y, z to keep the divide well conditioned.
+	const float* m = mat.ToFloats();
+	float m00 = m[0], m01 = m[1], m02 = m[2];
+	float m10 = m[4], m11 = m[5], m12 = m[6];
+	float m20 = m[8], m21 = m[9], m22 = m[10];
+	float trace = m00 + m11 + m22;
+	if (trace > 0.0f)
+	{
+		float s = 0.5f / sqrtf(trace + 1.0f);
+		_data = _mm_setr_ps((m21 - m12) * s, (m02 - m20) * s, (m10 - m01) * s, 0.25f / s);
+	}
+	else if (m00 > m11 && m00 > m22)
+	{
+		float s = 0.5f / sqrtf(1.0f + m00 - m11 - m22);
+		_data = _mm_setr_ps(0.25f / s, (m01 + m10) * s, (m02 + m20) * s, (m21 - m12) * s);
+	}
+	else if (m11 > m22)
+	{
+		float s = 0.5f / sqrtf(1.0f + m11 - m00 - m22);
+		_data = _mm_setr_ps((m01 + m10) * s, 0.25f / s, (m12 + m21) * s, (m02 - m20) * s);
+	}
+	else
+	{
+		float s = 0.5f / sqrtf(1.0f + m22 - m00 - m11);
+		_data = _mm_setr_ps((m02 + m20) * s, (m12 + m21) * s, 0.25f / s, (m10 - m01) * s);
+	}
+}
+
+void SinCos(const float* angles, float* sines, float* cosines, size_t n, SimdAccuracy accuracy)
+{
+	s_SinCosKernels[GetSimdLevel()](angles, sines, cosines, n, accuracy);
+}
+
+void FastQuaternion::NormalizeBatch(const FastQuaternion* in, FastQuaternion* out, size_t n)
+{
+	s_NormalizeQuatKernels[GetSimdLevel()](in, out, n);
+}
+
+void FastQuaternion::MultiplyBatch(const FastQuaternion* a, const FastQuaternion* b, FastQuaternion* out, size_t n)
+{
+	s_MultiplyQuatKernels[GetSimdLevel()](a, b, out, n);
+}
+
+void FastQuaternion::SlerpBatch(const FastQuaternion* a, const FastQuaternion* b, const float* f, FastQuaternion* out, size_t n)
+{
+	s_SlerpQuatKernels[GetSimdLevel()](a, b, f, out, n);
+}
+
+template <class Layout>
+void FastMatrix4T<Layout>::CreateTranslation(const FastVector3& translation)
+{
+	if (Layout::bColumnMajor)
+	{
+		// identity with (x, y, z, 1) in the last column
+		_vecs[0] = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		_vecs[1] = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+		_vecs[2] = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+		_vecs[3] = SimdSetW(translation._data, 1.0f);
+		return;
+	}
+
+	// 1 0 0 temp.x
+	_vecs[0] = SimdSetW(Identity._vecs[0], translation.GetX());
 
 	// 0 1 0 temp.y
-	_rows[1] = _mm_setr_ps(0.0f, 1.0f, 0.0f, translation.GetY());
+	_vecs[1] = SimdSetW(Identity._vecs[1], translation.GetY());
 
 	// 0 0 1 temp.z
-	_rows[2] = _mm_setr_ps(0.0f, 0.0f, 1.0f, translation.GetZ());
+	_vecs[2] = SimdSetW(Identity._vecs[2], translation.GetZ());
 
 	// 0 0 0 1
-	_rows[3] = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	_vecs[3] = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
 }
 
-void FastMatrix4::CreateFromQuaternion(const FastQuaternion& q)
+template <class Layout>
+void FastMatrix4T<Layout>::CreateFromQuaternion(const FastQuaternion& q)
 {
-	DirectX::XMMATRIX result = DirectX::XMMatrixRotationQuaternion(q._data);
-	_rows[0] = result.r[0];
-	_rows[1] = result.r[1];
-	_rows[2] = result.r[2];
-	_rows[3] = result.r[3];
-	// Have to transpose b/c DirectXMath assumes row vectors
-	_MM_TRANSPOSE4_PS(_rows[0], _rows[1], _rows[2], _rows[3]);
+	// Same formula as SlowMatrix4::CreateFromQuaternion, with the products
+	// computed three at a time.
+	__m128 quat = q._data;
+	__m128 quat2 = _mm_add_ps(quat, quat);
+
+	// 2xx, 2yy, 2zz
+	__m128 squares = _mm_mul_ps(quat, quat2);
+	// 1 - (2yy + 2zz), 1 - (2xx + 2zz), 1 - (2xx + 2yy)
+	__m128 diag = _mm_add_ps(_mm_shuffle_ps(squares, squares, _MM_SHUFFLER(1, 0, 0, 3)),
+							 _mm_shuffle_ps(squares, squares, _MM_SHUFFLER(2, 2, 1, 3)));
+	diag = _mm_sub_ps(_mm_set_ps1(1.0f), diag);
+
+	// 2xy, 2xz, 2yz
+	__m128 cross = _mm_mul_ps(_mm_shuffle_ps(quat, quat, _MM_SHUFFLER(0, 0, 1, 3)),
+							  _mm_shuffle_ps(quat2, quat2, _MM_SHUFFLER(1, 2, 2, 3)));
+	// 2zw, 2yw, 2xw
+	__m128 scalar = _mm_mul_ps(_mm_shuffle_ps(quat, quat, _MM_SHUFFLE(3, 3, 3, 3)),
+							   _mm_shuffle_ps(quat2, quat2, _MM_SHUFFLER(2, 1, 0, 3)));
+
+	SIMD_ALIGN(16) float d[4];
+	SIMD_ALIGN(16) float sum[4];
+	SIMD_ALIGN(16) float dif[4];
+	_mm_store_ps(d, diag);
+	_mm_store_ps(sum, _mm_add_ps(cross, scalar));
+	_mm_store_ps(dif, _mm_sub_ps(cross, scalar));
+
+	if (Layout::bColumnMajor)
+	{
+		_vecs[0] = _mm_setr_ps(d[0], sum[0], dif[1], 0.0f);
+		_vecs[1] = _mm_setr_ps(dif[0], d[1], sum[2], 0.0f);
+		_vecs[2] = _mm_setr_ps(sum[1], dif[2], d[2], 0.0f);
+	}
+	else
+	{
+		_vecs[0] = _mm_setr_ps(d[0], dif[0], sum[1], 0.0f);
+		_vecs[1] = _mm_setr_ps(sum[0], d[1], dif[2], 0.0f);
+		_vecs[2] = _mm_setr_ps(dif[1], sum[2], d[2], 0.0f);
+	}
+	_vecs[3] = Identity._vecs[3];
 }
 
 // Constructs a Look-At matrix
 // vUp MUST be normalized or bad things will happen
-void FastMatrix4::CreateLookAt( const FastVector3& vEye, const FastVector3& vAt, const FastVector3& vUp )
+template <class Layout>
+void FastMatrix4T<Layout>::CreateLookAt( const FastVector3& vEye, const FastVector3& vAt, const FastVector3& vUp )
 {
-	DirectX::XMMATRIX result = DirectX::XMMatrixLookAtLH(vEye._data, vAt._data, vUp._data);
-	_rows[0] = result.r[0];
-	_rows[1] = result.r[1];
-	_rows[2] = result.r[2];
-	_rows[3] = result.r[3];
+	// Left handed, same as SlowMatrix4::CreateLookAt
+	__m128 eye = vEye._data;
+
+	__m128 front = _mm_sub_ps(vAt._data, eye);
+	front = _mm_div_ps(front, _mm_sqrt_ps(SimdDot3(front, front)));
+
+	__m128 left = SimdCross3(vUp._data, front);
+	left = _mm_div_ps(left, _mm_sqrt_ps(SimdDot3(left, left)));
 
-	// Have to transpose b/c DirectXMath assumes row vectors
-	_MM_TRANSPOSE4_PS(_rows[0], _rows[1], _rows[2], _rows[3]);
+	__m128 up = SimdCross3(front, left);
+
+	// Each row is the axis, with -axis.eye in w
+	const __m128 mask = SimdMaskXYZ();
+	const __m128 negate = _mm_set_ps1(-0.0f);
+	__m128 rows[4];
+	rows[0] = _mm_or_ps(_mm_and_ps(left, mask),
+						_mm_andnot_ps(mask, _mm_xor_ps(SimdDot3(left, eye), negate)));
+	rows[1] = _mm_or_ps(_mm_and_ps(up, mask),
+						_mm_andnot_ps(mask, _mm_xor_ps(SimdDot3(up, eye), negate)));
+	rows[2] = _mm_or_ps(_mm_and_ps(front, mask),
+						_mm_andnot_ps(mask, _mm_xor_ps(SimdDot3(front, eye), negate)));
+	rows[3] = Identity._vecs[3];
+	SetRows(rows);
 }
 
-void FastMatrix4::CreatePerspectiveFOV(float fFOVy, float fAspectRatio, float fNear, float fFar)
+template <class Layout>
+void FastMatrix4T<Layout>::CreatePerspectiveFOV(float fFOVy, float fAspectRatio, float fNear, float fFar)
 {
-	float fYScale = tanf(1.57079633f - (fFOVy/2)); // cot(x) is the same as tan(pi/2 - x)
+	float sinHalf, cosHalf;
+	SinCos(fFOVy * 0.5f, sinHalf, cosHalf);
+	float fYScale = cosHalf / sinHalf; // cot(x)
 	float fXScale = fYScale / fAspectRatio;
 
-	_rows[0] = _mm_setr_ps(fXScale, 0.0f, 0.0f, 0.0f);
-	_rows[1] = _mm_setr_ps(0.0f, fYScale, 0.0f, 0.0f);
-	_rows[2] = _mm_setr_ps(0.0f, 0.0f, fFar/(fFar-fNear), -fNear*fFar/(fFar-fNear));
-	_rows[3] = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+	_vecs[0] = _mm_setr_ps(fXScale, 0.0f, 0.0f, 0.0f);
+	_vecs[1] = _mm_setr_ps(0.0f, fYScale, 0.0f, 0.0f);
+	if (Layout::bColumnMajor)
+	{
+		_vecs[2] = _mm_setr_ps(0.0f, 0.0f, fFar/(fFar-fNear), 1.0f);
+		_vecs[3] = _mm_setr_ps(0.0f, 0.0f, -fNear*fFar/(fFar-fNear), 0.0f);
+	}
+	else
+	{
+		_vecs[2] = _mm_setr_ps(0.0f, 0.0f, fFar/(fFar-fNear), -fNear*fFar/(fFar-fNear));
+		_vecs[3] = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+	}
 }
 
-void FastMatrix4::Invert()
+template <class Layout>
+void FastMatrix4T<Layout>::Invert()
 {
 	// Vectorizing this was a huge pain, so just use scalars :(
 	float tmp[12]; /* temp array for pairs */
-	float src[16]; /* array of transpose source matrix */
+	SIMD_ALIGN(16) float src[16]; /* array of transpose source matrix */
 	float dst[16]; /* storage */
 	float det; /* determinant */
 
-	// row 1 to col 1
-	src[0] = _rows[0].m128_f32[0];
-	src[4] = _rows[0].m128_f32[1];
-	src[8] = _rows[0].m128_f32[2];
-	src[12] = _rows[0].m128_f32[3];
-
-	// row 2 to col 2
-	src[1] = _rows[1].m128_f32[0];
-	src[5] = _rows[1].m128_f32[1];
-	src[9] = _rows[1].m128_f32[2];
-	src[13] = _rows[1].m128_f32[3];
-
-	// row 3 to col 3
-	src[2] = _rows[2].m128_f32[0];
-	src[6] = _rows[2].m128_f32[1];
-	src[10] = _rows[2].m128_f32[2];
-	src[14] = _rows[2].m128_f32[3];
-
-	// row 4 to col 4
-	src[3] = _rows[3].m128_f32[0];
-	src[7] = _rows[3].m128_f32[1];
-	src[11] = _rows[3].m128_f32[2];
-	src[15] = _rows[3].m128_f32[3];
+	// rows to columns, column major already has them
+	__m128 col0 = _vecs[0];
+	__m128 col1 = _vecs[1];
+	__m128 col2 = _vecs[2];
+	__m128 col3 = _vecs[3];
+	if (!Layout::bColumnMajor)
+	{
+		_MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+	}
+	_mm_store_ps(src, col0);
+	_mm_store_ps(src + 4, col1);
+	_mm_store_ps(src + 8, col2);
+	_mm_store_ps(src + 12, col3);
 
 // 	for (int i = 0; i < 4; i++) {
 // 		src[i] = mat[i*4];
@@ -175,16 +1549,92 @@ void FastMatrix4::Invert()
 	for (int j = 0; j < 16; j++)
 		dst[j] *= det;
 
-	// Set it back
-	_rows[0] = _mm_setr_ps(dst[0], dst[1], dst[2], dst[3]);
-	_rows[1] = _mm_setr_ps(dst[4], dst[5], dst[6], dst[7]);
-	_rows[2] = _mm_setr_ps(dst[8], dst[9], dst[10], dst[11]);
-	_rows[3] = _mm_setr_ps(dst[12], dst[13], dst[14], dst[15]);
+	// Set it back, dst is row by row
+	if (Layout::bColumnMajor)
+	{
+		_vecs[0] = _mm_setr_ps(dst[0], dst[4], dst[8], dst[12]);
+		_vecs[1] = _mm_setr_ps(dst[1], dst[5], dst[9], dst[13]);
+		_vecs[2] = _mm_setr_ps(dst[2], dst[6], dst[10], dst[14]);
+		_vecs[3] = _mm_setr_ps(dst[3], dst[7], dst[11], dst[15]);
+	}
+	else
+	{
+		_vecs[0] = _mm_setr_ps(dst[0], dst[1], dst[2], dst[3]);
+		_vecs[1] = _mm_setr_ps(dst[4], dst[5], dst[6], dst[7]);
+		_vecs[2] = _mm_setr_ps(dst[8], dst[9], dst[10], dst[11]);
+		_vecs[3] = _mm_setr_ps(dst[12], dst[13], dst[14], dst[15]);
+	}
 }
 
+// These work on rows, so column major layouts transpose in and out
+template <class Layout>
+void FastMatrix4T<Layout>::InvertAffine()
+{
+	Dbg_Assert(IsAffine(), "InvertAffine called on a matrix whose bottom row isn't (0, 0, 0, 1).");
+	__m128 rows[4];
+	GetRows(rows);
+	InvertAffineRows(rows, rows);
+	rows[3] = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	SetRows(rows);
+}
+
+template <class Layout>
+void FastMatrix4T<Layout>::InvertOrthonormal()
+{
+	Dbg_Assert(IsAffine(), "InvertOrthonormal called on a matrix whose bottom row isn't (0, 0, 0, 1).");
+	Dbg_Assert(IsOrthonormal(), "InvertOrthonormal called on a matrix that isn't orthonormal.");
+	__m128 rows[4];
+	GetRows(rows);
+	InvertOrthonormalRows(rows, rows);
+	rows[3] = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	SetRows(rows);
+}
+
+template <class Layout>
+void FastMatrix4T<Layout>::Decompose(FastVector3& translation, FastQuaternion& rotation, FastVector3& scale) const
+{
+	FastAffine3x4(*this).Decompose(translation, rotation, scale);
+}
+
+template <class Layout>
+void FastMatrix4T<Layout>::Compose(const FastVector3& translation, const FastQuaternion& rotation, const FastVector3& scale)
+{
+	FastAffine3x4 temp;
+	temp.Compose(translation, rotation, scale);
+	temp.ToMatrix4(*this);
+}
+
+template <class Layout>
+bool FastMatrix4T<Layout>::IsAffine(float epsilon) const
+{
+	__m128 rows[4];
+	GetRows(rows);
+	__m128 diff = _mm_sub_ps(rows[3], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+	__m128 absDiff = _mm_andnot_ps(_mm_set_ps1(-0.0f), diff);
+	return _mm_movemask_ps(_mm_cmpgt_ps(absDiff, _mm_set_ps1(epsilon))) == 0;
+}
+
+template <class Layout>
+bool FastMatrix4T<Layout>::IsOrthonormal(float epsilon) const
+{
+	__m128 rows[4];
+	GetRows(rows);
+	return IsOrthonormalRows(rows, epsilon);
+}
+
+template class FastMatrix4T<MatrixRowMajor>;
+template class FastMatrix4T<MatrixColumnMajor>;
+
 void FastVector3::Rotate(const FastQuaternion& q)
 {
-	_data = DirectX::XMVector3Rotate(_data, q._data);
+	// v + 2.0*cross(q.xyz, cross(q.xyz,v) + q.w*v);
+	__m128 qw = _mm_shuffle_ps(q._data, q._data, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128 temp = _mm_add_ps(SimdCross3(q._data, _data), _mm_mul_ps(qw, _data));
+	temp = SimdCross3(q._data, temp);
+	temp = _mm_add_ps(temp, temp);
+
+	// cross products leave w at 0, so w is unchanged
+	_data = _mm_add_ps(_data, temp);
 }
 
 } // namespace ITP485
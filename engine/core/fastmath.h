@@ -1,13 +1,13 @@
 // FastMath.h defines SIMD vector, matrix, and quaternion libraries
-// NOTE: This library uses SSE4.1 extensions, which is not supported
-// by AMD.
+// NOTE: Inline functions only require SSE2. Heavier kernels (such as matrix
+// multiply) have SSE2, SSE4.1 and AVX2/FMA versions chosen at runtime,
+// see simd.h.
 #ifndef _FASTMATH_H_
 #define _FASTMATH_H_
 
-#include <xmmintrin.h>
-#include <smmintrin.h>
+#include "simd.h"
 #include <cmath>
-#include <DirectXMath.h>
+#include <cstddef>
 
 // Define D3D Matrix here so we don't have to replicate
 #ifndef D3DMATRIX_DEFINED
@@ -26,9 +26,6 @@ typedef struct _D3DMATRIX {
 #define D3DMATRIX_DEFINED
 #endif
 
-#define _MM_SHUFFLER( xi, yi, zi, wi ) _MM_SHUFFLE( wi, zi, yi, xi )
-
-
 namespace ITP485
 {
 
@@ -40,212 +37,335 @@ const float PiOver2 = 3.1415926535f / 2.0f;
 const float PiOver4 = 3.1415926535f / 4.0f;
 #endif
 
-// 4x4 Matrix class using SIMD
-__declspec(align(16)) class FastMatrix4
+// Computes the sine and cosine of angle (in radians) together.
+// See SimdSinCos for the accuracy tiers.
+__forceinline void SinCos(float angle, float& s, float& c, SimdAccuracy accuracy = SIMD_PRECISE)
+{
+	__m128 sines, cosines;
+	SimdSinCos(_mm_set_ss(angle), sines, cosines, accuracy);
+	s = _mm_cvtss_f32(sines);
+	c = _mm_cvtss_f32(cosines);
+}
+
+// Returns 1 / f at the requested accuracy
+__forceinline float Reciprocal(float f, SimdAccuracy accuracy = SIMD_PRECISE)
+{
+	return _mm_cvtss_f32(SimdReciprocal(_mm_set_ss(f), accuracy));
+}
+
+// sines[i] = sin(angles[i]), cosines[i] = cos(angles[i]).
+// Works on 4 (or 8 with AVX2) angles at a time, the arrays don't need to be aligned.
+void SinCos(const float* angles, float* sines, float* cosines, size_t n, SimdAccuracy accuracy = SIMD_PRECISE);
+
+class FastVector3;
+class FastQuaternion;
+class FastAffine3x4;
+class Vector3x4;
+class Vector3x8;
+class Quaternionx4;
+class Quaternionx8;
+class FastDualQuaternion;
+
+// Storage layouts for FastMatrix4T. Either way the math is the same (column
+// vectors, result = M * v), only the order of the floats in memory changes.
+
+// The 4 registers hold the rows. Multiply broadcasts the elements of the lhs
+// against the rows of the rhs, but transforming a vector takes a transpose.
+struct MatrixRowMajor
+{
+	static const bool bColumnMajor = false;
+};
+
+// The 4 registers hold the columns. Multiply and transforming a vector are both
+// broadcast-multiply-adds. D3D wants rows, so StoreD3D transposes on upload.
+struct MatrixColumnMajor
+{
+	static const bool bColumnMajor = true;
+};
+
+// Set FASTMATH_COLUMN_MAJOR to 1 to make FastMatrix4 column major
+#ifndef FASTMATH_COLUMN_MAJOR
+#define FASTMATH_COLUMN_MAJOR 0
+#endif
+
+#if FASTMATH_COLUMN_MAJOR
+typedef MatrixColumnMajor FastMatrixLayout;
+#else
+typedef MatrixRowMajor FastMatrixLayout;
+#endif
+
+template <class Layout> class FastMatrix4T;
+typedef FastMatrix4T<FastMatrixLayout> FastMatrix4;
+
+// 4x4 Matrix class using SIMD. Layout is MatrixRowMajor or MatrixColumnMajor,
+// the out of line functions are instantiated for both in fastmath.cpp.
+template <class Layout>
+class SIMD_ALIGN(16) FastMatrix4T
 {
 private:
+	// Rows or columns, depending on Layout
 	union 
 	{
-		__m128 _rows[4];
+		__m128 _vecs[4];
 		D3DMATRIX _d3dm;
 	};
 public:
+	template <class> friend class FastMatrix4T;
 	friend class FastVector3;
 	friend class FastQuaternion;
+	friend class FastAffine3x4;
+	friend class Vector3x4;
+	friend class Vector3x8;
 
 	// Default constructor does nothing
-	__forceinline FastMatrix4() {}
+	__forceinline FastMatrix4T() {}
 
 	// Constructs the matrix based on the passed-in floating point array[rows][column]
-	__forceinline FastMatrix4(float mat[4][4])
+	__forceinline FastMatrix4T(float mat[4][4])
 	{
-		_rows[0] = _mm_setr_ps(mat[0][0], mat[0][1], mat[0][2], mat[0][3]);
-		_rows[1] = _mm_setr_ps(mat[1][0], mat[1][1], mat[1][2], mat[1][3]);
-		_rows[2] = _mm_setr_ps(mat[2][0], mat[2][1], mat[2][2], mat[2][3]);
-		_rows[3] = _mm_setr_ps(mat[3][0], mat[3][1], mat[3][2], mat[3][3]);
+		Set(mat);
 	}
 
 	__forceinline void Set(float mat[4][4])
 	{
-		_rows[0] = _mm_setr_ps(mat[0][0], mat[0][1], mat[0][2], mat[0][3]);
-		_rows[1] = _mm_setr_ps(mat[1][0], mat[1][1], mat[1][2], mat[1][3]);
-		_rows[2] = _mm_setr_ps(mat[2][0], mat[2][1], mat[2][2], mat[2][3]);
-		_rows[3] = _mm_setr_ps(mat[3][0], mat[3][1], mat[3][2], mat[3][3]);
+		const __m128 rows[4] =
+		{
+			_mm_setr_ps(mat[0][0], mat[0][1], mat[0][2], mat[0][3]),
+			_mm_setr_ps(mat[1][0], mat[1][1], mat[1][2], mat[1][3]),
+			_mm_setr_ps(mat[2][0], mat[2][1], mat[2][2], mat[2][3]),
+			_mm_setr_ps(mat[3][0], mat[3][1], mat[3][2], mat[3][3]),
+		};
+		SetRows(rows);
 	}
 
 	// Copy constructor
-	__forceinline FastMatrix4(const FastMatrix4& rhs)
+	__forceinline FastMatrix4T(const FastMatrix4T& rhs)
 	{
-		_rows[0] = rhs._rows[0];
-		_rows[1] = rhs._rows[1];
-		_rows[2] = rhs._rows[2];
-		_rows[3] = rhs._rows[3];
+		_vecs[0] = rhs._vecs[0];
+		_vecs[1] = rhs._vecs[1];
+		_vecs[2] = rhs._vecs[2];
+		_vecs[3] = rhs._vecs[3];
 	}
 
 	// Assignment operator
-	__forceinline FastMatrix4& operator=(const FastMatrix4& rhs)
+	__forceinline FastMatrix4T& operator=(const FastMatrix4T& rhs)
 	{
-		_rows[0] = rhs._rows[0];
-		_rows[1] = rhs._rows[1];
-		_rows[2] = rhs._rows[2];
-		_rows[3] = rhs._rows[3];
+		_vecs[0] = rhs._vecs[0];
+		_vecs[1] = rhs._vecs[1];
+		_vecs[2] = rhs._vecs[2];
+		_vecs[3] = rhs._vecs[3];
 		return *this;
 	}
 
-	// Returns this FastMatrix4 as a D3DMATRIX*
+	// Returns the storage of this matrix as a D3DMATRIX*.
+	// For column major layouts that's the transpose, so use StoreD3D for
+	// anything D3D or a shader will read.
 	__forceinline D3DMATRIX* ToD3D()
 	{
 		return &_d3dm;
 	}
 
-	// Multiplies this matrix by the rhs matrix, and stores the result in this matrix.
-	void Multiply(const FastMatrix4& rhs)
+	// Stores this matrix in out, row by row, the way D3D and the shaders
+	// expect it. This is where column major layouts get transposed, once per upload.
+	__forceinline void StoreD3D(D3DMATRIX& out) const
 	{
-		__m128 rhs_row0 = rhs._rows[0];
-		__m128 rhs_row1 = rhs._rows[1];
-		__m128 rhs_row2 = rhs._rows[2];
-		__m128 rhs_row3 = rhs._rows[3];
+		__m128 rows[4];
+		GetRows(rows);
+		_mm_storeu_ps(out.m[0], rows[0]);
+		_mm_storeu_ps(out.m[1], rows[1]);
+		_mm_storeu_ps(out.m[2], rows[2]);
+		_mm_storeu_ps(out.m[3], rows[3]);
+	}
 
-		// transpose the rhs matrix
-		_MM_TRANSPOSE4_PS(rhs_row0, rhs_row1, rhs_row2, rhs_row3);
+	// Returns the element at row, col
+	__forceinline float Get(int row, int col) const
+	{
+		return Layout::bColumnMajor ? _d3dm.m[col][row] : _d3dm.m[row][col];
+	}
 
-		for (int i = 0; i < 4; ++i)
+	// Copies the rows of this matrix to rows, transposing if the layout is column major
+	__forceinline void GetRows(__m128 rows[4]) const
+	{
+		rows[0] = _vecs[0];
+		rows[1] = _vecs[1];
+		rows[2] = _vecs[2];
+		rows[3] = _vecs[3];
+		if (Layout::bColumnMajor)
 		{
-			__m128 x = _mm_dp_ps(_rows[i], rhs_row0, 0xF1);
-			__m128 y = _mm_dp_ps(_rows[i], rhs_row1, 0xF2);
-			__m128 z = _mm_dp_ps(_rows[i], rhs_row2, 0xF4);
-			__m128 w = _mm_dp_ps(_rows[i], rhs_row3, 0xF8);
-
-			_rows[i] = _mm_add_ps(x, y);
-			_rows[i] = _mm_add_ps(_rows[i], z);
-			_rows[i] = _mm_add_ps(_rows[i], w);
+			_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
 		}
 	}
 
+	// Sets this matrix from its rows, transposing if the layout is column major
+	__forceinline void SetRows(const __m128 rows[4])
+	{
+		__m128 v0 = rows[0];
+		__m128 v1 = rows[1];
+		__m128 v2 = rows[2];
+		__m128 v3 = rows[3];
+		if (Layout::bColumnMajor)
+		{
+			_MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+		}
+		_vecs[0] = v0;
+		_vecs[1] = v1;
+		_vecs[2] = v2;
+		_vecs[3] = v3;
+	}
+
+	// Returns this * v for a 4 component vector.
+	// Row major does 4 dot products, column major adds up the columns scaled by v.
+	__forceinline __m128 Transform(__m128 v) const
+	{
+		if (!Layout::bColumnMajor)
+		{
+			return SimdTransform4(_vecs, v);
+		}
+		__m128 result = _mm_mul_ps(_vecs[0], _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+		result = _mm_add_ps(result, _mm_mul_ps(_vecs[1], _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+		result = _mm_add_ps(result, _mm_mul_ps(_vecs[2], _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+		return _mm_add_ps(result, _mm_mul_ps(_vecs[3], _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+	}
+
+	// Multiplies this matrix by the rhs matrix, and stores the result in this matrix.
+	// Uses the best kernel for this CPU (see fastmath.cpp).
+	void Multiply(const FastMatrix4T& rhs);
+
+	// Multiplies n pairs of matrices, out[i] = a[i] * b[i].
+	// out may be the same array as a or b, but must not partially overlap them.
+	static void MultiplyBatch(const FastMatrix4T* a, const FastMatrix4T* b, FastMatrix4T* out, size_t n);
+
+	// Multiplies one matrix against n matrices, out[i] = a * b[i].
+	// out may be the same array as b.
+	static void MultiplyBroadcast(const FastMatrix4T& a, const FastMatrix4T* b, FastMatrix4T* out, size_t n);
+
 	// Adds the rhs matrix to this one, storing in this
-	__forceinline void Add(FastMatrix4& rhs)
+	__forceinline void Add(FastMatrix4T& rhs)
 	{
-		_rows[0] = _mm_add_ps(_rows[0], rhs._rows[0]);
-		_rows[1] = _mm_add_ps(_rows[1], rhs._rows[1]);
-		_rows[2] = _mm_add_ps(_rows[2], rhs._rows[2]);
-		_rows[3] = _mm_add_ps(_rows[3], rhs._rows[3]);
+		_vecs[0] = _mm_add_ps(_vecs[0], rhs._vecs[0]);
+		_vecs[1] = _mm_add_ps(_vecs[1], rhs._vecs[1]);
+		_vecs[2] = _mm_add_ps(_vecs[2], rhs._vecs[2]);
+		_vecs[3] = _mm_add_ps(_vecs[3], rhs._vecs[3]);
 	}
 
 	// Subtracts this - rhs, storing in this
-	__forceinline void Sub(FastMatrix4& rhs)
+	__forceinline void Sub(FastMatrix4T& rhs)
 	{
-		_rows[0] = _mm_sub_ps(_rows[0], rhs._rows[0]);
-		_rows[1] = _mm_sub_ps(_rows[1], rhs._rows[1]);
-		_rows[2] = _mm_sub_ps(_rows[2], rhs._rows[2]);
-		_rows[3] = _mm_sub_ps(_rows[3], rhs._rows[3]);
+		_vecs[0] = _mm_sub_ps(_vecs[0], rhs._vecs[0]);
+		_vecs[1] = _mm_sub_ps(_vecs[1], rhs._vecs[1]);
+		_vecs[2] = _mm_sub_ps(_vecs[2], rhs._vecs[2]);
+		_vecs[3] = _mm_sub_ps(_vecs[3], rhs._vecs[3]);
 	}
 
 	// Given the passed in scale, constructs a Scale matrix
 	__forceinline void CreateScale(float scale)
 	{
 		// scale 0 0 0
-		_rows[0] = _mm_set_ss(scale);
-		_rows[0] = _mm_shuffle_ps(_rows[0], _rows[0], _MM_SHUFFLE(1, 1, 1, 0));
+		_vecs[0] = _mm_set_ss(scale);
+		_vecs[0] = _mm_shuffle_ps(_vecs[0], _vecs[0], _MM_SHUFFLE(1, 1, 1, 0));
 
 		// 0 scale 0 0
-		_rows[1] = _mm_set_ss(scale);
-		_rows[1] = _mm_shuffle_ps(_rows[1], _rows[1], _MM_SHUFFLE(1, 1, 0, 1));
+		_vecs[1] = _mm_set_ss(scale);
+		_vecs[1] = _mm_shuffle_ps(_vecs[1], _vecs[1], _MM_SHUFFLE(1, 1, 0, 1));
 
 		// 0 0 scale 0
-		_rows[2] = _mm_set_ss(scale);
-		_rows[2] = _mm_shuffle_ps(_rows[2], _rows[2], _MM_SHUFFLE(1, 0, 1, 1));
+		_vecs[2] = _mm_set_ss(scale);
+		_vecs[2] = _mm_shuffle_ps(_vecs[2], _vecs[2], _MM_SHUFFLE(1, 0, 1, 1));
 
 		// 0 0 0 1
-		_rows[3] = _mm_set_ss(1.0f);
-		_rows[3] = _mm_shuffle_ps(_rows[3], _rows[3], _MM_SHUFFLE(0, 1, 1, 1));
+		_vecs[3] = _mm_set_ss(1.0f);
+		_vecs[3] = _mm_shuffle_ps(_vecs[3], _vecs[3], _MM_SHUFFLE(0, 1, 1, 1));
 	}
 
+	// The rotations below are written as rows. The columns of a rotation are
+	// the rows of the opposite rotation, so column major just flips sin.
+
 	// Given the angle (in radians), constructs a Rotation about the X axis
 	__forceinline void CreateRotationX(float angle)
 	{
 		// 1 0 0 0
-		_rows[0] = _mm_set_ss(1.0f);
-		_rows[0] = _mm_shuffle_ps(_rows[0], _rows[0], _MM_SHUFFLE(1, 1, 1, 0));
+		_vecs[0] = _mm_set_ss(1.0f);
+		_vecs[0] = _mm_shuffle_ps(_vecs[0], _vecs[0], _MM_SHUFFLE(1, 1, 1, 0));
 
-		float cos_theta = cosf(angle);
-		float sin_theta = sinf(angle);
+		float sin_theta, cos_theta;
+		SinCos(Layout::bColumnMajor ? -angle : angle, sin_theta, cos_theta);
 
 		// 0 cos -sin 0
-		_rows[1] = _mm_setr_ps(0.0f, cos_theta, sin_theta * -1.0f, 0.0f);
+		_vecs[1] = _mm_setr_ps(0.0f, cos_theta, sin_theta * -1.0f, 0.0f);
 
 		// 0 sin cos 0
-		_rows[2] = _mm_setr_ps(0.0f, sin_theta, cos_theta, 0.0f);
+		_vecs[2] = _mm_setr_ps(0.0f, sin_theta, cos_theta, 0.0f);
 		
 		// 0 0 0 1
-		_rows[3] = _mm_set_ss(1.0f);
-		_rows[3] = _mm_shuffle_ps(_rows[3], _rows[3], _MM_SHUFFLE(0, 1, 1, 1));
+		_vecs[3] = _mm_set_ss(1.0f);
+		_vecs[3] = _mm_shuffle_ps(_vecs[3], _vecs[3], _MM_SHUFFLE(0, 1, 1, 1));
 	}
 
 	// Given the angle (in radians), constructs a Rotation about the Y axis
 	__forceinline void CreateRotationY(float angle)
 	{
-		float cos_theta = cosf(angle);
-		float sin_theta = sinf(angle);
+		float sin_theta, cos_theta;
+		SinCos(Layout::bColumnMajor ? -angle : angle, sin_theta, cos_theta);
 
 		// cos 0 sin 0
-		_rows[0] = _mm_setr_ps(cos_theta, 0.0f, sin_theta, 0.0f);
+		_vecs[0] = _mm_setr_ps(cos_theta, 0.0f, sin_theta, 0.0f);
 
 		// 0 1 0 0
-		_rows[1] = _mm_set_ss(1.0f);
-		_rows[1] = _mm_shuffle_ps(_rows[1], _rows[1], _MM_SHUFFLE(1, 1, 0, 1));
+		_vecs[1] = _mm_set_ss(1.0f);
+		_vecs[1] = _mm_shuffle_ps(_vecs[1], _vecs[1], _MM_SHUFFLE(1, 1, 0, 1));
 
 		// -sin 0 cos 0
-		_rows[2] = _mm_setr_ps(sin_theta * -1.0f, 0.0f, cos_theta, 0.0f);
+		_vecs[2] = _mm_setr_ps(sin_theta * -1.0f, 0.0f, cos_theta, 0.0f);
 
 		// 0 0 0 1
-		_rows[3] = _mm_set_ss(1.0f);
-		_rows[3] = _mm_shuffle_ps(_rows[3], _rows[3], _MM_SHUFFLE(0, 1, 1, 1));
+		_vecs[3] = _mm_set_ss(1.0f);
+		_vecs[3] = _mm_shuffle_ps(_vecs[3], _vecs[3], _MM_SHUFFLE(0, 1, 1, 1));
 	}
 
 	// Given the angle (in radians), constructs a Rotation about the Z axis
 	__forceinline void CreateRotationZ(float angle)
 	{
-		float cos_theta = cosf(angle);
-		float sin_theta = sinf(angle);
+		float sin_theta, cos_theta;
+		SinCos(Layout::bColumnMajor ? -angle : angle, sin_theta, cos_theta);
 
 		// cos -sin 0 0
-		_rows[0] = _mm_setr_ps(cos_theta, sin_theta * -1.0f, 0.0f, 0.0f);
+		_vecs[0] = _mm_setr_ps(cos_theta, sin_theta * -1.0f, 0.0f, 0.0f);
 
 		// sin cos 0 0
-		_rows[1] = _mm_setr_ps(sin_theta, cos_theta, 0.0f, 0.0f);
+		_vecs[1] = _mm_setr_ps(sin_theta, cos_theta, 0.0f, 0.0f);
 
 		// 0 0 1 0
-		_rows[2] = _mm_set_ss(1.0f);
-		_rows[2] = _mm_shuffle_ps(_rows[2], _rows[2], _MM_SHUFFLE(1, 0, 1, 1));
+		_vecs[2] = _mm_set_ss(1.0f);
+		_vecs[2] = _mm_shuffle_ps(_vecs[2], _vecs[2], _MM_SHUFFLE(1, 0, 1, 1));
 
 		// 0 0 0 1
-		_rows[3] = _mm_set_ss(1.0f);
-		_rows[3] = _mm_shuffle_ps(_rows[3], _rows[3], _MM_SHUFFLE(0, 1, 1, 1));
+		_vecs[3] = _mm_set_ss(1.0f);
+		_vecs[3] = _mm_shuffle_ps(_vecs[3], _vecs[3], _MM_SHUFFLE(0, 1, 1, 1));
 	}
 
-	__forceinline friend FastMatrix4 Lerp(const FastMatrix4& a, const FastMatrix4& b, float f)
+	__forceinline friend FastMatrix4T Lerp(const FastMatrix4T& a, const FastMatrix4T& b, float f)
 	{
 
-		FastMatrix4 retVal;
+		FastMatrix4T retVal;
 		
 		// row 0
 		__m128 pct = _mm_set_ps1(f);
-		retVal._rows[0] = _mm_mul_ps(b._rows[0], pct);
+		retVal._vecs[0] = _mm_mul_ps(b._vecs[0], pct);
 		__m128 ones = _mm_set_ps1(1.0f);
 		ones = _mm_sub_ps(ones, pct);
-		retVal._rows[0] = _mm_add_ps(retVal._rows[0], _mm_mul_ps(a._rows[0], ones));
+		retVal._vecs[0] = _mm_add_ps(retVal._vecs[0], _mm_mul_ps(a._vecs[0], ones));
 
 		// row 1
-		retVal._rows[1] = _mm_mul_ps(b._rows[1], pct);
-		retVal._rows[1] = _mm_add_ps(retVal._rows[1], _mm_mul_ps(a._rows[1], ones));
+		retVal._vecs[1] = _mm_mul_ps(b._vecs[1], pct);
+		retVal._vecs[1] = _mm_add_ps(retVal._vecs[1], _mm_mul_ps(a._vecs[1], ones));
 
 		// row 2
-		retVal._rows[2] = _mm_mul_ps(b._rows[2], pct);
-		retVal._rows[2] = _mm_add_ps(retVal._rows[2], _mm_mul_ps(a._rows[2], ones));
+		retVal._vecs[2] = _mm_mul_ps(b._vecs[2], pct);
+		retVal._vecs[2] = _mm_add_ps(retVal._vecs[2], _mm_mul_ps(a._vecs[2], ones));
 
 		// row 3
-		retVal._rows[3] = _mm_mul_ps(b._rows[3], pct);
-		retVal._rows[3] = _mm_add_ps(retVal._rows[3], _mm_mul_ps(a._rows[3], ones));
+		retVal._vecs[3] = _mm_mul_ps(b._vecs[3], pct);
+		retVal._vecs[3] = _mm_add_ps(retVal._vecs[3], _mm_mul_ps(a._vecs[3], ones));
 
 		return retVal;
 	}
@@ -264,22 +384,210 @@ public:
 	// Constructs a Perspective FOV matrix
 	void CreatePerspectiveFOV(float fFOVy, float fAspectRatio, float fNear, float fFar);
 
+	// Same as FastAffine3x4::Decompose, the bottom row is ignored
+	void Decompose(FastVector3& translation, FastQuaternion& rotation, FastVector3& scale) const;
+
+	// Same as FastAffine3x4::Compose, the bottom row is set to (0, 0, 0, 1)
+	void Compose(const FastVector3& translation, const FastQuaternion& rotation, const FastVector3& scale);
+
 	// Inverts the matrix
 	void Invert();
 
+	// Inverts a matrix whose bottom row is (0, 0, 0, 1).
+	// Much cheaper than Invert, asserts in debug if the matrix isn't affine
+	// or can't be inverted.
+	void InvertAffine();
+
+	// Inverts a rigid transform (rotation and translation only) by
+	// transposing the rotation. Asserts in debug if the upper 3x3 isn't
+	// orthonormal or the bottom row isn't (0, 0, 0, 1).
+	void InvertOrthonormal();
+
+	// Returns true if the bottom row is (0, 0, 0, 1)
+	bool IsAffine(float epsilon = 0.0001f) const;
+
+	// Returns true if the rows of the upper 3x3 are unit length and perpendicular
+	bool IsOrthonormal(float epsilon = 0.001f) const;
+
 	// Identity matrix
-	static const FastMatrix4 Identity;
+	static const FastMatrix4T Identity;
+};
+
+// Affine transform class using SIMD.
+// Stores the top 3 rows of a FastMatrix4, the bottom row is always (0, 0, 0, 1).
+// That's 48 bytes instead of 64, and a quarter less work to multiply.
+class SIMD_ALIGN(16) FastAffine3x4
+{
+private:
+	__m128 _rows[3];
+public:
+	friend class FastVector3;
+	template <class> friend class FastMatrix4T;
+
+	// Default constructor does nothing
+	__forceinline FastAffine3x4() {}
+
+	// Constructs the transform based on the passed-in floating point array[rows][column]
+	__forceinline FastAffine3x4(float mat[3][4])
+	{
+		_rows[0] = _mm_setr_ps(mat[0][0], mat[0][1], mat[0][2], mat[0][3]);
+		_rows[1] = _mm_setr_ps(mat[1][0], mat[1][1], mat[1][2], mat[1][3]);
+		_rows[2] = _mm_setr_ps(mat[2][0], mat[2][1], mat[2][2], mat[2][3]);
+	}
+
+	// Constructs the transform from the top 3 rows of mat.
+	// The bottom row of mat must be (0, 0, 0, 1).
+	template <class Layout>
+	__forceinline explicit FastAffine3x4(const FastMatrix4T<Layout>& mat)
+	{
+		__m128 rows[4];
+		mat.GetRows(rows);
+		_rows[0] = rows[0];
+		_rows[1] = rows[1];
+		_rows[2] = rows[2];
+	}
+
+	// Sets the transform from a 4x4 array, the bottom row is ignored
+	__forceinline void Set(float mat[4][4])
+	{
+		_rows[0] = _mm_setr_ps(mat[0][0], mat[0][1], mat[0][2], mat[0][3]);
+		_rows[1] = _mm_setr_ps(mat[1][0], mat[1][1], mat[1][2], mat[1][3]);
+		_rows[2] = _mm_setr_ps(mat[2][0], mat[2][1], mat[2][2], mat[2][3]);
+	}
+
+	// Copy constructor
+	__forceinline FastAffine3x4(const FastAffine3x4& rhs)
+	{
+		_rows[0] = rhs._rows[0];
+		_rows[1] = rhs._rows[1];
+		_rows[2] = rhs._rows[2];
+	}
+
+	// Assignment operator
+	__forceinline FastAffine3x4& operator=(const FastAffine3x4& rhs)
+	{
+		_rows[0] = rhs._rows[0];
+		_rows[1] = rhs._rows[1];
+		_rows[2] = rhs._rows[2];
+		return *this;
+	}
+
+	// Expands this transform into a full 4x4 matrix
+	template <class Layout>
+	__forceinline void ToMatrix4(FastMatrix4T<Layout>& out) const
+	{
+		const __m128 rows[4] = { _rows[0], _rows[1], _rows[2], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f) };
+		out.SetRows(rows);
+	}
+
+	// Returns the 12 floats of this transform, row by row.
+	// This is the layout of a row_major float3x4 shader constant.
+	__forceinline const float* ToFloats() const
+	{
+		return reinterpret_cast<const float*>(_rows);
+	}
+
+	// Multiplies this transform by the rhs transform, and stores the result in this.
+	// Uses the best kernel for this CPU (see fastmath.cpp).
+	void Multiply(const FastAffine3x4& rhs);
+
+	// Multiplies n pairs of transforms, out[i] = a[i] * b[i].
+	// out may be the same array as a or b, but must not partially overlap them.
+	static void MultiplyBatch(const FastAffine3x4* a, const FastAffine3x4* b, FastAffine3x4* out, size_t n);
+
+	// Given the passed in scale, constructs a Scale transform
+	__forceinline void CreateScale(float scale)
+	{
+		_rows[0] = _mm_setr_ps(scale, 0.0f, 0.0f, 0.0f);
+		_rows[1] = _mm_setr_ps(0.0f, scale, 0.0f, 0.0f);
+		_rows[2] = _mm_setr_ps(0.0f, 0.0f, scale, 0.0f);
+	}
+
+	// Interpolates each element between a and b, returning the result by value
+	__forceinline friend FastAffine3x4 Lerp(const FastAffine3x4& a, const FastAffine3x4& b, float f)
+	{
+		FastAffine3x4 retVal;
+		__m128 pct = _mm_set_ps1(f);
+		retVal._rows[0] = _mm_add_ps(a._rows[0], _mm_mul_ps(_mm_sub_ps(b._rows[0], a._rows[0]), pct));
+		retVal._rows[1] = _mm_add_ps(a._rows[1], _mm_mul_ps(_mm_sub_ps(b._rows[1], a._rows[1]), pct));
+		retVal._rows[2] = _mm_add_ps(a._rows[2], _mm_mul_ps(_mm_sub_ps(b._rows[2], a._rows[2]), pct));
+		return retVal;
+	}
+
+	// Has to be defined in fastmath.cpp because of circular dependency
+
+	// Given the translation vector, constructs a translation transform.
+	void CreateTranslation(const FastVector3& translation);
+
+	// Given the quaternion, constructs a rotation transform
+	void CreateFromQuaternion(const FastQuaternion& q);
+
+	// Given the quaternion and translation, constructs a rigid transform
+	// that rotates first, then translates.
+	void CreateFromQuaternion(const FastQuaternion& q, const FastVector3& translation);
+
+	// Inverts the transform. Asserts in debug if it can't be inverted.
+	void Invert();
+
+	// Inverts a rigid transform (rotation and translation only) by
+	// transposing the rotation. Asserts in debug if it isn't orthonormal.
+	void InvertOrthonormal();
+
+	// Inverts n transforms, out[i] = inverse(in[i]). out may be the same array as in.
+	// Works on 4 (or 8 with AVX2) transforms at a time.
+	static void InvertMany(const FastAffine3x4* in, FastAffine3x4* out, size_t n);
+
+	// Splits the transform into translation, rotation and scale, so that
+	// Compose(translation, rotation, scale) gives it back. scale is the length
+	// of each column of the upper 3x3. If the 3x3 has a reflection, scale.z
+	// is negative. Assumes there is no shear and no zero scale.
+	void Decompose(FastVector3& translation, FastQuaternion& rotation, FastVector3& scale) const;
+
+	// Constructs the transform that scales, then rotates, then translates
+	void Compose(const FastVector3& translation, const FastQuaternion& rotation, const FastVector3& scale);
+
+	// Batched versions of the above, for converting whole animation tracks.
+	// Work on 4 (or 8 with AVX2) transforms at a time.
+	static void DecomposeBatch(const FastAffine3x4* in, FastVector3* translations, FastQuaternion* rotations,
+							   FastVector3* scales, size_t n);
+	static void ComposeBatch(const FastVector3* translations, const FastQuaternion* rotations,
+							 const FastVector3* scales, FastAffine3x4* out, size_t n);
+
+	// Transforms n points (w is treated as 1.0f). Each point is 3 floats, and
+	// consecutive points are inStride/outStride bytes apart, so positions can be
+	// read from and written to an interleaved vertex buffer directly (32 bytes
+	// for VERTEX_P_N_T, 64 for VERTEX_P_N_S_T). Only the 3 floats of each point
+	// are written. in and out may be the same buffer if the strides match.
+	// Works on 4 (or 8 with AVX2) points at a time. If bStream is true and the
+	// output is packed (outStride 12) and 16 byte aligned, the results are
+	// written with non-temporal stores that go around the cache, which is
+	// faster for large outputs that won't be read again soon. Otherwise it's
+	// ignored: streaming 12 bytes at a time into an interleaved vertex buffer
+	// only fills part of each line, which is slower than plain stores.
+	void TransformPoints(const float* in, size_t inStride, float* out, size_t outStride, size_t n,
+						 bool bStream = false) const;
+
+	// Same as TransformPoints, but w is treated as 0.0f and the results are
+	// renormalized. With non-uniform scale, call this on the inverse transpose.
+	void TransformNormals(const float* in, size_t inStride, float* out, size_t outStride, size_t n,
+						  bool bStream = false) const;
+
+	// Returns true if the rows of the upper 3x3 are unit length and perpendicular
+	bool IsOrthonormal(float epsilon = 0.001f) const;
+
+	// Identity transform
+	static const FastAffine3x4 Identity;
 };
 
 // 3D vector class using SIMD
-__declspec(align(16)) class FastVector3
+class SIMD_ALIGN(16) FastVector3
 {
 private:
 	__m128 _data;
-	// _data.m128_f32[0] = x
-	// _data.m128_f32[1] = y
-	// _data.m128_f32[2] = z
-	// _data.m128_f32[3] = w
+	// lane 0 = x
+	// lane 1 = y
+	// lane 2 = z
+	// lane 3 = w
 public:
 
 	// Default constructor does nothing
@@ -314,25 +622,25 @@ public:
 	// Returns the X component (index 0) - SLOW
 	__forceinline float GetX() const
 	{
-		return _data.m128_f32[0];
+		return SimdGetX(_data);
 	}
 	
 	// Returns the Y component (index 1) - SLOW
 	__forceinline float GetY() const
 	{
-		return _data.m128_f32[1];
+		return SimdGetY(_data);
 	}
 	
 	// Returns the Z component (index 2) - SLOW
 	__forceinline float GetZ() const
 	{
-		return _data.m128_f32[2];
+		return SimdGetZ(_data);
 	}
 
 	// Returns the W component (index 3) - SLOW
 	__forceinline float GetW() const
 	{
-		return _data.m128_f32[3];
+		return SimdGetW(_data);
 	}
 	
 	// Sets the x, y, and z components to passed values.
@@ -345,36 +653,26 @@ public:
 	// Sets the X component
 	__forceinline void SetX(float x)
 	{
-		// set index 0 of temp to x
-		__m128 temp = _mm_set_ss(x);
-		// insert the value into the X component
-		_data = _mm_insert_ps(_data, temp, 0x00);
+		_data = SimdSetX(_data, x);
 	}
 	
 	// Sets the Y component
 	__forceinline void SetY(float y)
 	{
-		// set index 0 of temp to y
-		__m128 temp = _mm_set_ss(y);
-		// insert the value into the Y component
-		_data = _mm_insert_ps(_data, temp, 0x10);
+		_data = SimdSetY(_data, y);
 	}
 	
 	// Sets the Z component
 	__forceinline void SetZ(float z)
 	{
-		// set index 0 of temp to z
-		__m128 temp = _mm_set_ss(z);
-		// insert the value into the Z component
-		_data = _mm_insert_ps(_data, temp, 0x20);
+		_data = SimdSetZ(_data, z);
 	}
 
 	// Computes the dot product between this vector and rhs.
 	// Returns the float result.
 	__forceinline float Dot(const FastVector3& rhs) const
 	{
-		__m128 temp = _mm_dp_ps(_data, rhs._data, 0x71);
-		return temp.m128_f32[0];
+		return _mm_cvtss_f32(SimdDot3(_data, rhs._data));
 	}
 
 	// Adds this vector to rhs, storing in this
@@ -396,41 +694,63 @@ public:
 		_data = _mm_mul_ps(_data, temp);
 	}
 
-	// Normalizes this vector
-	__forceinline void Normalize()
+	// Normalizes this vector. SIMD_PRECISE divides by the length, the other
+	// tiers multiply by an rsqrt estimate (see SimdAccuracy).
+	__forceinline void Normalize(SimdAccuracy accuracy = SIMD_FAST)
 	{
-		__m128 temp = _mm_dp_ps(_data, _data, 0x77);
-		temp = _mm_rsqrt_ps(temp);
-		_data = _mm_mul_ps(_data, temp);
- 	}
+		__m128 temp = SimdDot3(_data, _data);
+		if (accuracy == SIMD_PRECISE)
+		{
+			_data = _mm_div_ps(_data, _mm_sqrt_ps(temp));
+		}
+		else
+		{
+			_data = _mm_mul_ps(_data, SimdInvSqrt(temp, accuracy));
+		}
+	}
 
 	// Returns the length squared of this vector
 	__forceinline float LengthSquared() const
 	{
-		__m128 temp = _mm_dp_ps(_data, _data, 0x71);
-		return temp.m128_f32[0];
+		return _mm_cvtss_f32(SimdDot3(_data, _data));
 	}
 
 	// Returns the length of this vector
+	__forceinline float Length(SimdAccuracy accuracy = SIMD_PRECISE) const
+	{
+		return _mm_cvtss_f32(SimdSqrt(SimdDot3(_data, _data), accuracy));
+	}
+
+	// Returns 1 / length of this vector
+	__forceinline float InvLength(SimdAccuracy accuracy = SIMD_PRECISE) const
+	{
+		return _mm_cvtss_f32(SimdInvSqrt(SimdDot3(_data, _data), accuracy));
+	}
+
+	// Same as above with the accuracy fixed at compile time, so code can
+	// pick its tier with a template parameter, e.g. v.Normalize<SIMD_ESTIMATE>()
+	template <SimdAccuracy accuracy>
+	__forceinline void Normalize()
+	{
+		Normalize(accuracy);
+	}
+
+	template <SimdAccuracy accuracy>
 	__forceinline float Length() const
 	{
-		__m128 temp = _mm_dp_ps(_data, _data, 0x71);
-		temp = _mm_sqrt_ps(temp);
-		return temp.m128_f32[0];
+		return Length(accuracy);
+	}
+
+	template <SimdAccuracy accuracy>
+	__forceinline float InvLength() const
+	{
+		return InvLength(accuracy);
 	}
 
 	// Does a cross product between lhs and rhs, returning the result vector by value
 	__forceinline friend FastVector3 Cross(const FastVector3& lhs, const FastVector3& rhs)
 	{
-		__m128 temp1 = _mm_shuffle_ps(lhs._data, lhs._data, _MM_SHUFFLER(1, 2, 0, 3));
-		__m128 temp2 = _mm_shuffle_ps(rhs._data, rhs._data, _MM_SHUFFLER(2, 0, 1, 3));
-		__m128 left = _mm_mul_ps(temp1, temp2);
-
-		temp1 = _mm_shuffle_ps(lhs._data, lhs._data, _MM_SHUFFLER(2, 0, 1, 3));
-		temp2 = _mm_shuffle_ps(rhs._data, rhs._data, _MM_SHUFFLER(1, 2, 0, 3));
-		__m128 right = _mm_mul_ps(temp1, temp2);
-
-		return FastVector3(_mm_sub_ps(left, right));
+		return FastVector3(SimdCross3(lhs._data, rhs._data));
 	}
 
 	// Interpolates between a and b, returning the result vector by value
@@ -472,18 +792,11 @@ public:
 
 	// Transforms this vector by the passed 4x4 matrix
 	// w is set to 1.0f before the transform is done
-	__forceinline void Transform(const FastMatrix4 &mat)
+	template <class Layout>
+	__forceinline void Transform(const FastMatrix4T<Layout> &mat)
 	{
-		_data = _mm_insert_ps(_data, _mm_set_ss(1.0f), 0x30);
-
-		__m128 x = _mm_dp_ps(mat._rows[0], _data, 0xF1);
-		__m128 y = _mm_dp_ps(mat._rows[1], _data, 0xF2);
-		__m128 z = _mm_dp_ps(mat._rows[2], _data, 0xF4);
-		__m128 w = _mm_dp_ps(mat._rows[3], _data, 0xF8);
-
-		_data = _mm_add_ps(x, y);
-		_data = _mm_add_ps(_data, z);
-		_data = _mm_add_ps(_data, w);
+		_data = SimdSetW(_data, 1.0f);
+		_data = mat.Transform(_data);
  	}
 
 	// Rotates this vector by the passed quaternion
@@ -491,22 +804,37 @@ public:
 
 	// Transforms this vector by the passed 4x4 matrix
 	// w is set to 0.0f before the transform is done
-	__forceinline void TransformAsVector(const FastMatrix4 &mat)
+	template <class Layout>
+	__forceinline void TransformAsVector(const FastMatrix4T<Layout> &mat)
 	{
-		_data = _mm_insert_ps(_data, _mm_set_ps1(0.0f), 0x30);
+		_data = _mm_and_ps(_data, SimdMaskXYZ());
+		_data = mat.Transform(_data);
+ 	}
 
-		__m128 x = _mm_dp_ps(mat._rows[0], _data, 0xF1);
-		__m128 y = _mm_dp_ps(mat._rows[1], _data, 0xF2);
-		__m128 z = _mm_dp_ps(mat._rows[2], _data, 0xF4);
-		__m128 w = _mm_dp_ps(mat._rows[3], _data, 0xF8);
+	// Transforms this vector by the passed affine transform
+	// w is set to 1.0f before the transform is done
+	__forceinline void Transform(const FastAffine3x4& mat)
+	{
+		const __m128 rows[4] = { mat._rows[0], mat._rows[1], mat._rows[2], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f) };
+		_data = SimdSetW(_data, 1.0f);
+		_data = SimdTransform4(rows, _data);
+	}
 
-		_data = _mm_add_ps(x, y);
-		_data = _mm_add_ps(_data, z);
-		_data = _mm_add_ps(_data, w);
- 	}
+	// Transforms this vector by the passed affine transform
+	// w is set to 0.0f before the transform is done
+	__forceinline void TransformAsVector(const FastAffine3x4& mat)
+	{
+		const __m128 rows[4] = { mat._rows[0], mat._rows[1], mat._rows[2], _mm_setzero_ps() };
+		_data = _mm_and_ps(_data, SimdMaskXYZ());
+		_data = SimdTransform4(rows, _data);
+	}
 
-	friend class FastMatrix4;
+	template <class> friend class FastMatrix4T;
 	friend class FastQuaternion;
+	friend class FastAffine3x4;
+	friend class Vector3x4;
+	friend class Vector3x8;
+	friend class FastDualQuaternion;
 
 	static const FastVector3 Zero;
 	static const FastVector3 UnitX;
@@ -518,10 +846,10 @@ public:
 };
 
 // Unit quaternion class using SIMD
-__declspec(align(16)) class FastQuaternion
+class SIMD_ALIGN(16) FastQuaternion
 {
 private:
-	DirectX::XMVECTOR _data;
+	__m128 _data;
 	// 3-1 is vector component
 	// 0 is scalar component
 public:
@@ -532,7 +860,11 @@ public:
 	// and the angle (in radians).
 	FastQuaternion(const FastVector3& axis, float angle)
 	{
-		_data = DirectX::XMQuaternionRotationNormal(axis._data, angle);
+		__m128 sin_half, cos_half;
+		SimdSinCos(_mm_set_ps1(angle * 0.5f), sin_half, cos_half);
+		// axis * sin in x, y, z and cos in w
+		const __m128 mask = SimdMaskXYZ();
+		_data = _mm_or_ps(_mm_and_ps(mask, _mm_mul_ps(axis._data, sin_half)), _mm_andnot_ps(mask, cos_half));
 	}
 
 	// Constructs the quaternion given an __m128
@@ -569,25 +901,25 @@ public:
 	// Returns the x component of the vector component (index 0)
 	__forceinline float GetVectorX() const
 	{
-		return _data.m128_f32[0];
+		return SimdGetX(_data);
 	}
 
 	// Returns the y component of the vector component (index 1)
 	__forceinline float GetVectorY() const
 	{
-		return _data.m128_f32[1];
+		return SimdGetY(_data);
 	}
 
 	// Returns the z component of the vector component (index 2)
 	__forceinline float GetVectorZ() const
 	{
-		return _data.m128_f32[2];
+		return SimdGetZ(_data);
 	}
 
 	// Returns the scalar component (index 3)
 	__forceinline float GetScalar() const
 	{
-		return _data.m128_f32[3];
+		return SimdGetW(_data);
 	}
 	
 	// Rotate by THIS quaternion, followed by rhs
@@ -595,34 +927,75 @@ public:
 	// Store result in this quaternion.
 	void Multiply(const FastQuaternion& rhs)
 	{
-		_data = DirectX::XMQuaternionMultiply(_data, rhs._data);
+		// result = p * q, expanded one component of p at a time:
+		// p.w * (qx,  qy,  qz, qw)
+		// p.x * (qw, -qz,  qy, -qx)
+		// p.y * (qz,  qw, -qx, -qy)
+		// p.z * (-qy, qx,  qw, -qz)
+		const __m128 p = rhs._data;
+		const __m128 q = _data;
+		const __m128 signX = _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f);
+		const __m128 signY = _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f);
+		const __m128 signZ = _mm_setr_ps(-0.0f, 0.0f, 0.0f, -0.0f);
+
+		__m128 result = _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3)), q);
+
+		__m128 temp = _mm_xor_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLER(3, 2, 1, 0)), signX);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), temp));
+
+		temp = _mm_xor_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLER(2, 3, 0, 1)), signY);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), temp));
+
+		temp = _mm_xor_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLER(1, 0, 3, 2)), signZ);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), temp));
+
+		_data = result;
 	}
 
 	// Calculates the conjugate of this quaternion
 	// Remember, for unit quaternions, the inverse is the conjugate.
 	__forceinline void Conjugate()
 	{
-		_data = DirectX::XMQuaternionConjugate(_data);
+		_data = _mm_xor_ps(_data, _mm_setr_ps(-0.0f, -0.0f, -0.0f, 0.0f));
 	}
 
 	// Returns the length squared of this quaternion
 	__forceinline float LengthSquared() const
 	{
-		__m128 result = DirectX::XMQuaternionLengthSq(_data);
-		return result.m128_f32[0];
+		return _mm_cvtss_f32(SimdDot4(_data, _data));
 	}
 
 	// Returns the length of this quaternion
+	__forceinline float Length(SimdAccuracy accuracy = SIMD_PRECISE) const
+	{
+		return _mm_cvtss_f32(SimdSqrt(SimdDot4(_data, _data), accuracy));
+	}
+
+	// Normalizes this quaternion. See FastVector3::Normalize for the tiers.
+	__forceinline void Normalize(SimdAccuracy accuracy = SIMD_PRECISE)
+	{
+		__m128 temp = SimdDot4(_data, _data);
+		if (accuracy == SIMD_PRECISE)
+		{
+			_data = _mm_div_ps(_data, _mm_sqrt_ps(temp));
+		}
+		else
+		{
+			_data = _mm_mul_ps(_data, SimdInvSqrt(temp, accuracy));
+		}
+	}
+
+	// Compile time versions, e.g. q.Normalize<SIMD_FAST>()
+	template <SimdAccuracy accuracy>
 	__forceinline float Length() const
 	{
-		__m128 result = DirectX::XMQuaternionLength(_data);
-		return result.m128_f32[0];
+		return Length(accuracy);
 	}
 
-	// Normalizes this quaternion
+	template <SimdAccuracy accuracy>
 	__forceinline void Normalize()
 	{
-		_data = DirectX::XMQuaternionNormalize(_data);
+		Normalize(accuracy);
 	}
 
 	// Interpolates between quaternion a and b, returning the result by value.
@@ -638,7 +1011,7 @@ public:
 		result = _mm_add_ps(result, _mm_mul_ps(a._data, pct));
 
 		// now normalize the result
-		result = DirectX::XMQuaternionNormalize(result);
+		result = _mm_div_ps(result, _mm_sqrt_ps(SimdDot4(result, result)));
 
 		return FastQuaternion(result);
 	}
@@ -670,13 +1043,63 @@ public:
 
 		// now normalize the result
 		// dot with self to get length squared
-		result = DirectX::XMQuaternionNormalize(result);
+		result = _mm_div_ps(result, _mm_sqrt_ps(SimdDot4(result, result)));
 
 		return FastQuaternion(result);
 	}
 
+	// Spherical interpolation between quaternion a and b, along the shortest arc.
+	// The weights come from a polynomial fit (see SimdSlerpWeight), so this is
+	// branch free and needs no acos/sin. Error is around 1e-6.
+	__forceinline friend FastQuaternion Slerp(const FastQuaternion& a, const FastQuaternion& b, float f)
+	{
+		const __m128 one = _mm_set_ps1(1.0f);
+		__m128 cosAngle = SimdDot4(a._data, b._data);
+		// flip b if needed so we go the short way around
+		__m128 sign = _mm_and_ps(cosAngle, _mm_set_ps1(-0.0f));
+		__m128 xm1 = _mm_sub_ps(_mm_xor_ps(cosAngle, sign), one);
+
+		// both weights at once: lane 0 is for a, lane 1 is for b
+		__m128 weights = SimdSlerpWeight(xm1, _mm_setr_ps(1.0f - f, f, 1.0f - f, f));
+		__m128 wa = _mm_shuffle_ps(weights, weights, _MM_SHUFFLE(0, 0, 0, 0));
+		__m128 wb = _mm_xor_ps(_mm_shuffle_ps(weights, weights, _MM_SHUFFLE(1, 1, 1, 1)), sign);
+
+		return FastQuaternion(_mm_add_ps(_mm_mul_ps(a._data, wa), _mm_mul_ps(b._data, wb)));
+	}
+
+	// Normalized lerp between quaternion a and b, along the shortest arc.
+	// This is the fast approximation of Slerp: the path is the same, but the
+	// speed along it isn't constant. Normalizes with rsqrt + one Newton-Raphson step.
+	__forceinline friend FastQuaternion NLerp(const FastQuaternion& a, const FastQuaternion& b, float f)
+	{
+		__m128 sign = _mm_and_ps(SimdDot4(a._data, b._data), _mm_set_ps1(-0.0f));
+		__m128 target = _mm_xor_ps(b._data, sign);
+		__m128 result = _mm_add_ps(a._data, _mm_mul_ps(_mm_sub_ps(target, a._data), _mm_set_ps1(f)));
+		return FastQuaternion(_mm_mul_ps(result, SimdRsqrt(SimdDot4(result, result))));
+	}
+
+	// Sets this to the rotation in the upper 3x3 of mat.
+	// mat must be orthonormal, with no scale or reflection.
+	// Has to be defined in fastmath.cpp because of circular dependency
+	void CreateFromMatrix(const FastAffine3x4& mat);
+
+	// Batched versions of the above. They work on 4 (or 8 with AVX2) quaternions
+	// at a time, and out may be the same array as any of the inputs.
+
+	// out[i] = normalize(in[i])
+	static void NormalizeBatch(const FastQuaternion* in, FastQuaternion* out, size_t n);
+
+	// out[i] = a[i] rotated by b[i], same order as Multiply
+	static void MultiplyBatch(const FastQuaternion* a, const FastQuaternion* b, FastQuaternion* out, size_t n);
+
+	// out[i] = Slerp(a[i], b[i], f[i])
+	static void SlerpBatch(const FastQuaternion* a, const FastQuaternion* b, const float* f, FastQuaternion* out, size_t n);
+
 	friend class FastVector3;
-	friend class FastMatrix4;
+	template <class> friend class FastMatrix4T;
+	friend class Quaternionx4;
+	friend class Quaternionx8;
+	friend class FastDualQuaternion;
 
 	static const FastQuaternion Identity;
 };
@@ -0,0 +1,91 @@
+// framealloc.cpp implements the frame allocator's buffer management
+#include "framealloc.h"
+#include <memory.h>
+
+namespace ITP485
+{
+
+// StartUp reserves numFrames buffers of bytesPerFrame bytes each,
+// and starts on the first one.
+void FrameAllocator::StartUp(size_t bytesPerFrame, unsigned int numFrames, VirtualPageType pages)
+{
+	Dbg_Assert(numFrames >= 1, "Need at least one frame.");
+
+	// Round up so allocations can count on 16 byte granularity
+	m_BytesPerFrame = (bytesPerFrame + 15) & ~size_t(15);
+	m_NumFrames = numFrames;
+	m_pArenas = new VirtualArena[m_NumFrames];
+	for (unsigned int i = 0; i < m_NumFrames; ++i)
+	{
+		if (!m_pArenas[i].Reserve(m_BytesPerFrame, pages))
+		{
+			Dbg_Assert(false, "Couldn't reserve the frame buffers.");
+		}
+	}
+
+	// Nothing is committed yet, the first Allocate commits some
+	m_pFrame = m_pArenas[0].GetBase();
+	m_Offset = 0;
+	m_Limit = 0;
+	m_PeakBytes = 0;
+	m_FrameNumber = 0;
+}
+
+// ShutDown releases the buffers.
+void FrameAllocator::ShutDown()
+{
+	delete[] m_pArenas;
+	m_pArenas = 0;
+	m_pFrame = 0;
+	m_Offset = 0;
+	m_Limit = 0;
+	m_BytesPerFrame = 0;
+}
+
+// BeginFrame moves on to the next buffer and resets it.
+void FrameAllocator::BeginFrame()
+{
+	if (m_Offset > m_PeakBytes)
+	{
+		m_PeakBytes = m_Offset;
+	}
+
+	++m_FrameNumber;
+	VirtualArena& arena = m_pArenas[m_FrameNumber % m_NumFrames];
+	m_pFrame = arena.GetBase();
+	m_Offset = 0;
+	m_Limit = (arena.GetBytesCommitted() < m_BytesPerFrame) ? arena.GetBytesCommitted() : m_BytesPerFrame;
+
+#ifdef _DEBUG
+	// Anything still pointing into this buffer is stale, make it obvious
+	memset(m_pFrame, 0xde, m_Limit);
+#endif
+}
+
+// Returns the bytes committed in all the buffers together
+size_t FrameAllocator::GetBytesCommitted() const
+{
+	size_t committed = 0;
+	for (unsigned int i = 0; i < m_NumFrames && m_pArenas; ++i)
+	{
+		committed += m_pArenas[i].GetBytesCommitted();
+	}
+	return committed;
+}
+
+// Commits more of the current frame's buffer for an allocation at offset
+void* FrameAllocator::AllocateSlow(size_t offset, size_t size)
+{
+	VirtualArena& arena = m_pArenas[m_FrameNumber % m_NumFrames];
+	if (offset + size > m_BytesPerFrame || !arena.Commit(offset + size))
+	{
+		Dbg_Assert(false, "Frame allocator is out of space, StartUp needs a larger bytesPerFrame.");
+		return 0;
+	}
+
+	m_Limit = (arena.GetBytesCommitted() < m_BytesPerFrame) ? arena.GetBytesCommitted() : m_BytesPerFrame;
+	m_Offset = offset + size;
+	return m_pFrame + offset;
+}
+
+} // namespace ITP485
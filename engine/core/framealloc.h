@@ -0,0 +1,214 @@
+// Defines a per-frame linear allocator, for temporaries that only live until
+// the end of the frame (or a few frames, see numFrames below).
+#ifndef _FRAMEALLOC_H_
+#define _FRAMEALLOC_H_
+#include "singleton.h"
+#include "dbg_assert.h"
+#include "vmarena.h"
+#include <cstddef>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace ITP485
+{
+
+// Position in the current frame's buffer, from FrameAllocator::GetMarker
+typedef size_t FrameMarker;
+
+// FrameAllocator hands out memory by bumping an offset in a fixed buffer, so
+// an allocation is a few instructions and there's nothing to free. Instead,
+// the whole buffer is reset at once when its frame comes around again.
+//
+// There are numFrames buffers, used in turn. BeginFrame moves to the next one
+// and resets it, so memory allocated in a frame stays valid for numFrames - 1
+// more BeginFrames. With 2 (double buffered) the render code can still read
+// what the previous frame's update wrote, 3 leaves room for one more frame
+// in flight.
+//
+// Each buffer is a VirtualArena, so bytesPerFrame only reserves address
+// space. Pages are committed as a frame first reaches them, and a generous
+// bytesPerFrame only costs memory for what the busiest frame actually used.
+//
+// Destructors are never called, so only put things in here that don't need
+// them, or call them yourself.
+//
+// IMPORTANT! StartUp must always be called before starting to use this,
+// and ShutDown must be called once you're done with it. Only the main thread
+// may use it.
+class FrameAllocator : public Singleton<FrameAllocator>
+{
+	DECLARE_SINGLETON(FrameAllocator);
+public:
+	// StartUp reserves numFrames buffers of bytesPerFrame bytes each,
+	// and starts on the first one. pages picks the kind of pages they use.
+	void StartUp(size_t bytesPerFrame, unsigned int numFrames = 2, VirtualPageType pages = VM_PAGES_NORMAL);
+
+	// ShutDown releases the buffers.
+	void ShutDown();
+
+	// BeginFrame moves on to the next buffer and resets it. Call this once at
+	// the start of every frame.
+	void BeginFrame();
+
+	// Allocate returns size bytes from the current frame, aligned to alignment
+	// (a power of 2). If the frame is out of space, it will Dbg_Assert and return 0.
+	void* Allocate(size_t size, size_t alignment = 16)
+	{
+		size_t offset = (m_Offset + alignment - 1) & ~(alignment - 1);
+		if (offset + size > m_Limit)
+		{
+			return AllocateSlow(offset, size);
+		}
+		m_Offset = offset + size;
+		return m_pFrame + offset;
+	}
+
+	// Returns the current position in the frame. Passing it to FreeToMarker
+	// later frees everything allocated in between.
+	FrameMarker GetMarker() const { return m_Offset; }
+
+	// Frees everything allocated since marker was returned by GetMarker.
+	// marker must be from the current frame.
+	void FreeToMarker(FrameMarker marker)
+	{
+		Dbg_Assert(marker <= m_Offset, "Marker is past the current position, is it from another frame?");
+		m_Offset = marker;
+	}
+
+	// Returns the number of the current frame, starting at 0 after StartUp
+	unsigned int GetFrameNumber() const { return m_FrameNumber; }
+
+	// Returns the bytes used in the current frame, and the most any frame has used
+	size_t GetBytesUsed() const { return m_Offset; }
+	size_t GetPeakBytesUsed() const { return (m_Offset > m_PeakBytes) ? m_Offset : m_PeakBytes; }
+	size_t GetBytesPerFrame() const { return m_BytesPerFrame; }
+
+	// Returns the bytes committed in all the buffers together
+	size_t GetBytesCommitted() const;
+
+protected:
+	// Default constructor does nothing other than set some pointers to 0
+	FrameAllocator()
+		: m_pArenas(0)
+		, m_pFrame(0)
+		, m_Offset(0)
+		, m_Limit(0)
+		, m_BytesPerFrame(0)
+		, m_PeakBytes(0)
+		, m_NumFrames(0)
+		, m_FrameNumber(0)
+	{ }
+
+	// Commits more of the current frame's buffer for an allocation at offset,
+	// or Dbg_Asserts if the frame is full. Out of line so Allocate stays small.
+	void* AllocateSlow(size_t offset, size_t size);
+
+	// One arena for each buffer
+	VirtualArena* m_pArenas;
+	// The current frame's buffer
+	char* m_pFrame;
+	// Bytes used in the current frame
+	size_t m_Offset;
+	// Bytes of the current frame that can be used without committing more
+	size_t m_Limit;
+	size_t m_BytesPerFrame;
+	size_t m_PeakBytes;
+	unsigned int m_NumFrames;
+	unsigned int m_FrameNumber;
+};
+
+// Returns the frame allocator to where it was when this was constructed, so
+// temporaries in a scope can be freed as soon as the scope ends.
+//
+// {
+//     ScopedFrameMarker marker;
+//     ... allocate from the frame allocator ...
+// } // everything allocated above is freed here
+class ScopedFrameMarker
+{
+public:
+	ScopedFrameMarker()
+		: m_Marker(FrameAllocator::get().GetMarker())
+		, m_FrameNumber(FrameAllocator::get().GetFrameNumber())
+	{ }
+
+	~ScopedFrameMarker()
+	{
+		Dbg_Assert(m_FrameNumber == FrameAllocator::get().GetFrameNumber(), "ScopedFrameMarker can't span BeginFrame.");
+		FrameAllocator::get().FreeToMarker(m_Marker);
+	}
+
+private:
+	// Not copyable
+	ScopedFrameMarker(const ScopedFrameMarker&);
+	ScopedFrameMarker& operator=(const ScopedFrameMarker&);
+
+	FrameMarker m_Marker;
+	unsigned int m_FrameNumber;
+};
+
+// STL allocator that allocates from the frame allocator, so containers built
+// and thrown away inside a frame don't touch the heap. deallocate does
+// nothing, the memory comes back at the frame boundary (or a ScopedFrameMarker).
+// The container must not outlive its frame. Containers expect allocate to
+// succeed or throw, so it throws std::bad_alloc when the frame is full.
+//
+// std::vector<int, FrameStlAllocator<int> > indices;
+template <class T>
+class FrameStlAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{
+		typedef FrameStlAllocator<U> other;
+	};
+
+	FrameStlAllocator() {}
+	template <class U>
+	FrameStlAllocator(const FrameStlAllocator<U>&) {}
+
+	T* allocate(size_t n)
+	{
+		if (n > max_size())
+		{
+			throw std::bad_alloc();
+		}
+		const size_t alignment = (__alignof(T) > sizeof(void*)) ? __alignof(T) : sizeof(void*);
+		void* ptr = FrameAllocator::get().Allocate(n * sizeof(T), alignment);
+		if (ptr == 0)
+		{
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(ptr);
+	}
+	void deallocate(T*, size_t) {}
+
+	size_t max_size() const { return FrameAllocator::get().GetBytesPerFrame() / sizeof(T); }
+
+	template <class U, class... Args>
+	void construct(U* p, Args&&... args) { new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+	template <class U>
+	void destroy(U* p) { p->~U(); }
+};
+
+template <class T, class U>
+bool operator==(const FrameStlAllocator<T>&, const FrameStlAllocator<U>&) { return true; }
+template <class T, class U>
+bool operator!=(const FrameStlAllocator<T>&, const FrameStlAllocator<U>&) { return false; }
+
+// A string that lives in the frame allocator
+typedef std::basic_string<char, std::char_traits<char>, FrameStlAllocator<char> > FrameString;
+
+} // namespace ITP485
+
+#endif // _FRAMEALLOC_H_
@@ -12,6 +12,7 @@ namespace ITP485
 {
 	typedef FastVector3 Vector3;
 	typedef FastMatrix4 Matrix4;
+	typedef FastAffine3x4 Affine3x4;
 	typedef FastQuaternion Quaternion;
 }
 
@@ -22,6 +23,7 @@ namespace ITP485
 {
 	typedef SlowVector3 Vector3;
 	typedef SlowMatrix4 Matrix4;
+	typedef SlowAffine3x4 Affine3x4;
 	typedef SlowQuaternion Quaternion;
 }
 
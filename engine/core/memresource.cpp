@@ -0,0 +1,142 @@
+// memresource.cpp implements the engine's memory resources
+#include "memresource.h"
+
+namespace ITP485
+{
+
+namespace
+{
+
+// 16 byte aligned heap, or more if asked
+class HeapResource : public MemoryResource
+{
+protected:
+	virtual void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		return AlignedAlloc(bytes, (alignment > 16) ? alignment : 16);
+	}
+	virtual void do_deallocate(void* ptr, size_t, size_t) override
+	{
+		AlignedFree(ptr);
+	}
+};
+
+// Size class pools, over-aligned allocations go to the heap
+class SmallObjectResource : public MemoryResource
+{
+protected:
+	virtual void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		if (alignment > 16)
+		{
+			return GetHeapResource()->allocate(bytes, alignment);
+		}
+		return SmallObjectAllocator::get().Allocate(bytes);
+	}
+	virtual void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+	{
+		if (alignment > 16)
+		{
+			GetHeapResource()->deallocate(ptr, bytes, alignment);
+			return;
+		}
+		SmallObjectAllocator::get().Free(ptr, bytes);
+	}
+};
+
+// The current frame, deallocate does nothing
+class FrameResource : public MemoryResource
+{
+protected:
+	virtual void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		return FrameAllocator::get().Allocate(bytes, alignment);
+	}
+	virtual void do_deallocate(void*, size_t, size_t) override {}
+};
+
+HeapResource s_HeapResource;
+SmallObjectResource s_SmallObjectResource;
+FrameResource s_FrameResource;
+MemoryResource* s_pDefaultResource = &s_HeapResource;
+
+} // anonymous namespace
+
+MemoryResource* GetHeapResource()
+{
+	return &s_HeapResource;
+}
+
+MemoryResource* GetSmallObjectResource()
+{
+	return &s_SmallObjectResource;
+}
+
+MemoryResource* GetFrameResource()
+{
+	return &s_FrameResource;
+}
+
+MemoryResource* GetDefaultResource()
+{
+	return s_pDefaultResource;
+}
+
+void SetDefaultResource(MemoryResource* pResource)
+{
+	s_pDefaultResource = pResource ? pResource : &s_HeapResource;
+}
+
+// Reserves maxBytes of address space, pages are committed as they're used
+MonotonicResource::MonotonicResource(size_t maxBytes, VirtualPageType pages, MemoryResource* pUpstream)
+	: m_pUpstream(pUpstream)
+{
+	// If this fails, everything comes from upstream
+	m_Arena.Reserve(maxBytes, pages);
+}
+
+// Releases the arena and anything from upstream
+MonotonicResource::~MonotonicResource()
+{
+	Release();
+	m_Arena.Release();
+}
+
+// Frees everything allocated. The arena's pages stay committed.
+void MonotonicResource::Release()
+{
+	for (size_t i = 0; i < m_Upstream.size(); ++i)
+	{
+		m_pUpstream->deallocate(m_Upstream[i].m_pMemory, m_Upstream[i].m_Bytes, m_Upstream[i].m_Alignment);
+	}
+	m_Upstream.clear();
+	m_Arena.Reset();
+}
+
+// Returns the bytes allocated from upstream
+size_t MonotonicResource::GetUpstreamBytesUsed() const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < m_Upstream.size(); ++i)
+	{
+		bytes += m_Upstream[i].m_Bytes;
+	}
+	return bytes;
+}
+
+void* MonotonicResource::do_allocate(size_t bytes, size_t alignment)
+{
+	void* ptr = m_Arena.Allocate(bytes, alignment);
+	if (!ptr)
+	{
+		UpstreamBlock block;
+		block.m_pMemory = m_pUpstream->allocate(bytes, alignment);
+		block.m_Bytes = bytes;
+		block.m_Alignment = alignment;
+		m_Upstream.push_back(block);
+		ptr = block.m_pMemory;
+	}
+	return ptr;
+}
+
+} // namespace ITP485
@@ -0,0 +1,206 @@
+// Defines memory resources, so STL containers can take their memory from the
+// engine's allocators. This follows C++17's std::pmr (memory_resource and
+// polymorphic_allocator), which our compiler doesn't have yet. The names
+// match, so moving over to std::pmr later is mostly a search and replace.
+#ifndef _MEMRESOURCE_H_
+#define _MEMRESOURCE_H_
+#include "poolalloc.h"
+#include "framealloc.h"
+#include "smallalloc.h"
+#include "vmarena.h"
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ITP485
+{
+
+// Something that hands out memory, like std::pmr::memory_resource
+class MemoryResource
+{
+public:
+	virtual ~MemoryResource() {}
+
+	// Returns bytes bytes aligned to alignment (a power of 2)
+	void* allocate(size_t bytes, size_t alignment = 16) { return do_allocate(bytes, alignment); }
+
+	// Gives back memory from allocate, bytes and alignment must match
+	void deallocate(void* ptr, size_t bytes, size_t alignment = 16) { do_deallocate(ptr, bytes, alignment); }
+
+	// Returns true if memory from this can be deallocated by other
+	bool is_equal(const MemoryResource& other) const { return this == &other || do_is_equal(other); }
+
+protected:
+	virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+	virtual void do_deallocate(void* ptr, size_t bytes, size_t alignment) = 0;
+	virtual bool do_is_equal(const MemoryResource&) const { return false; }
+};
+
+// The heap, 16 byte aligned (or more if asked)
+MemoryResource* GetHeapResource();
+
+// The small object allocator. Anything up to kMaxSmallObjectSize goes to a
+// size class pool, which is what set and map nodes want.
+MemoryResource* GetSmallObjectResource();
+
+// The frame allocator. deallocate does nothing, everything goes away at the
+// end of the frame, so containers using it must not outlive their frame.
+MemoryResource* GetFrameResource();
+
+// The resource ResourceStlAllocator uses when it isn't given one.
+// It's the heap unless SetDefaultResource changes it.
+MemoryResource* GetDefaultResource();
+void SetDefaultResource(MemoryResource* pResource);
+
+// A resource on one PoolAllocator. Allocations that fit in a block come from
+// the pool, anything bigger (or more aligned) comes from upstream.
+// The pool must be started up before anything is allocated.
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList = SingleThreadFreeList>
+class PoolResource : public MemoryResource
+{
+	typedef PoolAllocator<block_size, num_blocks, FreeList> Pool;
+public:
+	explicit PoolResource(MemoryResource* pUpstream = GetHeapResource())
+		: m_pUpstream(pUpstream)
+	{ }
+
+protected:
+	virtual void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		if (bytes > block_size || alignment > 16)
+		{
+			return m_pUpstream->allocate(bytes, alignment);
+		}
+		return Pool::get().Allocate(bytes);
+	}
+	virtual void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+	{
+		if (bytes > block_size || alignment > 16)
+		{
+			m_pUpstream->deallocate(ptr, bytes, alignment);
+			return;
+		}
+		Pool::get().Free(ptr);
+	}
+	// Every PoolResource on the same pool and upstream can free the others' memory
+	virtual bool do_is_equal(const MemoryResource& other) const override
+	{
+		const PoolResource* pOther = dynamic_cast<const PoolResource*>(&other);
+		return pOther && m_pUpstream->is_equal(*pOther->m_pUpstream);
+	}
+
+	MemoryResource* m_pUpstream;
+};
+
+// A resource that only ever bumps a pointer in a VirtualArena, like
+// std::pmr::monotonic_buffer_resource. deallocate does nothing, Release frees
+// everything at once. Once the arena is full, allocations come from upstream
+// until the next Release.
+//
+// Good for things built once that live until a level unloads, like the mesh
+// and effect tables: their nodes end up next to each other in memory.
+//
+// Not thread safe.
+class MonotonicResource : public MemoryResource
+{
+public:
+	// Reserves maxBytes of address space, pages are committed as they're used
+	explicit MonotonicResource(size_t maxBytes, VirtualPageType pages = VM_PAGES_NORMAL,
+		MemoryResource* pUpstream = GetHeapResource());
+
+	// Releases the arena and anything from upstream
+	virtual ~MonotonicResource();
+
+	// Frees everything allocated. The arena's pages stay committed.
+	void Release();
+
+	// Returns the bytes allocated from the arena, and from upstream
+	size_t GetBytesUsed() const { return m_Arena.GetBytesUsed(); }
+	size_t GetUpstreamBytesUsed() const;
+
+protected:
+	virtual void* do_allocate(size_t bytes, size_t alignment) override;
+	virtual void do_deallocate(void*, size_t, size_t) override {}
+
+	// An allocation from upstream, to give back in Release
+	struct UpstreamBlock
+	{
+		void* m_pMemory;
+		size_t m_Bytes;
+		size_t m_Alignment;
+	};
+
+	VirtualArena m_Arena;
+	MemoryResource* m_pUpstream;
+	std::vector<UpstreamBlock> m_Upstream;
+};
+
+// STL allocator that allocates from a MemoryResource, like
+// std::pmr::polymorphic_allocator. Every container keeps its own resource
+// pointer, and containers with different resources still have the same type.
+//
+// MonotonicResource tableResource(64 * 1024);
+// std::set<int, std::less<int>, ResourceStlAllocator<int> > values(&tableResource);
+template <class T>
+class ResourceStlAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{
+		typedef ResourceStlAllocator<U> other;
+	};
+
+	ResourceStlAllocator() : m_pResource(GetDefaultResource()) {}
+	// Not explicit, so a container can be constructed from a resource pointer
+	ResourceStlAllocator(MemoryResource* pResource) : m_pResource(pResource) {}
+	template <class U>
+	ResourceStlAllocator(const ResourceStlAllocator<U>& other) : m_pResource(other.GetResource()) {}
+
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(m_pResource->allocate(n * sizeof(T), GetAlignment()));
+	}
+	void deallocate(T* ptr, size_t n)
+	{
+		m_pResource->deallocate(ptr, n * sizeof(T), GetAlignment());
+	}
+
+	size_t max_size() const { return size_t(-1) / sizeof(T); }
+
+	template <class U, class... Args>
+	void construct(U* p, Args&&... args) { new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+	template <class U>
+	void destroy(U* p) { p->~U(); }
+
+	MemoryResource* GetResource() const { return m_pResource; }
+
+private:
+	static size_t GetAlignment() { return (__alignof(T) > sizeof(void*)) ? __alignof(T) : sizeof(void*); }
+
+	MemoryResource* m_pResource;
+};
+
+template <class T, class U>
+bool operator==(const ResourceStlAllocator<T>& a, const ResourceStlAllocator<U>& b)
+{
+	return a.GetResource()->is_equal(*b.GetResource());
+}
+template <class T, class U>
+bool operator!=(const ResourceStlAllocator<T>& a, const ResourceStlAllocator<U>& b)
+{
+	return !(a == b);
+}
+
+} // namespace ITP485
+
+#endif // _MEMRESOURCE_H_
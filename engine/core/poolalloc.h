@@ -3,11 +3,55 @@
 #define _POOLALLOC_H_
 #include "singleton.h"
 #include "dbg_assert.h"
+#include "allocstats.h"
+#include "vmarena.h"
 #include <memory.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <stdlib.h>
+#endif
 
 namespace ITP485
 {
 
+// 16 byte aligned heap allocations. _aligned_malloc is MSVC only.
+inline void* AlignedAlloc(size_t size, size_t alignment)
+{
+#if defined(_MSC_VER)
+	return _aligned_malloc(size, alignment);
+#else
+	void* ptr = 0;
+	return (posix_memalign(&ptr, alignment, size) == 0) ? ptr : 0;
+#endif
+}
+
+inline void AlignedFree(void* ptr)
+{
+#if defined(_MSC_VER)
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+// Returns the index of the lowest set bit, bits must not be 0
+inline unsigned int GetLowestSetBit(unsigned int bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return index;
+#else
+	return __builtin_ctz(bits);
+#endif
+}
+
 // PoolBlock is a structure that we use as the building block for the pool-based allocator.
 // It's templated by size of the block to support different size blocks in separate pools.
 // IMPORTANT! block_size must be divisible by 16 to ensure _memory returns a ptr aligned by 16 bytes.
@@ -16,82 +60,319 @@ struct PoolBlock
 {
 	// This is the actual memory that the caller will be writing to.
 	char _memory[block_size];
+
+#if ALLOC_STATS
+	// Allocation number (0 while the block is free), and when it was allocated.
+	// 16 bytes, so sizeof(PoolBlock) is still divisible by 16.
+	unsigned long long _allocId;
+	unsigned long long _allocTicks;
+#endif
 	
+	// Pointer to the next block in the free list.
+	// It comes before _boundary so there's no hidden padding between them.
+	PoolBlock<block_size>* _next;
+
 	// This boundary value is used to help find instances where memory is being written
 	// beyond the _memory array.
 	// 
 	// While this is only used in debug, it's always here to ensure sizeof(PoolBlock)
 	// is divisible by 16.
 	unsigned int _boundary;
-	
-	// Pointer to the next block in the free list.
-	PoolBlock<block_size>* _next;
-private:
-#if _WIN32
-	// Padding to ensure sizeof(PoolBlock) % 16 == 0
-	char _padding[8];
-#else // running 64 bit, padding only needs to be 4
-	char _padding[4];
-#endif
 
-public:
+	union
+	{
+		// Index of the block in its chunk, so the pool can find the chunk's
+		// occupancy bits
+		unsigned int _index;
+
+		// Padding to ensure sizeof(PoolBlock) % 16 == 0, 8 bytes on 32 bit and 4 on 64 bit
+		char _padding[16 - sizeof(void*) - sizeof(unsigned int)];
+	};
+
 	PoolBlock()
 	{
 		_next = 0;
+		_index = 0;
 		Dbg_Assert(block_size % 16 == 0, "Block size isn't divisible by 16.");
 	}
 
 	// Disallow single new/delete of a PoolBlock
-	void* operator new(size_t size)
+	void* operator new(size_t size) = delete;
+	void operator delete(void* ptr) = delete;
+
+	// Overloads of array new/delete to ensure the array is 16-byte aligned
+	void* operator new[] (size_t size)
 	{
-		Dbg_Assert(0, "Can't allocate single PoolBlock by itself.");
+		return AlignedAlloc(size, 16);
 	}
-	void operator delete(void* ptr)
+	void operator delete[] (void* ptr)
 	{
-		Dbg_Assert(0, "Can't delete single PoolBlock by itself.");
+		AlignedFree(ptr);
 	}
+};
 
-	// Overloads of array new/delete to ensure the array is 16-byte aligned
-	void* operator new[] (size_t size)
+// Free list policies for PoolAllocator. A free list keeps the free blocks,
+// linked through PoolBlock::_next, and how many there are. GrowMutex is
+// what the pool locks while it adds a chunk, and OccupancyWord holds 32 of
+// the bits that say which blocks are allocated.
+
+// Mutex that does nothing, for pools only one thread uses
+struct NullMutex
+{
+	void lock() {}
+	void unlock() {}
+};
+
+// Occupancy bits for pools only one thread uses
+struct PlainOccupancyWord
+{
+	unsigned int m_Bits;
+
+	void Reset() { m_Bits = 0; }
+	void Set(unsigned int mask) { m_Bits |= mask; }
+	void Clear(unsigned int mask) { m_Bits &= ~mask; }
+	unsigned int Load() const { return m_Bits; }
+};
+
+// Occupancy bits any thread can set and clear. Each bit only changes on the
+// thread that owns its block, so relaxed is enough.
+struct AtomicOccupancyWord
+{
+	std::atomic<unsigned int> m_Bits;
+
+	void Reset() { m_Bits.store(0, std::memory_order_relaxed); }
+	void Set(unsigned int mask) { m_Bits.fetch_or(mask, std::memory_order_relaxed); }
+	void Clear(unsigned int mask) { m_Bits.fetch_and(~mask, std::memory_order_relaxed); }
+	unsigned int Load() const { return m_Bits.load(std::memory_order_relaxed); }
+};
+
+// SingleThreadFreeList is a plain linked list. It's the default, and only one
+// thread may use the pool.
+template <class Block>
+class SingleThreadFreeList
+{
+public:
+	typedef NullMutex GrowMutex;
+	typedef PlainOccupancyWord OccupancyWord;
+
+	SingleThreadFreeList()
+		: m_pHead(0)
+		, m_iCount(0)
+	{ }
+
+	// Sets the list to the count blocks starting at pFirst, already linked by _next
+	void Reset(Block* pFirst, unsigned int count)
 	{
-		return _aligned_malloc(size, 16);
+		m_pHead = pFirst;
+		m_iCount = count;
 	}
-	void operator delete[] (void* ptr)
+
+	// Removes and returns the first block, or 0 if the list is empty
+	Block* Pop()
 	{
-		_aligned_free(ptr);
+		Block* pBlock = m_pHead;
+		if (pBlock)
+		{
+			m_pHead = pBlock->_next;
+			--m_iCount;
+		}
+		return pBlock;
 	}
+
+	// Adds pBlock to the front of the list
+	void Push(Block* pBlock)
+	{
+		pBlock->_next = m_pHead;
+		m_pHead = pBlock;
+		++m_iCount;
+	}
+
+	// Adds the count blocks from pFirst to pLast, already linked by _next,
+	// to the front of the list
+	void PushChain(Block* pFirst, Block* pLast, unsigned int count)
+	{
+		pLast->_next = m_pHead;
+		m_pHead = pFirst;
+		m_iCount += count;
+	}
+
+	unsigned int GetCount() const { return m_iCount; }
+
+private:
+	Block* m_pHead;
+	unsigned int m_iCount;
+};
+
+// LockFreeFreeList is a Treiber stack, so any number of threads can allocate
+// and free at once. The head is a pointer and a tag in one 64 bit word, and
+// every Pop bumps the tag, so a Pop that read a head which was popped and
+// pushed back in the meantime (the ABA problem) fails its compare exchange
+// and retries. The tag is 32 bits on 32 bit builds and 16 bits on 64 bit
+// builds, where pointers only use the low 48 bits.
+//
+// Pop reads _next of a block another thread may have just popped. That's
+// fine because blocks are never unmapped while the pool is running, and the
+// compare exchange throws the value away if it's stale.
+template <class Block>
+class LockFreeFreeList
+{
+public:
+	typedef std::mutex GrowMutex;
+	typedef AtomicOccupancyWord OccupancyWord;
+
+	LockFreeFreeList()
+		: m_Head(0)
+		, m_iCount(0)
+	{ }
+
+	// Sets the list to the count blocks starting at pFirst, already linked by _next.
+	// This isn't thread safe, the pool must not be in use.
+	void Reset(Block* pFirst, unsigned int count)
+	{
+		m_Head.store(Pack(pFirst, 0));
+		m_iCount.store(count);
+	}
+
+	// Removes and returns the first block, or 0 if the list is empty
+	Block* Pop()
+	{
+		unsigned long long head = m_Head.load(std::memory_order_acquire);
+		for (;;)
+		{
+			Block* pBlock = Unpack(head);
+			if (!pBlock)
+			{
+				return 0;
+			}
+			unsigned long long next = Pack(pBlock->_next, GetTag(head) + 1);
+			if (m_Head.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				m_iCount.fetch_sub(1, std::memory_order_relaxed);
+				return pBlock;
+			}
+		}
+	}
+
+	// Adds pBlock to the front of the list
+	void Push(Block* pBlock)
+	{
+		// Count first, so GetCount never drops below the real count
+		m_iCount.fetch_add(1, std::memory_order_relaxed);
+		unsigned long long head = m_Head.load(std::memory_order_relaxed);
+		do
+		{
+			pBlock->_next = Unpack(head);
+		} while (!m_Head.compare_exchange_weak(head, Pack(pBlock, GetTag(head)), std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	// Adds the count blocks from pFirst to pLast, already linked by _next,
+	// to the front of the list
+	void PushChain(Block* pFirst, Block* pLast, unsigned int count)
+	{
+		m_iCount.fetch_add(count, std::memory_order_relaxed);
+		unsigned long long head = m_Head.load(std::memory_order_relaxed);
+		do
+		{
+			pLast->_next = Unpack(head);
+		} while (!m_Head.compare_exchange_weak(head, Pack(pFirst, GetTag(head)), std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	// With other threads running this is only a snapshot
+	unsigned int GetCount() const { return m_iCount.load(std::memory_order_relaxed); }
+
+private:
+	static const int kTagShift = (sizeof(void*) == 4) ? 32 : 48;
+	static const unsigned long long kPointerMask = (1ULL << kTagShift) - 1;
+
+	static unsigned long long Pack(Block* pBlock, unsigned long long tag)
+	{
+		return static_cast<unsigned long long>(reinterpret_cast<size_t>(pBlock)) | (tag << kTagShift);
+	}
+	static Block* Unpack(unsigned long long head)
+	{
+		return reinterpret_cast<Block*>(static_cast<size_t>(head & kPointerMask));
+	}
+	static unsigned long long GetTag(unsigned long long head)
+	{
+		return head >> kTagShift;
+	}
+
+	std::atomic<unsigned long long> m_Head;
+	std::atomic<unsigned int> m_iCount;
 };
 
+// Called after a pool adds a chunk, with the pool's block size and its new
+// total number of blocks
+typedef void (*PoolGrowCallback)(size_t blockSize, unsigned int numBlocks);
+
+// Called by PoolAllocator::Compact for every block it moves. It must move the
+// object at pFrom into pTo (pTo is uninitialized, pFrom is freed afterwards),
+// and fix up every pointer or handle to it.
+typedef void (*PoolMoveCallback)(void* pUser, void* pFrom, void* pTo);
+
+// Pass as maxBlocks to let a pool grow without a limit
+const unsigned int kPoolNoLimit = 0xffffffff;
+
+// Most chunks of address space a pool reserves. A pool that grows past this
+// (or past what it could reserve) gets the rest of its chunks from the heap.
+const unsigned int kPoolMaxReservedChunks = 64;
+
 // Defines the Pool Allocator
-// Templated based on size of block and the number of blocks in the pool.
+// Templated based on size of block, the number of blocks in the pool, and the
+// free list policy (see above). The default SingleThreadFreeList is for pools
+// used by one thread, LockFreeFreeList lets any thread Allocate and Free.
+//
+// By default the pool is a fixed num_blocks blocks. StartUp can let it grow:
+// when it runs out it adds another chunk of num_blocks blocks, up to
+// maxBlocks in total. Blocks never move once allocated (unless you Compact),
+// and Free stays O(1).
+//
+// The chunks come from a VirtualArena reserved in StartUp, big enough for
+// maxBlocks (or kPoolMaxReservedChunks chunks), so they're one after the other
+// in memory and only committed as the pool grows into them.
+//
+// Each chunk ends with a bitmap of which of its blocks are allocated, so
+// ForEachLive can walk every allocated block in address order, skipping 32
+// free blocks at a time. After a lot of churn the free list hands blocks out
+// all over the pool, and Compact can move the allocated ones back together.
 //
 // To define your own pool to be used, it's recommended to typedef as such:
 // typedef PoolAllocator<256, 1024> ComponentPool;
+// typedef PoolAllocator<256, 1024, LockFreeFreeList> SharedComponentPool;
 // Remember block_size must be divisible by 16.
 //
 // IMPORTANT! Because of the way templates work, and this is a Singleton,
 // if you have two different typedefs that have the same block_size and
-// same num_blocks, both will end up using the SAME pool.
+// same num_blocks and free list, both will end up using the SAME pool.
+//
+// With ALLOC_STATS on (see allocstats.h), the pool counts its allocations and
+// registers with AllocStatsRegistry between StartUp and ShutDown. ShutDown
+// reports any blocks still allocated.
 //
 // IMPORTANT! StartUp must always be called before starting to use this,
 // and ShutDown must be called once you're done with it. Or bad things happen.
-template <size_t block_size, unsigned int num_blocks>
-class PoolAllocator : public Singleton<PoolAllocator<block_size, num_blocks> >
+// Neither is thread safe, even with LockFreeFreeList.
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList = SingleThreadFreeList>
+class PoolAllocator : public Singleton<PoolAllocator<block_size, num_blocks, FreeList> >, public PoolStatsBase
 {
 	DECLARE_SINGLETON(PoolAllocator);
 public:
-	// StartUp dynamically allocates the pool on the heap.
+	// StartUp reserves the pool's address space and allocates the first chunk.
 	// 
 	// mpPool should be allocated to an array with num_blocks elements
 	// It also will correctly initialize the free list and all its _next pointers.
 	// By default, you want index 0 of a pool to point to index 1, and so on.
-	// Make sure you update iBlocksFree.
 	//
 	// #ifdef _DEBUG, you should also write to all the _memory arrays the value 0xde over and over,
 	// and _boundary should be set to 0xdeadbeef.
-	void StartUp();
+	//
+	// maxBlocks is the most blocks the pool may grow to (kPoolNoLimit for no limit).
+	// The pool won't add a chunk that goes past it, so make it a multiple of num_blocks.
+	// pOnGrow, if set, is called every time the pool adds a chunk.
+	// pages picks the kind of pages the pool's arena asks for.
+	void StartUp(unsigned int maxBlocks = num_blocks, PoolGrowCallback pOnGrow = 0, VirtualPageType pages = VM_PAGES_NORMAL);
 
-	// ShutDown deallocates the pool.
+	// ShutDown deallocates every chunk of the pool.
 	void ShutDown();
 
 	// Allocate returns a pointer to usable memory within the pool.
@@ -99,13 +380,12 @@ public:
 	// It will Dbg_Assert size <= block_size.
 	// If the size is okay, it will remove a PoolBlock from the free list,
 	// and return the pointer to that PoolBlock's _memory member
-	// Make sure you update iBlocksFree.
 	//
-	// If there are no blocks available, it should Dbg_Assert and return 0.
+	// If there are no blocks available, and the pool can't grow, it should
+	// Dbg_Assert and return 0.
 	void* Allocate(size_t size);
 
 	// Free will return a block to the front of the free list.
-	// Make sure you update iBlocksFree.
 	//
 	// #ifdef _DEBUG, Dbg_Assert that boundary still == 0xdeadbeef (if not, the bounds were overwritten)
 	// Also, write the value 0xde over and over into the _memory array.
@@ -113,65 +393,239 @@ public:
 	void Free(void* ptr);
 
 	// Returns the number of blocks free in the pool
-	unsigned int GetNumBlocksFree() { return iBlocksFree; }
+	unsigned int GetNumBlocksFree() { return m_FreeList.GetCount(); }
+
+	// Returns the number of blocks in all the chunks. Only exact on the
+	// thread that's growing the pool.
+	unsigned int GetNumBlocks() { return m_iNumBlocks; }
+
+	// Returns the arena the chunks come from
+	const VirtualArena& GetArena() const { return m_Arena; }
+
+	// Returns the bytes one chunk takes, its blocks and their occupancy bits
+	static size_t GetChunkSize()
+	{
+		return (sizeof(PoolBlock<block_size>) * num_blocks + sizeof(OccupancyWord) * kOccupancyWords + 15) & ~size_t(15);
+	}
+
+	// Returns true if ptr, which must be a block from this pool, is allocated
+	bool IsAllocated(const void* ptr) const
+	{
+		const PoolBlock<block_size>* pBlock = reinterpret_cast<const PoolBlock<block_size>*>(ptr);
+		return (GetOccupancy(pBlock)[pBlock->_index / 32].Load() & (1u << (pBlock->_index % 32))) != 0;
+	}
+
+	// Calls func(ptr) for every allocated block, in address order.
+	// No other thread may use the pool while this runs, and func must not
+	// Allocate or Free.
+	template <class Func>
+	void ForEachLive(Func func);
+
+	// Moves allocated blocks from the end of the pool into the free blocks
+	// nearest the start, until every allocated block is in front of every free
+	// one. pMove is called for each block moved, see PoolMoveCallback.
+	// Afterwards the free list is in address order, like SortFreeList.
+	// Returns how many blocks were moved.
+	//
+	// Nothing else may use the pool while this runs, and anything holding a
+	// pointer to a block that pMove doesn't fix up is left dangling.
+	unsigned int Compact(PoolMoveCallback pMove, void* pUser);
+
+	// Relinks the free list in address order, so the next allocations come
+	// from the start of the pool and end up next to each other. Nothing else
+	// may use the pool while this runs.
+	void SortFreeList();
+
+#if ALLOC_STATS
+	// PoolStatsSource, for AllocStatsRegistry
+	virtual void GetStats(PoolStats& stats) override;
+	virtual void ForEachLiveBlock(LiveBlockCallback callback, void* pUser) override;
+#endif
 
 protected:
+	typedef typename FreeList<PoolBlock<block_size> >::GrowMutex GrowMutex;
+	typedef typename FreeList<PoolBlock<block_size> >::OccupancyWord OccupancyWord;
+
+	// Occupancy words at the end of each chunk, one bit per block
+	static const unsigned int kOccupancyWords = (num_blocks + 31) / 32;
+
+	// Returns the occupancy bits of pBlock's chunk
+	static OccupancyWord* GetOccupancy(const PoolBlock<block_size>* pBlock)
+	{
+		const PoolBlock<block_size>* pChunk = pBlock - pBlock->_index;
+		return reinterpret_cast<OccupancyWord*>(const_cast<PoolBlock<block_size>*>(pChunk + num_blocks));
+	}
+
+	// Returns the block at index, counting every chunk's blocks in address order
+	PoolBlock<block_size>* GetBlock(size_t index) { return &m_Chunks[index / num_blocks][index % num_blocks]; }
+
 	// Default constructor does nothing other than set some pointers to 0
  	PoolAllocator()
- 		: m_pPool(0)
- 		, m_pFreeList(0)
+ 		: m_iNumBlocks(0)
+ 		, m_iMaxBlocks(0)
+ 		, m_pOnGrow(0)
  	{ }
+
+	// Allocates a chunk of num_blocks blocks linked in order, and returns the first
+	PoolBlock<block_size>* AddChunk();
+
+	// Called when the free list is empty. Adds a chunk if the pool may grow,
+	// and returns a block from it, or 0.
+	PoolBlock<block_size>* Grow();
 	
-	// This pointer will point to the array of all blocks
-	PoolBlock<block_size>* m_pPool;
+	// Every chunk, in address order. The first is allocated in StartUp.
+	std::vector<PoolBlock<block_size>*> m_Chunks;
 	
-	// This pointer represents the free list. Initially points to element at index 0
-	PoolBlock<block_size>* m_pFreeList;
+	// The free list, initially starting at index 0 of the first chunk. It also
+	// keeps track of how many blocks are left in the pool.
+	FreeList<PoolBlock<block_size> > m_FreeList;
 
-	// This keeps track of how many blocks are left in the pool
-	unsigned int iBlocksFree;
+	// Growth settings from StartUp, and the number of blocks in m_Chunks
+	unsigned int m_iNumBlocks;
+	unsigned int m_iMaxBlocks;
+	PoolGrowCallback m_pOnGrow;
+
+	// Held while adding a chunk
+	GrowMutex m_GrowMutex;
+
+	// Address space for the chunks
+	VirtualArena m_Arena;
 };
 
 // IMPLEMENTATIONS for PoolAllocator
 
-// StartUp dynamically allocates the pool on the heap.
+// StartUp reserves the pool's address space and allocates the first chunk.
 // 
 // mpPool should be allocated to an array with num_blocks elements
 // It also will correctly initialize the free list and all its _next pointers.
 // By default, you want index 0 of a pool to point to index 1, and so on.
-// Make sure you update iBlocksFree.
 //
 // #ifdef _DEBUG, you should also write to all the _memory arrays the value 0xde over and over,
 // and _boundary should be set to 0xdeadbeef.
-template <size_t block_size, unsigned int num_blocks>
-void PoolAllocator<block_size, num_blocks>::StartUp()
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+void PoolAllocator<block_size, num_blocks, FreeList>::StartUp(unsigned int maxBlocks, PoolGrowCallback pOnGrow, VirtualPageType pages)
+{
+	Dbg_Assert(maxBlocks >= num_blocks, "maxBlocks must be at least num_blocks.");
+	m_iMaxBlocks = maxBlocks;
+	m_pOnGrow = pOnGrow;
+
+	// If this fails every chunk comes from the heap, which still works
+	unsigned int reservedChunks = maxBlocks / num_blocks;
+	if (reservedChunks > kPoolMaxReservedChunks) { reservedChunks = kPoolMaxReservedChunks; }
+	m_Arena.Reserve(GetChunkSize() * reservedChunks, pages);
+
+	m_FreeList.Reset(AddChunk(), num_blocks);
+
+#if ALLOC_STATS
+	m_Counters.Reset();
+	// Pools can start up during static initialization, maybe before the registry's created
+	AllocStatsRegistry::Create();
+	AllocStatsRegistry::get().Register(this);
+#endif
+}
+
+// ShutDown deallocates every chunk of the pool.
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+void PoolAllocator<block_size, num_blocks, FreeList>::ShutDown()
 {
-	m_pPool = new PoolBlock<block_size>[num_blocks];
+#if ALLOC_STATS
+	AllocStatsRegistry::get().ReportLiveBlocks(this);
+	AllocStatsRegistry::get().Unregister(this);
+#endif
 
-	m_pFreeList = m_pPool;
-	for (int i = 0; i < num_blocks - 1; ++i)
+	m_FreeList.Reset(0, 0);
+	for (size_t i = 0; i < m_Chunks.size(); ++i)
+	{
+		if (!m_Arena.Contains(m_Chunks[i]))
+		{
+			AlignedFree(m_Chunks[i]);
+		}
+	}
+	m_Chunks.clear();
+	m_Arena.Release();
+	m_iNumBlocks = 0;
+	// So Grow refuses to add chunks until the next StartUp
+	m_iMaxBlocks = 0;
+	m_pOnGrow = 0;
+}
+
+// AddChunk allocates num_blocks blocks and links them, index 0 to index 1 and so on.
+// They come from the arena while it has room, and the heap after that.
+// Their occupancy bits come right after them, all clear.
+//
+// #ifdef _DEBUG, it writes 0xde over all the _memory arrays, and sets _boundary to 0xdeadbeef.
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+PoolBlock<block_size>* PoolAllocator<block_size, num_blocks, FreeList>::AddChunk()
+{
+	void* pMemory = m_Arena.Allocate(GetChunkSize(), 16);
+	if (!pMemory)
 	{
-		m_pFreeList[i]._next = &m_pFreeList[i + 1];
+		pMemory = AlignedAlloc(GetChunkSize(), 16);
 	}
-	m_pFreeList[num_blocks - 1]._next = nullptr;
 
-	iBlocksFree = num_blocks;
+	PoolBlock<block_size>* pChunk = static_cast<PoolBlock<block_size>*>(pMemory);
+	for (unsigned int i = 0; i < num_blocks; ++i)
+	{
+		::new (static_cast<void*>(&pChunk[i])) PoolBlock<block_size>();
+		pChunk[i]._index = i;
+	}
+	OccupancyWord* pOccupancy = reinterpret_cast<OccupancyWord*>(pChunk + num_blocks);
+	for (unsigned int i = 0; i < kOccupancyWords; ++i)
+	{
+		::new (static_cast<void*>(&pOccupancy[i])) OccupancyWord();
+		pOccupancy[i].Reset();
+	}
+
+	for (unsigned int i = 0; i < num_blocks - 1; ++i)
+	{
+		pChunk[i]._next = &pChunk[i + 1];
+	}
+	pChunk[num_blocks - 1]._next = nullptr;
 
 #ifdef _DEBUG
-	for (int i = 0; i < num_blocks; ++i)
+	for (unsigned int i = 0; i < num_blocks; ++i)
 	{
-		memset(m_pPool[i]._memory, 0xde, block_size);
-		m_pPool[i]._boundary = 0xdeadbeef;
+		memset(pChunk[i]._memory, 0xde, block_size);
+		pChunk[i]._boundary = 0xdeadbeef;
 	}
 #endif
+
+#if ALLOC_STATS
+	for (unsigned int i = 0; i < num_blocks; ++i)
+	{
+		pChunk[i]._allocId = 0;
+	}
+#endif
+
+	m_Chunks.insert(std::upper_bound(m_Chunks.begin(), m_Chunks.end(), pChunk), pChunk);
+	m_iNumBlocks += num_blocks;
+	return pChunk;
 }
 
-// ShutDown deallocates the pool.
-template <size_t block_size, unsigned int num_blocks>
-void PoolAllocator<block_size, num_blocks>::ShutDown()
+// Grow adds a chunk, keeps its first block for the caller, and puts the rest
+// on the free list.
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+PoolBlock<block_size>* PoolAllocator<block_size, num_blocks, FreeList>::Grow()
 {
-	iBlocksFree = 0;
-	delete[] m_pPool;
+	std::lock_guard<GrowMutex> lock(m_GrowMutex);
+
+	// Another thread may have added a chunk while this one waited
+	PoolBlock<block_size>* ptr = m_FreeList.Pop();
+	if (ptr) { return ptr; }
+
+	// Also false before StartUp and after ShutDown, when both are 0
+	if (m_iMaxBlocks - m_iNumBlocks < num_blocks) { return 0; }
+
+	PoolBlock<block_size>* pChunk = AddChunk();
+	if (num_blocks > 1)
+	{
+		m_FreeList.PushChain(&pChunk[1], &pChunk[num_blocks - 1], num_blocks - 1);
+	}
+	if (m_pOnGrow)
+	{
+		m_pOnGrow(block_size, m_iNumBlocks);
+	}
+	return &pChunk[0];
 }
 
 // Allocate returns a pointer to usable memory within the pool.
@@ -179,46 +633,208 @@ void PoolAllocator<block_size, num_blocks>::ShutDown()
 // It will Dbg_Assert size <= block_size.
 // If the size is okay, it will remove a PoolBlock from the free list,
 // and return the pointer to that PoolBlock's _memory member
-// Make sure you update iBlocksFree.
 //
 // If there are no blocks available, it should Dbg_Assert and return 0.
-template <size_t block_size, unsigned int num_blocks>
-void* PoolAllocator<block_size, num_blocks>::Allocate(size_t size)
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+void* PoolAllocator<block_size, num_blocks, FreeList>::Allocate(size_t size)
 {
-	Dbg_Assert(iBlocksFree != 0, "No blocks available.");
-	if (iBlocksFree == 0) { return 0; }
 	Dbg_Assert(size <= block_size, "Size to allocate cannot be larger then the pool block size.");
-	if (size > block_size) { return 0; }
+	if (size > block_size)
+	{
+#if ALLOC_STATS
+		m_Counters.OnFailed();
+#endif
+		return 0;
+	}
 
-	PoolBlock<block_size>* ptr = m_pFreeList;
-	m_pFreeList = m_pFreeList->_next;
-	--iBlocksFree;
+	PoolBlock<block_size>* ptr = m_FreeList.Pop();
+	if (!ptr)
+	{
+		ptr = Grow();
+		Dbg_Assert(ptr != 0, "No blocks available.");
+	}
+
+	if (ptr)
+	{
+		GetOccupancy(ptr)[ptr->_index / 32].Set(1u << (ptr->_index % 32));
+	}
+
+#if ALLOC_STATS
+	if (ptr)
+	{
+		ptr->_allocId = m_Counters.OnAllocate();
+		ptr->_allocTicks = GetAllocStatsTicks();
+	}
+	else
+	{
+		m_Counters.OnFailed();
+	}
+#endif
 
 	return ptr;
 }
 
 // Free will return the block to the front of the free list.
-// Make sure you update iBlocksFree.
 //
 // #ifdef _DEBUG, Dbg_Assert that boundary still == 0xdeadbeef (if not, the bounds were overwritten)
 // Also, write the value 0xde over and over into the _memory array.
 //
 // Note that there is no reasonable way to verify that the pointer actually belongs in the
 // pool, so don't call this on random pointers!
-template <size_t block_size, unsigned int num_blocks>
-void PoolAllocator<block_size, num_blocks>::Free(void* ptr)
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+void PoolAllocator<block_size, num_blocks, FreeList>::Free(void* ptr)
 {
 	PoolBlock<block_size>* block = reinterpret_cast<PoolBlock<block_size>*>(ptr);
-	block->_next = iBlocksFree ? m_pFreeList : nullptr;
-	m_pFreeList = block;
-	++iBlocksFree;
+	Dbg_Assert(IsAllocated(block), "Block was freed twice.");
 
+	// The debug checks come first, once the block is back on the list
+	// another thread can allocate it
 #ifdef _DEBUG
 	Dbg_Assert(block->_boundary == 0xdeadbeef, "Bounds of PoolBlock were overwritten.");
 	if (block->_boundary != 0xdeadbeef) { block->_boundary = 0xdeadbeef; }
 	memset(block->_memory, 0xde, block_size);
 #endif
+
+#if ALLOC_STATS
+	m_Counters.OnFree(GetAllocStatsTicks() - block->_allocTicks);
+	block->_allocId = 0;
+#endif
+
+	GetOccupancy(block)[block->_index / 32].Clear(1u << (block->_index % 32));
+	m_FreeList.Push(block);
+}
+
+// ForEachLive scans each chunk's occupancy bits a word at a time, so runs of
+// free blocks cost almost nothing
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+template <class Func>
+void PoolAllocator<block_size, num_blocks, FreeList>::ForEachLive(Func func)
+{
+	for (size_t i = 0; i < m_Chunks.size(); ++i)
+	{
+		PoolBlock<block_size>* pChunk = m_Chunks[i];
+		const OccupancyWord* pOccupancy = GetOccupancy(pChunk);
+		for (unsigned int word = 0; word < kOccupancyWords; ++word)
+		{
+			unsigned int bits = pOccupancy[word].Load();
+			while (bits != 0)
+			{
+				func(static_cast<void*>(pChunk[word * 32 + GetLowestSetBit(bits)]._memory));
+				bits &= bits - 1;
+			}
+		}
+	}
+}
+
+// Compact walks one index up from the start of the pool to the next free
+// block, and one down from the end to the last allocated block, and moves the
+// latter into the former until they meet
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+unsigned int PoolAllocator<block_size, num_blocks, FreeList>::Compact(PoolMoveCallback pMove, void* pUser)
+{
+	Dbg_Assert(pMove != 0, "Compact needs a move callback.");
+	if (!pMove || m_Chunks.empty())
+	{
+		return 0;
+	}
+
+	unsigned int numMoved = 0;
+	size_t low = 0;
+	size_t high = m_Chunks.size() * num_blocks - 1;
+	for (;;)
+	{
+		while (low < high && IsAllocated(GetBlock(low))) { ++low; }
+		while (low < high && !IsAllocated(GetBlock(high))) { --high; }
+		if (low >= high)
+		{
+			break;
+		}
+
+		PoolBlock<block_size>* pFrom = GetBlock(high);
+		PoolBlock<block_size>* pTo = GetBlock(low);
+		pMove(pUser, pFrom->_memory, pTo->_memory);
+		GetOccupancy(pTo)[pTo->_index / 32].Set(1u << (pTo->_index % 32));
+		GetOccupancy(pFrom)[pFrom->_index / 32].Clear(1u << (pFrom->_index % 32));
+
+#if ALLOC_STATS
+		pTo->_allocId = pFrom->_allocId;
+		pTo->_allocTicks = pFrom->_allocTicks;
+		pFrom->_allocId = 0;
+#endif
+
+#ifdef _DEBUG
+		Dbg_Assert(pFrom->_boundary == 0xdeadbeef, "Bounds of PoolBlock were overwritten.");
+		memset(pFrom->_memory, 0xde, block_size);
+#endif
+
+		++numMoved;
+		++low;
+		--high;
+	}
+
+	SortFreeList();
+	return numMoved;
+}
+
+// SortFreeList links the free blocks in address order, the way AddChunk does
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+void PoolAllocator<block_size, num_blocks, FreeList>::SortFreeList()
+{
+	PoolBlock<block_size>* pFirst = 0;
+	PoolBlock<block_size>* pLast = 0;
+	unsigned int count = 0;
+	for (size_t i = 0; i < m_Chunks.size(); ++i)
+	{
+		for (unsigned int j = 0; j < num_blocks; ++j)
+		{
+			PoolBlock<block_size>* pBlock = &m_Chunks[i][j];
+			if (IsAllocated(pBlock))
+			{
+				continue;
+			}
+			if (pLast)
+			{
+				pLast->_next = pBlock;
+			}
+			else
+			{
+				pFirst = pBlock;
+			}
+			pLast = pBlock;
+			++count;
+		}
+	}
+	if (pLast)
+	{
+		pLast->_next = 0;
+	}
+	m_FreeList.Reset(pFirst, count);
+}
+
+#if ALLOC_STATS
+// GetStats fills stats with the pool's counters and size
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+void PoolAllocator<block_size, num_blocks, FreeList>::GetStats(PoolStats& stats)
+{
+	m_Counters.Fill(stats);
+	stats.m_szName = m_szStatsName;
+	stats.m_BlockSize = block_size;
+	stats.m_NumBlocks = m_iNumBlocks;
+}
+
+// ForEachLiveBlock calls callback for every allocated block, with its allocation number
+template <size_t block_size, unsigned int num_blocks, template <class> class FreeList>
+void PoolAllocator<block_size, num_blocks, FreeList>::ForEachLiveBlock(LiveBlockCallback callback, void* pUser)
+{
+	unsigned long long now = GetAllocStatsTicks();
+	double ticksPerSecond = GetAllocStatsTicksPerSecond();
+	ForEachLive([=](void* ptr)
+	{
+		const PoolBlock<block_size>* pBlock = static_cast<const PoolBlock<block_size>*>(ptr);
+		callback(pUser, pBlock->_memory, pBlock->_allocId, double(now - pBlock->_allocTicks) / ticksPerSecond);
+	});
 }
+#endif // ALLOC_STATS
 
 } // namespace ITP485
 
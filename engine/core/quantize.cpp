@@ -0,0 +1,499 @@
+// quantize.cpp implements the pack/unpack routines. The single value versions
+// run the 4 wide code on one lane, so they match the batches exactly.
+#include "quantize.h"
+#include "soamath.h"
+
+namespace ITP485
+{
+
+namespace
+{
+
+// 1 / sqrt(2), the largest the 3 smallest components of a unit quaternion can be
+const float kSqrtHalf = 0.707106781f;
+
+// Converts 4 floats to halves, returned sign extended in 32 bit lanes so
+// _mm_packs_epi32 narrows them without saturating. Round to nearest even,
+// after the SSE2 version in Fabian Giesen's "half to float done quic".
+__forceinline __m128i FloatToHalf4(__m128 f)
+{
+	const __m128i f16Max = _mm_set1_epi32((127 + 16) << 23);
+	const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+	const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+	const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+	__m128 sign = _mm_and_ps(f, _mm_set_ps1(-0.0f));
+	__m128 absF = _mm_xor_ps(f, sign);
+	__m128i absInt = _mm_castps_si128(absF);
+
+	// infinity, or a quiet NaN
+	__m128i nanBit = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absF, absF)), _mm_set1_epi32(0x200));
+	__m128i infOrNan = _mm_or_si128(nanBit, _mm_set1_epi32(0x7c00));
+
+	// Denormal results: adding the magic number rounds the mantissa in place
+	__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absF, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+	// Normal results: rebias the exponent and round, adding one more if the
+	// result's lowest mantissa bit is odd so ties go to even
+	__m128i odd = _mm_srai_epi32(_mm_slli_epi32(absInt, 31 - 13), 31);
+	__m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absInt, normalBias), odd), 13);
+
+	__m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absInt);
+	__m128i isFinite = _mm_cmpgt_epi32(f16Max, absInt);
+	__m128i result = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+	result = _mm_or_si128(_mm_and_si128(isFinite, result), _mm_andnot_si128(isFinite, infOrNan));
+	return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+// Converts 4 halves, zero extended in 32 bit lanes, to floats
+__forceinline __m128 HalfToFloat4(__m128i h)
+{
+	const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+
+	__m128i expMantissa = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+	__m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expMantissa), 16);
+	// Shift into place and fix the exponent bias with a multiply, which
+	// also normalizes denormals
+	__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMantissa, 13)), magic);
+	// the multiply can't reach the float infinity exponent, so set it for inf/NaN
+	__m128i isInfNan = _mm_cmpgt_epi32(expMantissa, _mm_set1_epi32(0x7bff));
+	__m128 infNanExp = _mm_and_ps(_mm_castsi128_ps(isInfNan), _mm_castsi128_ps(_mm_set1_epi32(255 << 23)));
+	return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infNanExp));
+}
+
+// Half conversion kernels, one per SimdLevel
+typedef void (*FloatsToHalvesKernel)(const float*, unsigned short*, size_t);
+typedef void (*HalvesToFloatsKernel)(const unsigned short*, float*, size_t);
+
+void FloatsToHalvesSSE2(const float* in, unsigned short* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i lo = FloatToHalf4(_mm_loadu_ps(in + i));
+		__m128i hi = FloatToHalf4(_mm_loadu_ps(in + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = FloatToHalf(in[i]);
+	}
+}
+
+void HalvesToFloatsSSE2(const unsigned short* in, float* out, size_t n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		_mm_storeu_ps(out + i, HalfToFloat4(_mm_unpacklo_epi16(h, zero)));
+		_mm_storeu_ps(out + i + 4, HalfToFloat4(_mm_unpackhi_epi16(h, zero)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = HalfToFloat(in[i]);
+	}
+}
+
+// F16C does the same conversions in one instruction
+SIMD_TARGET_AVX2 void FloatsToHalvesAVX2(const float* in, unsigned short* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+	}
+	FloatsToHalvesSSE2(in + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX2 void HalvesToFloatsAVX2(const unsigned short* in, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+	}
+	HalvesToFloatsSSE2(in + i, out + i, n - i);
+}
+
+const FloatsToHalvesKernel s_FloatsToHalvesKernels[SIMD_NUM_LEVELS] =
+{
+	FloatsToHalvesSSE2,
+	FloatsToHalvesSSE2,
+	FloatsToHalvesAVX2,
+};
+
+const HalvesToFloatsKernel s_HalvesToFloatsKernels[SIMD_NUM_LEVELS] =
+{
+	HalvesToFloatsSSE2,
+	HalvesToFloatsSSE2,
+	HalvesToFloatsAVX2,
+};
+
+// Converts 4 floats to snorm16 in 32 bit lanes
+__forceinline __m128i FloatToSnorm16x4(__m128 f)
+{
+	f = _mm_min_ps(_mm_max_ps(f, _mm_set_ps1(-1.0f)), _mm_set_ps1(1.0f));
+	return _mm_cvtps_epi32(_mm_mul_ps(f, _mm_set_ps1(32767.0f)));
+}
+
+// Converts 4 sign extended snorm16s to floats
+__forceinline __m128 Snorm16ToFloat4(__m128i s)
+{
+	__m128 f = _mm_mul_ps(_mm_cvtepi32_ps(s), _mm_set_ps1(1.0f / 32767.0f));
+	return _mm_max_ps(f, _mm_set_ps1(-1.0f));
+}
+
+// Converts 4 floats to unorm8 in 32 bit lanes
+__forceinline __m128i FloatToUnorm8x4(__m128 f)
+{
+	f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set_ps1(1.0f));
+	return _mm_cvtps_epi32(_mm_mul_ps(f, _mm_set_ps1(255.0f)));
+}
+
+__forceinline __m128 Unorm8ToFloat4(__m128i u)
+{
+	return _mm_mul_ps(_mm_cvtepi32_ps(u), _mm_set_ps1(1.0f / 255.0f));
+}
+
+// Packs count (at most 4) quaternions with smallest three
+void PackQuaternions4(const FastQuaternion* in, PackedQuaternion* out, int count)
+{
+	Quaternionx4 q = Quaternionx4::Gather(in, count);
+	const __m128 signMask = _mm_set_ps1(-0.0f);
+	__m128 ax = _mm_andnot_ps(signMask, q.x);
+	__m128 ay = _mm_andnot_ps(signMask, q.y);
+	__m128 az = _mm_andnot_ps(signMask, q.z);
+	__m128 aw = _mm_andnot_ps(signMask, q.w);
+
+	// Pick the largest component, ties go to w, then z, then y
+	__m128 largest = _mm_max_ps(_mm_max_ps(ax, ay), _mm_max_ps(az, aw));
+	__m128 isW = _mm_cmpeq_ps(aw, largest);
+	__m128 isZ = _mm_andnot_ps(isW, _mm_cmpeq_ps(az, largest));
+	__m128 isY = _mm_andnot_ps(_mm_or_ps(isW, isZ), _mm_cmpeq_ps(ay, largest));
+	__m128 isX = _mm_andnot_ps(_mm_or_ps(_mm_or_ps(isW, isZ), isY), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+	// Flip the quaternion so the dropped component is positive
+	__m128 value = SimdSelect(isW, q.w, SimdSelect(isZ, q.z, SimdSelect(isY, q.y, q.x)));
+	__m128 sign = _mm_and_ps(value, signMask);
+
+	// The other three, in x, y, z, w order
+	__m128 a = _mm_xor_ps(SimdSelect(isX, q.y, q.x), sign);
+	__m128 b = _mm_xor_ps(SimdSelect(_mm_or_ps(isX, isY), q.z, q.y), sign);
+	__m128 c = _mm_xor_ps(SimdSelect(isW, q.z, q.w), sign);
+
+	// [-1/sqrt(2), 1/sqrt(2)] to [0, 32767]
+	const __m128 bias = _mm_set_ps1(kSqrtHalf);
+	const __m128 scale = _mm_set_ps1(32767.0f / (2.0f * kSqrtHalf));
+	const __m128 maxValue = _mm_set_ps1(32767.0f);
+	__m128i qa = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(a, bias), scale), _mm_setzero_ps()), maxValue));
+	__m128i qb = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(b, bias), scale), _mm_setzero_ps()), maxValue));
+	__m128i qc = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(c, bias), scale), _mm_setzero_ps()), maxValue));
+
+	// Index bit 0 goes in the top bit of word 0, bit 1 in the top bit of word 1.
+	// -0x8000 is the top bit sign extended, so packs_epi32 keeps it.
+	const __m128i topBit = _mm_set1_epi32(-0x8000);
+	qa = _mm_or_si128(qa, _mm_and_si128(_mm_castps_si128(_mm_or_ps(isY, isW)), topBit));
+	qb = _mm_or_si128(qb, _mm_and_si128(_mm_castps_si128(_mm_or_ps(isZ, isW)), topBit));
+
+	SIMD_ALIGN(16) unsigned short words[16];
+	_mm_store_si128(reinterpret_cast<__m128i*>(words), _mm_packs_epi32(qa, qb));
+	_mm_store_si128(reinterpret_cast<__m128i*>(words + 8), _mm_packs_epi32(qc, qc));
+	for (int i = 0; i < count; ++i)
+	{
+		out[i].data[0] = words[i];
+		out[i].data[1] = words[i + 4];
+		out[i].data[2] = words[i + 8];
+	}
+}
+
+// Unpacks count (at most 4) smallest three quaternions
+void UnpackQuaternions4(const PackedQuaternion* in, FastQuaternion* out, int count)
+{
+	SIMD_ALIGN(16) unsigned short words[16];
+	for (int i = 0; i < 4; ++i)
+	{
+		bool bUsed = (i < count);
+		words[i] = bUsed ? in[i].data[0] : 0;
+		words[i + 4] = bUsed ? in[i].data[1] : 0;
+		words[i + 8] = bUsed ? in[i].data[2] : 0;
+	}
+	const __m128i zero = _mm_setzero_si128();
+	__m128i ab = _mm_load_si128(reinterpret_cast<const __m128i*>(words));
+	__m128i wa = _mm_unpacklo_epi16(ab, zero);
+	__m128i wb = _mm_unpackhi_epi16(ab, zero);
+	__m128i wc = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(words + 8)), zero);
+
+	const __m128i topBit = _mm_set1_epi32(0x8000);
+	__m128 bit0 = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(wa, topBit), topBit));
+	__m128 bit1 = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(wb, topBit), topBit));
+	__m128 isX = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_castps_si128(_mm_or_ps(bit0, bit1)), zero));
+	__m128 isY = _mm_andnot_ps(bit1, bit0);
+	__m128 isZ = _mm_andnot_ps(bit0, bit1);
+	__m128 isW = _mm_and_ps(bit0, bit1);
+
+	const __m128i lowBits = _mm_set1_epi32(0x7fff);
+	const __m128 scale = _mm_set_ps1(2.0f * kSqrtHalf / 32767.0f);
+	const __m128 bias = _mm_set_ps1(kSqrtHalf);
+	__m128 a = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(wa, lowBits)), scale), bias);
+	__m128 b = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(wb, lowBits)), scale), bias);
+	__m128 c = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(wc, lowBits)), scale), bias);
+
+	// The dropped component makes the quaternion unit length
+	__m128 sumSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(c, c));
+	__m128 largest = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set_ps1(1.0f), sumSq), _mm_setzero_ps()));
+
+	Quaternionx4 q(SimdSelect(isX, largest, a),
+				   SimdSelect(isX, a, SimdSelect(isY, largest, b)),
+				   SimdSelect(_mm_or_ps(isX, isY), b, SimdSelect(isZ, largest, c)),
+				   SimdSelect(isW, largest, c));
+	q.Scatter(out, count);
+}
+
+// Packs count (at most 4) unit vectors as octahedral normals
+void PackNormals4(const FastVector3* in, OctahedralNormal* out, int count)
+{
+	Vector3x4 v = Vector3x4::Gather(in, count);
+	const __m128 signMask = _mm_set_ps1(-0.0f);
+	const __m128 one = _mm_set_ps1(1.0f);
+
+	// Project onto the octahedron |x| + |y| + |z| = 1
+	__m128 ax = _mm_andnot_ps(signMask, v.x);
+	__m128 ay = _mm_andnot_ps(signMask, v.y);
+	__m128 az = _mm_andnot_ps(signMask, v.z);
+	__m128 invL1 = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(ax, ay), az));
+	__m128 x = _mm_mul_ps(v.x, invL1);
+	__m128 y = _mm_mul_ps(v.y, invL1);
+
+	// Fold the lower half over the diagonals
+	__m128 foldX = _mm_xor_ps(_mm_sub_ps(one, _mm_mul_ps(ay, invL1)), _mm_and_ps(x, signMask));
+	__m128 foldY = _mm_xor_ps(_mm_sub_ps(one, _mm_mul_ps(ax, invL1)), _mm_and_ps(y, signMask));
+	__m128 isLower = _mm_cmplt_ps(v.z, _mm_setzero_ps());
+	x = SimdSelect(isLower, foldX, x);
+	y = SimdSelect(isLower, foldY, y);
+
+	__m128i px = FloatToSnorm16x4(x);
+	__m128i py = FloatToSnorm16x4(y);
+	// x0 y0 x1 y1 x2 y2 x3 y3
+	__m128i xy = _mm_unpacklo_epi16(_mm_packs_epi32(px, px), _mm_packs_epi32(py, py));
+	if (count == 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), xy);
+	}
+	else
+	{
+		SIMD_ALIGN(16) OctahedralNormal temp[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(temp), xy);
+		for (int i = 0; i < count; ++i)
+		{
+			out[i] = temp[i];
+		}
+	}
+}
+
+// Unpacks count (at most 4) octahedral normals
+void UnpackNormals4(const OctahedralNormal* in, FastVector3* out, int count)
+{
+	__m128i xy;
+	if (count == 4)
+	{
+		xy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+	}
+	else
+	{
+		SIMD_ALIGN(16) OctahedralNormal temp[4] = {};
+		for (int i = 0; i < count; ++i)
+		{
+			temp[i] = in[i];
+		}
+		xy = _mm_load_si128(reinterpret_cast<const __m128i*>(temp));
+	}
+
+	const __m128 signMask = _mm_set_ps1(-0.0f);
+	__m128 x = Snorm16ToFloat4(_mm_srai_epi32(_mm_slli_epi32(xy, 16), 16));
+	__m128 y = Snorm16ToFloat4(_mm_srai_epi32(xy, 16));
+	__m128 ax = _mm_andnot_ps(signMask, x);
+	__m128 ay = _mm_andnot_ps(signMask, y);
+	__m128 z = _mm_sub_ps(_mm_sub_ps(_mm_set_ps1(1.0f), ax), ay);
+
+	// Unfold the lower half: move x and y back toward 0 by -z
+	__m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+	x = _mm_sub_ps(x, _mm_xor_ps(t, _mm_and_ps(x, signMask)));
+	y = _mm_sub_ps(y, _mm_xor_ps(t, _mm_and_ps(y, signMask)));
+
+	Vector3x4 v(x, y, z);
+	v.Normalize();
+	v.Scatter(out, count);
+}
+
+} // anonymous namespace
+
+unsigned short FloatToHalf(float f)
+{
+	return static_cast<unsigned short>(_mm_cvtsi128_si32(FloatToHalf4(_mm_set_ss(f))));
+}
+
+float HalfToFloat(unsigned short h)
+{
+	return _mm_cvtss_f32(HalfToFloat4(_mm_cvtsi32_si128(h)));
+}
+
+void FloatsToHalves(const float* in, unsigned short* out, size_t n)
+{
+	s_FloatsToHalvesKernels[GetSimdLevel()](in, out, n);
+}
+
+void HalvesToFloats(const unsigned short* in, float* out, size_t n)
+{
+	s_HalvesToFloatsKernels[GetSimdLevel()](in, out, n);
+}
+
+short FloatToSnorm16(float f)
+{
+	return static_cast<short>(_mm_cvtsi128_si32(FloatToSnorm16x4(_mm_set_ss(f))));
+}
+
+float Snorm16ToFloat(short s)
+{
+	return _mm_cvtss_f32(Snorm16ToFloat4(_mm_cvtsi32_si128(s)));
+}
+
+void FloatsToSnorm16(const float* in, short* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m128i lo = FloatToSnorm16x4(_mm_loadu_ps(in + i));
+		__m128i hi = FloatToSnorm16x4(_mm_loadu_ps(in + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = FloatToSnorm16(in[i]);
+	}
+}
+
+void Snorm16ToFloats(const short* in, float* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		// unpacking with itself puts each value in the top half, then shift down to sign extend
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		_mm_storeu_ps(out + i, Snorm16ToFloat4(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+		_mm_storeu_ps(out + i + 4, Snorm16ToFloat4(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = Snorm16ToFloat(in[i]);
+	}
+}
+
+unsigned char FloatToUnorm8(float f)
+{
+	return static_cast<unsigned char>(_mm_cvtsi128_si32(FloatToUnorm8x4(_mm_set_ss(f))));
+}
+
+float Unorm8ToFloat(unsigned char u)
+{
+	return _mm_cvtss_f32(Unorm8ToFloat4(_mm_cvtsi32_si128(u)));
+}
+
+void FloatsToUnorm8(const float* in, unsigned char* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i a = _mm_packs_epi32(FloatToUnorm8x4(_mm_loadu_ps(in + i)), FloatToUnorm8x4(_mm_loadu_ps(in + i + 4)));
+		__m128i b = _mm_packs_epi32(FloatToUnorm8x4(_mm_loadu_ps(in + i + 8)), FloatToUnorm8x4(_mm_loadu_ps(in + i + 12)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(a, b));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = FloatToUnorm8(in[i]);
+	}
+}
+
+void Unorm8ToFloats(const unsigned char* in, float* out, size_t n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		__m128i lo = _mm_unpacklo_epi8(u, zero);
+		__m128i hi = _mm_unpackhi_epi8(u, zero);
+		_mm_storeu_ps(out + i, Unorm8ToFloat4(_mm_unpacklo_epi16(lo, zero)));
+		_mm_storeu_ps(out + i + 4, Unorm8ToFloat4(_mm_unpackhi_epi16(lo, zero)));
+		_mm_storeu_ps(out + i + 8, Unorm8ToFloat4(_mm_unpacklo_epi16(hi, zero)));
+		_mm_storeu_ps(out + i + 12, Unorm8ToFloat4(_mm_unpackhi_epi16(hi, zero)));
+	}
+	for (; i < n; ++i)
+	{
+		out[i] = Unorm8ToFloat(in[i]);
+	}
+}
+
+PackedQuaternion PackQuaternion(const FastQuaternion& q)
+{
+	PackedQuaternion result;
+	PackQuaternions4(&q, &result, 1);
+	return result;
+}
+
+FastQuaternion UnpackQuaternion(const PackedQuaternion& packed)
+{
+	FastQuaternion result;
+	UnpackQuaternions4(&packed, &result, 1);
+	return result;
+}
+
+void PackQuaternions(const FastQuaternion* in, PackedQuaternion* out, size_t n)
+{
+	for (size_t i = 0; i < n; i += 4)
+	{
+		PackQuaternions4(in + i, out + i, (n - i < 4) ? int(n - i) : 4);
+	}
+}
+
+void UnpackQuaternions(const PackedQuaternion* in, FastQuaternion* out, size_t n)
+{
+	for (size_t i = 0; i < n; i += 4)
+	{
+		UnpackQuaternions4(in + i, out + i, (n - i < 4) ? int(n - i) : 4);
+	}
+}
+
+OctahedralNormal PackNormal(const FastVector3& normal)
+{
+	OctahedralNormal result;
+	PackNormals4(&normal, &result, 1);
+	return result;
+}
+
+FastVector3 UnpackNormal(const OctahedralNormal& packed)
+{
+	FastVector3 result;
+	UnpackNormals4(&packed, &result, 1);
+	return result;
+}
+
+void PackNormals(const FastVector3* in, OctahedralNormal* out, size_t n)
+{
+	for (size_t i = 0; i < n; i += 4)
+	{
+		PackNormals4(in + i, out + i, (n - i < 4) ? int(n - i) : 4);
+	}
+}
+
+void UnpackNormals(const OctahedralNormal* in, FastVector3* out, size_t n)
+{
+	for (size_t i = 0; i < n; i += 4)
+	{
+		UnpackNormals4(in + i, out + i, (n - i < 4) ? int(n - i) : 4);
+	}
+}
+
+} // namespace ITP485
@@ -0,0 +1,77 @@
+// quantize.h defines compact encodings for rotations, vectors and normals,
+// for animation compression, network snapshots and vertex streams:
+//  - half precision floats (IEEE 754 binary16)
+//  - snorm16 and unorm8, the D3DDECLTYPE_SHORT2N/4N and UBYTE4N formats
+//  - smallest three quaternions in 48 bits
+//  - octahedral unit vectors in two snorm16s (D3DDECLTYPE_SHORT2N)
+//
+// Every encoding has a single value version and a batch version. The batch
+// versions work on 4 values at a time (8 with AVX2 for halves), and the
+// single versions give bit for bit the same results (other than NaN payloads). The worst case round
+// trip errors are listed with each format and checked by the unit tests.
+#ifndef _QUANTIZE_H_
+#define _QUANTIZE_H_
+
+#include "fastmath.h"
+
+namespace ITP485
+{
+
+// Half precision floats, round to nearest even. Values too large for a half
+// become infinity, NaNs stay NaNs and tiny values become half denormals.
+// Round trip relative error is at most 2^-11 for normal halves
+// (6.1e-5 <= |f| <= 65504). Vectors are just 3 or 4 floats in a row.
+unsigned short FloatToHalf(float f);
+float HalfToFloat(unsigned short h);
+void FloatsToHalves(const float* in, unsigned short* out, size_t n);
+void HalvesToFloats(const unsigned short* in, float* out, size_t n);
+
+// snorm16: f in [-1, 1] maps to round(f * 32767), and unpacks as s / 32767
+// (-32768 unpacks as -1). Inputs outside [-1, 1] are clamped.
+// Round trip error is at most 0.5 / 32767 = 1.53e-5.
+short FloatToSnorm16(float f);
+float Snorm16ToFloat(short s);
+void FloatsToSnorm16(const float* in, short* out, size_t n);
+void Snorm16ToFloats(const short* in, float* out, size_t n);
+
+// unorm8: f in [0, 1] maps to round(f * 255), and unpacks as u / 255.
+// Inputs outside [0, 1] are clamped. Round trip error is at most 0.5 / 255 = 1.96e-3.
+unsigned char FloatToUnorm8(float f);
+float Unorm8ToFloat(unsigned char u);
+void FloatsToUnorm8(const float* in, unsigned char* out, size_t n);
+void Unorm8ToFloats(const unsigned char* in, float* out, size_t n);
+
+// Unit quaternion in 48 bits. The largest component is dropped and rebuilt
+// from the other three, which are in [-1/sqrt(2), 1/sqrt(2)] and stored with
+// 15 bits each. The top bit of data[0] and data[1] is the index of the dropped
+// component. q and -q are the same rotation, so the unpacked quaternion may
+// be the negative of the packed one.
+// Round trip error per component is at most 1e-4.
+struct PackedQuaternion
+{
+	unsigned short data[3];
+};
+
+PackedQuaternion PackQuaternion(const FastQuaternion& q);
+FastQuaternion UnpackQuaternion(const PackedQuaternion& packed);
+void PackQuaternions(const FastQuaternion* in, PackedQuaternion* out, size_t n);
+void UnpackQuaternions(const PackedQuaternion* in, FastQuaternion* out, size_t n);
+
+// Unit vector in 32 bits: the vector is projected onto an octahedron, the
+// octahedron is unfolded into a square, and the square coordinates are stored
+// as snorm16. Unpacked vectors are unit length.
+// Round trip error per component is at most 1e-4.
+struct OctahedralNormal
+{
+	short x;
+	short y;
+};
+
+OctahedralNormal PackNormal(const FastVector3& normal);
+FastVector3 UnpackNormal(const OctahedralNormal& packed);
+void PackNormals(const FastVector3* in, OctahedralNormal* out, size_t n);
+void UnpackNormals(const OctahedralNormal* in, FastVector3* out, size_t n);
+
+} // namespace ITP485
+
+#endif // _QUANTIZE_H_
@@ -0,0 +1,108 @@
+// simd.cpp implements runtime CPU feature detection
+#include "simd.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace ITP485
+{
+
+int g_SimdLevel = -1;
+
+namespace
+{
+
+// Fills regs with eax, ebx, ecx, edx for the passed cpuid leaf
+void Cpuid(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, leaf, subleaf);
+	regs[0] = info[0];
+	regs[1] = info[1];
+	regs[2] = info[2];
+	regs[3] = info[3];
+#else
+	if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]))
+	{
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	}
+#endif
+}
+
+// Returns the lower 32 bits of XCR0, which say which register state the OS saves
+unsigned int ReadXCR0()
+{
+#if defined(_MSC_VER)
+	return static_cast<unsigned int>(_xgetbv(0));
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return eax;
+#endif
+}
+
+// Returns the best level this machine can run, ignoring any override
+SimdLevel QueryHardwareLevel()
+{
+	unsigned int regs[4];
+	Cpuid(0, 0, regs);
+	unsigned int maxLeaf = regs[0];
+
+	Cpuid(1, 0, regs);
+	bool bSSE41 = (regs[2] & (1 << 19)) != 0;
+	bool bFMA = (regs[2] & (1 << 12)) != 0;
+	bool bOSXSave = (regs[2] & (1 << 27)) != 0;
+	bool bAVX = (regs[2] & (1 << 28)) != 0;
+	bool bF16C = (regs[2] & (1 << 29)) != 0;
+
+	if (!bSSE41)
+	{
+		return SIMD_SSE2;
+	}
+
+	// AVX needs the OS to save the upper halves of the ymm registers
+	if (!bOSXSave || !bAVX || !bFMA || !bF16C || (ReadXCR0() & 0x6) != 0x6 || maxLeaf < 7)
+	{
+		return SIMD_SSE41;
+	}
+
+	Cpuid(7, 0, regs);
+	bool bAVX2 = (regs[1] & (1 << 5)) != 0;
+	return bAVX2 ? SIMD_AVX2 : SIMD_SSE41;
+}
+
+} // anonymous namespace
+
+SimdLevel DetectSimdLevel()
+{
+	SimdLevel level = QueryHardwareLevel();
+	g_SimdLevel = level;
+	return level;
+}
+
+void SetSimdLevel(SimdLevel level)
+{
+	SimdLevel hardware = QueryHardwareLevel();
+	g_SimdLevel = (level < hardware) ? level : hardware;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+		case SIMD_SSE2:
+			return "SSE2";
+		case SIMD_SSE41:
+			return "SSE4.1";
+		case SIMD_AVX2:
+			return "AVX2/FMA";
+		default:
+			return "Unknown";
+	}
+}
+
+} // namespace ITP485
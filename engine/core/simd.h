@@ -0,0 +1,375 @@
+// simd.h defines the portability layer used by the SIMD math library:
+// compiler keywords, alignment, runtime CPU feature detection, and a handful
+// of SSE2 helpers that every compiler/CPU we ship on supports.
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+// Compiler specific keywords.
+// SIMD_TARGET_* marks a function that may use a newer instruction set than the
+// rest of the translation unit. MSVC allows any intrinsic anywhere, GCC/Clang
+// need the target attribute.
+#if defined(_MSC_VER)
+#define SIMD_ALIGN(n) __declspec(align(n))
+#define SIMD_TARGET_SSE41
+#define SIMD_TARGET_AVX2
+#else
+#ifndef __forceinline
+#define __forceinline inline __attribute__((always_inline))
+#endif
+#define SIMD_ALIGN(n) __attribute__((aligned(n)))
+#define SIMD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#endif
+
+// Inline functions can't be dispatched at runtime, so they only use SSE4.1
+// if the whole build targets it (/arch:AVX or -msse4.1 and up).
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define SIMD_COMPILE_SSE41 1
+#include <smmintrin.h>
+#else
+#define SIMD_COMPILE_SSE41 0
+#endif
+
+#define _MM_SHUFFLER( xi, yi, zi, wi ) _MM_SHUFFLE( wi, zi, yi, xi )
+
+namespace ITP485
+{
+
+// Instruction set levels, in increasing order. Out-of-line kernels keep one
+// implementation per level and pick one based on GetSimdLevel().
+enum SimdLevel
+{
+	SIMD_SSE2 = 0,
+	SIMD_SSE41,
+	// AVX2 + FMA + F16C, every CPU with AVX2 has the other two
+	SIMD_AVX2,
+	SIMD_NUM_LEVELS
+};
+
+// Cached level, -1 until the first call to GetSimdLevel().
+extern int g_SimdLevel;
+
+// Runs cpuid (and xgetbv for AVX) and stores the result in g_SimdLevel.
+SimdLevel DetectSimdLevel();
+
+// Returns the highest instruction set level supported by this CPU and OS.
+__forceinline SimdLevel GetSimdLevel()
+{
+	if (g_SimdLevel < 0)
+	{
+		return DetectSimdLevel();
+	}
+	return static_cast<SimdLevel>(g_SimdLevel);
+}
+
+// Forces a lower level, so tests and benchmarks can exercise every kernel.
+// Requests above what the CPU supports are clamped.
+void SetSimdLevel(SimdLevel level);
+
+// Returns a printable name for the level
+const char* GetSimdLevelName(SimdLevel level);
+
+// Accuracy tiers for the approximated math functions
+enum SimdAccuracy
+{
+	// Within a couple of ulps of the CRT functions
+	SIMD_PRECISE = 0,
+	// Cheaper, about 4e-5 absolute error. Fine for input and camera math.
+	// Square roots and reciprocals use an estimate refined with one
+	// Newton-Raphson step, good to about 22 bits.
+	SIMD_FAST,
+	// Raw rsqrt/rcp estimates, about 12 bits. Only for things like lighting
+	// and particles where nobody will notice. Same as SIMD_FAST for SinCos.
+	SIMD_ESTIMATE
+};
+
+// Helpers shared by the fast math classes. These are all SSE2 unless
+// SIMD_COMPILE_SSE41 is set.
+
+// Returns the requested lane as a float
+__forceinline float SimdGetX(__m128 v)
+{
+	return _mm_cvtss_f32(v);
+}
+
+__forceinline float SimdGetY(__m128 v)
+{
+	return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+}
+
+__forceinline float SimdGetZ(__m128 v)
+{
+	return _mm_cvtss_f32(_mm_movehl_ps(v, v));
+}
+
+__forceinline float SimdGetW(__m128 v)
+{
+	return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+
+// Returns v with the requested lane replaced by f
+__forceinline __m128 SimdSetX(__m128 v, float f)
+{
+	return _mm_move_ss(v, _mm_set_ss(f));
+}
+
+__forceinline __m128 SimdSetY(__m128 v, float f)
+{
+#if SIMD_COMPILE_SSE41
+	return _mm_insert_ps(v, _mm_set_ss(f), 0x10);
+#else
+	// swap x/y, replace x, swap back
+	__m128 temp = _mm_shuffle_ps(v, v, _MM_SHUFFLER(1, 0, 2, 3));
+	temp = _mm_move_ss(temp, _mm_set_ss(f));
+	return _mm_shuffle_ps(temp, temp, _MM_SHUFFLER(1, 0, 2, 3));
+#endif
+}
+
+__forceinline __m128 SimdSetZ(__m128 v, float f)
+{
+#if SIMD_COMPILE_SSE41
+	return _mm_insert_ps(v, _mm_set_ss(f), 0x20);
+#else
+	__m128 temp = _mm_shuffle_ps(v, v, _MM_SHUFFLER(2, 1, 0, 3));
+	temp = _mm_move_ss(temp, _mm_set_ss(f));
+	return _mm_shuffle_ps(temp, temp, _MM_SHUFFLER(2, 1, 0, 3));
+#endif
+}
+
+__forceinline __m128 SimdSetW(__m128 v, float f)
+{
+#if SIMD_COMPILE_SSE41
+	return _mm_insert_ps(v, _mm_set_ss(f), 0x30);
+#else
+	__m128 temp = _mm_shuffle_ps(v, v, _MM_SHUFFLER(3, 1, 2, 0));
+	temp = _mm_move_ss(temp, _mm_set_ss(f));
+	return _mm_shuffle_ps(temp, temp, _MM_SHUFFLER(3, 1, 2, 0));
+#endif
+}
+
+// Mask with all bits set in x, y, z and clear in w
+__forceinline __m128 SimdMaskXYZ()
+{
+	return _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+}
+
+// Returns a in the lanes where mask is set and b in the others
+__forceinline __m128 SimdSelect(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// 4 component dot product, result splatted to every lane
+__forceinline __m128 SimdDot4(__m128 a, __m128 b)
+{
+#if SIMD_COMPILE_SSE41
+	return _mm_dp_ps(a, b, 0xFF);
+#else
+	__m128 temp = _mm_mul_ps(a, b);
+	// x+y, x+y, z+w, z+w
+	temp = _mm_add_ps(temp, _mm_shuffle_ps(temp, temp, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_add_ps(temp, _mm_shuffle_ps(temp, temp, _MM_SHUFFLE(1, 0, 3, 2)));
+#endif
+}
+
+// 3 component dot product (w is ignored), result splatted to every lane
+__forceinline __m128 SimdDot3(__m128 a, __m128 b)
+{
+#if SIMD_COMPILE_SSE41
+	return _mm_dp_ps(a, b, 0x7F);
+#else
+	return SimdDot4(_mm_and_ps(a, SimdMaskXYZ()), b);
+#endif
+}
+
+// 3 component cross product, w is 0
+__forceinline __m128 SimdCross3(__m128 a, __m128 b)
+{
+	__m128 temp1 = _mm_shuffle_ps(a, a, _MM_SHUFFLER(1, 2, 0, 3));
+	__m128 temp2 = _mm_shuffle_ps(b, b, _MM_SHUFFLER(2, 0, 1, 3));
+	__m128 left = _mm_mul_ps(temp1, temp2);
+
+	temp1 = _mm_shuffle_ps(a, a, _MM_SHUFFLER(2, 0, 1, 3));
+	temp2 = _mm_shuffle_ps(b, b, _MM_SHUFFLER(1, 2, 0, 3));
+	__m128 right = _mm_mul_ps(temp1, temp2);
+
+	return _mm_sub_ps(left, right);
+}
+
+// Transforms v by the row-major matrix in rows (rows[i] . v for each i)
+__forceinline __m128 SimdTransform4(const __m128* rows, __m128 v)
+{
+#if SIMD_COMPILE_SSE41
+	__m128 x = _mm_dp_ps(rows[0], v, 0xF1);
+	__m128 y = _mm_dp_ps(rows[1], v, 0xF2);
+	__m128 z = _mm_dp_ps(rows[2], v, 0xF4);
+	__m128 w = _mm_dp_ps(rows[3], v, 0xF8);
+	return _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w));
+#else
+	// Multiply each row, then transpose so each column holds one dot product
+	__m128 x = _mm_mul_ps(rows[0], v);
+	__m128 y = _mm_mul_ps(rows[1], v);
+	__m128 z = _mm_mul_ps(rows[2], v);
+	__m128 w = _mm_mul_ps(rows[3], v);
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	return _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w));
+#endif
+}
+
+// Reciprocal square root, rsqrt refined with one Newton-Raphson step.
+// Good to about 22 bits, and much cheaper than a sqrt and a divide.
+__forceinline __m128 SimdRsqrt(__m128 v)
+{
+	__m128 estimate = _mm_rsqrt_ps(v);
+	// estimate * (1.5 - 0.5 * v * estimate^2)
+	__m128 half = _mm_mul_ps(_mm_set_ps1(0.5f), v);
+	__m128 temp = _mm_mul_ps(_mm_mul_ps(half, estimate), estimate);
+	return _mm_mul_ps(estimate, _mm_sub_ps(_mm_set_ps1(1.5f), temp));
+}
+
+// Reciprocal, rcp refined with one Newton-Raphson step
+__forceinline __m128 SimdRcp(__m128 v)
+{
+	__m128 estimate = _mm_rcp_ps(v);
+	// estimate * (2 - v * estimate)
+	return _mm_mul_ps(estimate, _mm_sub_ps(_mm_set_ps1(2.0f), _mm_mul_ps(v, estimate)));
+}
+
+// 1 / v at the requested accuracy. accuracy is nearly always a constant,
+// so the branches fold away.
+__forceinline __m128 SimdReciprocal(__m128 v, SimdAccuracy accuracy)
+{
+	if (accuracy == SIMD_PRECISE)
+	{
+		return _mm_div_ps(_mm_set_ps1(1.0f), v);
+	}
+	if (accuracy == SIMD_FAST)
+	{
+		return SimdRcp(v);
+	}
+	return _mm_rcp_ps(v);
+}
+
+// 1 / sqrt(v) at the requested accuracy
+__forceinline __m128 SimdInvSqrt(__m128 v, SimdAccuracy accuracy)
+{
+	if (accuracy == SIMD_PRECISE)
+	{
+		return _mm_div_ps(_mm_set_ps1(1.0f), _mm_sqrt_ps(v));
+	}
+	if (accuracy == SIMD_FAST)
+	{
+		return SimdRsqrt(v);
+	}
+	return _mm_rsqrt_ps(v);
+}
+
+// sqrt(v) at the requested accuracy. The approximations are v * rsqrt(v),
+// with 0 masked so it doesn't turn into 0 * inf.
+__forceinline __m128 SimdSqrt(__m128 v, SimdAccuracy accuracy)
+{
+	if (accuracy == SIMD_PRECISE)
+	{
+		return _mm_sqrt_ps(v);
+	}
+	__m128 result = _mm_mul_ps(v, SimdInvSqrt(v, accuracy));
+	return _mm_and_ps(result, _mm_cmpgt_ps(v, _mm_setzero_ps()));
+}
+
+// Slerp weight for each lane, sin(f * angle) / sin(angle), where xm1 is
+// cos(angle) - 1 and cos(angle) >= 0. Uses Eberly's polynomial ("A Fast and
+// Accurate Algorithm for Computing SLERP"), so there is no acos or sin and
+// no divide, and it stays accurate as the angle goes to 0.
+__forceinline __m128 SimdSlerpWeight(__m128 xm1, __m128 f)
+{
+	// The last term is scaled by 1 + mu to correct for the truncated series
+	const float onePlusMu = 1.90110745351730037f;
+	const __m128 one = _mm_set_ps1(1.0f);
+	__m128 sqr = _mm_mul_ps(f, f);
+	__m128 result = one;
+	for (int i = 8; i >= 1; --i)
+	{
+		float scale = (i == 8) ? onePlusMu : 1.0f;
+		__m128 u = _mm_set_ps1(scale / float(i * (2 * i + 1)));
+		__m128 v = _mm_set_ps1(scale * float(i) / float(2 * i + 1));
+		__m128 b = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, sqr), v), xm1);
+		result = _mm_add_ps(one, _mm_mul_ps(b, result));
+	}
+	return _mm_mul_ps(f, result);
+}
+
+// Sine and cosine of each lane of angle (in radians), computed together.
+// This is the Cephes sinf/cosf algorithm: reduce to [-pi/4, pi/4] around a
+// multiple of pi/4, then pick the sine or cosine polynomial for each lane
+// depending on the octant. SIMD_PRECISE is good for |angle| up to about 8192.
+// SIMD_FAST uses a one-step reduction and shorter polynomials, and is meant
+// for angles within a few turns of 0.
+__forceinline void SimdSinCos(__m128 angle, __m128& s, __m128& c, SimdAccuracy accuracy = SIMD_PRECISE)
+{
+	const __m128 signMask = _mm_set_ps1(-0.0f);
+	__m128 x = _mm_andnot_ps(signMask, angle);
+
+	// j = x / (pi/4), rounded up to an even number, so x - j*pi/4 is in [-pi/4, pi/4]
+	__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set_ps1(1.27323954473516f)));
+	j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+	__m128 y = _mm_cvtepi32_ps(j);
+
+	if (accuracy == SIMD_PRECISE)
+	{
+		// pi/4 split in three parts so the products are exact
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set_ps1(0.78515625f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set_ps1(2.4187564849853515625e-4f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set_ps1(3.77489497744594108e-8f)));
+	}
+	else
+	{
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set_ps1(0.785398163397448f)));
+	}
+
+	// sine flips sign in octants 4-7 and for negative angles, cosine in octants 2-5
+	const __m128i four = _mm_set1_epi32(4);
+	__m128 sinSign = _mm_xor_ps(_mm_and_ps(angle, signMask),
+								_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, four), 29)));
+	__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), four), 29));
+	// in octants 2, 3, 6 and 7 the polynomials swap
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+
+	__m128 z = _mm_mul_ps(x, x);
+	__m128 sinPoly;
+	__m128 cosPoly;
+	if (accuracy == SIMD_PRECISE)
+	{
+		sinPoly = _mm_set_ps1(-1.9515295891e-4f);
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set_ps1(8.3321608736e-3f));
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set_ps1(-1.6666654611e-1f));
+
+		cosPoly = _mm_set_ps1(2.443315711809948e-5f);
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set_ps1(-1.388731625493765e-3f));
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set_ps1(4.166664568298827e-2f));
+	}
+	else
+	{
+		sinPoly = _mm_set_ps1(8.3321608736e-3f);
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set_ps1(-1.6666654611e-1f));
+
+		cosPoly = _mm_set_ps1(-1.388731625493765e-3f);
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set_ps1(4.166664568298827e-2f));
+	}
+	// sin = x + x^3 * p(z), cos = 1 - z/2 + z^2 * q(z)
+	sinPoly = _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(sinPoly, z), x));
+	cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+	cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set_ps1(0.5f))), _mm_set_ps1(1.0f));
+
+	s = _mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly));
+	c = _mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly));
+	s = _mm_xor_ps(s, sinSign);
+	c = _mm_xor_ps(c, cosSign);
+}
+
+} // namespace ITP485
+
+#endif // _SIMD_H_
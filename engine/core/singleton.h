@@ -1,36 +1,117 @@
 // Defines a templated Singleton class
 #ifndef _SINGLETON_H_
 #define _SINGLETON_H_
+#include "dbg_assert.h"
+#include <new>
+#include <type_traits>
 
 // You must place this macro inside the class definition of your derived Singleton
-#define DECLARE_SINGLETON(SingletonClass) friend class Singleton<SingletonClass>;
+#define DECLARE_SINGLETON(SingletonClass) template <class, ITP485::SingletonCreation> friend class ITP485::Singleton;
 
 namespace ITP485
 {
 
+// When a Singleton's instance is constructed
+enum SingletonCreation
+{
+	// During static initialization, before main. For singletons whose
+	// constructor doesn't need anything else to be running, like the allocators.
+	SINGLETON_STATIC_INIT = 0,
+	// Only when Create is called, which SubsystemRegistry does right before
+	// the subsystem starts up
+	SINGLETON_EXPLICIT
+};
+
+// The instance's memory. It's its own template so sizeof(T) isn't needed
+// until T is complete, which it isn't yet while Singleton<T> is its base.
 template <class T>
+struct SingletonStorage
+{
+	static typename std::aligned_storage<sizeof(T), __alignof(T)>::type s_Instance;
+};
+
+template <class T> typename std::aligned_storage<sizeof(T), __alignof(T)>::type SingletonStorage<T>::s_Instance;
+
+template <class T, SingletonCreation creation>
+struct SingletonAutoCreate;
+
+// The instance lives in static memory rather than on the heap, so get() is
+// just its address: no check, no branch, and it inlines away.
+//
+// SINGLETON_STATIC_INIT instances are created during static initialization.
+// Anything that runs during static initialization itself (like a global that
+// starts up a pool) has to call Create first, since the order globals are
+// initialized in isn't defined. Create does nothing if it's already been called.
+//
+// SINGLETON_EXPLICIT instances don't exist until Create is called. Debug
+// builds assert if get() is called before Create or after Destroy.
+//
+// Instances are never destroyed unless Destroy is called.
+template <class T, SingletonCreation creation = SINGLETON_STATIC_INIT>
 class Singleton
 {
-private:
-	static T* _instance;
 protected:
 	Singleton() {}
 public:
 	static T& get()
 	{
-		if (_instance)
+		SingletonAutoCreate<T, creation>::Touch();
+		Dbg_Assert(s_bCreated, "Singleton used before it was created.");
+		return *reinterpret_cast<T*>(&SingletonStorage<T>::s_Instance);
+	}
+
+	// Constructs the instance, if it hasn't been already
+	static void Create()
+	{
+		if (!s_bCreated)
 		{
-			return *_instance;
+			new (&SingletonStorage<T>::s_Instance) T();
+			s_bCreated = true;
 		}
-		else
+	}
+
+	// Destroys the instance, if there is one
+	static void Destroy()
+	{
+		if (s_bCreated)
 		{
-			_instance = new T();
-			return *_instance;
+			s_bCreated = false;
+			reinterpret_cast<T*>(&SingletonStorage<T>::s_Instance)->~T();
 		}
 	}
+
+	static bool IsCreated() { return s_bCreated; }
+
+private:
+	// Constant initialized, so it's already false before any constructor runs
+	static bool s_bCreated;
+};
+
+template <class T, SingletonCreation creation> bool Singleton<T, creation>::s_bCreated = false;
+
+// SINGLETON_EXPLICIT instances are left alone
+template <class T, SingletonCreation creation>
+struct SingletonAutoCreate
+{
+	static void Touch() {}
+};
+
+// SINGLETON_STATIC_INIT instances are created by s_Creator's constructor.
+// get() refers to s_Creator, which is what makes the compiler instantiate it
+// for every T that's used. Touch itself compiles to nothing.
+template <class T>
+struct SingletonAutoCreate<T, SINGLETON_STATIC_INIT>
+{
+	struct Creator
+	{
+		Creator() { T::Create(); }
+	};
+	static Creator s_Creator;
+
+	static void Touch() { (void)&s_Creator; }
 };
 
-template <class T> T* Singleton<T>::_instance = 0;
+template <class T> typename SingletonAutoCreate<T, SINGLETON_STATIC_INIT>::Creator SingletonAutoCreate<T, SINGLETON_STATIC_INIT>::s_Creator;
 
 } // namespace ITP485
 
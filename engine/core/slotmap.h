@@ -0,0 +1,247 @@
+// Defines a slot map, which keeps objects packed in one array and hands out
+// generational handles to them
+#ifndef _SLOTMAP_H_
+#define _SLOTMAP_H_
+#include "dbg_assert.h"
+#include "poolalloc.h"
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ITP485
+{
+
+// Refers to an object in a SlotMap<T>. m_Index picks the slot, and
+// m_Generation has to match the slot's, so a handle to an erased object
+// never finds whatever took its slot afterwards.
+// Generation 0 is never used, so a default constructed handle is null.
+template <class T>
+struct SlotHandle
+{
+	unsigned int m_Index;
+	unsigned int m_Generation;
+
+	SlotHandle()
+	: m_Index(0)
+	, m_Generation(0)
+	{
+
+	}
+
+	bool IsNull() const { return m_Generation == 0; }
+
+	bool operator==(const SlotHandle& other) const
+	{
+		return m_Index == other.m_Index && m_Generation == other.m_Generation;
+	}
+	bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// SlotMap stores its objects in one contiguous array, so walking all of them
+// is a linear pass over memory. Insert, Erase and Get are all O(1).
+//
+// Erase moves the last object into the hole, so objects move around and
+// pointers to them only stay valid until the next Insert or Erase. Keep a
+// Handle instead, and Get the object when it's needed.
+//
+// T must be move (or copy) constructible. The array is aligned to at
+// least 16 bytes, so T can hold SIMD types.
+//
+// Not thread safe.
+template <class T>
+class SlotMap
+{
+public:
+	typedef SlotHandle<T> Handle;
+
+	SlotMap()
+	: m_pObjects(nullptr)
+	, m_Size(0)
+	, m_Capacity(0)
+	, m_FreeSlot(kNoSlot)
+	{
+
+	}
+
+	// Destroys every object and frees the array
+	~SlotMap()
+	{
+		Clear();
+		AlignedFree(m_pObjects);
+	}
+
+	// Constructs a new T from args at the end of the array,
+	// and returns its handle
+	template <class... Args>
+	Handle Insert(Args&&... args)
+	{
+		if (m_Size == m_Capacity)
+		{
+			Reserve((m_Capacity > 0) ? m_Capacity * 2 : kMinCapacity);
+		}
+		new (static_cast<void*>(m_pObjects + m_Size)) T(std::forward<Args>(args)...);
+
+		// Reuse a free slot if there is one
+		unsigned int slot = m_FreeSlot;
+		if (slot != kNoSlot)
+		{
+			m_FreeSlot = m_Slots[slot].m_Object;
+		}
+		else
+		{
+			slot = static_cast<unsigned int>(m_Slots.size());
+			Slot newSlot;
+			newSlot.m_Generation = 1;
+			m_Slots.push_back(newSlot);
+		}
+		m_Slots[slot].m_Object = m_Size;
+		m_ObjectSlots.push_back(slot);
+		m_Size++;
+
+		Handle handle;
+		handle.m_Index = slot;
+		handle.m_Generation = m_Slots[slot].m_Generation;
+		return handle;
+	}
+
+	// Destroys the object handle refers to, and moves the last object into
+	// its place. Returns false if handle is null or stale.
+	bool Erase(Handle handle)
+	{
+		if (!IsValid(handle))
+		{
+			return false;
+		}
+
+		unsigned int object = m_Slots[handle.m_Index].m_Object;
+		unsigned int last = m_Size - 1;
+		m_pObjects[object].~T();
+		if (object != last)
+		{
+			new (static_cast<void*>(m_pObjects + object)) T(std::move(m_pObjects[last]));
+			m_pObjects[last].~T();
+			m_ObjectSlots[object] = m_ObjectSlots[last];
+			m_Slots[m_ObjectSlots[object]].m_Object = object;
+		}
+		m_ObjectSlots.pop_back();
+		m_Size--;
+
+		FreeSlot(handle.m_Index);
+		return true;
+	}
+
+	// Returns true if handle refers to an object that's still in the map
+	bool IsValid(Handle handle) const
+	{
+		return handle.m_Index < m_Slots.size() && m_Slots[handle.m_Index].m_Generation == handle.m_Generation;
+	}
+
+	// Returns the object handle refers to, or nullptr if it's null or stale
+	T* Get(Handle handle)
+	{
+		return IsValid(handle) ? m_pObjects + m_Slots[handle.m_Index].m_Object : nullptr;
+	}
+	const T* Get(Handle handle) const
+	{
+		return IsValid(handle) ? m_pObjects + m_Slots[handle.m_Index].m_Object : nullptr;
+	}
+
+	// Returns the handle of the object at index in the array
+	Handle GetHandle(unsigned int index) const
+	{
+		Dbg_Assert(index < m_Size, "SlotMap index out of range!");
+		Handle handle;
+		handle.m_Index = m_ObjectSlots[index];
+		handle.m_Generation = m_Slots[handle.m_Index].m_Generation;
+		return handle;
+	}
+
+	// Number of objects in the map
+	unsigned int GetSize() const { return m_Size; }
+	bool IsEmpty() const { return m_Size == 0; }
+
+	// The object array, for walking every object in the map
+	T& operator[](unsigned int index) { return m_pObjects[index]; }
+	const T& operator[](unsigned int index) const { return m_pObjects[index]; }
+	T* begin() { return m_pObjects; }
+	T* end() { return m_pObjects + m_Size; }
+	const T* begin() const { return m_pObjects; }
+	const T* end() const { return m_pObjects + m_Size; }
+
+	// Makes room for capacity objects, so Insert doesn't move them until there
+	// are more than that
+	void Reserve(unsigned int capacity)
+	{
+		if (capacity <= m_Capacity)
+		{
+			return;
+		}
+
+		size_t alignment = (__alignof(T) > 16) ? __alignof(T) : 16;
+		T* pObjects = static_cast<T*>(AlignedAlloc(capacity * sizeof(T), alignment));
+		Dbg_Assert(pObjects != nullptr, "SlotMap is out of memory!");
+		for (unsigned int i = 0; i < m_Size; i++)
+		{
+			new (static_cast<void*>(pObjects + i)) T(std::move(m_pObjects[i]));
+			m_pObjects[i].~T();
+		}
+		AlignedFree(m_pObjects);
+		m_pObjects = pObjects;
+		m_Capacity = capacity;
+		m_ObjectSlots.reserve(capacity);
+	}
+
+	// Destroys every object. Every handle goes stale.
+	void Clear()
+	{
+		for (unsigned int i = 0; i < m_Size; i++)
+		{
+			m_pObjects[i].~T();
+			FreeSlot(m_ObjectSlots[i]);
+		}
+		m_ObjectSlots.clear();
+		m_Size = 0;
+	}
+
+private:
+	// Not copyable
+	SlotMap(const SlotMap&);
+	SlotMap& operator=(const SlotMap&);
+
+	// A handle's index leads here. m_Object is where the slot's object is in
+	// the array, or the next free slot if the slot is free.
+	struct Slot
+	{
+		unsigned int m_Generation;
+		unsigned int m_Object;
+	};
+
+	// Stales the slot's handles and puts it on the free list
+	void FreeSlot(unsigned int slot)
+	{
+		m_Slots[slot].m_Generation++;
+		if (m_Slots[slot].m_Generation == 0)
+		{
+			m_Slots[slot].m_Generation = 1;
+		}
+		m_Slots[slot].m_Object = m_FreeSlot;
+		m_FreeSlot = slot;
+	}
+
+	static const unsigned int kNoSlot = 0xffffffff;
+	static const unsigned int kMinCapacity = 16;
+
+	// The objects, packed at the front
+	T* m_pObjects;
+	unsigned int m_Size;
+	unsigned int m_Capacity;
+	// The slot of each object, so Erase can fix up the one it moves
+	std::vector<unsigned int> m_ObjectSlots;
+	std::vector<Slot> m_Slots;
+	// First free slot, the rest are linked through m_Object
+	unsigned int m_FreeSlot;
+};
+
+} // namespace ITP485
+
+#endif // _SLOTMAP_H_
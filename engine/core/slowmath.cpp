@@ -1,5 +1,6 @@
 // SlowMath.cpp defines statics for the slow math library
 #include "slowmath.h"
+#include "dbg_assert.h"
 
 namespace ITP485
 {
@@ -8,6 +9,7 @@ float _ident2[4][4] = {1.0f, 0.0f, 0.0f, 0.0f,
 						0.0f, 0.0f, 1.0f, 0.0f,
 						0.0f, 0.0f, 0.0f, 1.0f};
 const SlowMatrix4 SlowMatrix4::Identity(_ident2);
+const SlowAffine3x4 SlowAffine3x4::Identity(_ident2);
 
 const SlowVector3 SlowVector3::Zero(0.0f, 0.0f, 0.0f);
 const SlowVector3 SlowVector3::UnitX(1.0f, 0.0f, 0.0f);
@@ -31,6 +33,241 @@ void SlowMatrix4::CreateTranslation(const SlowVector3& rhs)
 	_matrix[3][3] = 1.0f;
 }
 
+void SlowAffine3x4::CreateTranslation(const SlowVector3& rhs)
+{
+	memset(_matrix, 0, sizeof(float) * 12);
+	_matrix[0][0] = 1.0f;
+	_matrix[0][3] = rhs._x;
+	_matrix[1][1] = 1.0f;
+	_matrix[1][3] = rhs._y;
+	_matrix[2][2] = 1.0f;
+	_matrix[2][3] = rhs._z;
+}
+
+void SlowAffine3x4::CreateFromQuaternion(const SlowQuaternion& q)
+{
+	SlowMatrix4 temp;
+	temp.CreateFromQuaternion(q);
+	*this = SlowAffine3x4(temp);
+}
+
+void SlowAffine3x4::CreateFromQuaternion(const SlowQuaternion& q, const SlowVector3& translation)
+{
+	CreateFromQuaternion(q);
+	_matrix[0][3] = translation.GetX();
+	_matrix[1][3] = translation.GetY();
+	_matrix[2][3] = translation.GetZ();
+}
+
+void SlowAffine3x4::Decompose(SlowVector3& translation, SlowQuaternion& rotation, SlowVector3& scale) const
+{
+	float s[3];
+	for (int j = 0; j < 3; ++j)
+	{
+		s[j] = sqrtf(_matrix[0][j] * _matrix[0][j] + _matrix[1][j] * _matrix[1][j] + _matrix[2][j] * _matrix[2][j]);
+	}
+
+	// A reflection shows up as a negative determinant, put it in z
+	float det = _matrix[0][0] * (_matrix[1][1] * _matrix[2][2] - _matrix[1][2] * _matrix[2][1])
+			  - _matrix[0][1] * (_matrix[1][0] * _matrix[2][2] - _matrix[1][2] * _matrix[2][0])
+			  + _matrix[0][2] * (_matrix[1][0] * _matrix[2][1] - _matrix[1][1] * _matrix[2][0]);
+	if (det < 0.0f)
+	{
+		s[2] = -s[2];
+	}
+
+	SlowAffine3x4 rot(*this);
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			rot._matrix[i][j] /= s[j];
+		}
+	}
+	rotation.CreateFromMatrix(rot);
+	translation.Set(_matrix[0][3], _matrix[1][3], _matrix[2][3]);
+	scale.Set(s[0], s[1], s[2]);
+}
+
+void SlowAffine3x4::Compose(const SlowVector3& translation, const SlowQuaternion& rotation, const SlowVector3& scale)
+{
+	CreateFromQuaternion(rotation, translation);
+	float s[3] = { scale.GetX(), scale.GetY(), scale.GetZ() };
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			_matrix[i][j] *= s[j];
+		}
+	}
+}
+
+void SlowAffine3x4::DecomposeBatch(const SlowAffine3x4* in, SlowVector3* translations, SlowQuaternion* rotations,
+								   SlowVector3* scales, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		in[i].Decompose(translations[i], rotations[i], scales[i]);
+	}
+}
+
+void SlowAffine3x4::ComposeBatch(const SlowVector3* translations, const SlowQuaternion* rotations,
+								 const SlowVector3* scales, SlowAffine3x4* out, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		out[i].Compose(translations[i], rotations[i], scales[i]);
+	}
+}
+
+void SlowQuaternion::CreateFromMatrix(const SlowAffine3x4& mat)
+{
+	const float* m = mat.ToFloats();
+	float m00 = m[0], m01 = m[1], m02 = m[2];
+	float m10 = m[4], m11 = m[5], m12 = m[6];
+	float m20 = m[8], m21 = m[9], m22 = m[10];
+	float trace = m00 + m11 + m22;
+	if (trace > 0.0f)
+	{
+		float s = 0.5f / sqrtf(trace + 1.0f);
+		Set((m21 - m12) * s, (m02 - m20) * s, (m10 - m01) * s, 0.25f / s);
+	}
+	else if (m00 > m11 && m00 > m22)
+	{
+		float s = 0.5f / sqrtf(1.0f + m00 - m11 - m22);
+		Set(0.25f / s, (m01 + m10) * s, (m02 + m20) * s, (m21 - m12) * s);
+	}
+	else if (m11 > m22)
+	{
+		float s = 0.5f / sqrtf(1.0f + m11 - m00 - m22);
+		Set((m01 + m10) * s, 0.25f / s, (m12 + m21) * s, (m02 - m20) * s);
+	}
+	else
+	{
+		float s = 0.5f / sqrtf(1.0f + m22 - m00 - m11);
+		Set((m02 + m20) * s, (m12 + m21) * s, 0.25f / s, (m10 - m01) * s);
+	}
+}
+
+// Shared by SlowAffine3x4 and SlowMatrix4, m is the top 3 rows of the transform
+static void InvertAffine3x4(float m[][4])
+{
+	// cofactors of the upper 3x3
+	float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+	Dbg_Assert(det != 0.0f, "Affine transform has a zero determinant and can't be inverted.");
+	float invDet = 1.0f / det;
+
+	float inv[3][3];
+	inv[0][0] = c00 * invDet;
+	inv[1][0] = c01 * invDet;
+	inv[2][0] = c02 * invDet;
+	inv[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+	inv[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+	inv[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+	inv[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+	inv[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+	inv[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+
+	float t[3] = { m[0][3], m[1][3], m[2][3] };
+	for (int i = 0; i < 3; i++)
+	{
+		m[i][0] = inv[i][0];
+		m[i][1] = inv[i][1];
+		m[i][2] = inv[i][2];
+		m[i][3] = -(inv[i][0] * t[0] + inv[i][1] * t[1] + inv[i][2] * t[2]);
+	}
+}
+
+// Same as above, but the inverse of the 3x3 is its transpose
+static void InvertOrthonormal3x4(float m[][4])
+{
+	float inv[3][3];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			inv[i][j] = m[j][i];
+		}
+	}
+
+	float t[3] = { m[0][3], m[1][3], m[2][3] };
+	for (int i = 0; i < 3; i++)
+	{
+		m[i][0] = inv[i][0];
+		m[i][1] = inv[i][1];
+		m[i][2] = inv[i][2];
+		m[i][3] = -(inv[i][0] * t[0] + inv[i][1] * t[1] + inv[i][2] * t[2]);
+	}
+}
+
+static bool IsOrthonormal3x4(const float m[][4], float epsilon)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = i; j < 3; j++)
+		{
+			float dot = m[i][0] * m[j][0] + m[i][1] * m[j][1] + m[i][2] * m[j][2];
+			float expected = (i == j) ? 1.0f : 0.0f;
+			if (fabsf(dot - expected) > epsilon)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void SlowAffine3x4::Invert()
+{
+	InvertAffine3x4(_matrix);
+}
+
+void SlowAffine3x4::InvertOrthonormal()
+{
+	Dbg_Assert(IsOrthonormal(), "InvertOrthonormal called on a transform that isn't orthonormal.");
+	InvertOrthonormal3x4(_matrix);
+}
+
+bool SlowAffine3x4::IsOrthonormal(float epsilon) const
+{
+	return IsOrthonormal3x4(_matrix, epsilon);
+}
+
+void SlowMatrix4::InvertAffine()
+{
+	Dbg_Assert(IsAffine(), "InvertAffine called on a matrix whose bottom row isn't (0, 0, 0, 1).");
+	InvertAffine3x4(_matrix);
+	_matrix[3][0] = 0.0f;
+	_matrix[3][1] = 0.0f;
+	_matrix[3][2] = 0.0f;
+	_matrix[3][3] = 1.0f;
+}
+
+void SlowMatrix4::InvertOrthonormal()
+{
+	Dbg_Assert(IsAffine(), "InvertOrthonormal called on a matrix whose bottom row isn't (0, 0, 0, 1).");
+	Dbg_Assert(IsOrthonormal(), "InvertOrthonormal called on a matrix that isn't orthonormal.");
+	InvertOrthonormal3x4(_matrix);
+	_matrix[3][0] = 0.0f;
+	_matrix[3][1] = 0.0f;
+	_matrix[3][2] = 0.0f;
+	_matrix[3][3] = 1.0f;
+}
+
+bool SlowMatrix4::IsAffine(float epsilon) const
+{
+	return fabsf(_matrix[3][0]) <= epsilon && fabsf(_matrix[3][1]) <= epsilon
+		&& fabsf(_matrix[3][2]) <= epsilon && fabsf(_matrix[3][3] - 1.0f) <= epsilon;
+}
+
+bool SlowMatrix4::IsOrthonormal(float epsilon) const
+{
+	return IsOrthonormal3x4(_matrix, epsilon);
+}
+
 void SlowMatrix4::CreateFromQuaternion(const SlowQuaternion& q)
 {
 	float x = q.GetVectorX();
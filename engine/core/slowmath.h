@@ -4,8 +4,14 @@
 #define _SLOWMATH_H_
 
 #include <cmath>
+#include <cstddef>
 #include <memory.h>
 
+// __forceinline is MSVC only
+#if !defined(_MSC_VER) && !defined(__forceinline)
+#define __forceinline inline __attribute__((always_inline))
+#endif
+
 // Define D3D Matrix here so we don't have to replicate
 #ifndef D3DMATRIX_DEFINED
 typedef struct _D3DMATRIX {
@@ -34,6 +40,10 @@ const float PiOver2 = 3.1415926535f / 2.0f;
 const float PiOver4 = 3.1415926535f / 4.0f;
 #endif
 
+class SlowVector3;
+class SlowQuaternion;
+class SlowAffine3x4;
+
 class SlowMatrix4
 {
 private:
@@ -45,6 +55,7 @@ private:
 public:
 	friend class SlowVector3;
 	friend class SlowQuaternion;
+	friend class SlowAffine3x4;
 
 	__forceinline SlowMatrix4() {}
 	__forceinline SlowMatrix4(float mat[4][4])
@@ -81,6 +92,12 @@ public:
 		return &_d3dm;
 	}
 
+	// Stores this matrix in out, row by row (same as FastMatrix4::StoreD3D)
+	__forceinline void StoreD3D(D3DMATRIX& out) const
+	{
+		memcpy(&out, _matrix, sizeof(float) * 16);
+	}
+
 	void Multiply(const SlowMatrix4& rhs)
 	{
 		float tmp[4][4];
@@ -111,6 +128,28 @@ public:
 		_matrix[3][3] = tmp[3][0] * rhs._matrix[0][3] + tmp[3][1] * rhs._matrix[1][3] + tmp[3][2] * rhs._matrix[2][3] + tmp[3][3] * rhs._matrix[3][3];
 	}
 
+	// Multiplies n pairs of matrices, out[i] = a[i] * b[i]
+	static void MultiplyBatch(const SlowMatrix4* a, const SlowMatrix4* b, SlowMatrix4* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			SlowMatrix4 temp(a[i]);
+			temp.Multiply(b[i]);
+			out[i] = temp;
+		}
+	}
+
+	// Multiplies one matrix against n matrices, out[i] = a * b[i]
+	static void MultiplyBroadcast(const SlowMatrix4& a, const SlowMatrix4* b, SlowMatrix4* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			SlowMatrix4 temp(a);
+			temp.Multiply(b[i]);
+			out[i] = temp;
+		}
+	}
+
 	__forceinline void Add(SlowMatrix4& rhs)
 	{
 		_matrix[0][0] += rhs._matrix[0][0];
@@ -238,9 +277,203 @@ public:
 	// Inverts the matrix
 	void Invert();
 
+	// Inverts a matrix whose bottom row is (0, 0, 0, 1)
+	void InvertAffine();
+
+	// Inverts a rigid transform by transposing the rotation
+	void InvertOrthonormal();
+
+	// Returns true if the bottom row is (0, 0, 0, 1)
+	bool IsAffine(float epsilon = 0.0001f) const;
+
+	// Returns true if the rows of the upper 3x3 are unit length and perpendicular
+	bool IsOrthonormal(float epsilon = 0.001f) const;
+
 	static const SlowMatrix4 Identity;
 };
 
+// Affine transform, the top 3 rows of a SlowMatrix4.
+// The bottom row is always (0, 0, 0, 1) and isn't stored.
+class SlowAffine3x4
+{
+private:
+	float _matrix[3][4];
+public:
+	friend class SlowVector3;
+
+	__forceinline SlowAffine3x4() {}
+	__forceinline SlowAffine3x4(float mat[3][4])
+	{
+		memcpy(_matrix, mat, sizeof(float) * 12);
+	}
+
+	// The bottom row of mat must be (0, 0, 0, 1)
+	__forceinline explicit SlowAffine3x4(const SlowMatrix4& mat)
+	{
+		memcpy(_matrix, mat._matrix, sizeof(float) * 12);
+	}
+
+	// Sets from a 4x4 array, the bottom row is ignored
+	__forceinline void Set(float mat[4][4])
+	{
+		memcpy(_matrix, mat, sizeof(float) * 12);
+	}
+
+	__forceinline SlowAffine3x4(const SlowAffine3x4& rhs)
+	{
+		memcpy(_matrix, rhs._matrix, sizeof(float) * 12);
+	}
+
+	__forceinline SlowAffine3x4& operator=(const SlowAffine3x4& rhs)
+	{
+		memcpy(_matrix, rhs._matrix, sizeof(float) * 12);
+		return *this;
+	}
+
+	__forceinline void ToMatrix4(SlowMatrix4& out) const
+	{
+		memcpy(out._matrix, _matrix, sizeof(float) * 12);
+		out._matrix[3][0] = 0.0f;
+		out._matrix[3][1] = 0.0f;
+		out._matrix[3][2] = 0.0f;
+		out._matrix[3][3] = 1.0f;
+	}
+
+	__forceinline const float* ToFloats() const
+	{
+		return &_matrix[0][0];
+	}
+
+	void Multiply(const SlowAffine3x4& rhs)
+	{
+		float tmp[3][4];
+		memcpy(tmp, _matrix, sizeof(float) * 12);
+
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				_matrix[i][j] = tmp[i][0] * rhs._matrix[0][j] + tmp[i][1] * rhs._matrix[1][j] + tmp[i][2] * rhs._matrix[2][j];
+			}
+			_matrix[i][3] += tmp[i][3];
+		}
+	}
+
+	// Multiplies n pairs of transforms, out[i] = a[i] * b[i]
+	static void MultiplyBatch(const SlowAffine3x4* a, const SlowAffine3x4* b, SlowAffine3x4* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			SlowAffine3x4 temp(a[i]);
+			temp.Multiply(b[i]);
+			out[i] = temp;
+		}
+	}
+
+	__forceinline void CreateScale(float scale)
+	{
+		memset(_matrix, 0, sizeof(float) * 12);
+		_matrix[0][0] = scale;
+		_matrix[1][1] = scale;
+		_matrix[2][2] = scale;
+	}
+
+	__forceinline friend SlowAffine3x4 Lerp(const SlowAffine3x4& a, const SlowAffine3x4& b, float f)
+	{
+		SlowAffine3x4 retval;
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				retval._matrix[i][j] = b._matrix[i][j] * f + (1.0f - f) * a._matrix[i][j];
+			}
+		}
+
+		return retval;
+	}
+
+	// Has to be defined in Slowmath.cpp because of circular dependency
+	void CreateTranslation(const SlowVector3& rhs);
+	void CreateFromQuaternion(const SlowQuaternion& q);
+
+	// Rotation first, then translation
+	void CreateFromQuaternion(const SlowQuaternion& q, const SlowVector3& translation);
+
+	// Inverts the transform
+	void Invert();
+
+	// Inverts a rigid transform by transposing the rotation
+	void InvertOrthonormal();
+
+	// Inverts n transforms, out[i] = inverse(in[i])
+	static void InvertMany(const SlowAffine3x4* in, SlowAffine3x4* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[i] = in[i];
+			out[i].Invert();
+		}
+	}
+
+	// Splits the transform into translation, rotation and scale (negative
+	// scale.z if there's a reflection). Assumes no shear and no zero scale.
+	void Decompose(SlowVector3& translation, SlowQuaternion& rotation, SlowVector3& scale) const;
+
+	// Scale first, then rotation, then translation
+	void Compose(const SlowVector3& translation, const SlowQuaternion& rotation, const SlowVector3& scale);
+
+	// Decomposes/composes n transforms
+	static void DecomposeBatch(const SlowAffine3x4* in, SlowVector3* translations, SlowQuaternion* rotations,
+							   SlowVector3* scales, size_t n);
+	static void ComposeBatch(const SlowVector3* translations, const SlowQuaternion* rotations,
+							 const SlowVector3* scales, SlowAffine3x4* out, size_t n);
+
+	// Transforms n points (w is treated as 1.0f) that are inStride/outStride
+	// bytes apart. bStream is only a hint for the SIMD version.
+	void TransformPoints(const float* in, size_t inStride, float* out, size_t outStride, size_t n,
+						 bool /*bStream*/ = false) const
+	{
+		TransformStrided(in, inStride, out, outStride, n, 1.0f);
+	}
+
+	// Same as TransformPoints, but w is treated as 0.0f and the results are renormalized
+	void TransformNormals(const float* in, size_t inStride, float* out, size_t outStride, size_t n,
+						  bool /*bStream*/ = false) const
+	{
+		TransformStrided(in, inStride, out, outStride, n, 0.0f);
+	}
+
+	// Returns true if the rows of the upper 3x3 are unit length and perpendicular
+	bool IsOrthonormal(float epsilon = 0.001f) const;
+
+	static const SlowAffine3x4 Identity;
+private:
+	void TransformStrided(const float* in, size_t inStride, float* out, size_t outStride, size_t n, float w) const
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			const float* pIn = reinterpret_cast<const float*>(reinterpret_cast<const char*>(in) + i * inStride);
+			float* pOut = reinterpret_cast<float*>(reinterpret_cast<char*>(out) + i * outStride);
+			float x = pIn[0], y = pIn[1], z = pIn[2];
+			float result[3];
+			for (int row = 0; row < 3; ++row)
+			{
+				result[row] = _matrix[row][0] * x + _matrix[row][1] * y + _matrix[row][2] * z + _matrix[row][3] * w;
+			}
+			if (w == 0.0f)
+			{
+				float invLength = 1.0f / sqrtf(result[0] * result[0] + result[1] * result[1] + result[2] * result[2]);
+				result[0] *= invLength;
+				result[1] *= invLength;
+				result[2] *= invLength;
+			}
+			pOut[0] = result[0];
+			pOut[1] = result[1];
+			pOut[2] = result[2];
+		}
+	}
+};
+
 class SlowVector3
 {
 private:
@@ -419,6 +652,33 @@ public:
 
 	void Rotate(const SlowQuaternion& q);
 
+	__forceinline void Transform(const SlowAffine3x4& mat)
+	{
+		// w is 1.0f, and stays 1.0f
+		_w = 1.0f;
+
+		float new_x = mat._matrix[0][0] * _x + mat._matrix[0][1] * _y + mat._matrix[0][2] * _z + mat._matrix[0][3];
+		float new_y = mat._matrix[1][0] * _x + mat._matrix[1][1] * _y + mat._matrix[1][2] * _z + mat._matrix[1][3];
+		float new_z = mat._matrix[2][0] * _x + mat._matrix[2][1] * _y + mat._matrix[2][2] * _z + mat._matrix[2][3];
+
+		_x = new_x;
+		_y = new_y;
+		_z = new_z;
+	}
+
+	__forceinline void TransformAsVector(const SlowAffine3x4& mat)
+	{
+		_w = 0.0f;
+
+		float new_x = mat._matrix[0][0] * _x + mat._matrix[0][1] * _y + mat._matrix[0][2] * _z;
+		float new_y = mat._matrix[1][0] * _x + mat._matrix[1][1] * _y + mat._matrix[1][2] * _z;
+		float new_z = mat._matrix[2][0] * _x + mat._matrix[2][1] * _y + mat._matrix[2][2] * _z;
+
+		_x = new_x;
+		_y = new_y;
+		_z = new_z;
+	}
+
 	__forceinline void TransformAsVector(SlowMatrix4 &mat)
 	{
 		// set W component to 0.0f before we do anything
@@ -437,6 +697,7 @@ public:
 
 	friend class SlowMatrix4;
 	friend class SlowQuaternion;
+	friend class SlowAffine3x4;
 
 	static const SlowVector3 Zero;
 	static const SlowVector3 UnitX;
@@ -579,6 +840,83 @@ public:
 		return result;
 	}
 
+	// Spherical interpolation along the shortest arc, using acos/sin
+	friend SlowQuaternion Slerp(const SlowQuaternion& a, const SlowQuaternion& b, float f)
+	{
+		float cosAngle = a._qv.Dot(b._qv) + a._qs * b._qs;
+		float sign = 1.0f;
+		if (cosAngle < 0.0f)
+		{
+			sign = -1.0f;
+			cosAngle = -cosAngle;
+		}
+
+		float fa = 1.0f - f;
+		float fb = f;
+		// sin(angle) goes to 0 for nearly equal quaternions, lerp is fine there
+		if (cosAngle < 0.9999f)
+		{
+			float angle = acosf(cosAngle);
+			float invSin = 1.0f / sinf(angle);
+			fa = sinf(fa * angle) * invSin;
+			fb = sinf(fb * angle) * invSin;
+		}
+		fb *= sign;
+
+		SlowQuaternion result(a._qv.GetX() * fa + b._qv.GetX() * fb,
+							  a._qv.GetY() * fa + b._qv.GetY() * fb,
+							  a._qv.GetZ() * fa + b._qv.GetZ() * fb,
+							  a._qs * fa + b._qs * fb);
+		result.Normalize();
+		return result;
+	}
+
+	// Normalized lerp along the shortest arc
+	friend SlowQuaternion NLerp(const SlowQuaternion& a, const SlowQuaternion& b, float f)
+	{
+		float fb = (a._qv.Dot(b._qv) + a._qs * b._qs < 0.0f) ? -f : f;
+		float fa = 1.0f - f;
+		SlowQuaternion result(a._qv.GetX() * fa + b._qv.GetX() * fb,
+							  a._qv.GetY() * fa + b._qv.GetY() * fb,
+							  a._qv.GetZ() * fa + b._qv.GetZ() * fb,
+							  a._qs * fa + b._qs * fb);
+		result.Normalize();
+		return result;
+	}
+
+	// Sets this to the rotation in the upper 3x3 of mat
+	void CreateFromMatrix(const SlowAffine3x4& mat);
+
+	// out[i] = normalize(in[i])
+	static void NormalizeBatch(const SlowQuaternion* in, SlowQuaternion* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[i] = in[i];
+			out[i].Normalize();
+		}
+	}
+
+	// out[i] = a[i] rotated by b[i]
+	static void MultiplyBatch(const SlowQuaternion* a, const SlowQuaternion* b, SlowQuaternion* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			SlowQuaternion temp(a[i]);
+			temp.Multiply(b[i]);
+			out[i] = temp;
+		}
+	}
+
+	// out[i] = Slerp(a[i], b[i], f[i])
+	static void SlerpBatch(const SlowQuaternion* a, const SlowQuaternion* b, const float* f, SlowQuaternion* out, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[i] = Slerp(a[i], b[i], f[i]);
+		}
+	}
+
 	friend class SlowVector3;
 	friend class SlowMatrix4;
 
@@ -0,0 +1,62 @@
+// smallalloc.cpp creates the size class pools of the small object allocator
+#include "smallalloc.h"
+
+namespace ITP485
+{
+
+namespace
+{
+
+// Names of the size class pools in allocator stats reports
+const char* kSizeClassNames[kNumSmallObjectSizeClasses] =
+{
+	"SmallObject 16", "SmallObject 32", "SmallObject 48", "SmallObject 64",
+	"SmallObject 80", "SmallObject 96", "SmallObject 112", "SmallObject 128",
+	"SmallObject 144", "SmallObject 160", "SmallObject 176", "SmallObject 192",
+	"SmallObject 208", "SmallObject 224", "SmallObject 240", "SmallObject 256",
+};
+
+// Creates the pools for block_size and every smaller size class
+template <size_t block_size>
+struct SizeClassPools
+{
+	static void Create(SmallObjectPoolBase** pPools)
+	{
+		const unsigned int sizeClass = block_size / kSmallObjectGranularity - 1;
+		SmallObjectPool<block_size>* pPool = new SmallObjectPool<block_size>();
+		pPool->SetStatsName(kSizeClassNames[sizeClass]);
+		pPools[sizeClass] = pPool;
+		SizeClassPools<block_size - kSmallObjectGranularity>::Create(pPools);
+	}
+};
+
+template <>
+struct SizeClassPools<0>
+{
+	static void Create(SmallObjectPoolBase**) {}
+};
+
+} // anonymous namespace
+
+// StartUp creates and starts up the pool for each size class
+void SmallObjectAllocator::StartUp()
+{
+	SizeClassPools<kMaxSmallObjectSize>::Create(m_pPools);
+	for (unsigned int i = 0; i < kNumSmallObjectSizeClasses; ++i)
+	{
+		m_pPools[i]->StartUp();
+	}
+}
+
+// ShutDown shuts down and deletes the pools
+void SmallObjectAllocator::ShutDown()
+{
+	for (unsigned int i = 0; i < kNumSmallObjectSizeClasses; ++i)
+	{
+		m_pPools[i]->ShutDown();
+		delete m_pPools[i];
+		m_pPools[i] = 0;
+	}
+}
+
+} // namespace ITP485
@@ -0,0 +1,150 @@
+// Defines the small object allocator, which sends every allocation up to
+// kMaxSmallObjectSize bytes to a pool for its size class, so classes can be
+// pooled without picking a PoolAllocator typedef for each one.
+#ifndef _SMALLALLOC_H_
+#define _SMALLALLOC_H_
+#include "poolalloc.h"
+
+namespace ITP485
+{
+
+// Largest allocation that goes to a pool, anything bigger goes to the heap
+const size_t kMaxSmallObjectSize = 256;
+
+// Size classes are every multiple of 16 up to kMaxSmallObjectSize
+const size_t kSmallObjectGranularity = 16;
+const unsigned int kNumSmallObjectSizeClasses = kMaxSmallObjectSize / kSmallObjectGranularity;
+
+// Blocks in each chunk of a size class pool. The pools grow a chunk at a time.
+const unsigned int kSmallObjectChunkBlocks = 64;
+
+// Interface to the pool of one size class
+class SmallObjectPoolBase
+{
+public:
+	virtual ~SmallObjectPoolBase() {}
+	virtual void StartUp() = 0;
+	virtual void ShutDown() = 0;
+	virtual void* Allocate(size_t size) = 0;
+	virtual void Free(void* ptr) = 0;
+	virtual unsigned int GetNumBlocksFree() = 0;
+	virtual unsigned int GetNumBlocks() = 0;
+};
+
+// The pool for one size class. It's an instance of its own rather than the
+// PoolAllocator singleton, so it never shares blocks with a PoolAllocator
+// typedef that happens to have the same parameters.
+template <size_t block_size>
+class SmallObjectPool : public SmallObjectPoolBase, public PoolAllocator<block_size, kSmallObjectChunkBlocks>
+{
+	typedef PoolAllocator<block_size, kSmallObjectChunkBlocks> Pool;
+public:
+	SmallObjectPool() {}
+
+	virtual void StartUp() override { Pool::StartUp(kPoolNoLimit); }
+	virtual void ShutDown() override { Pool::ShutDown(); }
+	virtual void* Allocate(size_t size) override { return Pool::Allocate(size); }
+	virtual void Free(void* ptr) override { Pool::Free(ptr); }
+	virtual unsigned int GetNumBlocksFree() override { return Pool::GetNumBlocksFree(); }
+	virtual unsigned int GetNumBlocks() override { return Pool::GetNumBlocks(); }
+};
+
+// SmallObjectAllocator rounds the size of each allocation up to a multiple
+// of 16 and takes it from that size's pool. Every pool grows as needed.
+// Allocations over kMaxSmallObjectSize come from the heap. All of them are
+// 16 byte aligned.
+//
+// Free needs the size that was passed to Allocate, which C++ passes to a
+// class's operator delete(void*, size_t). Use DECLARE_SMALL_OBJECT_NEW_DELETE
+// rather than calling this directly.
+//
+// IMPORTANT! StartUp must always be called before starting to use this,
+// and ShutDown must be called once you're done with it. Only the main thread
+// may use it.
+class SmallObjectAllocator : public Singleton<SmallObjectAllocator>
+{
+	DECLARE_SINGLETON(SmallObjectAllocator);
+public:
+	// StartUp creates and starts up the pool for each size class
+	void StartUp();
+
+	// ShutDown shuts down and deletes the pools
+	void ShutDown();
+
+	// Allocate returns size bytes from the pool for size's class, or from
+	// the heap if size is over kMaxSmallObjectSize
+	void* Allocate(size_t size)
+	{
+		if (size > kMaxSmallObjectSize)
+		{
+			return AlignedAlloc(size, 16);
+		}
+		return m_pPools[GetSizeClass(size)]->Allocate(size);
+	}
+
+	// Free returns ptr to where it came from. size must be the size passed to Allocate.
+	void Free(void* ptr, size_t size)
+	{
+		if (!ptr)
+		{
+			return;
+		}
+		if (size > kMaxSmallObjectSize)
+		{
+			AlignedFree(ptr);
+			return;
+		}
+		m_pPools[GetSizeClass(size)]->Free(ptr);
+	}
+
+	// Returns the pool that allocations of size bytes come from, or 0 if they
+	// come from the heap
+	SmallObjectPoolBase* GetPool(size_t size)
+	{
+		return (size > kMaxSmallObjectSize) ? 0 : m_pPools[GetSizeClass(size)];
+	}
+
+	// Returns the index of size's class, 0 for 1 to 16 bytes and so on
+	static unsigned int GetSizeClass(size_t size)
+	{
+		return (size == 0) ? 0 : static_cast<unsigned int>((size - 1) / kSmallObjectGranularity);
+	}
+
+protected:
+	// Default constructor does nothing other than set some pointers to 0
+	SmallObjectAllocator()
+	{
+		memset(m_pPools, 0, sizeof(m_pPools));
+	}
+
+	// The pool for each size class
+	SmallObjectPoolBase* m_pPools[kNumSmallObjectSizeClasses];
+};
+
+} // namespace ITP485
+
+// Macro that defines operator new/deletes which use the small object allocator.
+// Use this inside the definition of a class, when you want said class to be
+// pooled without picking a pool for it. Arrays of the class are pooled too if
+// they're small enough. Derived classes use it as well, as long as the
+// destructor is virtual (so delete gets the derived class's size).
+// This must be defined within the public section of the class or it won't work.
+#define DECLARE_SMALL_OBJECT_NEW_DELETE()								\
+	static void* operator new(size_t size)								\
+	{																	\
+		return ITP485::SmallObjectAllocator::get().Allocate(size);		\
+	}																	\
+	static void operator delete(void* ptr, size_t size)					\
+	{																	\
+		ITP485::SmallObjectAllocator::get().Free(ptr, size);			\
+	}																	\
+	static void* operator new[](size_t size)							\
+	{																	\
+		return ITP485::SmallObjectAllocator::get().Allocate(size);		\
+	}																	\
+	static void operator delete[](void* ptr, size_t size)				\
+	{																	\
+		ITP485::SmallObjectAllocator::get().Free(ptr, size);			\
+	}
+
+#endif // _SMALLALLOC_H_
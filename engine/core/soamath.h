@@ -0,0 +1,999 @@
+// soamath.h defines structure-of-arrays packets of vectors and quaternions.
+// A packet holds 4 (SSE) or 8 (AVX) values with each component in its own
+// register, so every lane does useful work and there are no horizontal ops.
+//
+// The 8 wide types use AVX2/FMA instructions. Only use them from code marked
+// SIMD_TARGET_AVX2 (or built with /arch:AVX2, -mavx2 -mfma), and only when
+// GetSimdLevel() == SIMD_AVX2.
+#ifndef _SOAMATH_H_
+#define _SOAMATH_H_
+
+#include "fastmath.h"
+
+namespace ITP485
+{
+
+class Quaternionx4;
+class Quaternionx8;
+
+// 4 FastVector3s, one component per register
+class SIMD_ALIGN(16) Vector3x4
+{
+public:
+	// Lane i of each register is vector i
+	__m128 x;
+	__m128 y;
+	__m128 z;
+
+	// Default constructor does nothing
+	__forceinline Vector3x4() {}
+
+	// Constructs a packet from the component registers
+	__forceinline Vector3x4(__m128 _x, __m128 _y, __m128 _z)
+	: x(_x), y(_y), z(_z)
+	{
+	}
+
+	// Constructs a packet with v in every lane
+	__forceinline explicit Vector3x4(const FastVector3& v)
+	{
+		x = _mm_shuffle_ps(v._data, v._data, _MM_SHUFFLE(0, 0, 0, 0));
+		y = _mm_shuffle_ps(v._data, v._data, _MM_SHUFFLE(1, 1, 1, 1));
+		z = _mm_shuffle_ps(v._data, v._data, _MM_SHUFFLE(2, 2, 2, 2));
+	}
+
+	// Loads 4 vectors from src
+	__forceinline static Vector3x4 Gather(const FastVector3* src)
+	{
+		__m128 r0 = src[0]._data;
+		__m128 r1 = src[1]._data;
+		__m128 r2 = src[2]._data;
+		__m128 r3 = src[3]._data;
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		return Vector3x4(r0, r1, r2);
+	}
+
+	// Loads count (at most 4) vectors from src, the other lanes are zero
+	__forceinline static Vector3x4 Gather(const FastVector3* src, int count)
+	{
+		__m128 r[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			r[i] = (i < count) ? src[i]._data : _mm_setzero_ps();
+		}
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		return Vector3x4(r[0], r[1], r[2]);
+	}
+
+	// Stores the 4 vectors to dest, w is set to 1.0f
+	__forceinline void Scatter(FastVector3* dest) const
+	{
+		__m128 r0 = x;
+		__m128 r1 = y;
+		__m128 r2 = z;
+		__m128 r3 = _mm_set_ps1(1.0f);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		dest[0]._data = r0;
+		dest[1]._data = r1;
+		dest[2]._data = r2;
+		dest[3]._data = r3;
+	}
+
+	// Stores the first count (at most 4) vectors to dest, w is set to 1.0f
+	__forceinline void Scatter(FastVector3* dest, int count) const
+	{
+		__m128 r[4] = { x, y, z, _mm_set_ps1(1.0f) };
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		for (int i = 0; i < count && i < 4; ++i)
+		{
+			dest[i]._data = r[i];
+		}
+	}
+
+	// Adds rhs to this, storing in this
+	__forceinline void Add(const Vector3x4& rhs)
+	{
+		x = _mm_add_ps(x, rhs.x);
+		y = _mm_add_ps(y, rhs.y);
+		z = _mm_add_ps(z, rhs.z);
+	}
+
+	// Subtracts this - rhs, storing in this
+	__forceinline void Sub(const Vector3x4& rhs)
+	{
+		x = _mm_sub_ps(x, rhs.x);
+		y = _mm_sub_ps(y, rhs.y);
+		z = _mm_sub_ps(z, rhs.z);
+	}
+
+	// Multiplies each lane by the matching lane of scalars
+	__forceinline void Multiply(__m128 scalars)
+	{
+		x = _mm_mul_ps(x, scalars);
+		y = _mm_mul_ps(y, scalars);
+		z = _mm_mul_ps(z, scalars);
+	}
+
+	// Multiplies every lane by scalar
+	__forceinline void Multiply(float scalar)
+	{
+		Multiply(_mm_set_ps1(scalar));
+	}
+
+	// Returns the 4 dot products between this and rhs
+	__forceinline __m128 Dot(const Vector3x4& rhs) const
+	{
+		__m128 result = _mm_mul_ps(x, rhs.x);
+		result = _mm_add_ps(result, _mm_mul_ps(y, rhs.y));
+		return _mm_add_ps(result, _mm_mul_ps(z, rhs.z));
+	}
+
+	// Returns the 4 squared lengths
+	__forceinline __m128 LengthSquared() const
+	{
+		return Dot(*this);
+	}
+
+	// Returns the 4 lengths
+	__forceinline __m128 Length(SimdAccuracy accuracy = SIMD_PRECISE) const
+	{
+		return SimdSqrt(Dot(*this), accuracy);
+	}
+
+	// Normalizes all 4 vectors
+	__forceinline void Normalize(SimdAccuracy accuracy = SIMD_PRECISE)
+	{
+		Multiply(SimdInvSqrt(Dot(*this), accuracy));
+	}
+
+	// Does 4 cross products between lhs and rhs, returning the result by value
+	__forceinline friend Vector3x4 Cross(const Vector3x4& lhs, const Vector3x4& rhs)
+	{
+		return Vector3x4(
+			_mm_sub_ps(_mm_mul_ps(lhs.y, rhs.z), _mm_mul_ps(lhs.z, rhs.y)),
+			_mm_sub_ps(_mm_mul_ps(lhs.z, rhs.x), _mm_mul_ps(lhs.x, rhs.z)),
+			_mm_sub_ps(_mm_mul_ps(lhs.x, rhs.y), _mm_mul_ps(lhs.y, rhs.x)));
+	}
+
+	// Interpolates between a and b, returning the result by value
+	// result = a + (b - a) * f
+	__forceinline friend Vector3x4 Lerp(const Vector3x4& a, const Vector3x4& b, __m128 f)
+	{
+		return Vector3x4(
+			_mm_add_ps(a.x, _mm_mul_ps(_mm_sub_ps(b.x, a.x), f)),
+			_mm_add_ps(a.y, _mm_mul_ps(_mm_sub_ps(b.y, a.y), f)),
+			_mm_add_ps(a.z, _mm_mul_ps(_mm_sub_ps(b.z, a.z), f)));
+	}
+
+	// Same as above, with the same f for every lane
+	__forceinline friend Vector3x4 Lerp(const Vector3x4& a, const Vector3x4& b, float f)
+	{
+		return Lerp(a, b, _mm_set_ps1(f));
+	}
+
+	// Rotates each vector by the matching quaternion in q (defined below)
+	__forceinline void Rotate(const Quaternionx4& q);
+
+	// Transforms all 4 vectors by the passed matrix, w is treated as 1.0f
+	template <class Layout>
+	__forceinline void Transform(const FastMatrix4T<Layout>& mat)
+	{
+		__m128 rx = _mm_add_ps(_mm_mul_ps(x, _mm_set_ps1(mat.Get(0, 0))), _mm_mul_ps(y, _mm_set_ps1(mat.Get(0, 1))));
+		__m128 ry = _mm_add_ps(_mm_mul_ps(x, _mm_set_ps1(mat.Get(1, 0))), _mm_mul_ps(y, _mm_set_ps1(mat.Get(1, 1))));
+		__m128 rz = _mm_add_ps(_mm_mul_ps(x, _mm_set_ps1(mat.Get(2, 0))), _mm_mul_ps(y, _mm_set_ps1(mat.Get(2, 1))));
+		rx = _mm_add_ps(rx, _mm_add_ps(_mm_mul_ps(z, _mm_set_ps1(mat.Get(0, 2))), _mm_set_ps1(mat.Get(0, 3))));
+		ry = _mm_add_ps(ry, _mm_add_ps(_mm_mul_ps(z, _mm_set_ps1(mat.Get(1, 2))), _mm_set_ps1(mat.Get(1, 3))));
+		rz = _mm_add_ps(rz, _mm_add_ps(_mm_mul_ps(z, _mm_set_ps1(mat.Get(2, 2))), _mm_set_ps1(mat.Get(2, 3))));
+		x = rx;
+		y = ry;
+		z = rz;
+	}
+
+	// Transforms all 4 vectors by the passed matrix, w is treated as 0.0f
+	template <class Layout>
+	__forceinline void TransformAsVector(const FastMatrix4T<Layout>& mat)
+	{
+		__m128 rx = _mm_add_ps(_mm_mul_ps(x, _mm_set_ps1(mat.Get(0, 0))), _mm_mul_ps(y, _mm_set_ps1(mat.Get(0, 1))));
+		__m128 ry = _mm_add_ps(_mm_mul_ps(x, _mm_set_ps1(mat.Get(1, 0))), _mm_mul_ps(y, _mm_set_ps1(mat.Get(1, 1))));
+		__m128 rz = _mm_add_ps(_mm_mul_ps(x, _mm_set_ps1(mat.Get(2, 0))), _mm_mul_ps(y, _mm_set_ps1(mat.Get(2, 1))));
+		x = _mm_add_ps(rx, _mm_mul_ps(z, _mm_set_ps1(mat.Get(0, 2))));
+		y = _mm_add_ps(ry, _mm_mul_ps(z, _mm_set_ps1(mat.Get(1, 2))));
+		z = _mm_add_ps(rz, _mm_mul_ps(z, _mm_set_ps1(mat.Get(2, 2))));
+	}
+};
+
+// 4 FastQuaternions, one component per register
+class SIMD_ALIGN(16) Quaternionx4
+{
+public:
+	// Lane i of each register is quaternion i, w is the scalar component
+	__m128 x;
+	__m128 y;
+	__m128 z;
+	__m128 w;
+
+	// Default constructor does nothing
+	__forceinline Quaternionx4() {}
+
+	// Constructs a packet from the component registers
+	__forceinline Quaternionx4(__m128 _x, __m128 _y, __m128 _z, __m128 _w)
+	: x(_x), y(_y), z(_z), w(_w)
+	{
+	}
+
+	// Constructs a packet with q in every lane
+	__forceinline explicit Quaternionx4(const FastQuaternion& q)
+	{
+		x = _mm_shuffle_ps(q._data, q._data, _MM_SHUFFLE(0, 0, 0, 0));
+		y = _mm_shuffle_ps(q._data, q._data, _MM_SHUFFLE(1, 1, 1, 1));
+		z = _mm_shuffle_ps(q._data, q._data, _MM_SHUFFLE(2, 2, 2, 2));
+		w = _mm_shuffle_ps(q._data, q._data, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	// Loads 4 quaternions from src
+	__forceinline static Quaternionx4 Gather(const FastQuaternion* src)
+	{
+		Quaternionx4 result(src[0]._data, src[1]._data, src[2]._data, src[3]._data);
+		_MM_TRANSPOSE4_PS(result.x, result.y, result.z, result.w);
+		return result;
+	}
+
+	// Loads count (at most 4) quaternions from src, the other lanes are identity
+	__forceinline static Quaternionx4 Gather(const FastQuaternion* src, int count)
+	{
+		__m128 r[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			r[i] = (i < count) ? src[i]._data : _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		return Quaternionx4(r[0], r[1], r[2], r[3]);
+	}
+
+	// Stores the 4 quaternions to dest
+	__forceinline void Scatter(FastQuaternion* dest) const
+	{
+		__m128 r0 = x;
+		__m128 r1 = y;
+		__m128 r2 = z;
+		__m128 r3 = w;
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		dest[0]._data = r0;
+		dest[1]._data = r1;
+		dest[2]._data = r2;
+		dest[3]._data = r3;
+	}
+
+	// Stores the first count (at most 4) quaternions to dest
+	__forceinline void Scatter(FastQuaternion* dest, int count) const
+	{
+		__m128 r[4] = { x, y, z, w };
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		for (int i = 0; i < count && i < 4; ++i)
+		{
+			dest[i]._data = r[i];
+		}
+	}
+
+	// Converts 4 rotation matrices, given as their columns (so m[i][j] is
+	// cols[j][i]), to quaternions. Same branches as FastQuaternion::CreateFromMatrix,
+	// picked per lane with masks.
+	__forceinline static Quaternionx4 FromRotationColumns(const Vector3x4* cols)
+	{
+		const __m128 one = _mm_set_ps1(1.0f);
+		__m128 m00 = cols[0].x, m10 = cols[0].y, m20 = cols[0].z;
+		__m128 m01 = cols[1].x, m11 = cols[1].y, m21 = cols[1].z;
+		__m128 m02 = cols[2].x, m12 = cols[2].y, m22 = cols[2].z;
+
+		__m128 trace = _mm_add_ps(_mm_add_ps(m00, m11), m22);
+		__m128 t0 = _mm_add_ps(one, trace);
+		__m128 t1 = _mm_sub_ps(_mm_add_ps(one, m00), _mm_add_ps(m11, m22));
+		__m128 t2 = _mm_sub_ps(_mm_add_ps(one, m11), _mm_add_ps(m00, m22));
+		__m128 t3 = _mm_sub_ps(_mm_add_ps(one, m22), _mm_add_ps(m00, m11));
+		__m128 a = _mm_sub_ps(m21, m12);
+		__m128 b = _mm_sub_ps(m02, m20);
+		__m128 c = _mm_sub_ps(m10, m01);
+		__m128 d = _mm_add_ps(m01, m10);
+		__m128 e = _mm_add_ps(m02, m20);
+		__m128 f = _mm_add_ps(m12, m21);
+
+		// Later selects win, so go from the last branch to the first
+		__m128 use2 = _mm_cmpgt_ps(m11, m22);
+		__m128 use1 = _mm_and_ps(_mm_cmpgt_ps(m00, m11), _mm_cmpgt_ps(m00, m22));
+		__m128 use0 = _mm_cmpgt_ps(trace, _mm_setzero_ps());
+
+		__m128 x = SimdSelect(use2, d, e);
+		__m128 y = SimdSelect(use2, t2, f);
+		__m128 z = SimdSelect(use2, f, t3);
+		__m128 w = SimdSelect(use2, b, c);
+		__m128 t = SimdSelect(use2, t2, t3);
+		x = SimdSelect(use1, t1, x);
+		y = SimdSelect(use1, d, y);
+		z = SimdSelect(use1, e, z);
+		w = SimdSelect(use1, a, w);
+		t = SimdSelect(use1, t1, t);
+		x = SimdSelect(use0, a, x);
+		y = SimdSelect(use0, b, y);
+		z = SimdSelect(use0, c, z);
+		w = SimdSelect(use0, t0, w);
+		t = SimdSelect(use0, t0, t);
+
+		__m128 s = _mm_div_ps(_mm_set_ps1(0.5f), _mm_sqrt_ps(t));
+		return Quaternionx4(_mm_mul_ps(x, s), _mm_mul_ps(y, s), _mm_mul_ps(z, s), _mm_mul_ps(w, s));
+	}
+
+	// Returns the 4 4D dot products between this and rhs
+	__forceinline __m128 Dot(const Quaternionx4& rhs) const
+	{
+		__m128 result = _mm_mul_ps(x, rhs.x);
+		result = _mm_add_ps(result, _mm_mul_ps(y, rhs.y));
+		result = _mm_add_ps(result, _mm_mul_ps(z, rhs.z));
+		return _mm_add_ps(result, _mm_mul_ps(w, rhs.w));
+	}
+
+	// Multiplies each quaternion by the matching one in rhs, storing in this.
+	// Same order as FastQuaternion::Multiply, result = rhs * this
+	__forceinline void Multiply(const Quaternionx4& rhs)
+	{
+		__m128 rx = _mm_mul_ps(rhs.w, x);
+		rx = _mm_add_ps(rx, _mm_mul_ps(rhs.x, w));
+		rx = _mm_add_ps(rx, _mm_mul_ps(rhs.y, z));
+		rx = _mm_sub_ps(rx, _mm_mul_ps(rhs.z, y));
+
+		__m128 ry = _mm_mul_ps(rhs.w, y);
+		ry = _mm_sub_ps(ry, _mm_mul_ps(rhs.x, z));
+		ry = _mm_add_ps(ry, _mm_mul_ps(rhs.y, w));
+		ry = _mm_add_ps(ry, _mm_mul_ps(rhs.z, x));
+
+		__m128 rz = _mm_mul_ps(rhs.w, z);
+		rz = _mm_add_ps(rz, _mm_mul_ps(rhs.x, y));
+		rz = _mm_sub_ps(rz, _mm_mul_ps(rhs.y, x));
+		rz = _mm_add_ps(rz, _mm_mul_ps(rhs.z, w));
+
+		__m128 rw = _mm_mul_ps(rhs.w, w);
+		rw = _mm_sub_ps(rw, _mm_mul_ps(rhs.x, x));
+		rw = _mm_sub_ps(rw, _mm_mul_ps(rhs.y, y));
+		rw = _mm_sub_ps(rw, _mm_mul_ps(rhs.z, z));
+
+		x = rx;
+		y = ry;
+		z = rz;
+		w = rw;
+	}
+
+	// Conjugates all 4 quaternions
+	__forceinline void Conjugate()
+	{
+		const __m128 sign = _mm_set_ps1(-0.0f);
+		x = _mm_xor_ps(x, sign);
+		y = _mm_xor_ps(y, sign);
+		z = _mm_xor_ps(z, sign);
+	}
+
+	// Normalizes all 4 quaternions
+	__forceinline void Normalize(SimdAccuracy accuracy = SIMD_PRECISE)
+	{
+		__m128 scale = SimdInvSqrt(Dot(*this), accuracy);
+		x = _mm_mul_ps(x, scale);
+		y = _mm_mul_ps(y, scale);
+		z = _mm_mul_ps(z, scale);
+		w = _mm_mul_ps(w, scale);
+	}
+
+	// Interpolates between a and b, normalizing the result
+	// result = normalize(a * (1.0f - f) + b * f)
+	__forceinline friend Quaternionx4 Lerp(const Quaternionx4& a, const Quaternionx4& b, __m128 f)
+	{
+		Quaternionx4 result(
+			_mm_add_ps(a.x, _mm_mul_ps(_mm_sub_ps(b.x, a.x), f)),
+			_mm_add_ps(a.y, _mm_mul_ps(_mm_sub_ps(b.y, a.y), f)),
+			_mm_add_ps(a.z, _mm_mul_ps(_mm_sub_ps(b.z, a.z), f)),
+			_mm_add_ps(a.w, _mm_mul_ps(_mm_sub_ps(b.w, a.w), f)));
+		result.Normalize();
+		return result;
+	}
+
+	// Same as above, with the same f for every lane
+	__forceinline friend Quaternionx4 Lerp(const Quaternionx4& a, const Quaternionx4& b, float f)
+	{
+		return Lerp(a, b, _mm_set_ps1(f));
+	}
+
+	// Spherical interpolation between a and b along the shortest arc,
+	// same as the FastQuaternion version
+	__forceinline friend Quaternionx4 Slerp(const Quaternionx4& a, const Quaternionx4& b, __m128 f)
+	{
+		const __m128 one = _mm_set_ps1(1.0f);
+		__m128 cosAngle = a.Dot(b);
+		__m128 sign = _mm_and_ps(cosAngle, _mm_set_ps1(-0.0f));
+		__m128 xm1 = _mm_sub_ps(_mm_xor_ps(cosAngle, sign), one);
+		__m128 wa = SimdSlerpWeight(xm1, _mm_sub_ps(one, f));
+		__m128 wb = _mm_xor_ps(SimdSlerpWeight(xm1, f), sign);
+		return Quaternionx4(
+			_mm_add_ps(_mm_mul_ps(a.x, wa), _mm_mul_ps(b.x, wb)),
+			_mm_add_ps(_mm_mul_ps(a.y, wa), _mm_mul_ps(b.y, wb)),
+			_mm_add_ps(_mm_mul_ps(a.z, wa), _mm_mul_ps(b.z, wb)),
+			_mm_add_ps(_mm_mul_ps(a.w, wa), _mm_mul_ps(b.w, wb)));
+	}
+
+	// Normalized lerp between a and b along the shortest arc,
+	// same as the FastQuaternion version
+	__forceinline friend Quaternionx4 NLerp(const Quaternionx4& a, const Quaternionx4& b, __m128 f)
+	{
+		__m128 sign = _mm_and_ps(a.Dot(b), _mm_set_ps1(-0.0f));
+		Quaternionx4 result(
+			_mm_add_ps(a.x, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(b.x, sign), a.x), f)),
+			_mm_add_ps(a.y, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(b.y, sign), a.y), f)),
+			_mm_add_ps(a.z, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(b.z, sign), a.z), f)),
+			_mm_add_ps(a.w, _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(b.w, sign), a.w), f)));
+		__m128 scale = SimdRsqrt(result.Dot(result));
+		result.x = _mm_mul_ps(result.x, scale);
+		result.y = _mm_mul_ps(result.y, scale);
+		result.z = _mm_mul_ps(result.z, scale);
+		result.w = _mm_mul_ps(result.w, scale);
+		return result;
+	}
+};
+
+// v + 2.0*cross(q.xyz, cross(q.xyz,v) + q.w*v), same as FastVector3::Rotate
+__forceinline void Vector3x4::Rotate(const Quaternionx4& q)
+{
+	Vector3x4 qv(q.x, q.y, q.z);
+	Vector3x4 temp = Cross(qv, *this);
+	temp.x = _mm_add_ps(temp.x, _mm_mul_ps(q.w, x));
+	temp.y = _mm_add_ps(temp.y, _mm_mul_ps(q.w, y));
+	temp.z = _mm_add_ps(temp.z, _mm_mul_ps(q.w, z));
+	temp = Cross(qv, temp);
+	x = _mm_add_ps(x, _mm_add_ps(temp.x, temp.x));
+	y = _mm_add_ps(y, _mm_add_ps(temp.y, temp.y));
+	z = _mm_add_ps(z, _mm_add_ps(temp.z, temp.z));
+}
+
+// Transposes 8 rows (r0-r3 in the low halves, r4-r7 in the high halves) into
+// 4 registers of 8 lanes. Only used by the 8 wide gather.
+SIMD_TARGET_AVX2 __forceinline void SimdTranspose8x4(__m256& r04, __m256& r15, __m256& r26, __m256& r37)
+{
+	__m256 t0 = _mm256_unpacklo_ps(r04, r15);
+	__m256 t1 = _mm256_unpacklo_ps(r26, r37);
+	__m256 t2 = _mm256_unpackhi_ps(r04, r15);
+	__m256 t3 = _mm256_unpackhi_ps(r26, r37);
+	r04 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+	r15 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+	r26 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	r37 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// Builds a 256 bit register from two 128 bit halves
+SIMD_TARGET_AVX2 __forceinline __m256 SimdCombine(__m128 lo, __m128 hi)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+// 8 wide version of SimdRsqrt
+SIMD_TARGET_AVX2 __forceinline __m256 SimdRsqrt8(__m256 v)
+{
+	__m256 estimate = _mm256_rsqrt_ps(v);
+	__m256 temp = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), v), _mm256_mul_ps(estimate, estimate));
+	return _mm256_mul_ps(estimate, _mm256_sub_ps(_mm256_set1_ps(1.5f), temp));
+}
+
+// 8 wide version of SimdInvSqrt
+SIMD_TARGET_AVX2 __forceinline __m256 SimdInvSqrt8(__m256 v, SimdAccuracy accuracy)
+{
+	if (accuracy == SIMD_PRECISE)
+	{
+		return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(v));
+	}
+	if (accuracy == SIMD_FAST)
+	{
+		return SimdRsqrt8(v);
+	}
+	return _mm256_rsqrt_ps(v);
+}
+
+// 8 wide version of SimdSqrt
+SIMD_TARGET_AVX2 __forceinline __m256 SimdSqrt8(__m256 v, SimdAccuracy accuracy)
+{
+	if (accuracy == SIMD_PRECISE)
+	{
+		return _mm256_sqrt_ps(v);
+	}
+	__m256 result = _mm256_mul_ps(v, SimdInvSqrt8(v, accuracy));
+	return _mm256_and_ps(result, _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GT_OQ));
+}
+
+// 8 wide version of SimdSinCos
+SIMD_TARGET_AVX2 __forceinline void SimdSinCos8(__m256 angle, __m256& s, __m256& c, SimdAccuracy accuracy = SIMD_PRECISE)
+{
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	__m256 x = _mm256_andnot_ps(signMask, angle);
+
+	__m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(1.27323954473516f)));
+	j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+	__m256 y = _mm256_cvtepi32_ps(j);
+
+	if (accuracy == SIMD_PRECISE)
+	{
+		x = _mm256_fnmadd_ps(y, _mm256_set1_ps(0.78515625f), x);
+		x = _mm256_fnmadd_ps(y, _mm256_set1_ps(2.4187564849853515625e-4f), x);
+		x = _mm256_fnmadd_ps(y, _mm256_set1_ps(3.77489497744594108e-8f), x);
+	}
+	else
+	{
+		x = _mm256_fnmadd_ps(y, _mm256_set1_ps(0.785398163397448f), x);
+	}
+
+	const __m256i four = _mm256_set1_epi32(4);
+	__m256 sinSign = _mm256_xor_ps(_mm256_and_ps(angle, signMask),
+								   _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, four), 29)));
+	__m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), four), 29));
+	__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(2)));
+
+	__m256 z = _mm256_mul_ps(x, x);
+	__m256 sinPoly;
+	__m256 cosPoly;
+	if (accuracy == SIMD_PRECISE)
+	{
+		sinPoly = _mm256_fmadd_ps(_mm256_set1_ps(-1.9515295891e-4f), z, _mm256_set1_ps(8.3321608736e-3f));
+		sinPoly = _mm256_fmadd_ps(sinPoly, z, _mm256_set1_ps(-1.6666654611e-1f));
+		cosPoly = _mm256_fmadd_ps(_mm256_set1_ps(2.443315711809948e-5f), z, _mm256_set1_ps(-1.388731625493765e-3f));
+		cosPoly = _mm256_fmadd_ps(cosPoly, z, _mm256_set1_ps(4.166664568298827e-2f));
+	}
+	else
+	{
+		sinPoly = _mm256_fmadd_ps(_mm256_set1_ps(8.3321608736e-3f), z, _mm256_set1_ps(-1.6666654611e-1f));
+		cosPoly = _mm256_fmadd_ps(_mm256_set1_ps(-1.388731625493765e-3f), z, _mm256_set1_ps(4.166664568298827e-2f));
+	}
+	sinPoly = _mm256_fmadd_ps(_mm256_mul_ps(sinPoly, z), x, x);
+	cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+	cosPoly = _mm256_add_ps(_mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), cosPoly), _mm256_set1_ps(1.0f));
+
+	s = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, swap), sinSign);
+	c = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, swap), cosSign);
+}
+
+// 8 wide version of SimdSlerpWeight
+SIMD_TARGET_AVX2 __forceinline __m256 SimdSlerpWeight8(__m256 xm1, __m256 f)
+{
+	const float onePlusMu = 1.90110745351730037f;
+	const __m256 one = _mm256_set1_ps(1.0f);
+	__m256 sqr = _mm256_mul_ps(f, f);
+	__m256 result = one;
+	for (int i = 8; i >= 1; --i)
+	{
+		float scale = (i == 8) ? onePlusMu : 1.0f;
+		__m256 u = _mm256_set1_ps(scale / float(i * (2 * i + 1)));
+		__m256 v = _mm256_set1_ps(scale * float(i) / float(2 * i + 1));
+		__m256 b = _mm256_mul_ps(_mm256_fmsub_ps(u, sqr, v), xm1);
+		result = _mm256_fmadd_ps(b, result, one);
+	}
+	return _mm256_mul_ps(f, result);
+}
+
+// 8 FastVector3s, one component per register. AVX2/FMA only.
+class SIMD_ALIGN(32) Vector3x8
+{
+public:
+	// Lane i of each register is vector i
+	__m256 x;
+	__m256 y;
+	__m256 z;
+
+	// Default constructor does nothing
+	SIMD_TARGET_AVX2 __forceinline Vector3x8() {}
+
+	// Constructs a packet from the component registers
+	SIMD_TARGET_AVX2 __forceinline Vector3x8(__m256 _x, __m256 _y, __m256 _z)
+	: x(_x), y(_y), z(_z)
+	{
+	}
+
+	// Constructs a packet with v in every lane
+	SIMD_TARGET_AVX2 __forceinline explicit Vector3x8(const FastVector3& v)
+	{
+		x = _mm256_set1_ps(SimdGetX(v._data));
+		y = _mm256_set1_ps(SimdGetY(v._data));
+		z = _mm256_set1_ps(SimdGetZ(v._data));
+	}
+
+	// Loads 8 vectors from src
+	SIMD_TARGET_AVX2 __forceinline static Vector3x8 Gather(const FastVector3* src)
+	{
+		__m256 r04 = SimdCombine(src[0]._data, src[4]._data);
+		__m256 r15 = SimdCombine(src[1]._data, src[5]._data);
+		__m256 r26 = SimdCombine(src[2]._data, src[6]._data);
+		__m256 r37 = SimdCombine(src[3]._data, src[7]._data);
+		SimdTranspose8x4(r04, r15, r26, r37);
+		return Vector3x8(r04, r15, r26);
+	}
+
+	// Loads count (at most 8) vectors from src, the other lanes are zero
+	SIMD_TARGET_AVX2 __forceinline static Vector3x8 Gather(const FastVector3* src, int count)
+	{
+		__m128 r[8];
+		for (int i = 0; i < 8; ++i)
+		{
+			r[i] = (i < count) ? src[i]._data : _mm_setzero_ps();
+		}
+		__m256 r04 = SimdCombine(r[0], r[4]);
+		__m256 r15 = SimdCombine(r[1], r[5]);
+		__m256 r26 = SimdCombine(r[2], r[6]);
+		__m256 r37 = SimdCombine(r[3], r[7]);
+		SimdTranspose8x4(r04, r15, r26, r37);
+		return Vector3x8(r04, r15, r26);
+	}
+
+	// Stores the first count (at most 8) vectors to dest, w is set to 1.0f
+	SIMD_TARGET_AVX2 __forceinline void Scatter(FastVector3* dest, int count = 8) const
+	{
+		// the 4x4 transpose is its own inverse
+		__m256 r04 = x;
+		__m256 r15 = y;
+		__m256 r26 = z;
+		__m256 r37 = _mm256_set1_ps(1.0f);
+		SimdTranspose8x4(r04, r15, r26, r37);
+
+		__m128 r[8] = {
+			_mm256_castps256_ps128(r04), _mm256_castps256_ps128(r15),
+			_mm256_castps256_ps128(r26), _mm256_castps256_ps128(r37),
+			_mm256_extractf128_ps(r04, 1), _mm256_extractf128_ps(r15, 1),
+			_mm256_extractf128_ps(r26, 1), _mm256_extractf128_ps(r37, 1) };
+		for (int i = 0; i < count && i < 8; ++i)
+		{
+			dest[i]._data = r[i];
+		}
+	}
+
+	// Adds rhs to this, storing in this
+	SIMD_TARGET_AVX2 __forceinline void Add(const Vector3x8& rhs)
+	{
+		x = _mm256_add_ps(x, rhs.x);
+		y = _mm256_add_ps(y, rhs.y);
+		z = _mm256_add_ps(z, rhs.z);
+	}
+
+	// Subtracts this - rhs, storing in this
+	SIMD_TARGET_AVX2 __forceinline void Sub(const Vector3x8& rhs)
+	{
+		x = _mm256_sub_ps(x, rhs.x);
+		y = _mm256_sub_ps(y, rhs.y);
+		z = _mm256_sub_ps(z, rhs.z);
+	}
+
+	// Multiplies each lane by the matching lane of scalars
+	SIMD_TARGET_AVX2 __forceinline void Multiply(__m256 scalars)
+	{
+		x = _mm256_mul_ps(x, scalars);
+		y = _mm256_mul_ps(y, scalars);
+		z = _mm256_mul_ps(z, scalars);
+	}
+
+	// Multiplies every lane by scalar
+	SIMD_TARGET_AVX2 __forceinline void Multiply(float scalar)
+	{
+		Multiply(_mm256_set1_ps(scalar));
+	}
+
+	// Returns the 8 dot products between this and rhs
+	SIMD_TARGET_AVX2 __forceinline __m256 Dot(const Vector3x8& rhs) const
+	{
+		__m256 result = _mm256_mul_ps(x, rhs.x);
+		result = _mm256_fmadd_ps(y, rhs.y, result);
+		return _mm256_fmadd_ps(z, rhs.z, result);
+	}
+
+	// Returns the 8 squared lengths
+	SIMD_TARGET_AVX2 __forceinline __m256 LengthSquared() const
+	{
+		return Dot(*this);
+	}
+
+	// Returns the 8 lengths
+	SIMD_TARGET_AVX2 __forceinline __m256 Length(SimdAccuracy accuracy = SIMD_PRECISE) const
+	{
+		return SimdSqrt8(Dot(*this), accuracy);
+	}
+
+	// Normalizes all 8 vectors
+	SIMD_TARGET_AVX2 __forceinline void Normalize(SimdAccuracy accuracy = SIMD_PRECISE)
+	{
+		Multiply(SimdInvSqrt8(Dot(*this), accuracy));
+	}
+
+	// Does 8 cross products between lhs and rhs, returning the result by value
+	SIMD_TARGET_AVX2 __forceinline friend Vector3x8 Cross(const Vector3x8& lhs, const Vector3x8& rhs)
+	{
+		return Vector3x8(
+			_mm256_fmsub_ps(lhs.y, rhs.z, _mm256_mul_ps(lhs.z, rhs.y)),
+			_mm256_fmsub_ps(lhs.z, rhs.x, _mm256_mul_ps(lhs.x, rhs.z)),
+			_mm256_fmsub_ps(lhs.x, rhs.y, _mm256_mul_ps(lhs.y, rhs.x)));
+	}
+
+	// Interpolates between a and b, returning the result by value
+	// result = a + (b - a) * f
+	SIMD_TARGET_AVX2 __forceinline friend Vector3x8 Lerp(const Vector3x8& a, const Vector3x8& b, __m256 f)
+	{
+		return Vector3x8(
+			_mm256_fmadd_ps(_mm256_sub_ps(b.x, a.x), f, a.x),
+			_mm256_fmadd_ps(_mm256_sub_ps(b.y, a.y), f, a.y),
+			_mm256_fmadd_ps(_mm256_sub_ps(b.z, a.z), f, a.z));
+	}
+
+	// Same as above, with the same f for every lane
+	SIMD_TARGET_AVX2 __forceinline friend Vector3x8 Lerp(const Vector3x8& a, const Vector3x8& b, float f)
+	{
+		return Lerp(a, b, _mm256_set1_ps(f));
+	}
+
+	// Rotates each vector by the matching quaternion in q (defined below)
+	SIMD_TARGET_AVX2 __forceinline void Rotate(const Quaternionx8& q);
+
+	// Transforms all 8 vectors by the passed matrix, w is treated as 1.0f
+	template <class Layout>
+	SIMD_TARGET_AVX2 __forceinline void Transform(const FastMatrix4T<Layout>& mat)
+	{
+		__m256 rx = _mm256_fmadd_ps(x, _mm256_set1_ps(mat.Get(0, 0)), _mm256_set1_ps(mat.Get(0, 3)));
+		__m256 ry = _mm256_fmadd_ps(x, _mm256_set1_ps(mat.Get(1, 0)), _mm256_set1_ps(mat.Get(1, 3)));
+		__m256 rz = _mm256_fmadd_ps(x, _mm256_set1_ps(mat.Get(2, 0)), _mm256_set1_ps(mat.Get(2, 3)));
+		rx = _mm256_fmadd_ps(y, _mm256_set1_ps(mat.Get(0, 1)), rx);
+		ry = _mm256_fmadd_ps(y, _mm256_set1_ps(mat.Get(1, 1)), ry);
+		rz = _mm256_fmadd_ps(y, _mm256_set1_ps(mat.Get(2, 1)), rz);
+		x = _mm256_fmadd_ps(z, _mm256_set1_ps(mat.Get(0, 2)), rx);
+		y = _mm256_fmadd_ps(z, _mm256_set1_ps(mat.Get(1, 2)), ry);
+		z = _mm256_fmadd_ps(z, _mm256_set1_ps(mat.Get(2, 2)), rz);
+	}
+
+	// Transforms all 8 vectors by the passed matrix, w is treated as 0.0f
+	template <class Layout>
+	SIMD_TARGET_AVX2 __forceinline void TransformAsVector(const FastMatrix4T<Layout>& mat)
+	{
+		__m256 rx = _mm256_mul_ps(x, _mm256_set1_ps(mat.Get(0, 0)));
+		__m256 ry = _mm256_mul_ps(x, _mm256_set1_ps(mat.Get(1, 0)));
+		__m256 rz = _mm256_mul_ps(x, _mm256_set1_ps(mat.Get(2, 0)));
+		rx = _mm256_fmadd_ps(y, _mm256_set1_ps(mat.Get(0, 1)), rx);
+		ry = _mm256_fmadd_ps(y, _mm256_set1_ps(mat.Get(1, 1)), ry);
+		rz = _mm256_fmadd_ps(y, _mm256_set1_ps(mat.Get(2, 1)), rz);
+		x = _mm256_fmadd_ps(z, _mm256_set1_ps(mat.Get(0, 2)), rx);
+		y = _mm256_fmadd_ps(z, _mm256_set1_ps(mat.Get(1, 2)), ry);
+		z = _mm256_fmadd_ps(z, _mm256_set1_ps(mat.Get(2, 2)), rz);
+	}
+};
+
+// 8 FastQuaternions, one component per register. AVX2/FMA only.
+class SIMD_ALIGN(32) Quaternionx8
+{
+public:
+	// Lane i of each register is quaternion i, w is the scalar component
+	__m256 x;
+	__m256 y;
+	__m256 z;
+	__m256 w;
+
+	// Default constructor does nothing
+	SIMD_TARGET_AVX2 __forceinline Quaternionx8() {}
+
+	// Constructs a packet from the component registers
+	SIMD_TARGET_AVX2 __forceinline Quaternionx8(__m256 _x, __m256 _y, __m256 _z, __m256 _w)
+	: x(_x), y(_y), z(_z), w(_w)
+	{
+	}
+
+	// Constructs a packet with q in every lane
+	SIMD_TARGET_AVX2 __forceinline explicit Quaternionx8(const FastQuaternion& q)
+	{
+		x = _mm256_set1_ps(SimdGetX(q._data));
+		y = _mm256_set1_ps(SimdGetY(q._data));
+		z = _mm256_set1_ps(SimdGetZ(q._data));
+		w = _mm256_set1_ps(SimdGetW(q._data));
+	}
+
+	// Loads count (at most 8) quaternions from src, the other lanes are identity
+	SIMD_TARGET_AVX2 __forceinline static Quaternionx8 Gather(const FastQuaternion* src, int count = 8)
+	{
+		__m128 r[8];
+		for (int i = 0; i < 8; ++i)
+		{
+			r[i] = (i < count) ? src[i]._data : _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+		Quaternionx8 result(SimdCombine(r[0], r[4]), SimdCombine(r[1], r[5]),
+							SimdCombine(r[2], r[6]), SimdCombine(r[3], r[7]));
+		SimdTranspose8x4(result.x, result.y, result.z, result.w);
+		return result;
+	}
+
+	// Stores the first count (at most 8) quaternions to dest
+	SIMD_TARGET_AVX2 __forceinline void Scatter(FastQuaternion* dest, int count = 8) const
+	{
+		__m256 r04 = x;
+		__m256 r15 = y;
+		__m256 r26 = z;
+		__m256 r37 = w;
+		SimdTranspose8x4(r04, r15, r26, r37);
+
+		__m128 r[8] = {
+			_mm256_castps256_ps128(r04), _mm256_castps256_ps128(r15),
+			_mm256_castps256_ps128(r26), _mm256_castps256_ps128(r37),
+			_mm256_extractf128_ps(r04, 1), _mm256_extractf128_ps(r15, 1),
+			_mm256_extractf128_ps(r26, 1), _mm256_extractf128_ps(r37, 1) };
+		for (int i = 0; i < count && i < 8; ++i)
+		{
+			dest[i]._data = r[i];
+		}
+	}
+
+	// Same as Quaternionx4::FromRotationColumns
+	SIMD_TARGET_AVX2 __forceinline static Quaternionx8 FromRotationColumns(const Vector3x8* cols)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		__m256 m00 = cols[0].x, m10 = cols[0].y, m20 = cols[0].z;
+		__m256 m01 = cols[1].x, m11 = cols[1].y, m21 = cols[1].z;
+		__m256 m02 = cols[2].x, m12 = cols[2].y, m22 = cols[2].z;
+
+		__m256 trace = _mm256_add_ps(_mm256_add_ps(m00, m11), m22);
+		__m256 t0 = _mm256_add_ps(one, trace);
+		__m256 t1 = _mm256_sub_ps(_mm256_add_ps(one, m00), _mm256_add_ps(m11, m22));
+		__m256 t2 = _mm256_sub_ps(_mm256_add_ps(one, m11), _mm256_add_ps(m00, m22));
+		__m256 t3 = _mm256_sub_ps(_mm256_add_ps(one, m22), _mm256_add_ps(m00, m11));
+		__m256 a = _mm256_sub_ps(m21, m12);
+		__m256 b = _mm256_sub_ps(m02, m20);
+		__m256 c = _mm256_sub_ps(m10, m01);
+		__m256 d = _mm256_add_ps(m01, m10);
+		__m256 e = _mm256_add_ps(m02, m20);
+		__m256 f = _mm256_add_ps(m12, m21);
+
+		__m256 use2 = _mm256_cmp_ps(m11, m22, _CMP_GT_OQ);
+		__m256 use1 = _mm256_and_ps(_mm256_cmp_ps(m00, m11, _CMP_GT_OQ), _mm256_cmp_ps(m00, m22, _CMP_GT_OQ));
+		__m256 use0 = _mm256_cmp_ps(trace, _mm256_setzero_ps(), _CMP_GT_OQ);
+
+		// blendv picks its second operand where the mask is set
+		__m256 x = _mm256_blendv_ps(e, d, use2);
+		__m256 y = _mm256_blendv_ps(f, t2, use2);
+		__m256 z = _mm256_blendv_ps(t3, f, use2);
+		__m256 w = _mm256_blendv_ps(c, b, use2);
+		__m256 t = _mm256_blendv_ps(t3, t2, use2);
+		x = _mm256_blendv_ps(x, t1, use1);
+		y = _mm256_blendv_ps(y, d, use1);
+		z = _mm256_blendv_ps(z, e, use1);
+		w = _mm256_blendv_ps(w, a, use1);
+		t = _mm256_blendv_ps(t, t1, use1);
+		x = _mm256_blendv_ps(x, a, use0);
+		y = _mm256_blendv_ps(y, b, use0);
+		z = _mm256_blendv_ps(z, c, use0);
+		w = _mm256_blendv_ps(w, t0, use0);
+		t = _mm256_blendv_ps(t, t0, use0);
+
+		__m256 s = _mm256_div_ps(_mm256_set1_ps(0.5f), _mm256_sqrt_ps(t));
+		return Quaternionx8(_mm256_mul_ps(x, s), _mm256_mul_ps(y, s), _mm256_mul_ps(z, s), _mm256_mul_ps(w, s));
+	}
+
+	// Returns the 8 4D dot products between this and rhs
+	SIMD_TARGET_AVX2 __forceinline __m256 Dot(const Quaternionx8& rhs) const
+	{
+		__m256 result = _mm256_mul_ps(x, rhs.x);
+		result = _mm256_fmadd_ps(y, rhs.y, result);
+		result = _mm256_fmadd_ps(z, rhs.z, result);
+		return _mm256_fmadd_ps(w, rhs.w, result);
+	}
+
+	// Multiplies each quaternion by the matching one in rhs, storing in this.
+	// Same order as FastQuaternion::Multiply, result = rhs * this
+	SIMD_TARGET_AVX2 __forceinline void Multiply(const Quaternionx8& rhs)
+	{
+		__m256 rx = _mm256_mul_ps(rhs.w, x);
+		rx = _mm256_fmadd_ps(rhs.x, w, rx);
+		rx = _mm256_fmadd_ps(rhs.y, z, rx);
+		rx = _mm256_fnmadd_ps(rhs.z, y, rx);
+
+		__m256 ry = _mm256_mul_ps(rhs.w, y);
+		ry = _mm256_fnmadd_ps(rhs.x, z, ry);
+		ry = _mm256_fmadd_ps(rhs.y, w, ry);
+		ry = _mm256_fmadd_ps(rhs.z, x, ry);
+
+		__m256 rz = _mm256_mul_ps(rhs.w, z);
+		rz = _mm256_fmadd_ps(rhs.x, y, rz);
+		rz = _mm256_fnmadd_ps(rhs.y, x, rz);
+		rz = _mm256_fmadd_ps(rhs.z, w, rz);
+
+		__m256 rw = _mm256_mul_ps(rhs.w, w);
+		rw = _mm256_fnmadd_ps(rhs.x, x, rw);
+		rw = _mm256_fnmadd_ps(rhs.y, y, rw);
+		rw = _mm256_fnmadd_ps(rhs.z, z, rw);
+
+		x = rx;
+		y = ry;
+		z = rz;
+		w = rw;
+	}
+
+	// Conjugates all 8 quaternions
+	SIMD_TARGET_AVX2 __forceinline void Conjugate()
+	{
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+		x = _mm256_xor_ps(x, sign);
+		y = _mm256_xor_ps(y, sign);
+		z = _mm256_xor_ps(z, sign);
+	}
+
+	// Normalizes all 8 quaternions
+	SIMD_TARGET_AVX2 __forceinline void Normalize(SimdAccuracy accuracy = SIMD_PRECISE)
+	{
+		__m256 scale = SimdInvSqrt8(Dot(*this), accuracy);
+		x = _mm256_mul_ps(x, scale);
+		y = _mm256_mul_ps(y, scale);
+		z = _mm256_mul_ps(z, scale);
+		w = _mm256_mul_ps(w, scale);
+	}
+
+	// Interpolates between a and b, normalizing the result
+	// result = normalize(a * (1.0f - f) + b * f)
+	SIMD_TARGET_AVX2 __forceinline friend Quaternionx8 Lerp(const Quaternionx8& a, const Quaternionx8& b, __m256 f)
+	{
+		Quaternionx8 result(
+			_mm256_fmadd_ps(_mm256_sub_ps(b.x, a.x), f, a.x),
+			_mm256_fmadd_ps(_mm256_sub_ps(b.y, a.y), f, a.y),
+			_mm256_fmadd_ps(_mm256_sub_ps(b.z, a.z), f, a.z),
+			_mm256_fmadd_ps(_mm256_sub_ps(b.w, a.w), f, a.w));
+		result.Normalize();
+		return result;
+	}
+
+	// Same as above, with the same f for every lane
+	SIMD_TARGET_AVX2 __forceinline friend Quaternionx8 Lerp(const Quaternionx8& a, const Quaternionx8& b, float f)
+	{
+		return Lerp(a, b, _mm256_set1_ps(f));
+	}
+
+	// Spherical interpolation between a and b along the shortest arc,
+	// same as the FastQuaternion version
+	SIMD_TARGET_AVX2 __forceinline friend Quaternionx8 Slerp(const Quaternionx8& a, const Quaternionx8& b, __m256 f)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		__m256 cosAngle = a.Dot(b);
+		__m256 sign = _mm256_and_ps(cosAngle, _mm256_set1_ps(-0.0f));
+		__m256 xm1 = _mm256_sub_ps(_mm256_xor_ps(cosAngle, sign), one);
+		__m256 wa = SimdSlerpWeight8(xm1, _mm256_sub_ps(one, f));
+		__m256 wb = _mm256_xor_ps(SimdSlerpWeight8(xm1, f), sign);
+		return Quaternionx8(
+			_mm256_fmadd_ps(a.x, wa, _mm256_mul_ps(b.x, wb)),
+			_mm256_fmadd_ps(a.y, wa, _mm256_mul_ps(b.y, wb)),
+			_mm256_fmadd_ps(a.z, wa, _mm256_mul_ps(b.z, wb)),
+			_mm256_fmadd_ps(a.w, wa, _mm256_mul_ps(b.w, wb)));
+	}
+
+	// Normalized lerp between a and b along the shortest arc,
+	// same as the FastQuaternion version
+	SIMD_TARGET_AVX2 __forceinline friend Quaternionx8 NLerp(const Quaternionx8& a, const Quaternionx8& b, __m256 f)
+	{
+		__m256 sign = _mm256_and_ps(a.Dot(b), _mm256_set1_ps(-0.0f));
+		Quaternionx8 result(
+			_mm256_fmadd_ps(_mm256_sub_ps(_mm256_xor_ps(b.x, sign), a.x), f, a.x),
+			_mm256_fmadd_ps(_mm256_sub_ps(_mm256_xor_ps(b.y, sign), a.y), f, a.y),
+			_mm256_fmadd_ps(_mm256_sub_ps(_mm256_xor_ps(b.z, sign), a.z), f, a.z),
+			_mm256_fmadd_ps(_mm256_sub_ps(_mm256_xor_ps(b.w, sign), a.w), f, a.w));
+		__m256 scale = SimdRsqrt8(result.Dot(result));
+		result.x = _mm256_mul_ps(result.x, scale);
+		result.y = _mm256_mul_ps(result.y, scale);
+		result.z = _mm256_mul_ps(result.z, scale);
+		result.w = _mm256_mul_ps(result.w, scale);
+		return result;
+	}
+};
+
+// v + 2.0*cross(q.xyz, cross(q.xyz,v) + q.w*v), same as FastVector3::Rotate
+SIMD_TARGET_AVX2 __forceinline void Vector3x8::Rotate(const Quaternionx8& q)
+{
+	Vector3x8 qv(q.x, q.y, q.z);
+	Vector3x8 temp = Cross(qv, *this);
+	temp.x = _mm256_fmadd_ps(q.w, x, temp.x);
+	temp.y = _mm256_fmadd_ps(q.w, y, temp.y);
+	temp.z = _mm256_fmadd_ps(q.w, z, temp.z);
+	temp = Cross(qv, temp);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	x = _mm256_fmadd_ps(temp.x, two, x);
+	y = _mm256_fmadd_ps(temp.y, two, y);
+	z = _mm256_fmadd_ps(temp.z, two, z);
+}
+
+} // namespace ITP485
+
+#endif // _SOAMATH_H_
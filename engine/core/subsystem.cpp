@@ -0,0 +1,59 @@
+// subsystem.cpp implements starting up and shutting down the subsystems in order
+#include "subsystem.h"
+#include <cstddef>
+
+namespace ITP485
+{
+
+SubsystemRegistry::SubsystemRegistry()
+	: m_NumStartedUp(0)
+{ }
+
+// Shuts down anything that's still running
+SubsystemRegistry::~SubsystemRegistry()
+{
+	ShutDown();
+}
+
+// Adds a subsystem after the ones already added
+void SubsystemRegistry::Add(const char* szName, SubsystemFunc startUp, SubsystemFunc shutDown)
+{
+	Dbg_Assert(!IsStartedUp(), "Can't add a subsystem once they've started up.");
+
+	Subsystem subsystem;
+	subsystem.m_szName = szName;
+	subsystem.m_StartUp = startUp;
+	subsystem.m_ShutDown = shutDown;
+	m_Subsystems.push_back(subsystem);
+}
+
+// Starts up every subsystem, in the order they were added
+void SubsystemRegistry::StartUp()
+{
+	Dbg_Assert(!IsStartedUp(), "Subsystems are already started up.");
+
+	for (size_t i = 0; i < m_Subsystems.size(); ++i)
+	{
+		if (m_Subsystems[i].m_StartUp)
+		{
+			m_Subsystems[i].m_StartUp();
+		}
+		// Counted as each one finishes, so ShutDown only undoes what was done
+		m_NumStartedUp = static_cast<unsigned int>(i + 1);
+	}
+}
+
+// Shuts down every subsystem that was started up, in reverse order
+void SubsystemRegistry::ShutDown()
+{
+	while (m_NumStartedUp > 0)
+	{
+		--m_NumStartedUp;
+		if (m_Subsystems[m_NumStartedUp].m_ShutDown)
+		{
+			m_Subsystems[m_NumStartedUp].m_ShutDown();
+		}
+	}
+}
+
+} // namespace ITP485
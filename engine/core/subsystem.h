@@ -0,0 +1,86 @@
+// Defines the subsystem registry, which starts the engine's subsystems up in
+// one set order and shuts them down in reverse
+#ifndef _SUBSYSTEM_H_
+#define _SUBSYSTEM_H_
+#include "dbg_assert.h"
+#include <functional>
+#include <vector>
+
+namespace ITP485
+{
+
+// Starts up or shuts down one subsystem
+typedef std::function<void()> SubsystemFunc;
+
+// SubsystemRegistry keeps the order the subsystems start up in, so it's
+// written down in one place instead of spread over main and each subsystem's
+// Setup. StartUp runs each subsystem's start up in the order they were added,
+// and ShutDown runs their shut downs in reverse.
+//
+// A subsystem added with Add<T> is a Singleton, and it's created right before
+// it starts up and destroyed right after it shuts down.
+//
+// SubsystemRegistry subsystems;
+// subsystems.Add<FrameAllocator>("FrameAllocator",
+// 	[]() { FrameAllocator::get().StartUp(1024 * 1024, 2); },
+// 	[]() { FrameAllocator::get().ShutDown(); });
+// subsystems.StartUp();
+//
+// Only the main thread may use it.
+class SubsystemRegistry
+{
+public:
+	SubsystemRegistry();
+
+	// Shuts down anything that's still running
+	~SubsystemRegistry();
+
+	// Adds a subsystem after the ones already added. Either function may be empty.
+	// szName must stay valid, it's usually a string literal.
+	void Add(const char* szName, SubsystemFunc startUp, SubsystemFunc shutDown);
+
+	// Adds the Singleton T, created before startUp and destroyed after shutDown
+	template <class T>
+	void Add(const char* szName, SubsystemFunc startUp, SubsystemFunc shutDown)
+	{
+		Add(szName,
+			[startUp]() { T::Create(); if (startUp) { startUp(); } },
+			[shutDown]() { if (shutDown) { shutDown(); } T::Destroy(); });
+	}
+
+	// Starts up every subsystem, in the order they were added
+	void StartUp();
+
+	// Shuts down every subsystem that was started up, in reverse order
+	void ShutDown();
+
+	bool IsStartedUp() const { return m_NumStartedUp > 0; }
+
+	// Returns the number of subsystems, and each one's name in start up order
+	unsigned int GetNumSubsystems() const { return static_cast<unsigned int>(m_Subsystems.size()); }
+	const char* GetName(unsigned int index) const
+	{
+		Dbg_Assert(index < m_Subsystems.size(), "Subsystem index out of range!");
+		return m_Subsystems[index].m_szName;
+	}
+
+private:
+	// Not copyable
+	SubsystemRegistry(const SubsystemRegistry&);
+	SubsystemRegistry& operator=(const SubsystemRegistry&);
+
+	struct Subsystem
+	{
+		const char* m_szName;
+		SubsystemFunc m_StartUp;
+		SubsystemFunc m_ShutDown;
+	};
+
+	std::vector<Subsystem> m_Subsystems;
+	// The first m_NumStartedUp subsystems are running
+	unsigned int m_NumStartedUp;
+};
+
+} // namespace ITP485
+
+#endif // _SUBSYSTEM_H_
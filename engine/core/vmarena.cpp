@@ -0,0 +1,220 @@
+// vmarena.cpp implements the virtual memory arena on top of VirtualAlloc
+// on Windows and mmap everywhere else.
+#include "vmarena.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ITP485
+{
+
+namespace
+{
+
+// Huge pages on Linux x86. There's no portable way to ask, and it's the
+// only size the transparent huge pages use.
+#ifndef _WIN32
+const size_t kLinuxHugePageSize = 2 * 1024 * 1024;
+#endif
+
+// Smallest amount committed at once with normal pages, so a growing arena
+// doesn't make a system call for every page
+const size_t kMinCommitStep = 64 * 1024;
+
+size_t RoundUp(size_t value, size_t multiple)
+{
+	return (value + multiple - 1) / multiple * multiple;
+}
+
+} // anonymous namespace
+
+#ifdef _WIN32
+size_t GetVirtualPageSize()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+}
+
+size_t GetHugePageSize()
+{
+	return GetLargePageMinimum();
+}
+#else
+size_t GetVirtualPageSize()
+{
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+size_t GetHugePageSize()
+{
+	return kLinuxHugePageSize;
+}
+#endif // _WIN32
+
+VirtualArena::VirtualArena()
+	: m_pBase(0)
+	, m_pMapping(0)
+	, m_MappingSize(0)
+	, m_Reserved(0)
+	, m_Committed(0)
+	, m_Offset(0)
+	, m_CommitStep(0)
+	, m_PageType(VM_PAGES_NORMAL)
+{ }
+
+VirtualArena::~VirtualArena()
+{
+	Release();
+}
+
+// Reserves at least maxBytes of address space
+bool VirtualArena::Reserve(size_t maxBytes, VirtualPageType pages)
+{
+	Release();
+
+	const size_t pageSize = GetVirtualPageSize();
+	const size_t hugePageSize = GetHugePageSize();
+	if (hugePageSize == 0)
+	{
+		pages = VM_PAGES_NORMAL;
+	}
+
+#ifdef _WIN32
+	if (pages == VM_PAGES_HUGE)
+	{
+		// Large pages have to be committed along with the reserve
+		size_t size = RoundUp(maxBytes, hugePageSize);
+		void* ptr = VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (ptr)
+		{
+			m_pMapping = m_pBase = static_cast<char*>(ptr);
+			m_MappingSize = m_Reserved = m_Committed = size;
+			m_PageType = VM_PAGES_HUGE;
+			return true;
+		}
+	}
+
+	// No transparent huge pages on Windows, reserve normal pages
+	size_t size = RoundUp(maxBytes, pageSize);
+	void* ptr = VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+	if (!ptr)
+	{
+		return false;
+	}
+	m_pMapping = m_pBase = static_cast<char*>(ptr);
+	m_MappingSize = m_Reserved = size;
+	m_CommitStep = kMinCommitStep;
+	m_PageType = VM_PAGES_NORMAL;
+	return true;
+#else
+	if (pages == VM_PAGES_HUGE)
+	{
+		// MAP_HUGETLB fails unless enough huge pages were set aside, fall back
+		// below. No MAP_NORESERVE, or it would map anyway and SIGBUS on first touch.
+		size_t size = RoundUp(maxBytes, hugePageSize);
+		void* ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (ptr != MAP_FAILED)
+		{
+			m_pMapping = m_pBase = static_cast<char*>(ptr);
+			m_MappingSize = m_Reserved = m_Committed = size;
+			m_PageType = VM_PAGES_HUGE;
+			return true;
+		}
+		pages = VM_PAGES_TRANSPARENT_HUGE;
+	}
+
+	// Transparent huge pages only back 2MB aligned ranges, so map one extra
+	// huge page and start at the first boundary in it
+	const bool bTransparent = (pages == VM_PAGES_TRANSPARENT_HUGE);
+	const size_t alignment = bTransparent ? hugePageSize : pageSize;
+	size_t size = RoundUp(maxBytes, alignment);
+	size_t mappingSize = bTransparent ? size + hugePageSize : size;
+	void* ptr = mmap(0, mappingSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (ptr == MAP_FAILED)
+	{
+		return false;
+	}
+	m_pMapping = static_cast<char*>(ptr);
+	m_MappingSize = mappingSize;
+	m_pBase = reinterpret_cast<char*>(RoundUp(reinterpret_cast<size_t>(ptr), alignment));
+	m_Reserved = size;
+	m_CommitStep = bTransparent ? hugePageSize : kMinCommitStep;
+	m_PageType = VM_PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+	if (bTransparent && madvise(m_pBase, m_Reserved, MADV_HUGEPAGE) == 0)
+	{
+		m_PageType = VM_PAGES_TRANSPARENT_HUGE;
+	}
+#endif
+	return true;
+#endif // _WIN32
+}
+
+// Releases the range. Everything allocated from it is gone.
+void VirtualArena::Release()
+{
+	if (m_pMapping)
+	{
+#ifdef _WIN32
+		VirtualFree(m_pMapping, 0, MEM_RELEASE);
+#else
+		munmap(m_pMapping, m_MappingSize);
+#endif
+	}
+	m_pBase = 0;
+	m_pMapping = 0;
+	m_MappingSize = 0;
+	m_Reserved = 0;
+	m_Committed = 0;
+	m_Offset = 0;
+	m_CommitStep = 0;
+	m_PageType = VM_PAGES_NORMAL;
+}
+
+// Returns size bytes aligned to alignment, committing pages if needed
+void* VirtualArena::Allocate(size_t size, size_t alignment)
+{
+	size_t offset = (m_Offset + alignment - 1) & ~(alignment - 1);
+	if (offset + size > m_Reserved || !Commit(offset + size))
+	{
+		return 0;
+	}
+	m_Offset = offset + size;
+	return m_pBase + offset;
+}
+
+// Commits pages up to at least bytes, in steps of m_CommitStep
+bool VirtualArena::CommitMore(size_t bytes)
+{
+	if (bytes > m_Reserved)
+	{
+		return false;
+	}
+
+	size_t committed = RoundUp(bytes, m_CommitStep);
+	if (committed > m_Reserved)
+	{
+		committed = m_Reserved;
+	}
+
+#ifdef _WIN32
+	if (!VirtualAlloc(m_pBase + m_Committed, committed - m_Committed, MEM_COMMIT, PAGE_READWRITE))
+	{
+		return false;
+	}
+#else
+	if (mprotect(m_pBase + m_Committed, committed - m_Committed, PROT_READ | PROT_WRITE) != 0)
+	{
+		return false;
+	}
+#endif
+	m_Committed = committed;
+	return true;
+}
+
+} // namespace ITP485
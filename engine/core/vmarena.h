@@ -0,0 +1,108 @@
+// Defines a virtual memory arena, which reserves a range of address space up
+// front and commits pages in it as they're needed. The pools and the frame
+// allocator get their memory from these.
+#ifndef _VMARENA_H_
+#define _VMARENA_H_
+#include <cstddef>
+
+namespace ITP485
+{
+
+// Kinds of pages an arena can ask for. If the huge pages aren't available,
+// the arena quietly uses normal pages instead.
+enum VirtualPageType
+{
+	// Normal 4KB pages
+	VM_PAGES_NORMAL = 0,
+	// Normal pages, but the range is aligned to the huge page size and the OS
+	// is asked to back it with huge pages when it can (madvise(MADV_HUGEPAGE)
+	// on Linux). Same as VM_PAGES_NORMAL on Windows, which has no such thing.
+	VM_PAGES_TRANSPARENT_HUGE,
+	// Explicit huge pages (MAP_HUGETLB on Linux, MEM_LARGE_PAGES on Windows).
+	// These can't be committed bit by bit, so the whole range is committed at
+	// once. Needs huge pages set aside on Linux, and the "Lock pages in
+	// memory" privilege on Windows.
+	VM_PAGES_HUGE
+};
+
+// Returns the size of a normal page, and of a huge page (0 if there are none)
+size_t GetVirtualPageSize();
+size_t GetHugePageSize();
+
+// VirtualArena owns one reserved range of address space. Reserving costs no
+// memory, only address space, so it can be generous: pages are committed from
+// the start of the range as Allocate (or Commit) reaches them.
+//
+// Allocate bumps an offset like the frame allocator. There's no Free, Reset
+// takes everything back at once and keeps the pages committed.
+//
+// Keeping a pool in one range means its blocks are next to each other,
+// so walking all of them touches as few pages (and TLB entries) as possible,
+// even fewer with huge pages.
+//
+// Not thread safe.
+class VirtualArena
+{
+public:
+	VirtualArena();
+
+	// Releases the range, if there is one
+	~VirtualArena();
+
+	// Reserves at least maxBytes of address space. Returns false if the
+	// address space couldn't be reserved. Any previous range is released first.
+	bool Reserve(size_t maxBytes, VirtualPageType pages = VM_PAGES_NORMAL);
+
+	// Releases the range. Everything allocated from it is gone.
+	void Release();
+
+	// Makes sure the first bytes of the range are committed. Returns false if
+	// that's past the end of the range, or the OS is out of memory.
+	bool Commit(size_t bytes)
+	{
+		return (bytes <= m_Committed) ? true : CommitMore(bytes);
+	}
+
+	// Returns size bytes aligned to alignment (a power of 2), committing pages
+	// if needed, or 0 if the range is full.
+	void* Allocate(size_t size, size_t alignment = 16);
+
+	// Frees everything allocated, the pages stay committed
+	void Reset() { m_Offset = 0; }
+
+	// Returns true if ptr is in the reserved range
+	bool Contains(const void* ptr) const
+	{
+		return ptr >= m_pBase && ptr < m_pBase + m_Reserved;
+	}
+
+	char* GetBase() const { return m_pBase; }
+	size_t GetBytesReserved() const { return m_Reserved; }
+	size_t GetBytesCommitted() const { return m_Committed; }
+	size_t GetBytesUsed() const { return m_Offset; }
+
+	// Returns the kind of pages the range actually got
+	VirtualPageType GetPageType() const { return m_PageType; }
+
+private:
+	// Not copyable
+	VirtualArena(const VirtualArena&);
+	VirtualArena& operator=(const VirtualArena&);
+
+	// Commits pages up to at least bytes, in steps of m_CommitStep
+	bool CommitMore(size_t bytes);
+
+	char* m_pBase;
+	// Start of what was actually mapped, m_pBase may be past it for alignment
+	char* m_pMapping;
+	size_t m_MappingSize;
+	size_t m_Reserved;
+	size_t m_Committed;
+	size_t m_Offset;
+	size_t m_CommitStep;
+	VirtualPageType m_PageType;
+};
+
+} // namespace ITP485
+
+#endif // _VMARENA_H_
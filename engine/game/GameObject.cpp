@@ -3,21 +3,23 @@
 #include "../components/MeshComponent.h"
 #include "../components/AnimComponent.h"
 #include "../graphics/EffectManager.h"
+#include "../graphics/GraphicsDevice.h"
+#include "GameWorld.h"
 
 namespace ITP485
 {
 
-// Sets component pointers to NULL
+// Component handles start out null
 GameObject::GameObject()
 {
-	m_pMeshComponent = nullptr;
-	m_pAnimComponent = nullptr;
+
 }
 
-// Deletes any components which were initialized
+// Destroys any components which were created
 GameObject::~GameObject()
 {
-	delete m_pMeshComponent;
+	GraphicsDevice::get().DestroyMeshComponent(m_MeshComponent);
+	GameWorld::get().DestroyAnimComponent(m_AnimComponent);
 }
 
 // Spawn this object based on ObjectName
@@ -30,20 +32,21 @@ bool GameObject::Spawn(std::string sObjectName, minIni& iniReader)
 	input = iniReader.gets(sObjectName, "Mesh");
 	if (input != "")
 	{
-		m_pMeshComponent = new MeshComponent(input.c_str());
+		m_MeshComponent = GraphicsDevice::get().CreateMeshComponent(input.c_str());
+		MeshComponent* pMeshComponent = GraphicsDevice::get().GetMeshComponent(m_MeshComponent);
 		
 		input = iniReader.gets(sObjectName, "Effect");
 		if (input != "")
 		{
 			LPD3DXEFFECT effectData = EffectManager::get().GetEffectData(input.c_str());
-			m_pMeshComponent->SetEffectData(effectData);
+			pMeshComponent->SetEffectData(effectData);
 		}
 
 		input = iniReader.gets(sObjectName, "Animation");
 		if (input != "")
 		{
-			m_pAnimComponent = new AnimComponent(input.c_str());
-			m_pMeshComponent->SetAnimComponent(m_pAnimComponent);
+			m_AnimComponent = GameWorld::get().CreateAnimComponent(input.c_str());
+			pMeshComponent->SetAnimComponent(m_AnimComponent);
 		}
 
 		input = iniReader.gets(sObjectName, "Position");
@@ -51,7 +54,7 @@ bool GameObject::Spawn(std::string sObjectName, minIni& iniReader)
 		{
 			float x, y, z;
 			sscanf_s(input.c_str(), "(%f,%f,%f)", &x, &y, &z);
-			m_pMeshComponent->GetTranslationVector().Set(x, y, z);
+			pMeshComponent->GetTranslationVector().Set(x, y, z);
 		}
 		
 		input = iniReader.gets(sObjectName, "Rotation");
@@ -62,7 +65,7 @@ bool GameObject::Spawn(std::string sObjectName, minIni& iniReader)
 			Quaternion yawQuat(Vector3::UnitY, yaw);
 			Quaternion pitchQuat(Vector3::UnitX, pitch);
 			Quaternion rollQuat(Vector3::UnitZ, roll);
-			Quaternion& meshComponentQuat = m_pMeshComponent->GetQuaternion();
+			Quaternion& meshComponentQuat = pMeshComponent->GetQuaternion();
 			meshComponentQuat = yawQuat;
 			meshComponentQuat.Multiply(pitchQuat);
 			meshComponentQuat.Multiply(rollQuat);
@@ -71,7 +74,7 @@ bool GameObject::Spawn(std::string sObjectName, minIni& iniReader)
 		float scale = iniReader.getf(sObjectName, "Scale");
 		if (scale != 0)
 		{
-			m_pMeshComponent->SetScale(scale);
+			pMeshComponent->SetScale(scale);
 		}
 	}
 	
@@ -82,10 +85,7 @@ bool GameObject::Spawn(std::string sObjectName, minIni& iniReader)
 // Update this GameObject
 void GameObject::Update(float fDelta)
 {
-	if (m_pAnimComponent != nullptr)
-	{
-		m_pAnimComponent->Update(fDelta);
-	}
+
 }
 
 }
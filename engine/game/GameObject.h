@@ -4,6 +4,8 @@
 
 #include <string>
 #include "../ini/minIni.h"
+#include "../core/smallalloc.h"
+#include "../core/slotmap.h"
 
 namespace ITP485
 {
@@ -14,25 +16,30 @@ class AnimComponent;
 class GameObject
 {
 public:
-	// Sets component pointers to NULL
+	// Game objects and everything derived from them use the small object allocator
+	DECLARE_SMALL_OBJECT_NEW_DELETE();
+
+	// Component handles start out null
 	GameObject();
 
-	// Deletes any components which were initialized
+	// Destroys any components which were created
 	virtual ~GameObject();
 
 	// Spawn this object based on ObjectName
 	// Returns true if successfully spawned
 	virtual bool Spawn(std::string sObjectName, minIni& iniReader);
 
-	// Update this GameObject
+	// Update this GameObject. Its components are updated by their owners
+	// (GameWorld and GraphicsDevice), so this only has to do what's special
+	// to the object.
 	virtual void Update(float fDelta);
 
 protected:
 	// We use std::string for ObjectName because of minINI
 	std::string m_sObjectName;
-	// Component pointers
-	MeshComponent* m_pMeshComponent;
-	AnimComponent* m_pAnimComponent;
+	// Component handles, the components are in GraphicsDevice and GameWorld
+	SlotHandle<MeshComponent> m_MeshComponent;
+	SlotHandle<AnimComponent> m_AnimComponent;
 };
 
 }
@@ -30,10 +30,14 @@ void GameWorld::Cleanup()
 	}
 	m_GameObjects.clear();
 
+	// The point lights were spawned here too, and they need the GameWorld
+	// to delete their components
+	GraphicsDevice::get().ClearPointLights();
+
 	delete m_pLevelFile;
 }
 
-// Update all GameObjects if not paused
+// Update all AnimComponents, then all GameObjects, if not paused
 void GameWorld::Update(float fDelta)
 {
 	if (fDelta > 0.1f)
@@ -43,6 +47,11 @@ void GameWorld::Update(float fDelta)
 
 	if (!m_bPaused)
 	{
+		for (AnimComponent& animComponent : m_AnimComponents)
+		{
+			animComponent.Update(fDelta);
+		}
+
 		for (GameObject* pGameObject : m_GameObjects)
 		{
 			pGameObject->Update(fDelta);
@@ -50,6 +59,16 @@ void GameWorld::Update(float fDelta)
 	}
 }
 
+SlotHandle<AnimComponent> GameWorld::CreateAnimComponent(const char* szFileName)
+{
+	return m_AnimComponents.Insert(szFileName);
+}
+
+void GameWorld::DestroyAnimComponent(SlotHandle<AnimComponent> handle)
+{
+	m_AnimComponents.Erase(handle);
+}
+
 // Load in the level file
 // Returns true if succeeded
 bool GameWorld::LoadLevel(const char* szLevelFile)
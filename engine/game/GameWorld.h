@@ -2,6 +2,9 @@
 #ifndef _GAMEWORLD_H_
 #define _GAMEWORLD_H_
 #include "../core/singleton.h"
+#include "../core/memresource.h"
+#include "../core/slotmap.h"
+#include "../components/AnimComponent.h"
 #include <set>
 
 class minIni;
@@ -10,7 +13,7 @@ namespace ITP485
 
 class GameObject;
 
-class GameWorld : public Singleton<GameWorld>
+class GameWorld : public Singleton<GameWorld, SINGLETON_EXPLICIT>
 {
 	DECLARE_SINGLETON(GameWorld);
 public:
@@ -20,19 +23,40 @@ public:
 	// Cleanup will delete all the GameObjects
 	void Cleanup();
 
-	// Update all GameObjects if not paused
+	// Update all AnimComponents, then all GameObjects, if not paused
 	void Update(float fDelta);
 
+	// Creates an AnimComponent from the anim file, and returns its handle
+	SlotHandle<AnimComponent> CreateAnimComponent(const char* szFileName);
+
+	// Destroys the AnimComponent, does nothing if the handle is null or stale
+	void DestroyAnimComponent(SlotHandle<AnimComponent> handle);
+
+	// Returns the AnimComponent, or nullptr if the handle is null or stale.
+	// The pointer is only good until the next Create or DestroyAnimComponent.
+	AnimComponent* GetAnimComponent(SlotHandle<AnimComponent> handle) { return m_AnimComponents.Get(handle); }
+
 	// Load in the level file
 	// Returns true if succeeded
 	bool LoadLevel(const char* szLevelFile);
 
 	bool IsPaused() const { return m_bPaused; }
 	void SetPaused(bool bValue) { m_bPaused = bValue; }
+
+protected:
+	// Default constructor puts the game object set's nodes in the small object pools
+	GameWorld()
+		: m_GameObjects(GameObjectSet::allocator_type(GetSmallObjectResource()))
+		, m_pLevelFile(NULL)
+		, m_bPaused(false)
+	{ }
 	
 private:
 	// Stores all the game objects in the world
-	std::set<GameObject*> m_GameObjects;
+	typedef std::set<GameObject*, std::less<GameObject*>, ResourceStlAllocator<GameObject*> > GameObjectSet;
+	GameObjectSet m_GameObjects;
+	// All active AnimComponents, packed so Update walks them in order
+	SlotMap<AnimComponent> m_AnimComponents;
 	// This is our level ini file pointer
 	minIni* m_pLevelFile;
 	// Master bool for pausing/unpausing the game
@@ -6,7 +6,7 @@
 namespace ITP485
 {
 
-class InputManager : public Singleton<InputManager>
+class InputManager : public Singleton<InputManager, SINGLETON_EXPLICIT>
 {
 	DECLARE_SINGLETON(InputManager);
 
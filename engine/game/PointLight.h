@@ -24,15 +24,7 @@ public:
 	float m_InnerRadius;
 	float m_OuterRadius;
 
-	// Overloads of new/delete to ensure it is 16-byte aligned.
-	void* operator new(size_t size)
-	{
-		return _aligned_malloc(size, 16);
-	}
-	void operator delete(void* ptr)
-	{
-		_aligned_free(ptr);
-	}
+	// new/delete come from GameObject, the small object allocator is 16-byte aligned.
 };
 
 }
@@ -1,6 +1,7 @@
 #include "EffectManager.h"
 #include "GraphicsDevice.h"
 #include "../game/PointLight.h"
+#include "../core/framealloc.h"
 
 namespace ITP485
 {
@@ -44,10 +45,12 @@ LPD3DXEFFECT EffectManager::GetEffectData(const char* szEffectFile)
 // Iterates through the map and sets the viewProj matrix for each effect.
 void EffectManager::SetViewProjMatrix(Matrix4& viewProj)
 {
-	D3DXMATRIX* matrix = static_cast<D3DXMATRIX*>(viewProj.ToD3D());
+	// Convert to D3D's layout once for every effect
+	D3DXMATRIX matrix;
+	viewProj.StoreD3D(matrix);
 	for (auto it = m_EffectMap.begin(); it != m_EffectMap.end(); ++it)
 	{
-		it->second->SetMatrix("gViewProj", matrix);
+		it->second->SetMatrix("gViewProj", &matrix);
 	}
 }
 
@@ -67,24 +70,29 @@ void EffectManager::SetPointLights(std::set<PointLight*>& lights)
 		int lightNum = 0;
 		for (PointLight* light : lights)
 		{
-			std::string handle;
-
-			handle = "PointLights[" + std::to_string(lightNum) + "].DiffuseColor";
+			// The handle strings only live until the end of this iteration
+			ScopedFrameMarker marker;
+			FrameString prefix = "PointLights[";
+			prefix += std::to_string(lightNum).c_str();
+			prefix += "].";
+			FrameString handle;
+
+			handle = prefix + "DiffuseColor";
 			it->second->SetVector(handle.c_str(), &(light->m_DiffuseColor));
 
-			handle = "PointLights[" + std::to_string(lightNum) + "].SpecularColor";
+			handle = prefix + "SpecularColor";
 			it->second->SetVector(handle.c_str(), &(light->m_SpecularColor));
 
-			handle = "PointLights[" + std::to_string(lightNum) + "].Position";
+			handle = prefix + "Position";
 			it->second->SetValue(handle.c_str(), &(light->m_Position), 12);
 
-			handle = "PointLights[" + std::to_string(lightNum) + "].SpecularPower";
+			handle = prefix + "SpecularPower";
 			it->second->SetFloat(handle.c_str(), light->m_SpecularPower);
 
-			handle = "PointLights[" + std::to_string(lightNum) + "].InnerRadius";
+			handle = prefix + "InnerRadius";
 			it->second->SetFloat(handle.c_str(), light->m_InnerRadius);
 
-			handle = "PointLights[" + std::to_string(lightNum) + "].OuterRadius";
+			handle = prefix + "OuterRadius";
 			it->second->SetFloat(handle.c_str(), light->m_OuterRadius);
 
 			++lightNum;
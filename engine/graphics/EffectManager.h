@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/singleton.h"
+#include "../core/memresource.h"
 #include <d3dx9effect.h>
 #include <unordered_map>
 #include "../core/math.h"
@@ -11,7 +12,7 @@ namespace ITP485
 
 class PointLight;
 
-class EffectManager : public Singleton<EffectManager>
+class EffectManager : public Singleton<EffectManager, SINGLETON_EXPLICIT>
 {
 	DECLARE_SINGLETON(EffectManager);
 public:
@@ -40,8 +41,20 @@ public:
 	// Iterates through the map and sets the CameraPosition for each effect.
 	void SetCameraPosition(Vector3& pos);
 
+protected:
+	// Default constructor puts the effect map in its own monotonic arena
+	EffectManager()
+		: m_MapResource(64 * 1024)
+		, m_EffectMap(16, std::hash<std::string>(), std::equal_to<std::string>(), EffectMap::allocator_type(&m_MapResource))
+	{ }
+
 private:
-	std::unordered_map<std::string, LPD3DXEFFECT> m_EffectMap;
+	// Effects are only added until Cleanup, so the map's nodes and buckets
+	// are bumped out of one arena, next to each other
+	MonotonicResource m_MapResource;
+	typedef std::unordered_map<std::string, LPD3DXEFFECT, std::hash<std::string>, std::equal_to<std::string>,
+		ResourceStlAllocator<std::pair<const std::string, LPD3DXEFFECT> > > EffectMap;
+	EffectMap m_EffectMap;
 };
 
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "GraphicsDevice.h"
 #include "../core/dbg_assert.h"
+#include "../core/bounds.h"
 #include "MeshManager.h"
 #include "EffectManager.h"
 #include "MeshData.h"
@@ -44,23 +45,11 @@ void GraphicsDevice::Setup(HWND hWnd)
 	m_CameraMtx.CreateLookAt(Vector3(0.0f, 3.0f, -5.0f),
 		Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
 	m_ProjectionMtx.CreatePerspectiveFOV(0.78539816f, 1.333333f, 1.0f, 100.0f);
-
-	// Setup the MeshManager and EffectManager.
-	MeshManager::get().Setup();
-	EffectManager::get().Setup();
-
-	// Setup the pools.
-	MeshComponentPool::get().StartUp();
-	KeyFramePool::get().StartUp();
 }
 
 // Releases all D3D resources
 void GraphicsDevice::Cleanup()
 {
-	// Cleanup the pools.
-	MeshComponentPool::get().ShutDown();
-	KeyFramePool::get().ShutDown();
-
 	if (m_pDevice)
 	{
 		m_pDevice->Release();
@@ -71,16 +60,8 @@ void GraphicsDevice::Cleanup()
 		m_pD3D->Release();
 	}
 
-	// Cleanup the MeshManager and EffectManager.
-	MeshManager::get().Cleanup();
-	EffectManager::get().Cleanup();
-
 	// Clean up the PointLight set.
-	for (PointLight* light : m_PointLights)
-	{
-		delete light;
-	}
-	m_PointLights.clear();
+	ClearPointLights();
 }
 
 // Renders the current frame
@@ -117,11 +98,50 @@ void GraphicsDevice::Render()
 		// Set the camera position for our effects.
 		EffectManager::get().SetCameraPosition(m_vCameraPosition);
 
-		// Draw all MeshComponents.
-		for (MeshComponent* pMeshComponent : m_MeshComponentSet)
+		// Cull MeshComponents against the view frustum 16 at a time,
+		// and only draw the ones that aren't completely outside.
+		D3DXMATRIX d3dViewProj;
+		mViewProj.StoreD3D(d3dViewProj);
+		Frustum frustum(d3dViewProj);
+		AabbBatch batch;
+		MeshComponent* batchComponents[AabbBatch::kCapacity];
+		int batchCount = 0;
+		auto drawBatch = [&]()
 		{
-			pMeshComponent->Draw();
+			unsigned int visible = frustum.TestVisible(batch, batchCount);
+			for (int i = 0; i < batchCount; ++i)
+			{
+				if (visible & (1 << i))
+				{
+					batchComponents[i]->Draw();
+				}
+			}
+			batchCount = 0;
+		};
+
+		for (MeshComponent& meshComponent : m_MeshComponents)
+		{
+			if (!meshComponent.GetVisible())
+			{
+				continue;
+			}
+
+			meshComponent.UpdateWorldTransform();
+			if (!meshComponent.IsCullable())
+			{
+				meshComponent.Draw();
+				continue;
+			}
+
+			batch.Set(batchCount, meshComponent.GetWorldBounds());
+			batchComponents[batchCount] = &meshComponent;
+			batchCount++;
+			if (batchCount == AabbBatch::kCapacity)
+			{
+				drawBatch();
+			}
 		}
+		drawBatch();
 
 		// End the scene.
 		m_pDevice->EndScene();
@@ -131,11 +151,31 @@ void GraphicsDevice::Render()
 	m_pDevice->Present(NULL, NULL, NULL, NULL);
 }
 
+SlotHandle<MeshComponent> GraphicsDevice::CreateMeshComponent(const char* szFileName)
+{
+	return m_MeshComponents.Insert(szFileName);
+}
+
+void GraphicsDevice::DestroyMeshComponent(SlotHandle<MeshComponent> handle)
+{
+	m_MeshComponents.Erase(handle);
+}
+
 void GraphicsDevice::AddPointLight(PointLight* light)
 {
 	m_PointLights.insert(light);
 }
 
+// Deletes every PointLight in the set
+void GraphicsDevice::ClearPointLights()
+{
+	for (PointLight* light : m_PointLights)
+	{
+		delete light;
+	}
+	m_PointLights.clear();
+}
+
 LPD3DXEFFECT GraphicsDevice::LoadEffect( const char* szFileName )
 {
 #ifdef _DEBUG
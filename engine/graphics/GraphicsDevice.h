@@ -6,6 +6,8 @@
 #include <d3dx9effect.h>
 #include "../core/singleton.h"
 #include "../core/math.h"
+#include "../core/slotmap.h"
+#include "../components/MeshComponent.h"
 #include <set>
 
 namespace ITP485
@@ -13,9 +15,8 @@ namespace ITP485
 
 class PointLight;
 
-class GraphicsDevice : public Singleton<GraphicsDevice>
+class GraphicsDevice : public Singleton<GraphicsDevice, SINGLETON_EXPLICIT>
 {
-	friend class MeshComponent;
 	DECLARE_SINGLETON(GraphicsDevice);
 public:
 	// Sets up our D3D device to the passed window.
@@ -46,9 +47,22 @@ public:
 	D3DXVECTOR4& GetAmbientColor() { return m_AmbientColor; }
 	void SetAmbientColor(const D3DXVECTOR4& color) { m_AmbientColor = color; }
 
+	// Creates a MeshComponent from the mesh file, and returns its handle
+	SlotHandle<MeshComponent> CreateMeshComponent(const char* szFileName);
+
+	// Destroys the MeshComponent, does nothing if the handle is null or stale
+	void DestroyMeshComponent(SlotHandle<MeshComponent> handle);
+
+	// Returns the MeshComponent, or nullptr if the handle is null or stale.
+	// The pointer is only good until the next Create or DestroyMeshComponent.
+	MeshComponent* GetMeshComponent(SlotHandle<MeshComponent> handle) { return m_MeshComponents.Get(handle); }
+
 	// Adds a PointLight to the PointLight set.
 	void AddPointLight(PointLight* light);
 
+	// Deletes every PointLight in the set.
+	void ClearPointLights();
+
 	// Given an effect file.
 	LPD3DXEFFECT LoadEffect(const char* szFileName);
 
@@ -77,8 +91,8 @@ protected:
 	// Direct3D9 device pointer
 	LPDIRECT3DDEVICE9 m_pDevice;
 
-	// Set of all active MeshComponents
-	std::set<MeshComponent*> m_MeshComponentSet;
+	// All active MeshComponents, packed so Render walks them in order
+	SlotMap<MeshComponent> m_MeshComponents;
 
 	// Set of all PointLights
 	std::set<PointLight*> m_PointLights;
@@ -1,6 +1,8 @@
 #include "MeshData.h"
 #include "../core/dbg_assert.h"
 #include <cstdlib>
+#include <cfloat>
+#include <cmath>
 #include <wchar.h>
 #include "GraphicsDevice.h"
 #include "../../ticpp/ticpp.h"
@@ -68,6 +70,11 @@ MeshData::MeshData(const char* szFileName)
 	HRESULT hr;
 	LPDIRECT3DDEVICE9 pDevice = GraphicsDevice::get().GetD3DDevice();
 	VOID* pData;
+	for (int i = 0; i < 3; ++i)
+	{
+		m_vBoundsMin[i] = 0.0f;
+		m_vBoundsMax[i] = 0.0f;
+	}
 
 	// Parse the itpmesh file
 	ticpp::Document doc(szFileName);
@@ -153,6 +160,10 @@ MeshData::MeshData(const char* szFileName)
 			m_iNumVerts = atoi(strValue.c_str());
 			float* pVerts = new float[m_iNumVerts * m_iVertexSize];
 			int i = 0;
+
+			// Track the min/max position for the bounding box
+			float vMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float vMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
 			
 			// Now get every vertex
 			ticpp::Iterator<ticpp::Element> vert;
@@ -168,6 +179,13 @@ MeshData::MeshData(const char* szFileName)
 					if (strName == "pos")
 					{
 						sscanf_s(ele->GetText().c_str(), "%f,%f,%f", &x, &y, &z);
+						vMin[0] = fminf(vMin[0], x);
+						vMin[1] = fminf(vMin[1], y);
+						vMin[2] = fminf(vMin[2], z);
+						vMax[0] = fmaxf(vMax[0], x);
+						vMax[1] = fmaxf(vMax[1], y);
+						vMax[2] = fmaxf(vMax[2], z);
+
 						pVerts[i] = x;
 						i++;
 
@@ -231,6 +249,15 @@ MeshData::MeshData(const char* szFileName)
 				}
 			}
 
+			if (m_iNumVerts > 0)
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					m_vBoundsMin[j] = vMin[j];
+					m_vBoundsMax[j] = vMax[j];
+				}
+			}
+
 			// Load up the vertex buffer
 			hr = pDevice->CreateVertexBuffer(sizeof(float) * m_iNumVerts * m_iVertexSize,D3DUSAGE_WRITEONLY,
 				0,D3DPOOL_MANAGED,&m_pVertexBuffer,NULL);
@@ -3,6 +3,7 @@
 #ifndef _MESHDATA_H_
 #define _MESHDATA_H_
 #include <d3dx9.h>
+#include "../core/bounds.h"
 
 namespace ITP485
 {
@@ -18,6 +19,13 @@ public:
 	~MeshData();
 
 	void Draw(ID3DXEffect* pEffect, D3DXHANDLE hTechnique);
+
+	// Returns the object space box around every vertex position
+	Aabb GetBounds() const
+	{
+		return Aabb(m_vBoundsMin[0], m_vBoundsMin[1], m_vBoundsMin[2],
+					m_vBoundsMax[0], m_vBoundsMax[1], m_vBoundsMax[2]);
+	}
 private:
 	MeshData() {} // Disallow default constructor
 	
@@ -31,6 +39,11 @@ private:
 	int m_iNumVerts;
 
 	int m_iNumTris;
+
+	// Object space bounds, for culling. Kept as floats since MeshData
+	// comes from the regular heap, which isn't 16 byte aligned.
+	float m_vBoundsMin[3];
+	float m_vBoundsMax[3];
 };
 
 } // namespace
@@ -2,6 +2,8 @@
 #ifndef _MESHMANAGER_H_
 #define _MESHMANAGER_H_
 #include "../core/singleton.h"
+#include "../core/memresource.h"
+#include <string>
 #include <unordered_map>
 
 namespace ITP485
@@ -9,7 +11,7 @@ namespace ITP485
 
 struct MeshData;
 
-class MeshManager : public Singleton<MeshManager>
+class MeshManager : public Singleton<MeshManager, SINGLETON_EXPLICIT>
 {
 	DECLARE_SINGLETON(MeshManager);
 public:
@@ -25,11 +27,24 @@ public:
 	// If the MeshData isn't already loaded for it, will construct a MeshData
 	// using new, add that pointer to the hash map, and then return that pointer
 	MeshData* GetMeshData(const char* szMeshFile);
+
+protected:
+	// Default constructor puts the mesh map in its own monotonic arena
+	MeshManager()
+		: m_MapResource(64 * 1024)
+		, m_MeshMap(16, std::hash<std::string>(), std::equal_to<std::string>(), MeshMap::allocator_type(&m_MapResource))
+	{ }
+
 private:
 	// Helper function which hashes the passed string using djb2 algorithm
 	unsigned int HashString(const char* str);
 
-	std::unordered_map<std::string, MeshData*> m_MeshMap;
+	// Meshes are only added until Cleanup, so the map's nodes and buckets
+	// are bumped out of one arena, next to each other
+	MonotonicResource m_MapResource;
+	typedef std::unordered_map<std::string, MeshData*, std::hash<std::string>, std::equal_to<std::string>,
+		ResourceStlAllocator<std::pair<const std::string, MeshData*> > > MeshMap;
+	MeshMap m_MeshMap;
 };
 
 } // namespace
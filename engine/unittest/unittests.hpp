@@ -3,14 +3,32 @@
 #include "stdafx.h"
 #include <iostream>
 #include "..\core\fastmath.h"
+#include "..\core\soamath.h"
 #include "..\core\slowmath.h"
+#include "..\core\bounds.h"
+#include "..\core\dualquat.h"
+#include "..\core\quantize.h"
 #include "..\MiniCppUnit-2.5\MiniCppUnit.hxx"
 #include "..\core\singleton.h"
 #include "..\core\poolalloc.h"
+#include "..\core\framealloc.h"
+#include "..\core\smallalloc.h"
+#include "..\core\allocstats.h"
+#include "..\core\vmarena.h"
+#include "..\core\memresource.h"
+#include "..\core\slotmap.h"
+#include "..\core\subsystem.h"
 #include <vector>
+#include <map>
+#include <set>
 #include <algorithm>
 #include <ctime>
 #include <cstdlib>
+#include <cfloat>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <atomic>
 
 namespace ITP485
 {
@@ -36,6 +54,74 @@ public:
 		TEST_CASE_DESCRIBE(testLerp, "Linear Interpolation");
 		//TEST_CASE_DESCRIBE(testScalarMult, "Scalar Multiply");
 		TEST_CASE_DESCRIBE(testBlend, "4-Way Blend");
+		TEST_CASE_DESCRIBE(testAccuracyTiers, "Normalize/Length accuracy tiers");
+	}
+	// Returns how many floats lie between a and b
+	static unsigned int UlpDistance(float a, float b)
+	{
+		int ia, ib;
+		memcpy(&ia, &a, sizeof(int));
+		memcpy(&ib, &b, sizeof(int));
+		// Make the bit patterns ordered like the floats
+		long long la = (ia < 0) ? (long long)(int)0x80000000 - ia : ia;
+		long long lb = (ib < 0) ? (long long)(int)0x80000000 - ib : ib;
+		return static_cast<unsigned int>((la > lb) ? la - lb : lb - la);
+	}
+	// Returns the max ulp error of Normalize, Length and InvLength at the
+	// requested tier against SlowVector3, over vectors of all sorts of lengths
+	unsigned int MaxUlpError(SimdAccuracy accuracy)
+	{
+		unsigned int maxError = 0;
+		for (int i = 0; i < 2000; ++i)
+		{
+			float scale = powf(10.0f, float(i % 9) - 4.0f);
+			float x = sinf(i * 1.7f) * scale;
+			float y = cosf(i * 0.31f) * scale;
+			float z = sinf(i * 2.9f + 1.0f) * scale;
+
+			SlowVector3 slow(x, y, z);
+			float length = slow.Length();
+			slow.Normalize();
+
+			FastVector3 fast(x, y, z);
+			maxError = std::max(maxError, UlpDistance(length, fast.Length(accuracy)));
+			maxError = std::max(maxError, UlpDistance(1.0f / length, fast.InvLength(accuracy)));
+			fast.Normalize(accuracy);
+			maxError = std::max(maxError, UlpDistance(slow.GetX(), fast.GetX()));
+			maxError = std::max(maxError, UlpDistance(slow.GetY(), fast.GetY()));
+			maxError = std::max(maxError, UlpDistance(slow.GetZ(), fast.GetZ()));
+		}
+		return maxError;
+	}
+	void testAccuracyTiers()
+	{
+		unsigned int precise = MaxUlpError(SIMD_PRECISE);
+		unsigned int fast = MaxUlpError(SIMD_FAST);
+		unsigned int estimate = MaxUlpError(SIMD_ESTIMATE);
+		printf("max ulp error: precise %u, fast %u, estimate %u\n", precise, fast, estimate);
+		ASSERT_TEST_MESSAGE(precise <= 2, "SIMD_PRECISE is more than 2 ulps off.");
+		// one Newton-Raphson step gets to about 22 bits
+		ASSERT_TEST_MESSAGE(fast <= 16, "SIMD_FAST is more than 16 ulps off.");
+		// rsqrt is good to 1.5 * 2^-12 relative error, which is up to 6144 ulps
+		// when the result lands just under a power of 2
+		ASSERT_TEST_MESSAGE(estimate <= 6144, "SIMD_ESTIMATE is more than 6144 ulps off.");
+
+		// The compile time versions are the same thing
+		FastVector3 a(1.0f, 2.0f, 3.0f);
+		FastVector3 b(1.0f, 2.0f, 3.0f);
+		a.Normalize(SIMD_ESTIMATE);
+		b.Normalize<SIMD_ESTIMATE>();
+		ASSERT_EQUALS(a.GetX(), b.GetX());
+		ASSERT_EQUALS(a.Length(SIMD_FAST), b.Length<SIMD_FAST>());
+		ASSERT_EQUALS(a.InvLength(SIMD_FAST), b.InvLength<SIMD_FAST>());
+
+		// 0 doesn't turn into NaN
+		FastVector3 zero(0.0f, 0.0f, 0.0f);
+		ASSERT_EQUALS(0.0f, zero.Length(SIMD_FAST));
+		ASSERT_EQUALS(0.0f, zero.Length(SIMD_ESTIMATE));
+
+		ASSERT_EQUALS_EPSILON(0.25f, Reciprocal(4.0f, SIMD_FAST), 1e-6f);
+		ASSERT_EQUALS_EPSILON(0.25f, Reciprocal(4.0f, SIMD_ESTIMATE), 1e-3f);
 	}
 	void testConstructorGettersSetters()
 	{
@@ -151,6 +237,14 @@ public:
 		TEST_CASE_DESCRIBE(testVectorTransformX2, "Transform a vector (as a position) by a matrix and back");
 		TEST_CASE_DESCRIBE(testVectorTransformAsVector, "Transform a vector (as a vector) by a matrix");
 		TEST_CASE_DESCRIBE(testMatrixMult, "Multiply two matrices together (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixMultKernels, "Multiply with every SIMD kernel, compare against SlowMatrix4");
+		TEST_CASE_DESCRIBE(testMatrixMultBatch, "MultiplyBatch/MultiplyBroadcast with every SIMD kernel");
+		TEST_CASE_DESCRIBE(testAffine, "FastAffine3x4 multiply/transform/invert match FastMatrix4");
+		TEST_CASE_DESCRIBE(testSpecializedInverses, "InvertAffine/InvertOrthonormal/InvertMany match Invert");
+		TEST_CASE_DESCRIBE(testSinCos, "SinCos matches sinf/cosf for both accuracy tiers and every SIMD level");
+		TEST_CASE_DESCRIBE(testTransformStrided, "TransformPoints/TransformNormals over interleaved vertices");
+		TEST_CASE_DESCRIBE(testColumnMajor, "Column major FastMatrix4T matches row major");
+		TEST_CASE_DESCRIBE(testDecompose, "Decompose/Compose round trip, batches at every SIMD level");
 // 		TEST_CASE_DESCRIBE(testMatrixAdd, "Add two matrices together (then apply to vector)");
 // 		TEST_CASE_DESCRIBE(testMatrixSub, "Subtract two matrices together (then apply to vector)");
 // 		TEST_CASE_DESCRIBE(testMatrixScale, "Creates scale matrix (then apply to vector)");
@@ -237,6 +331,618 @@ public:
 		ASSERT_EQUALS_EPSILON(33.0f, v.GetY(), 0.01f);
 		ASSERT_EQUALS_EPSILON(-9.0f, v.GetZ(), 0.01f);
 	}
+	void testMatrixMultKernels()
+	{
+		float mat1[4][4] = {1.0f, 2.0f, 3.0f, 4.0f,
+			5.0f, 6.0f, 7.0f, 8.0f,
+			-1.0f, 0.5f, 2.0f, -3.0f,
+			0.25f, -2.0f, 1.0f, 1.0f};
+		float mat2[4][4] = {2.0f, -1.0f, 0.0f, 3.0f,
+			0.5f, 1.0f, 4.0f, -2.0f,
+			1.0f, 1.0f, -1.0f, 0.0f,
+			0.0f, 3.0f, 2.0f, 1.0f};
+
+		SlowMatrix4 expected(mat1);
+		expected.Multiply(SlowMatrix4(mat2));
+		D3DMATRIX* pExpected = expected.ToD3D();
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+			FastMatrix4 result(mat1);
+			result.Multiply(FastMatrix4(mat2));
+			for (int i = 0; i < 4; ++i)
+			{
+				for (int j = 0; j < 4; ++j)
+				{
+					ASSERT_EQUALS_EPSILON(pExpected->m[i][j], result.Get(i, j), 0.001f);
+				}
+			}
+		}
+		SetSimdLevel(hardware);
+	}
+	void testMatrixMultBatch()
+	{
+		// Odd count so the AVX2 kernels hit their leftover path
+		const int count = 5;
+		float mats[count * 2][4][4];
+		for (int m = 0; m < count * 2; ++m)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				for (int j = 0; j < 4; ++j)
+				{
+					mats[m][i][j] = float((m * 7 + i * 5 + j * 3) % 11) * 0.5f - 2.0f;
+				}
+			}
+		}
+
+		SlowMatrix4 slowA[count], slowB[count], slowBatch[count], slowBroadcast[count];
+		for (int m = 0; m < count; ++m)
+		{
+			slowA[m].Set(mats[m]);
+			slowB[m].Set(mats[count + m]);
+		}
+		SlowMatrix4::MultiplyBatch(slowA, slowB, slowBatch, count);
+		SlowMatrix4::MultiplyBroadcast(slowA[0], slowB, slowBroadcast, count);
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+
+			FastMatrix4 fastA[count], fastB[count], fastBroadcast[count];
+			for (int m = 0; m < count; ++m)
+			{
+				fastA[m].Set(mats[m]);
+				fastB[m].Set(mats[count + m]);
+			}
+
+			// In place, the way AnimComponent uses it
+			FastMatrix4::MultiplyBroadcast(fastA[0], fastB, fastBroadcast, count);
+			FastMatrix4::MultiplyBatch(fastA, fastB, fastA, count);
+
+			for (int m = 0; m < count; ++m)
+			{
+				for (int i = 0; i < 4; ++i)
+				{
+					for (int j = 0; j < 4; ++j)
+					{
+						ASSERT_EQUALS_EPSILON(slowBatch[m].ToD3D()->m[i][j], fastA[m].Get(i, j), 0.001f);
+						ASSERT_EQUALS_EPSILON(slowBroadcast[m].ToD3D()->m[i][j], fastBroadcast[m].Get(i, j), 0.001f);
+					}
+				}
+			}
+		}
+		SetSimdLevel(hardware);
+	}
+	void testAffine()
+	{
+		// Translate * rotate * scale, like MeshComponent builds its world transform
+		const int count = 5;
+		FastMatrix4 full[count];
+		FastAffine3x4 affine[count];
+		for (int m = 0; m < count; ++m)
+		{
+			FastVector3 axis(1.0f, float(m), 2.0f);
+			axis.Normalize();
+			FastMatrix4 temp;
+			full[m].CreateTranslation(FastVector3(float(m), -2.0f, 0.5f * m));
+			temp.CreateFromQuaternion(FastQuaternion(axis, 0.3f * m + 0.1f));
+			full[m].Multiply(temp);
+			temp.CreateScale(1.0f + 0.5f * m);
+			full[m].Multiply(temp);
+			affine[m] = FastAffine3x4(full[m]);
+		}
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+
+			FastAffine3x4 batch[count];
+			FastAffine3x4::MultiplyBatch(affine, affine + 1, batch, count - 1);
+			for (int m = 0; m < count - 1; ++m)
+			{
+				FastMatrix4 expected = full[m];
+				expected.Multiply(full[m + 1]);
+				FastAffine3x4 single = affine[m];
+				single.Multiply(affine[m + 1]);
+
+				FastMatrix4 fromBatch, fromSingle;
+				batch[m].ToMatrix4(fromBatch);
+				single.ToMatrix4(fromSingle);
+				for (int i = 0; i < 4; ++i)
+				{
+					for (int j = 0; j < 4; ++j)
+					{
+						ASSERT_EQUALS_EPSILON(expected.ToD3D()->m[i][j], fromBatch.ToD3D()->m[i][j], 0.001f);
+						ASSERT_EQUALS_EPSILON(expected.ToD3D()->m[i][j], fromSingle.ToD3D()->m[i][j], 0.001f);
+					}
+				}
+			}
+		}
+		SetSimdLevel(hardware);
+
+		// Transform, then transform back by the inverse
+		FastVector3 v(1.0f, 2.0f, 3.0f);
+		FastVector3 expected(v);
+		expected.Transform(full[3]);
+		v.Transform(affine[3]);
+		ASSERT_EQUALS_EPSILON(expected.GetX(), v.GetX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetY(), v.GetY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetZ(), v.GetZ(), 0.001f);
+		ASSERT_EQUALS_EPSILON(1.0f, v.GetW(), 0.001f);
+
+		FastAffine3x4 inverse = affine[3];
+		inverse.Invert();
+		v.Transform(inverse);
+		ASSERT_EQUALS_EPSILON(1.0f, v.GetX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(2.0f, v.GetY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(3.0f, v.GetZ(), 0.001f);
+	}
+	void testSinCos()
+	{
+		// Odd count so the batch kernels hit their leftover path
+		const int count = 203;
+		float angles[count];
+		for (int i = 0; i < count; ++i)
+		{
+			angles[i] = (float(i) - 101.0f) * 0.173f;
+		}
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+			float sines[count];
+			float cosines[count];
+
+			SinCos(angles, sines, cosines, count);
+			for (int i = 0; i < count; ++i)
+			{
+				ASSERT_EQUALS_EPSILON(sinf(angles[i]), sines[i], 0.000001f);
+				ASSERT_EQUALS_EPSILON(cosf(angles[i]), cosines[i], 0.000001f);
+			}
+
+			SinCos(angles, sines, cosines, count, SIMD_FAST);
+			for (int i = 0; i < count; ++i)
+			{
+				ASSERT_EQUALS_EPSILON(sinf(angles[i]), sines[i], 0.0001f);
+				ASSERT_EQUALS_EPSILON(cosf(angles[i]), cosines[i], 0.0001f);
+			}
+		}
+		SetSimdLevel(hardware);
+
+		float s, c;
+		SinCos(-PiOver4, s, c);
+		ASSERT_EQUALS_EPSILON(-0.7071068f, s, 0.000001f);
+		ASSERT_EQUALS_EPSILON(0.7071068f, c, 0.000001f);
+
+		FastMatrix4 proj;
+		proj.CreatePerspectiveFOV(1.2f, 1.5f, 1.0f, 100.0f);
+		ASSERT_EQUALS_EPSILON(1.0f / tanf(0.6f), proj.ToD3D()->m[1][1], 0.0001f);
+	}
+	// Compares both matrices the way D3D would see them
+	template <class LayoutA, class LayoutB>
+	void AssertSameMatrix(const FastMatrix4T<LayoutA>& a, const FastMatrix4T<LayoutB>& b)
+	{
+		D3DMATRIX da, db;
+		a.StoreD3D(da);
+		b.StoreD3D(db);
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				ASSERT_EQUALS_EPSILON(da.m[i][j], db.m[i][j], 0.001f);
+				ASSERT_EQUALS(a.Get(i, j), da.m[i][j]);
+			}
+		}
+	}
+	void testColumnMajor()
+	{
+		typedef FastMatrix4T<MatrixRowMajor> RowMatrix;
+		typedef FastMatrix4T<MatrixColumnMajor> ColMatrix;
+
+		float mat[4][4] = {1.0f, 2.0f, 3.0f, 4.0f,
+			5.0f, 6.0f, 7.0f, 8.0f,
+			-1.0f, 0.5f, 2.0f, -3.0f,
+			0.25f, -2.0f, 1.0f, 1.0f};
+		RowMatrix rowGeneral(mat);
+		ColMatrix colGeneral(mat);
+		AssertSameMatrix(rowGeneral, colGeneral);
+
+		FastVector3 axis(1.0f, -2.0f, 0.5f);
+		axis.Normalize(SIMD_PRECISE);
+		FastQuaternion q(axis, 1.1f);
+		FastVector3 t(3.0f, -4.0f, 5.0f);
+
+		RowMatrix rowTemp, rowRigid;
+		ColMatrix colTemp, colRigid;
+		rowRigid.CreateTranslation(t);
+		colRigid.CreateTranslation(t);
+		AssertSameMatrix(rowRigid, colRigid);
+		rowTemp.CreateFromQuaternion(q);
+		colTemp.CreateFromQuaternion(q);
+		AssertSameMatrix(rowTemp, colTemp);
+		rowRigid.Multiply(rowTemp);
+		colRigid.Multiply(colTemp);
+		AssertSameMatrix(rowRigid, colRigid);
+
+		rowTemp.CreateRotationX(0.7f);
+		colTemp.CreateRotationX(0.7f);
+		AssertSameMatrix(rowTemp, colTemp);
+		rowTemp.CreateRotationY(-1.3f);
+		colTemp.CreateRotationY(-1.3f);
+		AssertSameMatrix(rowTemp, colTemp);
+		rowTemp.CreateRotationZ(2.1f);
+		colTemp.CreateRotationZ(2.1f);
+		AssertSameMatrix(rowTemp, colTemp);
+		rowTemp.CreateLookAt(t, FastVector3::Zero, FastVector3::UnitY);
+		colTemp.CreateLookAt(t, FastVector3::Zero, FastVector3::UnitY);
+		AssertSameMatrix(rowTemp, colTemp);
+		rowTemp.CreatePerspectiveFOV(1.2f, 1.5f, 0.1f, 100.0f);
+		colTemp.CreatePerspectiveFOV(1.2f, 1.5f, 0.1f, 100.0f);
+		AssertSameMatrix(rowTemp, colTemp);
+
+		RowMatrix rowInverse(rowGeneral);
+		ColMatrix colInverse(colGeneral);
+		rowInverse.Invert();
+		colInverse.Invert();
+		AssertSameMatrix(rowInverse, colInverse);
+		rowInverse = rowRigid;
+		colInverse = colRigid;
+		rowInverse.InvertAffine();
+		colInverse.InvertAffine();
+		AssertSameMatrix(rowInverse, colInverse);
+		rowInverse = rowRigid;
+		colInverse = colRigid;
+		rowInverse.InvertOrthonormal();
+		colInverse.InvertOrthonormal();
+		AssertSameMatrix(rowInverse, colInverse);
+		ASSERT_TEST_MESSAGE(colRigid.IsAffine() && colRigid.IsOrthonormal(), "Column major rigid transform should be affine and orthonormal.");
+		ASSERT_TEST_MESSAGE(!colGeneral.IsAffine(), "Column major general matrix shouldn't be affine.");
+
+		// Vectors, one at a time and 4 at a time
+		FastVector3 rowPoint(1.0f, 2.0f, 3.0f);
+		FastVector3 colPoint(1.0f, 2.0f, 3.0f);
+		rowPoint.Transform(rowRigid);
+		colPoint.Transform(colRigid);
+		ASSERT_EQUALS_EPSILON(rowPoint.GetX(), colPoint.GetX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(rowPoint.GetY(), colPoint.GetY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(rowPoint.GetZ(), colPoint.GetZ(), 0.001f);
+		rowPoint.TransformAsVector(rowGeneral);
+		colPoint.TransformAsVector(colGeneral);
+		ASSERT_EQUALS_EPSILON(rowPoint.GetX(), colPoint.GetX(), 0.01f);
+		ASSERT_EQUALS_EPSILON(rowPoint.GetY(), colPoint.GetY(), 0.01f);
+		ASSERT_EQUALS_EPSILON(rowPoint.GetZ(), colPoint.GetZ(), 0.01f);
+
+		Vector3x4 rowPacket(_mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f), _mm_set_ps1(-1.0f), _mm_set_ps1(0.5f));
+		Vector3x4 colPacket(rowPacket);
+		rowPacket.Transform(rowRigid);
+		colPacket.Transform(colRigid);
+		ASSERT_EQUALS_EPSILON(SimdGetW(rowPacket.x), SimdGetW(colPacket.x), 0.001f);
+		ASSERT_EQUALS_EPSILON(SimdGetZ(rowPacket.y), SimdGetZ(colPacket.y), 0.001f);
+
+		FastAffine3x4 fromRow(rowRigid);
+		FastAffine3x4 fromCol(colRigid);
+		for (int i = 0; i < 12; ++i)
+		{
+			ASSERT_EQUALS_EPSILON(fromRow.ToFloats()[i], fromCol.ToFloats()[i], 0.001f);
+		}
+		fromCol.ToMatrix4(colTemp);
+		AssertSameMatrix(rowRigid, colTemp);
+
+		// Batches at every SIMD level
+		const int kCount = 5;
+		RowMatrix* rowA = static_cast<RowMatrix*>(_mm_malloc(sizeof(RowMatrix) * kCount * 3, 16));
+		ColMatrix* colA = static_cast<ColMatrix*>(_mm_malloc(sizeof(ColMatrix) * kCount * 3, 16));
+		RowMatrix* rowOut = rowA + kCount;
+		ColMatrix* colOut = colA + kCount;
+		RowMatrix* rowBroadcast = rowA + kCount * 2;
+		ColMatrix* colBroadcast = colA + kCount * 2;
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+			for (int i = 0; i < kCount; ++i)
+			{
+				rowA[i].CreateRotationY(0.3f * i);
+				colA[i].CreateRotationY(0.3f * i);
+			}
+			RowMatrix::MultiplyBatch(rowA, rowA, rowOut, kCount);
+			ColMatrix::MultiplyBatch(colA, colA, colOut, kCount);
+			RowMatrix::MultiplyBroadcast(rowRigid, rowA, rowBroadcast, kCount);
+			ColMatrix::MultiplyBroadcast(colRigid, colA, colBroadcast, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				AssertSameMatrix(rowOut[i], colOut[i]);
+				AssertSameMatrix(rowBroadcast[i], colBroadcast[i]);
+			}
+
+			RowMatrix rowProduct(rowGeneral);
+			ColMatrix colProduct(colGeneral);
+			rowProduct.Multiply(rowRigid);
+			colProduct.Multiply(colRigid);
+			AssertSameMatrix(rowProduct, colProduct);
+		}
+		SetSimdLevel(hardware);
+		_mm_free(rowA);
+		_mm_free(colA);
+	}
+	void testTransformStrided()
+	{
+		// 19 vertices covers the 8 wide, 4 wide and padded paths. The buffer
+		// uses the VERTEX_P_N_S_T layout (16 floats, position then normal).
+		const int count = 19;
+		const int stride = 16;
+		float vertices[count * stride];
+		for (int i = 0; i < count * stride; ++i)
+		{
+			vertices[i] = float(i % 23) * 0.37f - 3.0f;
+		}
+
+		FastAffine3x4 transform, temp;
+		transform.CreateTranslation(FastVector3(1.0f, -2.0f, 3.0f));
+		temp.CreateFromQuaternion(FastQuaternion(FastVector3(0.0f, 0.6f, 0.8f), 0.7f));
+		transform.Multiply(temp);
+		temp.CreateScale(2.0f);
+		transform.Multiply(temp);
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+			for (int stream = 0; stream < 2; ++stream)
+			{
+				float result[count * stride];
+				memcpy(result, vertices, sizeof(result));
+				transform.TransformPoints(vertices, stride * sizeof(float), result, stride * sizeof(float), count, stream != 0);
+				transform.TransformNormals(vertices + 3, stride * sizeof(float), result + 3, stride * sizeof(float), count, stream != 0);
+
+				for (int i = 0; i < count; ++i)
+				{
+					const float* pIn = vertices + i * stride;
+					const float* pOut = result + i * stride;
+
+					FastVector3 point(pIn[0], pIn[1], pIn[2]);
+					point.Transform(transform);
+					ASSERT_EQUALS_EPSILON(point.GetX(), pOut[0], 0.001f);
+					ASSERT_EQUALS_EPSILON(point.GetY(), pOut[1], 0.001f);
+					ASSERT_EQUALS_EPSILON(point.GetZ(), pOut[2], 0.001f);
+
+					FastVector3 normal(pIn[3], pIn[4], pIn[5]);
+					normal.TransformAsVector(transform);
+					normal.Normalize();
+					ASSERT_EQUALS_EPSILON(normal.GetX(), pOut[3], 0.001f);
+					ASSERT_EQUALS_EPSILON(normal.GetY(), pOut[4], 0.001f);
+					ASSERT_EQUALS_EPSILON(normal.GetZ(), pOut[5], 0.001f);
+
+					// The rest of the vertex is left alone
+					for (int j = 6; j < stride; ++j)
+					{
+						ASSERT_EQUALS(pIn[j], pOut[j]);
+					}
+				}
+			}
+
+			// Packed and 16 byte aligned, the only output that's really streamed
+			float* packed = static_cast<float*>(_mm_malloc(count * 3 * sizeof(float), 16));
+			float* packedNormals = static_cast<float*>(_mm_malloc(count * 3 * sizeof(float), 16));
+			transform.TransformPoints(vertices, stride * sizeof(float), packed, 3 * sizeof(float), count, true);
+			transform.TransformNormals(vertices + 3, stride * sizeof(float), packedNormals, 3 * sizeof(float), count, true);
+			for (int i = 0; i < count; ++i)
+			{
+				const float* pIn = vertices + i * stride;
+				FastVector3 point(pIn[0], pIn[1], pIn[2]);
+				point.Transform(transform);
+				ASSERT_EQUALS_EPSILON(point.GetX(), packed[i * 3], 0.001f);
+				ASSERT_EQUALS_EPSILON(point.GetY(), packed[i * 3 + 1], 0.001f);
+				ASSERT_EQUALS_EPSILON(point.GetZ(), packed[i * 3 + 2], 0.001f);
+
+				FastVector3 normal(pIn[3], pIn[4], pIn[5]);
+				normal.TransformAsVector(transform);
+				normal.Normalize();
+				ASSERT_EQUALS_EPSILON(normal.GetX(), packedNormals[i * 3], 0.001f);
+				ASSERT_EQUALS_EPSILON(normal.GetY(), packedNormals[i * 3 + 1], 0.001f);
+				ASSERT_EQUALS_EPSILON(normal.GetZ(), packedNormals[i * 3 + 2], 0.001f);
+			}
+			_mm_free(packed);
+			_mm_free(packedNormals);
+
+			// In place, with the VERTEX_P_N_T stride
+			const int tightStride = 8;
+			float inPlace[count * tightStride];
+			memcpy(inPlace, vertices, sizeof(inPlace));
+			transform.TransformPoints(inPlace, tightStride * sizeof(float), inPlace, tightStride * sizeof(float), count);
+			for (int i = 0; i < count; ++i)
+			{
+				FastVector3 point(vertices[i * tightStride], vertices[i * tightStride + 1], vertices[i * tightStride + 2]);
+				point.Transform(transform);
+				ASSERT_EQUALS_EPSILON(point.GetX(), inPlace[i * tightStride], 0.001f);
+				ASSERT_EQUALS_EPSILON(point.GetY(), inPlace[i * tightStride + 1], 0.001f);
+				ASSERT_EQUALS_EPSILON(point.GetZ(), inPlace[i * tightStride + 2], 0.001f);
+				ASSERT_EQUALS(vertices[i * tightStride + 3], inPlace[i * tightStride + 3]);
+			}
+		}
+		SetSimdLevel(hardware);
+	}
+	void testSpecializedInverses()
+	{
+		// 11 covers the 8 wide, 4 wide and single paths
+		const int count = 11;
+		FastMatrix4 rigid[count], affine[count];
+		FastAffine3x4 transforms[count];
+		for (int m = 0; m < count; ++m)
+		{
+			FastVector3 axis(float(m) - 3.0f, 1.0f, 0.5f);
+			axis.Normalize();
+			FastMatrix4 temp;
+			rigid[m].CreateTranslation(FastVector3(float(m), 2.0f, -1.0f));
+			temp.CreateFromQuaternion(FastQuaternion(axis, 0.2f * m));
+			rigid[m].Multiply(temp);
+
+			affine[m] = rigid[m];
+			temp.CreateScale(0.5f + 0.25f * m);
+			affine[m].Multiply(temp);
+			transforms[m] = FastAffine3x4(affine[m]);
+		}
+
+		ASSERT_TEST_MESSAGE(rigid[3].IsOrthonormal(), "rotation + translation should be orthonormal");
+		ASSERT_TEST_MESSAGE(!affine[3].IsOrthonormal(), "scaled transform shouldn't be orthonormal");
+		ASSERT_TEST_MESSAGE(affine[3].IsAffine(), "TRS transform should be affine");
+
+		for (int m = 0; m < count; ++m)
+		{
+			FastMatrix4 expected = rigid[m];
+			expected.Invert();
+			FastMatrix4 result = rigid[m];
+			result.InvertOrthonormal();
+			checkMatrix(expected, result);
+
+			expected = affine[m];
+			expected.Invert();
+			result = affine[m];
+			result.InvertAffine();
+			checkMatrix(expected, result);
+		}
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+
+			FastAffine3x4 inverses[count];
+			FastAffine3x4::InvertMany(transforms, inverses, count);
+			for (int m = 0; m < count; ++m)
+			{
+				FastMatrix4 expected = affine[m];
+				expected.Invert();
+				FastMatrix4 result;
+				inverses[m].ToMatrix4(result);
+				checkMatrix(expected, result);
+			}
+		}
+		SetSimdLevel(hardware);
+	}
+	void testDecompose()
+	{
+		// 11 covers the 8 wide, 4 wide and single paths
+		const int count = 11;
+		FastVector3 translations[count], scales[count];
+		FastQuaternion rotations[count];
+		FastAffine3x4 transforms[count];
+		for (int m = 0; m < count; ++m)
+		{
+			// angles up to almost pi so every branch of the quaternion extraction runs
+			FastVector3 axis(float(m % 4) - 1.5f, float(m % 3), 1.0f);
+			axis.Normalize();
+			rotations[m] = FastQuaternion(axis, 0.3f * m);
+			translations[m] = FastVector3(float(m), -2.0f, 0.5f * m);
+			// every third one is mirrored
+			scales[m] = FastVector3(0.5f + 0.25f * m, 2.0f, (m % 3 == 0) ? -1.5f : 1.0f);
+			transforms[m].Compose(translations[m], rotations[m], scales[m]);
+		}
+
+		for (int m = 0; m < count; ++m)
+		{
+			// Compose matches scale, then rotate, then translate
+			FastMatrix4 expected, temp;
+			expected.CreateTranslation(translations[m]);
+			temp.CreateFromQuaternion(rotations[m]);
+			expected.Multiply(temp);
+			float scale[4][4] =
+			{
+				{ scales[m].GetX(), 0.0f, 0.0f, 0.0f },
+				{ 0.0f, scales[m].GetY(), 0.0f, 0.0f },
+				{ 0.0f, 0.0f, scales[m].GetZ(), 0.0f },
+				{ 0.0f, 0.0f, 0.0f, 1.0f },
+			};
+			temp.Set(scale);
+			expected.Multiply(temp);
+			FastMatrix4 result;
+			transforms[m].ToMatrix4(result);
+			checkMatrix(expected, result);
+
+			FastVector3 t, s;
+			FastQuaternion q;
+			transforms[m].Decompose(t, q, s);
+			checkTRS(translations[m], rotations[m], scales[m], t, q, s);
+
+			float rows[3][4];
+			memcpy(rows, transforms[m].ToFloats(), sizeof(rows));
+			SlowVector3 slowT, slowS;
+			SlowQuaternion slowQ;
+			SlowAffine3x4(rows).Decompose(slowT, slowQ, slowS);
+			ASSERT_EQUALS_EPSILON(s.GetX(), slowS.GetX(), 0.001f);
+			ASSERT_EQUALS_EPSILON(s.GetZ(), slowS.GetZ(), 0.001f);
+			ASSERT_EQUALS_EPSILON(fabsf(q.GetScalar()), fabsf(slowQ.GetScalar()), 0.001f);
+
+			// A mirror in x decomposes into a mirror in z plus a rotation,
+			// but composes back into the same transform
+			FastAffine3x4 mirrored;
+			mirrored.Compose(translations[m], rotations[m], FastVector3(-2.0f, 1.0f, 3.0f));
+			mirrored.Decompose(t, q, s);
+			ASSERT_EQUALS_EPSILON(-3.0f, s.GetZ(), 0.001f);
+			FastMatrix4 roundTrip;
+			roundTrip.Compose(t, q, s);
+			mirrored.ToMatrix4(expected);
+			checkMatrix(expected, roundTrip);
+		}
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+
+			FastVector3 t[count], s[count];
+			FastQuaternion q[count];
+			FastAffine3x4::DecomposeBatch(transforms, t, q, s, count);
+			for (int m = 0; m < count; ++m)
+			{
+				checkTRS(translations[m], rotations[m], scales[m], t[m], q[m], s[m]);
+			}
+
+			FastAffine3x4 composed[count];
+			FastAffine3x4::ComposeBatch(t, q, s, composed, count);
+			for (int m = 0; m < count; ++m)
+			{
+				FastMatrix4 expected, result;
+				transforms[m].ToMatrix4(expected);
+				composed[m].ToMatrix4(result);
+				checkMatrix(expected, result);
+			}
+		}
+		SetSimdLevel(hardware);
+	}
+	void checkTRS(const FastVector3& expectedT, const FastQuaternion& expectedQ, const FastVector3& expectedS,
+				  const FastVector3& t, const FastQuaternion& q, const FastVector3& s)
+	{
+		ASSERT_EQUALS_EPSILON(expectedT.GetX(), t.GetX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expectedT.GetY(), t.GetY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expectedT.GetZ(), t.GetZ(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expectedS.GetX(), s.GetX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expectedS.GetY(), s.GetY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expectedS.GetZ(), s.GetZ(), 0.001f);
+
+		// q and -q are the same rotation
+		float sign = (q.GetScalar() * expectedQ.GetScalar() < 0.0f) ? -1.0f : 1.0f;
+		ASSERT_EQUALS_EPSILON(expectedQ.GetVectorX(), sign * q.GetVectorX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expectedQ.GetVectorY(), sign * q.GetVectorY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expectedQ.GetVectorZ(), sign * q.GetVectorZ(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expectedQ.GetScalar(), sign * q.GetScalar(), 0.001f);
+	}
+	void checkMatrix(FastMatrix4& expected, FastMatrix4& actual)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				ASSERT_EQUALS_EPSILON(expected.ToD3D()->m[i][j], actual.ToD3D()->m[i][j], 0.001f);
+			}
+		}
+	}
 	void testMatrixAdd()
 	{
 		FastVector3 v(1.0f, 1.0f, 1.0f);
@@ -378,6 +1084,138 @@ public:
 		TEST_CASE_DESCRIBE(testMatrix, "Create a matrix from a quaternion, and apply to vector");
 		TEST_CASE_DESCRIBE(testLerp, "Lerp");
 		TEST_CASE_DESCRIBE(testBlend, "4-Way Blend");
+		TEST_CASE_DESCRIBE(testSlerp, "Slerp/NLerp match SlowQuaternion, including the short way around");
+		TEST_CASE_DESCRIBE(testFromMatrix, "Quaternion -> matrix -> quaternion");
+		TEST_CASE_DESCRIBE(testBatches, "NormalizeBatch/MultiplyBatch/SlerpBatch at every SIMD level");
+	}
+	static const int kCount = 11;
+	// Pairs of unit quaternions, some more than 180 degrees apart and one nearly equal
+	void makePairs(FastQuaternion* a, FastQuaternion* b, SlowQuaternion* slowA, SlowQuaternion* slowB)
+	{
+		for (int i = 0; i < kCount; ++i)
+		{
+			float f = float(i);
+			FastVector3 axis(0.3f * f - 1.0f, 1.0f, 0.1f * f);
+			axis.Normalize();
+			a[i] = FastQuaternion(axis, 0.4f * f - 2.0f);
+			b[i] = FastQuaternion(FastVector3::UnitY, (i == 5) ? 0.0f : 0.7f * f + 2.5f);
+			if (i == 3)
+			{
+				b[i] = a[i];
+				b[i].Multiply(FastQuaternion(FastVector3::UnitX, 0.001f));
+			}
+			slowA[i].Set(a[i].GetVectorX(), a[i].GetVectorY(), a[i].GetVectorZ(), a[i].GetScalar());
+			slowB[i].Set(b[i].GetVectorX(), b[i].GetVectorY(), b[i].GetVectorZ(), b[i].GetScalar());
+		}
+	}
+	void checkQuaternion(const SlowQuaternion& expected, const FastQuaternion& actual)
+	{
+		ASSERT_EQUALS_EPSILON(expected.GetVectorX(), actual.GetVectorX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetVectorY(), actual.GetVectorY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetVectorZ(), actual.GetVectorZ(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetScalar(), actual.GetScalar(), 0.001f);
+	}
+	void testSlerp()
+	{
+		FastQuaternion a[kCount], b[kCount];
+		SlowQuaternion slowA[kCount], slowB[kCount];
+		makePairs(a, b, slowA, slowB);
+
+		for (int i = 0; i < kCount; ++i)
+		{
+			for (float f = 0.0f; f <= 1.0f; f += 0.125f)
+			{
+				FastQuaternion result = Slerp(a[i], b[i], f);
+				checkQuaternion(Slerp(slowA[i], slowB[i], f), result);
+				ASSERT_EQUALS_EPSILON(1.0f, result.Length(), 0.0001f);
+
+				result = NLerp(a[i], b[i], f);
+				checkQuaternion(NLerp(slowA[i], slowB[i], f), result);
+				ASSERT_EQUALS_EPSILON(1.0f, result.Length(), 0.0001f);
+			}
+		}
+
+		// 90 degrees about z, slerp should be at exactly 22.5 degrees a quarter of the way there
+		FastQuaternion result = Slerp(FastQuaternion::Identity, FastQuaternion(FastVector3::UnitZ, PiOver2), 0.25f);
+		ASSERT_EQUALS_EPSILON(sinf(Pi / 16.0f), result.GetVectorZ(), 0.0001f);
+		ASSERT_EQUALS_EPSILON(cosf(Pi / 16.0f), result.GetScalar(), 0.0001f);
+	}
+	void testFromMatrix()
+	{
+		FastQuaternion a[kCount], b[kCount];
+		SlowQuaternion slowA[kCount], slowB[kCount];
+		makePairs(a, b, slowA, slowB);
+
+		for (int i = 0; i < kCount; ++i)
+		{
+			FastAffine3x4 mat;
+			mat.CreateFromQuaternion(a[i], FastVector3(1.0f, 2.0f, 3.0f));
+			FastQuaternion result;
+			result.CreateFromMatrix(mat);
+
+			// q and -q are the same rotation
+			float sign = (result.GetScalar() * a[i].GetScalar() < 0.0f) ? -1.0f : 1.0f;
+			ASSERT_EQUALS_EPSILON(a[i].GetVectorX(), sign * result.GetVectorX(), 0.001f);
+			ASSERT_EQUALS_EPSILON(a[i].GetVectorY(), sign * result.GetVectorY(), 0.001f);
+			ASSERT_EQUALS_EPSILON(a[i].GetVectorZ(), sign * result.GetVectorZ(), 0.001f);
+			ASSERT_EQUALS_EPSILON(a[i].GetScalar(), sign * result.GetScalar(), 0.001f);
+
+			SlowAffine3x4 slowMat;
+			slowMat.CreateFromQuaternion(slowA[i], SlowVector3(1.0f, 2.0f, 3.0f));
+			SlowQuaternion slowResult;
+			slowResult.CreateFromMatrix(slowMat);
+			ASSERT_EQUALS_EPSILON(slowResult.GetVectorX(), result.GetVectorX(), 0.001f);
+			ASSERT_EQUALS_EPSILON(slowResult.GetScalar(), result.GetScalar(), 0.001f);
+			ASSERT_EQUALS_EPSILON(3.0f, mat.ToFloats()[11], 0.001f);
+		}
+	}
+	void testBatches()
+	{
+		FastQuaternion a[kCount], b[kCount];
+		SlowQuaternion slowA[kCount], slowB[kCount];
+		makePairs(a, b, slowA, slowB);
+
+		float f[kCount];
+		FastQuaternion scaled[kCount];
+		for (int i = 0; i < kCount; ++i)
+		{
+			f[i] = float(i) / float(kCount - 1);
+			scaled[i] = FastQuaternion(a[i].GetVectorX() * 3.0f, a[i].GetVectorY() * 3.0f,
+									   a[i].GetVectorZ() * 3.0f, a[i].GetScalar() * 3.0f);
+		}
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+			FastQuaternion result[kCount];
+
+			FastQuaternion::NormalizeBatch(scaled, result, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				checkQuaternion(slowA[i], result[i]);
+			}
+
+			FastQuaternion::MultiplyBatch(a, b, result, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				SlowQuaternion expected(slowA[i]);
+				expected.Multiply(slowB[i]);
+				checkQuaternion(expected, result[i]);
+			}
+
+			// in place, like the animation sampler
+			for (int i = 0; i < kCount; ++i)
+			{
+				result[i] = a[i];
+			}
+			FastQuaternion::SlerpBatch(result, b, f, result, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				checkQuaternion(Slerp(slowA[i], slowB[i], f[i]), result[i]);
+			}
+		}
+		SetSimdLevel(hardware);
 	}
 	void testConstructor()
 	{
@@ -492,150 +1330,856 @@ public:
 	}
 };
 
-class SlowVector3Test : public TestFixture<SlowVector3Test>
+class SoAMathTest : public TestFixture<SoAMathTest>
 {
 public:
-	void PrintVector3(const SlowVector3& data)
+	static const int kCount = 11;
+
+	TEST_FIXTURE_DESCRIBE(SoAMathTest, "Testing SoA packets...")
 	{
-		printf("<%f, %f, %f>\n", data.GetX(), data.GetY(), data.GetZ());
+		TEST_CASE_DESCRIBE(testVector3x4, "Vector3x4 matches FastVector3 (gather, ops, scatter)");
+		TEST_CASE_DESCRIBE(testQuaternionx4, "Quaternionx4 matches FastQuaternion");
+		TEST_CASE_DESCRIBE(testPackets8, "Vector3x8/Quaternionx8 match FastVector3/FastQuaternion (AVX2 only)");
 	}
-
-	TEST_FIXTURE_DESCRIBE(SlowVector3Test, "Testing SlowVector3...")
+	void setUp()
 	{
-		TEST_CASE_DESCRIBE(testConstructorGettersSetters, "Getters/Setters");
-		TEST_CASE_DESCRIBE(testNormalize, "Normalize");
-		TEST_CASE_DESCRIBE(testDotProduct, "Dot Product");
-		TEST_CASE_DESCRIBE(testAdd, "Addition");
-		TEST_CASE_DESCRIBE(testSub, "Subtraction");
-		TEST_CASE_DESCRIBE(testLengthSquared, "Length Squared");
-		TEST_CASE_DESCRIBE(testLength, "Length");
-		TEST_CASE_DESCRIBE(testCross, "Cross Product");
-		TEST_CASE_DESCRIBE(testLerp, "Linear Interpolation");
-		TEST_CASE_DESCRIBE(testBlend, "4-Way Blend");
+		for (int i = 0; i < kCount; ++i)
+		{
+			float f = float(i);
+			m_Vectors[i].Set(f - 5.0f, 0.5f * f + 1.0f, 3.0f - 0.25f * f * f);
+			m_Others[i].Set(1.0f - f, 2.0f, 0.5f * f);
+			FastVector3 axis(0.3f * f - 1.0f, 1.0f, 0.1f * f);
+			axis.Normalize();
+			m_Quats[i] = FastQuaternion(axis, 0.4f * f - 2.0f);
+			m_OtherQuats[i] = FastQuaternion(FastVector3::UnitY, 0.25f * f);
+		}
+		FastMatrix4 rot;
+		rot.CreateFromQuaternion(m_Quats[3]);
+		m_Matrix.CreateTranslation(FastVector3(1.0f, -2.0f, 3.0f));
+		m_Matrix.Multiply(rot);
 	}
-	void testConstructorGettersSetters()
+	void checkVector(const FastVector3& expected, const FastVector3& actual)
 	{
-		SlowVector3 v(1.0f, 2.0f, 3.0f);
-		ASSERT_EQUALS(1.0f, v.GetX());
-		ASSERT_EQUALS(2.0f, v.GetY());
-		ASSERT_EQUALS(3.0f, v.GetZ());
-
-		v.SetX(2.0f);
-		v.SetY(4.0f);
-		v.SetZ(6.0f);
-		ASSERT_EQUALS(2.0f, v.GetX());
-		ASSERT_EQUALS(4.0f, v.GetY());
-		ASSERT_EQUALS(6.0f, v.GetZ());
+		ASSERT_EQUALS_EPSILON(expected.GetX(), actual.GetX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetY(), actual.GetY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetZ(), actual.GetZ(), 0.001f);
+	}
+	void checkQuaternion(const FastQuaternion& expected, const FastQuaternion& actual)
+	{
+		ASSERT_EQUALS_EPSILON(expected.GetVectorX(), actual.GetVectorX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetVectorY(), actual.GetVectorY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetVectorZ(), actual.GetVectorZ(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetScalar(), actual.GetScalar(), 0.001f);
+	}
+	// Runs the scalar version of every vector op the packet tests do
+	void expectedVectors(FastVector3* cross, FastVector3* lerp, FastVector3* rotated, FastVector3* transformed, float* dots)
+	{
+		for (int i = 0; i < kCount; ++i)
+		{
+			dots[i] = m_Vectors[i].Dot(m_Others[i]);
+			cross[i] = Cross(m_Vectors[i], m_Others[i]);
+			lerp[i] = Lerp(m_Vectors[i], m_Others[i], 0.25f);
+			rotated[i] = m_Vectors[i];
+			rotated[i].Rotate(m_Quats[i]);
+			transformed[i] = m_Vectors[i];
+			transformed[i].Transform(m_Matrix);
+		}
+	}
+	void testVector3x4()
+	{
+		FastVector3 cross[kCount], lerp[kCount], rotated[kCount], transformed[kCount];
+		float dots[kCount];
+		expectedVectors(cross, lerp, rotated, transformed, dots);
 
-		v.Set(3.0f, 5.0f, 7.0f);
-		ASSERT_EQUALS(3.0f, v.GetX());
-		ASSERT_EQUALS(5.0f, v.GetY());
-		ASSERT_EQUALS(7.0f, v.GetZ());
+		// kCount isn't a multiple of 4, so the last packet is partial
+		FastVector3 result[kCount];
+		for (int i = 0; i < kCount; i += 4)
+		{
+			int count = (kCount - i < 4) ? kCount - i : 4;
+			Vector3x4 a = Vector3x4::Gather(m_Vectors + i, count);
+			Vector3x4 b = Vector3x4::Gather(m_Others + i, count);
+			Quaternionx4 q = Quaternionx4::Gather(m_Quats + i, count);
+
+			SIMD_ALIGN(16) float dot[4];
+			_mm_store_ps(dot, a.Dot(b));
+
+			Cross(a, b).Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				ASSERT_EQUALS_EPSILON(dots[i + j], dot[j], 0.001f);
+				checkVector(cross[i + j], result[i + j]);
+			}
+
+			Lerp(a, b, 0.25f).Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				checkVector(lerp[i + j], result[i + j]);
+			}
+
+			Vector3x4 temp = a;
+			temp.Rotate(q);
+			temp.Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				checkVector(rotated[i + j], result[i + j]);
+			}
+
+			temp = a;
+			temp.Transform(m_Matrix);
+			temp.Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				checkVector(transformed[i + j], result[i + j]);
+			}
+
+			temp = a;
+			temp.Normalize();
+			temp.Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				ASSERT_EQUALS_EPSILON(1.0f, result[i + j].Length(), 0.001f);
+				ASSERT_EQUALS_EPSILON(1.0f, result[i + j].GetW(), 0.001f);
+			}
+		}
 	}
-	void testNormalize()
+	void testQuaternionx4()
 	{
-		SlowVector3 v(0.0f, 3.0f, 4.0f);
-		v.Normalize();
-		ASSERT_EQUALS_EPSILON(0.0f, v.GetX(), 0.01f);
-		ASSERT_EQUALS_EPSILON(0.6f, v.GetY(), 0.01f);
-		ASSERT_EQUALS_EPSILON(0.8f, v.GetZ(), 0.01f);
+		FastQuaternion result[kCount];
+		for (int i = 0; i < kCount; i += 4)
+		{
+			int count = (kCount - i < 4) ? kCount - i : 4;
+			Quaternionx4 a = Quaternionx4::Gather(m_Quats + i, count);
+			Quaternionx4 b = Quaternionx4::Gather(m_OtherQuats + i, count);
+
+			Quaternionx4 product = a;
+			product.Multiply(b);
+			product.Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				FastQuaternion expected = m_Quats[i + j];
+				expected.Multiply(m_OtherQuats[i + j]);
+				checkQuaternion(expected, result[i + j]);
+			}
+
+			Lerp(a, b, 0.3f).Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				checkQuaternion(Lerp(m_Quats[i + j], m_OtherQuats[i + j], 0.3f), result[i + j]);
+			}
+		}
 	}
-	void testDotProduct()
+	void testPackets8()
 	{
-		SlowVector3 v(2.0f, 4.0f, 6.0f);
-		ASSERT_EQUALS_EPSILON(56.0f, v.Dot(v), 0.01f);
+		if (GetSimdLevel() < SIMD_AVX2)
+		{
+			return;
+		}
+		runPackets8();
 	}
-	void testAdd()
+	// Kept separate so no AVX instruction can run before the level check
+	SIMD_TARGET_AVX2 void runPackets8()
 	{
-		SlowVector3 v1(1.0f, 2.0f, 3.0f);
-		SlowVector3 v2(2.0f, 4.0f, 6.0f);
-		v1.Add(v2);
-		ASSERT_EQUALS_EPSILON(3.0f, v1.GetX(), 0.01f);
-		ASSERT_EQUALS_EPSILON(6.0f, v1.GetY(), 0.01f);
-		ASSERT_EQUALS_EPSILON(9.0f, v1.GetZ(), 0.01f);
+		FastVector3 cross[kCount], lerp[kCount], rotated[kCount], transformed[kCount];
+		float dots[kCount];
+		expectedVectors(cross, lerp, rotated, transformed, dots);
+
+		FastVector3 result[kCount];
+		FastQuaternion quatResult[kCount];
+		for (int i = 0; i < kCount; i += 8)
+		{
+			int count = (kCount - i < 8) ? kCount - i : 8;
+			Vector3x8 a = Vector3x8::Gather(m_Vectors + i, count);
+			Vector3x8 b = Vector3x8::Gather(m_Others + i, count);
+			Quaternionx8 q = Quaternionx8::Gather(m_Quats + i, count);
+			Quaternionx8 q2 = Quaternionx8::Gather(m_OtherQuats + i, count);
+
+			SIMD_ALIGN(32) float dot[8];
+			_mm256_store_ps(dot, a.Dot(b));
+
+			Cross(a, b).Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				ASSERT_EQUALS_EPSILON(dots[i + j], dot[j], 0.001f);
+				checkVector(cross[i + j], result[i + j]);
+			}
+
+			Lerp(a, b, 0.25f).Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				checkVector(lerp[i + j], result[i + j]);
+			}
+
+			Vector3x8 temp = a;
+			temp.Rotate(q);
+			temp.Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				checkVector(rotated[i + j], result[i + j]);
+			}
+
+			temp = a;
+			temp.Transform(m_Matrix);
+			temp.Scatter(result + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				checkVector(transformed[i + j], result[i + j]);
+			}
+
+			Quaternionx8 product = q;
+			product.Multiply(q2);
+			product.Scatter(quatResult + i, count);
+			for (int j = 0; j < count; ++j)
+			{
+				FastQuaternion expected = m_Quats[i + j];
+				expected.Multiply(m_OtherQuats[i + j]);
+				checkQuaternion(expected, quatResult[i + j]);
+			}
+		}
 	}
-	void testSub()
+private:
+	FastVector3 m_Vectors[kCount];
+	FastVector3 m_Others[kCount];
+	FastQuaternion m_Quats[kCount];
+	FastQuaternion m_OtherQuats[kCount];
+	FastMatrix4 m_Matrix;
+};
+
+class BoundsTest : public TestFixture<BoundsTest>
+{
+public:
+	TEST_FIXTURE_DESCRIBE(BoundsTest, "Testing bounds and frustum culling...")
 	{
-		SlowVector3 v1(1.0f, 2.0f, 3.0f);
-		SlowVector3 v2(2.0f, 4.0f, 6.0f);
-		v1.Sub(v2);
-		ASSERT_EQUALS_EPSILON(-1.0f, v1.GetX(), 0.01f);
-		ASSERT_EQUALS_EPSILON(-2.0f, v1.GetY(), 0.01f);
-		ASSERT_EQUALS_EPSILON(-3.0f, v1.GetZ(), 0.01f);
+		TEST_CASE_DESCRIBE(testExtract, "Frustum planes from a view projection matrix");
+		TEST_CASE_DESCRIBE(testClassify, "Classify single boxes and spheres");
+		TEST_CASE_DESCRIBE(testBatch, "Batch tests match the single tests at every SIMD level");
+		TEST_CASE_DESCRIBE(testTransform, "Aabb::Transform encloses the transformed corners");
 	}
-	void testLengthSquared()
+	void setUp()
 	{
-		SlowVector3 v(3.0f, 1.0f, 4.0f);
-		ASSERT_EQUALS_EPSILON(26.0f, v.LengthSquared(), 0.01f);
+		// Looking down +z from (0, 0, -10), 90 degree fov, near 1, far 100
+		FastMatrix4 view, proj;
+		view.CreateLookAt(FastVector3(0.0f, 0.0f, -10.0f), FastVector3::Zero, FastVector3::UnitY);
+		proj.CreatePerspectiveFOV(Pi / 2.0f, 1.0f, 1.0f, 100.0f);
+		proj.Multiply(view);
+		D3DMATRIX viewProj;
+		proj.StoreD3D(viewProj);
+		m_Frustum.Extract(viewProj);
 	}
-	void testLength()
+	void testExtract()
 	{
-		SlowVector3 v(3.0f, 0.0f, 4.0f);
-		ASSERT_EQUALS_EPSILON(5.0f, v.Length(), 0.01f);
+		ASSERT_EQUALS_EPSILON(9.0f, m_Frustum.GetPlane(Frustum::PLANE_NEAR).Distance(0.0f, 0.0f, 0.0f), 0.001f);
+		ASSERT_EQUALS_EPSILON(90.0f, m_Frustum.GetPlane(Frustum::PLANE_FAR).Distance(0.0f, 0.0f, 0.0f), 0.001f);
+
+		// The side planes go through the eye at 45 degrees
+		const float halfSqrt2 = 0.70710678f;
+		for (int i = Frustum::PLANE_LEFT; i <= Frustum::PLANE_TOP; ++i)
+		{
+			const Plane& plane = m_Frustum.GetPlane(i);
+			ASSERT_EQUALS_EPSILON(0.0f, plane.Distance(0.0f, 0.0f, -10.0f), 0.001f);
+			ASSERT_EQUALS_EPSILON(halfSqrt2 * 10.0f, plane.Distance(0.0f, 0.0f, 0.0f), 0.001f);
+		}
 	}
-	void testCross()
+	void testClassify()
 	{
-		SlowVector3 v1(3.0f, 2.0f, 5.0f);
-		SlowVector3 v2(4.0f, 6.0f, 1.0f);
-		SlowVector3 v3 = Cross(v1, v2);
-		ASSERT_EQUALS_EPSILON(-28.0f, v3.GetX(), 0.01f);
-		ASSERT_EQUALS_EPSILON(17.0f, v3.GetY(), 0.01f);
-		ASSERT_EQUALS_EPSILON(10.0f, v3.GetZ(), 0.01f);
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Aabb(-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f)) == CULL_INSIDE, "Box at the origin should be inside");
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Aabb(-1.0f, -1.0f, -21.0f, 1.0f, 1.0f, -19.0f)) == CULL_OUTSIDE, "Box behind the eye should be outside");
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Aabb(-1.0f, -1.0f, 199.0f, 1.0f, 1.0f, 201.0f)) == CULL_OUTSIDE, "Box past the far plane should be outside");
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Aabb(49.0f, -1.0f, -1.0f, 51.0f, 1.0f, 1.0f)) == CULL_OUTSIDE, "Box off to the side should be outside");
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Aabb(-1.0f, -1.0f, -12.0f, 1.0f, 1.0f, -8.0f)) == CULL_INTERSECTING, "Box across the near plane should intersect");
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Aabb(5.0f, -1.0f, -1.0f, 15.0f, 1.0f, 1.0f)) == CULL_INTERSECTING, "Box across a side plane should intersect");
+
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Sphere(0.0f, 0.0f, 0.0f, 1.0f)) == CULL_INSIDE, "Sphere at the origin should be inside");
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Sphere(0.0f, 0.0f, -20.0f, 1.0f)) == CULL_OUTSIDE, "Sphere behind the eye should be outside");
+		ASSERT_TEST_MESSAGE(m_Frustum.Classify(Sphere(0.0f, 0.0f, 90.0f, 1.0f)) == CULL_INTERSECTING, "Sphere on the far plane should intersect");
 	}
-	void testLerp()
+	void testBatch()
 	{
-		SlowVector3 v1(1.0f, 10.0f, 100.0f);
-		SlowVector3 v2(0.0f, 0.0f, 0.0f);
-		SlowVector3 v3 = Lerp(v1, v2, 0.75f);
-		ASSERT_EQUALS_EPSILON(0.25f, v3.GetX(), 0.01f);
-		ASSERT_EQUALS_EPSILON(2.5f, v3.GetY(), 0.01f);
-		ASSERT_EQUALS_EPSILON(25.0f, v3.GetZ(), 0.01f);
+		// A grid of bounds around the frustum, some in, some out, some on the edges
+		Aabb boxes[kCount];
+		Sphere spheres[kCount];
+		AabbBatch boxBatch;
+		SphereBatch sphereBatch;
+		for (int i = 0; i < kCount; ++i)
+		{
+			float x = float(i % 4) * 12.0f - 18.0f;
+			float z = float(i / 4) * 40.0f - 25.0f;
+			float size = 1.0f + float(i % 3) * 2.0f;
+			boxes[i] = Aabb(x - size, -size, z - size * 0.5f, x + size, size, z + size * 0.5f);
+			spheres[i] = Sphere(x, float(i % 2) * 5.0f, z, size);
+			boxBatch.Set(i, boxes[i]);
+			sphereBatch.Set(i, spheres[i]);
+		}
+
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+
+			// 11 makes the last group of lanes partial
+			const int counts[] = { kCount, 11 };
+			for (int c = 0; c < 2; ++c)
+			{
+				int count = counts[c];
+				CullResult boxResults[kCount], sphereResults[kCount];
+				m_Frustum.Classify(boxBatch, count, boxResults);
+				m_Frustum.Classify(sphereBatch, count, sphereResults);
+				unsigned int boxVisible = m_Frustum.TestVisible(boxBatch, count);
+				unsigned int sphereVisible = m_Frustum.TestVisible(sphereBatch, count);
+				ASSERT_TEST_MESSAGE((boxVisible >> count) == 0, "Visible mask has bits past count");
+
+				for (int i = 0; i < count; ++i)
+				{
+					CullResult box = m_Frustum.Classify(boxes[i]);
+					CullResult sphere = m_Frustum.Classify(spheres[i]);
+					ASSERT_TEST_MESSAGE(box == boxResults[i], "Batch box result doesn't match");
+					ASSERT_TEST_MESSAGE(sphere == sphereResults[i], "Batch sphere result doesn't match");
+					ASSERT_TEST_MESSAGE(((boxVisible >> i) & 1) == (box != CULL_OUTSIDE ? 1u : 0u), "Box visible bit doesn't match");
+					ASSERT_TEST_MESSAGE(((sphereVisible >> i) & 1) == (sphere != CULL_OUTSIDE ? 1u : 0u), "Sphere visible bit doesn't match");
+				}
+			}
+		}
+		SetSimdLevel(hardware);
 	}
-	void testBlend()
+	void testTransform()
 	{
-		SlowVector3 v1(1.0f, 1.0f, 1.0f);
-		SlowVector3 v2(4.0f, 4.0f, 4.0f);
-		SlowVector3 v3(8.0f, 8.0f, 8.0f);
-		SlowVector3 v4(16.0f, 16.0f, 16.0f);
+		FastAffine3x4 transform, temp;
+		transform.CreateTranslation(FastVector3(1.0f, -2.0f, 3.0f));
+		temp.CreateFromQuaternion(FastQuaternion(FastVector3(0.0f, 0.6f, 0.8f), 0.7f));
+		transform.Multiply(temp);
+		temp.CreateScale(2.0f);
+		transform.Multiply(temp);
 
-		SlowVector3 vBlendResult = Blend(v1, v2, v3, v4, 0.25f, 0.25f, 0.25f);
-		ASSERT_EQUALS_EPSILON(7.25f, vBlendResult.GetX(), 0.01f);
-		ASSERT_EQUALS_EPSILON(7.25f, vBlendResult.GetY(), 0.01f);
-		ASSERT_EQUALS_EPSILON(7.25f, vBlendResult.GetZ(), 0.01f);
+		Aabb box(-1.0f, 0.0f, 2.0f, 3.0f, 1.0f, 5.0f);
+		Aabb world = box;
+		world.Transform(transform.ToFloats());
+
+		// The result should be the tightest box around the 8 transformed corners
+		float minCorner[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maxCorner[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (int i = 0; i < 8; ++i)
+		{
+			FastVector3 corner(box.GetCenterX() + ((i & 1) ? box.GetExtentX() : -box.GetExtentX()),
+							   box.GetCenterY() + ((i & 2) ? box.GetExtentY() : -box.GetExtentY()),
+							   box.GetCenterZ() + ((i & 4) ? box.GetExtentZ() : -box.GetExtentZ()));
+			corner.Transform(transform);
+			float coords[3] = { corner.GetX(), corner.GetY(), corner.GetZ() };
+			for (int j = 0; j < 3; ++j)
+			{
+				minCorner[j] = std::min(minCorner[j], coords[j]);
+				maxCorner[j] = std::max(maxCorner[j], coords[j]);
+			}
+		}
+		ASSERT_EQUALS_EPSILON(0.5f * (minCorner[0] + maxCorner[0]), world.GetCenterX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(0.5f * (minCorner[1] + maxCorner[1]), world.GetCenterY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(0.5f * (minCorner[2] + maxCorner[2]), world.GetCenterZ(), 0.001f);
+		ASSERT_EQUALS_EPSILON(0.5f * (maxCorner[0] - minCorner[0]), world.GetExtentX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(0.5f * (maxCorner[1] - minCorner[1]), world.GetExtentY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(0.5f * (maxCorner[2] - minCorner[2]), world.GetExtentZ(), 0.001f);
 	}
+private:
+	static const int kCount = AabbBatch::kCapacity;
+	Frustum m_Frustum;
 };
 
-class SlowMatrix4Test : public TestFixture<SlowMatrix4Test>
+class DualQuaternionTest : public TestFixture<DualQuaternionTest>
 {
 public:
-	void PrintVector3(const SlowVector3& data)
+	// covers the 8 wide, 4 wide and single paths
+	static const int kCount = 11;
+
+	TEST_FIXTURE_DESCRIBE(DualQuaternionTest, "Testing FastDualQuaternion...")
 	{
-		printf("<%f, %f, %f>\n", data.GetX(), data.GetY(), data.GetZ());
+		TEST_CASE_DESCRIBE(testConversions, "Rotation/translation and affine round trips");
+		TEST_CASE_DESCRIBE(testMultiply, "Multiply and TransformPoint match FastAffine3x4");
+		TEST_CASE_DESCRIBE(testBlend, "Blend takes the short way and stays rigid");
+		TEST_CASE_DESCRIBE(testBatch, "CreateFromAffineBatch matches CreateFromAffine at every SIMD level");
 	}
-
-	TEST_FIXTURE_DESCRIBE(SlowMatrix4Test, "Testing SlowMatrix4...")
+	void setUp()
 	{
-		TEST_CASE_DESCRIBE(testVectorTransform, "Transform a vector (as a position) by a matrix");
-		TEST_CASE_DESCRIBE(testVectorTransformX2, "Transform a vector (as a position) by a matrix and back");
-		TEST_CASE_DESCRIBE(testVectorTransformAsVector, "Transform a vector (as a vector) by a matrix");
-		TEST_CASE_DESCRIBE(testMatrixMult, "Multiply two matrices together (then apply to vector)");
-		TEST_CASE_DESCRIBE(testMatrixAdd, "Add two matrices together (then apply to vector)");
-		TEST_CASE_DESCRIBE(testMatrixSub, "Subtract two matrices together (then apply to vector)");
-		TEST_CASE_DESCRIBE(testMatrixScale, "Creates scale matrix (then apply to vector)");
-		TEST_CASE_DESCRIBE(testMatrixRotateX, "Creates rotate X matrix (then apply to vector)");
-		TEST_CASE_DESCRIBE(testMatrixRotateY, "Creates rotate Y matrix (then apply to vector)");
-		TEST_CASE_DESCRIBE(testMatrixRotateZ, "Creates rotate Z matrix (then apply to vector)");
-		TEST_CASE_DESCRIBE(testMatrixTranslate, "Creates translate matrix (then apply to vector)");
-		TEST_CASE_DESCRIBE(testMatrixInvert, "Inverts the matrix");
+		for (int i = 0; i < kCount; ++i)
+		{
+			// angles up to almost 2 pi so every branch of the quaternion extraction runs
+			FastVector3 axis(float(i % 3) - 1.0f, 1.0f, float(i % 4) * 0.5f);
+			axis.Normalize();
+			m_Rotations[i] = FastQuaternion(axis, 0.55f * i);
+			m_Translations[i] = FastVector3(float(i), -3.0f, 0.25f * i);
+			m_Transforms[i].CreateFromQuaternion(m_Rotations[i], m_Translations[i]);
+		}
 	}
-	void testVectorTransform()
+	void testConversions()
 	{
-		SlowVector3 v(SlowVector3::Zero);
-		float trans[4][4] = {1.0f, 0.0f, 0.0f, -5.0f,
-			0.0f, 1.0f, 0.0f, -10.0f,
-			0.0f, 0.0f, 1.0f, 4.0f,
-			0.0f, 0.0f, 0.0f, 1.0f};
-		SlowMatrix4 translate(trans);
+		for (int i = 0; i < kCount; ++i)
+		{
+			FastDualQuaternion dq(m_Rotations[i], m_Translations[i]);
+			checkVector(m_Translations[i], dq.GetTranslation());
+
+			FastAffine3x4 result;
+			dq.ToAffine(result);
+			checkAffine(m_Transforms[i], result);
+
+			FastDualQuaternion fromAffine(m_Transforms[i]);
+			fromAffine.ToAffine(result);
+			checkAffine(m_Transforms[i], result);
+			checkVector(m_Translations[i], fromAffine.GetTranslation());
+		}
+
+		FastAffine3x4 identity;
+		FastDualQuaternion::Identity.ToAffine(identity);
+		checkAffine(FastAffine3x4::Identity, identity);
+	}
+	void testMultiply()
+	{
+		for (int i = 0; i + 1 < kCount; ++i)
+		{
+			// a first, then b
+			FastDualQuaternion dq(m_Transforms[i]);
+			dq.Multiply(FastDualQuaternion(m_Transforms[i + 1]));
+
+			FastAffine3x4 expected = m_Transforms[i + 1];
+			expected.Multiply(m_Transforms[i]);
+			FastAffine3x4 result;
+			dq.ToAffine(result);
+			checkAffine(expected, result);
+
+			FastVector3 p(1.0f, -2.0f, 0.5f * i);
+			FastVector3 expectedP(p);
+			expectedP.Transform(expected);
+			checkVector(expectedP, dq.TransformPoint(p));
+
+			// the conjugate undoes the transform
+			FastDualQuaternion inverse(dq);
+			inverse.Conjugate();
+			checkVector(p, inverse.TransformPoint(dq.TransformPoint(p)));
+		}
+	}
+	void testBlend()
+	{
+		for (int i = 0; i + 1 < kCount; ++i)
+		{
+			FastDualQuaternion a(m_Rotations[i], m_Translations[i]);
+			FastDualQuaternion b(m_Rotations[i + 1], m_Translations[i + 1]);
+			// -b is the same transform as b, and must blend the same way
+			FastDualQuaternion negB(_mm_sub_ps(_mm_setzero_ps(), _mm_load_ps(b.ToFloats())),
+									_mm_sub_ps(_mm_setzero_ps(), _mm_load_ps(b.ToFloats() + 4)));
+
+			FastDualQuaternion blend = Blend(a, b, a, b, 0.2f, 0.3f, 0.2f);
+			FastDualQuaternion flipped = Blend(a, negB, a, negB, 0.2f, 0.3f, 0.2f);
+			FastAffine3x4 expected, result;
+			blend.ToAffine(expected);
+			flipped.ToAffine(result);
+			checkAffine(expected, result);
+
+			// unit real part, dual part perpendicular to it
+			const float* f = blend.ToFloats();
+			ASSERT_EQUALS_EPSILON(1.0f, blend.GetReal().Length(), 0.001f);
+			ASSERT_EQUALS_EPSILON(0.0f, f[0] * f[4] + f[1] * f[5] + f[2] * f[6] + f[3] * f[7], 0.001f);
+			ASSERT_TEST_MESSAGE(result.IsOrthonormal(), "blended transform should be rigid");
+
+			// all the weight on one input gives that input back
+			Blend(a, b, a, b, 0.0f, 1.0f, 0.0f).ToAffine(result);
+			b.ToAffine(expected);
+			checkAffine(expected, result);
+		}
+	}
+	void testBatch()
+	{
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+			FastDualQuaternion result[kCount];
+			FastDualQuaternion::CreateFromAffineBatch(m_Transforms, result, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				FastDualQuaternion expected(m_Transforms[i]);
+				for (int j = 0; j < 8; ++j)
+				{
+					ASSERT_EQUALS_EPSILON(expected.ToFloats()[j], result[i].ToFloats()[j], 0.001f);
+				}
+			}
+		}
+		SetSimdLevel(hardware);
+	}
+	void checkVector(const FastVector3& expected, const FastVector3& actual)
+	{
+		ASSERT_EQUALS_EPSILON(expected.GetX(), actual.GetX(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetY(), actual.GetY(), 0.001f);
+		ASSERT_EQUALS_EPSILON(expected.GetZ(), actual.GetZ(), 0.001f);
+	}
+	void checkAffine(const FastAffine3x4& expected, const FastAffine3x4& actual)
+	{
+		for (int i = 0; i < 12; ++i)
+		{
+			ASSERT_EQUALS_EPSILON(expected.ToFloats()[i], actual.ToFloats()[i], 0.001f);
+		}
+	}
+private:
+	FastQuaternion m_Rotations[kCount];
+	FastVector3 m_Translations[kCount];
+	FastAffine3x4 m_Transforms[kCount];
+};
+
+class QuantizeTest : public TestFixture<QuantizeTest>
+{
+public:
+	// covers the 16 wide, 8 wide, 4 wide and single paths
+	static const int kCount = 43;
+
+	TEST_FIXTURE_DESCRIBE(QuantizeTest, "Testing quantize...")
+	{
+		TEST_CASE_DESCRIBE(testHalf, "Half precision specials, rounding and error bound");
+		TEST_CASE_DESCRIBE(testSnormUnorm, "snorm16 and unorm8 clamping and error bounds");
+		TEST_CASE_DESCRIBE(testQuaternion, "Smallest three quaternion round trip error");
+		TEST_CASE_DESCRIBE(testNormal, "Octahedral normal round trip error");
+		TEST_CASE_DESCRIBE(testBatch, "Batches match the single versions at every SIMD level");
+	}
+	void setUp()
+	{
+		// fixed seed so a failure can be reproduced
+		std::srand(485);
+		for (int i = 0; i < kCount; ++i)
+		{
+			m_Floats[i] = randomFloat() * 2.5f;
+		}
+
+		// the axes and their negatives first, so every dropped index and
+		// sign and both octahedron halves are tested
+		for (int i = 0; i < 8; ++i)
+		{
+			float q[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			q[i % 4] = (i < 4) ? 1.0f : -1.0f;
+			m_Rotations[i] = FastQuaternion(q[0], q[1], q[2], q[3]);
+		}
+		for (int i = 0; i < 6; ++i)
+		{
+			float v[3] = { 0.0f, 0.0f, 0.0f };
+			v[i % 3] = (i < 3) ? 1.0f : -1.0f;
+			m_Normals[i] = FastVector3(v[0], v[1], v[2]);
+		}
+		for (int i = 8; i < kCount; ++i)
+		{
+			m_Rotations[i] = FastQuaternion(randomFloat(), randomFloat(), randomFloat(), randomFloat());
+			m_Rotations[i].Normalize();
+		}
+		for (int i = 6; i < kCount; ++i)
+		{
+			m_Normals[i] = FastVector3(randomFloat(), randomFloat(), randomFloat());
+			m_Normals[i].Normalize();
+		}
+	}
+	void testHalf()
+	{
+		ASSERT_EQUALS(0x3c00, int(FloatToHalf(1.0f)));
+		ASSERT_EQUALS(0xc000, int(FloatToHalf(-2.0f)));
+		ASSERT_EQUALS(0x8000, int(FloatToHalf(-0.0f)));
+		ASSERT_EQUALS(0x7bff, int(FloatToHalf(65504.0f)));
+		// past the largest half rounds up to infinity
+		ASSERT_EQUALS(0x7c00, int(FloatToHalf(65520.0f)));
+		ASSERT_EQUALS(0x7c00, int(FloatToHalf(FLT_MAX)));
+		ASSERT_EQUALS(0xfc00, int(FloatToHalf(-std::numeric_limits<float>::infinity())));
+		unsigned short nan = FloatToHalf(std::numeric_limits<float>::quiet_NaN());
+		ASSERT_TEST_MESSAGE((nan & 0x7c00) == 0x7c00 && (nan & 0x3ff) != 0, "NaN should stay NaN");
+		float nanResult = HalfToFloat(nan);
+		ASSERT_TEST_MESSAGE(nanResult != nanResult, "NaN should stay NaN");
+		ASSERT_TEST_MESSAGE(HalfToFloat(0x7c00) == std::numeric_limits<float>::infinity(), "Infinity should stay infinity");
+
+		// ties round to even
+		ASSERT_EQUALS(0x3c00, int(FloatToHalf(1.0f + 1.0f / 2048.0f)));
+		ASSERT_EQUALS(0x3c02, int(FloatToHalf(1.0f + 3.0f / 2048.0f)));
+
+		// denormals, the smallest is 2^-24
+		const float smallest = 1.0f / 16777216.0f;
+		ASSERT_EQUALS(0x0001, int(FloatToHalf(smallest)));
+		ASSERT_EQUALS(0x8003, int(FloatToHalf(-3.0f * smallest)));
+		ASSERT_EQUALS(0x0000, int(FloatToHalf(smallest * 0.25f)));
+		ASSERT_TEST_MESSAGE(HalfToFloat(0x03ff) == 1023.0f * smallest, "Incorrect denormal");
+
+		// every finite half converts back to itself
+		for (unsigned int h = 0; h < 0x10000; ++h)
+		{
+			if ((h & 0x7c00) != 0x7c00)
+			{
+				ASSERT_EQUALS(int(h), int(FloatToHalf(HalfToFloat(static_cast<unsigned short>(h)))));
+			}
+		}
+
+		// relative error bound over the normal range
+		const float bound = 1.0f / 2048.0f;
+		for (float f = 6.2e-5f; f < 65504.0f; f *= 1.0137f)
+		{
+			ASSERT_TEST_MESSAGE(fabsf(HalfToFloat(FloatToHalf(f)) - f) <= f * bound, "Half error out of bounds");
+			ASSERT_TEST_MESSAGE(fabsf(HalfToFloat(FloatToHalf(-f)) + f) <= f * bound, "Half error out of bounds");
+		}
+	}
+	void testSnormUnorm()
+	{
+		ASSERT_EQUALS(32767, int(FloatToSnorm16(1.0f)));
+		ASSERT_EQUALS(-32767, int(FloatToSnorm16(-1.0f)));
+		ASSERT_EQUALS(32767, int(FloatToSnorm16(7.0f)));
+		ASSERT_EQUALS(-32767, int(FloatToSnorm16(-7.0f)));
+		ASSERT_EQUALS(0, int(FloatToSnorm16(0.0f)));
+		ASSERT_EQUALS(-1.0f, Snorm16ToFloat(-32768));
+		ASSERT_EQUALS(255, int(FloatToUnorm8(1.0f)));
+		ASSERT_EQUALS(255, int(FloatToUnorm8(3.0f)));
+		ASSERT_EQUALS(0, int(FloatToUnorm8(-3.0f)));
+		ASSERT_EQUALS(1.0f, Unorm8ToFloat(255));
+		ASSERT_EQUALS(0.0f, Unorm8ToFloat(0));
+
+		for (float f = -1.0f; f <= 1.0f; f += 0.001953f)
+		{
+			ASSERT_TEST_MESSAGE(fabsf(Snorm16ToFloat(FloatToSnorm16(f)) - f) <= 0.5f / 32767.0f + 1e-7f, "snorm16 error out of bounds");
+		}
+		for (float f = 0.0f; f <= 1.0f; f += 0.000977f)
+		{
+			ASSERT_TEST_MESSAGE(fabsf(Unorm8ToFloat(FloatToUnorm8(f)) - f) <= 0.5f / 255.0f + 1e-7f, "unorm8 error out of bounds");
+		}
+	}
+	void testQuaternion()
+	{
+		for (int i = 0; i < kCount; ++i)
+		{
+			const FastQuaternion& q = m_Rotations[i];
+			FastQuaternion result = UnpackQuaternion(PackQuaternion(q));
+			ASSERT_EQUALS_EPSILON(1.0f, result.Length(), 1e-5f);
+
+			// q and -q are the same rotation
+			float dot = q.GetVectorX() * result.GetVectorX() + q.GetVectorY() * result.GetVectorY() +
+						q.GetVectorZ() * result.GetVectorZ() + q.GetScalar() * result.GetScalar();
+			float sign = (dot < 0.0f) ? -1.0f : 1.0f;
+			ASSERT_EQUALS_EPSILON(q.GetVectorX(), sign * result.GetVectorX(), 1e-4f);
+			ASSERT_EQUALS_EPSILON(q.GetVectorY(), sign * result.GetVectorY(), 1e-4f);
+			ASSERT_EQUALS_EPSILON(q.GetVectorZ(), sign * result.GetVectorZ(), 1e-4f);
+			ASSERT_EQUALS_EPSILON(q.GetScalar(), sign * result.GetScalar(), 1e-4f);
+		}
+	}
+	void testNormal()
+	{
+		for (int i = 0; i < kCount; ++i)
+		{
+			const FastVector3& n = m_Normals[i];
+			FastVector3 result = UnpackNormal(PackNormal(n));
+			ASSERT_EQUALS_EPSILON(1.0f, result.Length(), 1e-5f);
+			ASSERT_EQUALS_EPSILON(n.GetX(), result.GetX(), 1e-4f);
+			ASSERT_EQUALS_EPSILON(n.GetY(), result.GetY(), 1e-4f);
+			ASSERT_EQUALS_EPSILON(n.GetZ(), result.GetZ(), 1e-4f);
+		}
+	}
+	void testBatch()
+	{
+		SimdLevel hardware = GetSimdLevel();
+		for (int level = SIMD_SSE2; level <= hardware; ++level)
+		{
+			SetSimdLevel(static_cast<SimdLevel>(level));
+
+			unsigned short halves[kCount];
+			float floats[kCount];
+			FloatsToHalves(m_Floats, halves, kCount);
+			HalvesToFloats(halves, floats, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				ASSERT_EQUALS(int(FloatToHalf(m_Floats[i])), int(halves[i]));
+				ASSERT_EQUALS(HalfToFloat(halves[i]), floats[i]);
+			}
+
+			short snorms[kCount];
+			FloatsToSnorm16(m_Floats, snorms, kCount);
+			Snorm16ToFloats(snorms, floats, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				ASSERT_EQUALS(int(FloatToSnorm16(m_Floats[i])), int(snorms[i]));
+				ASSERT_EQUALS(Snorm16ToFloat(snorms[i]), floats[i]);
+			}
+
+			unsigned char unorms[kCount];
+			FloatsToUnorm8(m_Floats, unorms, kCount);
+			Unorm8ToFloats(unorms, floats, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				ASSERT_EQUALS(int(FloatToUnorm8(m_Floats[i])), int(unorms[i]));
+				ASSERT_EQUALS(Unorm8ToFloat(unorms[i]), floats[i]);
+			}
+
+			PackedQuaternion packedRotations[kCount];
+			FastQuaternion rotations[kCount];
+			PackQuaternions(m_Rotations, packedRotations, kCount);
+			UnpackQuaternions(packedRotations, rotations, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				PackedQuaternion expected = PackQuaternion(m_Rotations[i]);
+				ASSERT_TEST_MESSAGE(memcmp(&expected, &packedRotations[i], sizeof(expected)) == 0, "Packed quaternions don't match");
+				FastQuaternion unpacked = UnpackQuaternion(expected);
+				ASSERT_TEST_MESSAGE(memcmp(&unpacked, &rotations[i], sizeof(unpacked)) == 0, "Unpacked quaternions don't match");
+			}
+
+			OctahedralNormal packedNormals[kCount];
+			FastVector3 normals[kCount];
+			PackNormals(m_Normals, packedNormals, kCount);
+			UnpackNormals(packedNormals, normals, kCount);
+			for (int i = 0; i < kCount; ++i)
+			{
+				OctahedralNormal expected = PackNormal(m_Normals[i]);
+				ASSERT_TEST_MESSAGE(expected.x == packedNormals[i].x && expected.y == packedNormals[i].y, "Packed normals don't match");
+				FastVector3 unpacked = UnpackNormal(expected);
+				ASSERT_TEST_MESSAGE(memcmp(&unpacked, &normals[i], sizeof(unpacked)) == 0, "Unpacked normals don't match");
+			}
+		}
+		SetSimdLevel(hardware);
+	}
+	// Returns a float in [-1, 1]
+	float randomFloat()
+	{
+		return std::rand() / float(RAND_MAX) * 2.0f - 1.0f;
+	}
+private:
+	float m_Floats[kCount];
+	FastQuaternion m_Rotations[kCount];
+	FastVector3 m_Normals[kCount];
+};
+
+class SlowVector3Test : public TestFixture<SlowVector3Test>
+{
+public:
+	void PrintVector3(const SlowVector3& data)
+	{
+		printf("<%f, %f, %f>\n", data.GetX(), data.GetY(), data.GetZ());
+	}
+
+	TEST_FIXTURE_DESCRIBE(SlowVector3Test, "Testing SlowVector3...")
+	{
+		TEST_CASE_DESCRIBE(testConstructorGettersSetters, "Getters/Setters");
+		TEST_CASE_DESCRIBE(testNormalize, "Normalize");
+		TEST_CASE_DESCRIBE(testDotProduct, "Dot Product");
+		TEST_CASE_DESCRIBE(testAdd, "Addition");
+		TEST_CASE_DESCRIBE(testSub, "Subtraction");
+		TEST_CASE_DESCRIBE(testLengthSquared, "Length Squared");
+		TEST_CASE_DESCRIBE(testLength, "Length");
+		TEST_CASE_DESCRIBE(testCross, "Cross Product");
+		TEST_CASE_DESCRIBE(testLerp, "Linear Interpolation");
+		TEST_CASE_DESCRIBE(testBlend, "4-Way Blend");
+	}
+	void testConstructorGettersSetters()
+	{
+		SlowVector3 v(1.0f, 2.0f, 3.0f);
+		ASSERT_EQUALS(1.0f, v.GetX());
+		ASSERT_EQUALS(2.0f, v.GetY());
+		ASSERT_EQUALS(3.0f, v.GetZ());
+
+		v.SetX(2.0f);
+		v.SetY(4.0f);
+		v.SetZ(6.0f);
+		ASSERT_EQUALS(2.0f, v.GetX());
+		ASSERT_EQUALS(4.0f, v.GetY());
+		ASSERT_EQUALS(6.0f, v.GetZ());
+
+		v.Set(3.0f, 5.0f, 7.0f);
+		ASSERT_EQUALS(3.0f, v.GetX());
+		ASSERT_EQUALS(5.0f, v.GetY());
+		ASSERT_EQUALS(7.0f, v.GetZ());
+	}
+	void testNormalize()
+	{
+		SlowVector3 v(0.0f, 3.0f, 4.0f);
+		v.Normalize();
+		ASSERT_EQUALS_EPSILON(0.0f, v.GetX(), 0.01f);
+		ASSERT_EQUALS_EPSILON(0.6f, v.GetY(), 0.01f);
+		ASSERT_EQUALS_EPSILON(0.8f, v.GetZ(), 0.01f);
+	}
+	void testDotProduct()
+	{
+		SlowVector3 v(2.0f, 4.0f, 6.0f);
+		ASSERT_EQUALS_EPSILON(56.0f, v.Dot(v), 0.01f);
+	}
+	void testAdd()
+	{
+		SlowVector3 v1(1.0f, 2.0f, 3.0f);
+		SlowVector3 v2(2.0f, 4.0f, 6.0f);
+		v1.Add(v2);
+		ASSERT_EQUALS_EPSILON(3.0f, v1.GetX(), 0.01f);
+		ASSERT_EQUALS_EPSILON(6.0f, v1.GetY(), 0.01f);
+		ASSERT_EQUALS_EPSILON(9.0f, v1.GetZ(), 0.01f);
+	}
+	void testSub()
+	{
+		SlowVector3 v1(1.0f, 2.0f, 3.0f);
+		SlowVector3 v2(2.0f, 4.0f, 6.0f);
+		v1.Sub(v2);
+		ASSERT_EQUALS_EPSILON(-1.0f, v1.GetX(), 0.01f);
+		ASSERT_EQUALS_EPSILON(-2.0f, v1.GetY(), 0.01f);
+		ASSERT_EQUALS_EPSILON(-3.0f, v1.GetZ(), 0.01f);
+	}
+	void testLengthSquared()
+	{
+		SlowVector3 v(3.0f, 1.0f, 4.0f);
+		ASSERT_EQUALS_EPSILON(26.0f, v.LengthSquared(), 0.01f);
+	}
+	void testLength()
+	{
+		SlowVector3 v(3.0f, 0.0f, 4.0f);
+		ASSERT_EQUALS_EPSILON(5.0f, v.Length(), 0.01f);
+	}
+	void testCross()
+	{
+		SlowVector3 v1(3.0f, 2.0f, 5.0f);
+		SlowVector3 v2(4.0f, 6.0f, 1.0f);
+		SlowVector3 v3 = Cross(v1, v2);
+		ASSERT_EQUALS_EPSILON(-28.0f, v3.GetX(), 0.01f);
+		ASSERT_EQUALS_EPSILON(17.0f, v3.GetY(), 0.01f);
+		ASSERT_EQUALS_EPSILON(10.0f, v3.GetZ(), 0.01f);
+	}
+	void testLerp()
+	{
+		SlowVector3 v1(1.0f, 10.0f, 100.0f);
+		SlowVector3 v2(0.0f, 0.0f, 0.0f);
+		SlowVector3 v3 = Lerp(v1, v2, 0.75f);
+		ASSERT_EQUALS_EPSILON(0.25f, v3.GetX(), 0.01f);
+		ASSERT_EQUALS_EPSILON(2.5f, v3.GetY(), 0.01f);
+		ASSERT_EQUALS_EPSILON(25.0f, v3.GetZ(), 0.01f);
+	}
+	void testBlend()
+	{
+		SlowVector3 v1(1.0f, 1.0f, 1.0f);
+		SlowVector3 v2(4.0f, 4.0f, 4.0f);
+		SlowVector3 v3(8.0f, 8.0f, 8.0f);
+		SlowVector3 v4(16.0f, 16.0f, 16.0f);
+
+		SlowVector3 vBlendResult = Blend(v1, v2, v3, v4, 0.25f, 0.25f, 0.25f);
+		ASSERT_EQUALS_EPSILON(7.25f, vBlendResult.GetX(), 0.01f);
+		ASSERT_EQUALS_EPSILON(7.25f, vBlendResult.GetY(), 0.01f);
+		ASSERT_EQUALS_EPSILON(7.25f, vBlendResult.GetZ(), 0.01f);
+	}
+};
+
+class SlowMatrix4Test : public TestFixture<SlowMatrix4Test>
+{
+public:
+	void PrintVector3(const SlowVector3& data)
+	{
+		printf("<%f, %f, %f>\n", data.GetX(), data.GetY(), data.GetZ());
+	}
+
+	TEST_FIXTURE_DESCRIBE(SlowMatrix4Test, "Testing SlowMatrix4...")
+	{
+		TEST_CASE_DESCRIBE(testVectorTransform, "Transform a vector (as a position) by a matrix");
+		TEST_CASE_DESCRIBE(testVectorTransformX2, "Transform a vector (as a position) by a matrix and back");
+		TEST_CASE_DESCRIBE(testVectorTransformAsVector, "Transform a vector (as a vector) by a matrix");
+		TEST_CASE_DESCRIBE(testMatrixMult, "Multiply two matrices together (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixAdd, "Add two matrices together (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixSub, "Subtract two matrices together (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixScale, "Creates scale matrix (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixRotateX, "Creates rotate X matrix (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixRotateY, "Creates rotate Y matrix (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixRotateZ, "Creates rotate Z matrix (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixTranslate, "Creates translate matrix (then apply to vector)");
+		TEST_CASE_DESCRIBE(testMatrixInvert, "Inverts the matrix");
+	}
+	void testVectorTransform()
+	{
+		SlowVector3 v(SlowVector3::Zero);
+		float trans[4][4] = {1.0f, 0.0f, 0.0f, -5.0f,
+			0.0f, 1.0f, 0.0f, -10.0f,
+			0.0f, 0.0f, 1.0f, 4.0f,
+			0.0f, 0.0f, 0.0f, 1.0f};
+		SlowMatrix4 translate(trans);
 
 		v.Transform(translate);
 		ASSERT_EQUALS_EPSILON(-5.0f, v.GetX(), 0.01f);
@@ -989,6 +2533,18 @@ public:
 
 typedef PoolAllocator<32, 64> SmallPool;
 typedef PoolAllocator<16, 16> TestPool;
+typedef PoolAllocator<32, 64, LockFreeFreeList> SharedPool;
+typedef PoolAllocator<16, 4> GrowPool;
+typedef PoolAllocator<32, 8, LockFreeFreeList> SharedGrowPool;
+
+// Records the calls to a PoolGrowCallback
+static unsigned int s_NumPoolGrows = 0;
+static unsigned int s_PoolGrowBlocks = 0;
+void OnTestPoolGrow(size_t blockSize, unsigned int numBlocks)
+{
+	++s_NumPoolGrows;
+	s_PoolGrowBlocks = numBlocks;
+}
 
 class TestPoolUser
 {
@@ -1016,6 +2572,15 @@ public:
 		TEST_CASE_DESCRIBE(testReuse, "Allocate/Free all 32 byte blocks 10 times in a row with no errors");
 		TEST_CASE_DESCRIBE(testBoundaryCheck, "Allocate, Overwrite Boundary, Free (SHOULD ASSERT IN DEBUG!)");
 		TEST_CASE_DESCRIBE(testReuseRandom, "Allocate all blocks/randomly free some, try to allocate again.");
+		TEST_CASE_DESCRIBE(testLockFree, "Lock-free pool hands out every block once, then returns 0");
+		TEST_CASE_DESCRIBE(testLockFreeThreads, "Lock-free pool with 8 threads allocating and freeing at once");
+		TEST_CASE_DESCRIBE(testGrow, "Pool adds chunks up to its cap, and old blocks stay put");
+		TEST_CASE_DESCRIBE(testAllocateAfterShutDown, "Allocate returns 0 after ShutDown instead of growing (SHOULD ASSERT IN DEBUG!)");
+		TEST_CASE_DESCRIBE(testArena, "Chunks are next to each other in the arena, then come from the heap");
+		TEST_CASE_DESCRIBE(testGrowThreads, "Lock-free pool grows with 8 threads allocating at once");
+		TEST_CASE_DESCRIBE(testLiveIteration, "ForEachLive visits the allocated blocks in address order");
+		TEST_CASE_DESCRIBE(testCompact, "Compact packs allocated blocks at the start and fixes up handles");
+		TEST_CASE_DESCRIBE(testSortFreeList, "SortFreeList hands out free blocks in address order");
 		//TEST_CASE_DESCRIBE(testAlignment, "Make sure we get back a block that's 16-byte aligned.");
 		//TEST_CASE_DESCRIBE(testPoolNewDelete, "Allocate for a class using overloaded new/delete");
 	}
@@ -1131,6 +2696,334 @@ public:
 		}
 		SmallPool::get().ShutDown();
 	}
+	void testLockFree()
+	{
+		SharedPool::get().StartUp();
+		std::vector<void*> blocks;
+		for (int i = 0; i < 64; i++)
+		{
+			void* temp = SharedPool::get().Allocate(32);
+			ASSERT_TEST_MESSAGE(temp != 0, "Allocate returned 0 when there should be blocks left.");
+			ASSERT_TEST_MESSAGE(std::find(blocks.begin(), blocks.end(), temp) == blocks.end(),
+				"Allocate returned a pointer that's already in use.");
+			blocks.push_back(temp);
+		}
+		ASSERT_TEST_MESSAGE(SharedPool::get().GetNumBlocksFree() == 0, "Incorrect number of blocks remaining.");
+		ASSERT_TEST_MESSAGE(SharedPool::get().Allocate(32) == 0, "Allocate should return 0 when the pool is full.");
+		for (int i = 0; i < 64; i++)
+		{
+			SharedPool::get().Free(blocks[i]);
+		}
+		ASSERT_TEST_MESSAGE(SharedPool::get().GetNumBlocksFree() == 64, "Incorrect number of blocks remaining.");
+		SharedPool::get().ShutDown();
+	}
+	void testLockFreeThreads()
+	{
+		// Each thread holds up to 6 blocks at a time, so 8 threads never run the
+		// pool dry. A block handed to two threads at once shows up as the other
+		// thread's id in the block.
+		const int kThreads = 8;
+		const int kLoops = 20000;
+		SharedPool::get().StartUp();
+		std::atomic<int> errors(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < kThreads; t++)
+		{
+			threads.push_back(std::thread([t, &errors]()
+			{
+				unsigned int* held[6];
+				for (int i = 0; i < kLoops; i++)
+				{
+					int count = 1 + (i + t) % 6;
+					for (int j = 0; j < count; j++)
+					{
+						held[j] = reinterpret_cast<unsigned int*>(SharedPool::get().Allocate(32));
+						if (held[j] == 0) { errors++; return; }
+						*held[j] = t;
+					}
+					for (int j = 0; j < count; j++)
+					{
+						if (*held[j] != static_cast<unsigned int>(t)) { errors++; }
+						SharedPool::get().Free(held[j]);
+					}
+				}
+			}));
+		}
+		for (int t = 0; t < kThreads; t++)
+		{
+			threads[t].join();
+		}
+		ASSERT_TEST_MESSAGE(errors == 0, "A block was handed out twice, or the pool ran dry.");
+		ASSERT_TEST_MESSAGE(SharedPool::get().GetNumBlocksFree() == 64, "Incorrect number of blocks remaining.");
+		SharedPool::get().ShutDown();
+	}
+	void testGrow()
+	{
+		s_NumPoolGrows = 0;
+		GrowPool::get().StartUp(12, OnTestPoolGrow);
+		ASSERT_TEST_MESSAGE(GrowPool::get().GetNumBlocks() == 4, "Pool should start with one chunk.");
+		std::vector<unsigned int*> blocks;
+		for (unsigned int i = 0; i < 12; i++)
+		{
+			unsigned int* temp = reinterpret_cast<unsigned int*>(GrowPool::get().Allocate(16));
+			ASSERT_TEST_MESSAGE(temp != 0, "Allocate returned 0 when the pool should have grown.");
+			ASSERT_TEST_MESSAGE(std::find(blocks.begin(), blocks.end(), temp) == blocks.end(),
+				"Allocate returned a pointer that's already in use.");
+			*temp = i;
+			blocks.push_back(temp);
+		}
+		ASSERT_TEST_MESSAGE(s_NumPoolGrows == 2 && s_PoolGrowBlocks == 12, "Callback should be called once per chunk added.");
+		ASSERT_TEST_MESSAGE(GrowPool::get().GetNumBlocks() == 12, "Incorrect number of blocks.");
+		ASSERT_TEST_MESSAGE(GrowPool::get().Allocate(16) == 0, "Allocate should return 0 at the cap.");
+
+		for (unsigned int i = 0; i < 12; i++)
+		{
+			ASSERT_TEST_MESSAGE(*blocks[i] == i, "A block moved or was overwritten when the pool grew.");
+			GrowPool::get().Free(blocks[i]);
+		}
+		ASSERT_TEST_MESSAGE(GrowPool::get().GetNumBlocksFree() == 12, "Incorrect number of blocks remaining.");
+		GrowPool::get().ShutDown();
+
+		// Without a cap the pool keeps going
+		GrowPool::get().StartUp(kPoolNoLimit);
+		for (unsigned int i = 0; i < 100; i++)
+		{
+			ASSERT_TEST_MESSAGE(GrowPool::get().Allocate(16) != 0, "Allocate returned 0 from a pool with no limit.");
+		}
+		ASSERT_TEST_MESSAGE(GrowPool::get().GetNumBlocks() == 100, "Incorrect number of blocks.");
+		GrowPool::get().ShutDown();
+	}
+	void testAllocateAfterShutDown()
+	{
+		s_NumPoolGrows = 0;
+		GrowPool::get().StartUp(kPoolNoLimit, OnTestPoolGrow);
+		for (unsigned int i = 0; i < 8; i++)
+		{
+			GrowPool::get().Free(GrowPool::get().Allocate(16));
+		}
+		GrowPool::get().ShutDown();
+
+		// The cap and callback from StartUp are gone, so it can't grow
+		s_NumPoolGrows = 0;
+		ASSERT_TEST_MESSAGE(GrowPool::get().Allocate(16) == 0, "Allocate should return 0 after ShutDown.");
+		ASSERT_TEST_MESSAGE(GrowPool::get().GetNumBlocks() == 0, "Pool shouldn't have grown after ShutDown.");
+		ASSERT_TEST_MESSAGE(s_NumPoolGrows == 0, "Grow callback shouldn't be called after ShutDown.");
+	}
+	void testArena()
+	{
+		// With a cap, every chunk fits in the arena, one after the other
+		GrowPool::get().StartUp(12);
+		std::vector<char*> blocks;
+		for (unsigned int i = 0; i < 12; i++)
+		{
+			blocks.push_back(reinterpret_cast<char*>(GrowPool::get().Allocate(16)));
+		}
+		std::sort(blocks.begin(), blocks.end());
+		for (unsigned int i = 1; i < 12; i++)
+		{
+			// Each chunk's occupancy bits are between it and the next chunk
+			size_t expected = (i % 4 == 0) ? GrowPool::GetChunkSize() - 3 * sizeof(PoolBlock<16>) : sizeof(PoolBlock<16>);
+			ASSERT_TEST_MESSAGE(size_t(blocks[i] - blocks[i - 1]) == expected, "Chunks should be contiguous in the arena.");
+		}
+		ASSERT_TEST_MESSAGE(GrowPool::get().GetArena().Contains(blocks[0]) && GrowPool::get().GetArena().Contains(blocks[11]),
+			"Blocks should come from the arena.");
+		GrowPool::get().ShutDown();
+
+		// Past kPoolMaxReservedChunks chunks (rounded up to whole pages), the rest come from the heap
+		GrowPool::get().StartUp(kPoolNoLimit);
+		const size_t arenaChunks = GrowPool::get().GetArena().GetBytesReserved() / GrowPool::GetChunkSize();
+		ASSERT_TEST_MESSAGE(arenaChunks >= kPoolMaxReservedChunks, "The arena should have room for kPoolMaxReservedChunks chunks.");
+		const unsigned int numBlocks = static_cast<unsigned int>(4 * arenaChunks + 8);
+		blocks.clear();
+		for (unsigned int i = 0; i < numBlocks; i++)
+		{
+			char* temp = reinterpret_cast<char*>(GrowPool::get().Allocate(16));
+			ASSERT_TEST_MESSAGE(temp != 0, "Allocate returned 0 from a pool with no limit.");
+			memset(temp, 0, 16);
+			blocks.push_back(temp);
+		}
+		ASSERT_TEST_MESSAGE(!GrowPool::get().GetArena().Contains(blocks.back()), "Blocks past the arena should come from the heap.");
+		for (unsigned int i = 0; i < numBlocks; i++)
+		{
+			GrowPool::get().Free(blocks[i]);
+		}
+		GrowPool::get().ShutDown();
+	}
+	void testGrowThreads()
+	{
+		// 8 threads holding up to 6 blocks need more than the first chunk of 8
+		const int kThreads = 8;
+		const int kLoops = 5000;
+		SharedGrowPool::get().StartUp(kPoolNoLimit);
+		std::atomic<int> errors(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < kThreads; t++)
+		{
+			threads.push_back(std::thread([t, &errors]()
+			{
+				unsigned int* held[6];
+				for (int i = 0; i < kLoops; i++)
+				{
+					int count = 1 + (i + t) % 6;
+					for (int j = 0; j < count; j++)
+					{
+						held[j] = reinterpret_cast<unsigned int*>(SharedGrowPool::get().Allocate(32));
+						if (held[j] == 0) { errors++; return; }
+						*held[j] = t;
+					}
+					for (int j = 0; j < count; j++)
+					{
+						if (*held[j] != static_cast<unsigned int>(t)) { errors++; }
+						SharedGrowPool::get().Free(held[j]);
+					}
+				}
+			}));
+		}
+		for (int t = 0; t < kThreads; t++)
+		{
+			threads[t].join();
+		}
+		ASSERT_TEST_MESSAGE(errors == 0, "A block was handed out twice, or the pool didn't grow.");
+		ASSERT_TEST_MESSAGE(SharedGrowPool::get().GetNumBlocks() <= kThreads * 6 + 8, "Pool grew more than it needed to.");
+		ASSERT_TEST_MESSAGE(SharedGrowPool::get().GetNumBlocksFree() == SharedGrowPool::get().GetNumBlocks(),
+			"Incorrect number of blocks remaining.");
+		SharedGrowPool::get().ShutDown();
+	}
+	void testLiveIteration()
+	{
+		// Allocate 3 chunks, then free every third block
+		GrowPool::get().StartUp(kPoolNoLimit);
+		std::vector<char*> blocks;
+		for (unsigned int i = 0; i < 12; i++)
+		{
+			blocks.push_back(reinterpret_cast<char*>(GrowPool::get().Allocate(16)));
+		}
+		std::vector<char*> live;
+		for (unsigned int i = 0; i < 12; i++)
+		{
+			if (i % 3 == 0)
+			{
+				GrowPool::get().Free(blocks[i]);
+				ASSERT_TEST_MESSAGE(!GrowPool::get().IsAllocated(blocks[i]), "Freed blocks shouldn't be allocated.");
+			}
+			else
+			{
+				ASSERT_TEST_MESSAGE(GrowPool::get().IsAllocated(blocks[i]), "Allocated blocks should be allocated.");
+				live.push_back(blocks[i]);
+			}
+		}
+		std::sort(live.begin(), live.end());
+
+		std::vector<char*> visited;
+		GrowPool::get().ForEachLive([&visited](void* ptr) { visited.push_back(reinterpret_cast<char*>(ptr)); });
+		ASSERT_TEST_MESSAGE(visited == live, "ForEachLive should visit every allocated block once, in address order.");
+
+		for (size_t i = 0; i < live.size(); i++)
+		{
+			GrowPool::get().Free(live[i]);
+		}
+		int count = 0;
+		GrowPool::get().ForEachLive([&count](void*) { count++; });
+		ASSERT_EQUALS(0, count);
+		GrowPool::get().ShutDown();
+
+		// Lock-free pools keep the same bits
+		SharedPool::get().StartUp();
+		void* a = SharedPool::get().Allocate(32);
+		void* b = SharedPool::get().Allocate(32);
+		SharedPool::get().Free(a);
+		count = 0;
+		SharedPool::get().ForEachLive([&count, b](void* ptr) { count += (ptr == b) ? 1 : 100; });
+		ASSERT_EQUALS(1, count);
+		SharedPool::get().Free(b);
+		SharedPool::get().ShutDown();
+	}
+	void testCompact()
+	{
+		// Objects in the pool, and a handle table pointing at them
+		struct HandleTable
+		{
+			unsigned int* m_Objects[64];
+			unsigned int m_NumMoves;
+		};
+		struct Mover
+		{
+			static void Move(void* pUser, void* pFrom, void* pTo)
+			{
+				HandleTable* pTable = static_cast<HandleTable*>(pUser);
+				unsigned int* pObject = static_cast<unsigned int*>(pFrom);
+				pTable->m_Objects[*pObject] = new (pTo) unsigned int(*pObject);
+				pTable->m_NumMoves++;
+			}
+		};
+
+		SmallPool::get().StartUp();
+		HandleTable table;
+		table.m_NumMoves = 0;
+		for (unsigned int i = 0; i < 64; i++)
+		{
+			table.m_Objects[i] = new (SmallPool::get().Allocate(32)) unsigned int(i);
+		}
+		char* pStart = reinterpret_cast<char*>(table.m_Objects[0]);
+
+		// Free the first 32 blocks in LIFO order, so the other 32 are at the end
+		for (unsigned int i = 0; i < 32; i++)
+		{
+			SmallPool::get().Free(table.m_Objects[i]);
+			table.m_Objects[i] = 0;
+		}
+
+		unsigned int numMoved = SmallPool::get().Compact(Mover::Move, &table);
+		ASSERT_EQUALS(32, int(numMoved));
+		ASSERT_EQUALS(32, int(table.m_NumMoves));
+		for (unsigned int i = 32; i < 64; i++)
+		{
+			ASSERT_TEST_MESSAGE(*table.m_Objects[i] == i, "Handles should point at the moved objects.");
+			ASSERT_TEST_MESSAGE(reinterpret_cast<char*>(table.m_Objects[i]) < pStart + 32 * sizeof(PoolBlock<32>),
+				"Objects should be packed at the start of the pool.");
+			ASSERT_TEST_MESSAGE(SmallPool::get().IsAllocated(table.m_Objects[i]), "Moved objects should be allocated.");
+		}
+		ASSERT_EQUALS(32, int(SmallPool::get().GetNumBlocksFree()));
+
+		// Compacting a compact pool moves nothing
+		ASSERT_EQUALS(0, int(SmallPool::get().Compact(Mover::Move, &table)));
+
+		// The free list is in address order, starting right after the objects
+		char* pPrevious = 0;
+		for (unsigned int i = 0; i < 32; i++)
+		{
+			char* temp = reinterpret_cast<char*>(SmallPool::get().Allocate(32));
+			ASSERT_TEST_MESSAGE(temp == pStart + (32 + i) * sizeof(PoolBlock<32>), "Free list should be in address order.");
+			ASSERT_TEST_MESSAGE(temp > pPrevious, "Free list should be in address order.");
+			pPrevious = temp;
+		}
+		ASSERT_EQUALS(0, int(SmallPool::get().GetNumBlocksFree()));
+		SmallPool::get().ShutDown();
+	}
+	void testSortFreeList()
+	{
+		GrowPool::get().StartUp(12);
+		std::vector<char*> blocks;
+		for (unsigned int i = 0; i < 12; i++)
+		{
+			blocks.push_back(reinterpret_cast<char*>(GrowPool::get().Allocate(16)));
+		}
+		std::sort(blocks.begin(), blocks.end());
+		for (unsigned int i = 0; i < 12; i += 2)
+		{
+			GrowPool::get().Free(blocks[i]);
+		}
+
+		// LIFO would hand out the last block freed first
+		GrowPool::get().SortFreeList();
+		ASSERT_EQUALS(6, int(GrowPool::get().GetNumBlocksFree()));
+		for (unsigned int i = 0; i < 12; i += 2)
+		{
+			ASSERT_TEST_MESSAGE(GrowPool::get().Allocate(16) == blocks[i], "Sorted free list should hand out the lowest block first.");
+		}
+		ASSERT_TEST_MESSAGE(GrowPool::get().Allocate(16) == 0, "Pool should be full.");
+		GrowPool::get().ShutDown();
+	}
 	void testAlignment()
 	{
 		SmallPool::get().StartUp();
@@ -1157,14 +3050,873 @@ public:
 	}
 };
 
+class FrameAllocatorTest : public TestFixture<FrameAllocatorTest>
+{
+public:
+	TEST_FIXTURE_DESCRIBE(FrameAllocatorTest, "Testing Frame Allocator...")
+	{
+		TEST_CASE_DESCRIBE(testAllocate, "Allocations are aligned, in order, and return 0 when the frame is full");
+		TEST_CASE_DESCRIBE(testMarkers, "FreeToMarker and ScopedFrameMarker give memory back");
+		TEST_CASE_DESCRIBE(testBuffering, "Memory from a frame survives numFrames - 1 BeginFrames");
+		TEST_CASE_DESCRIBE(testStlAllocator, "Containers and strings can live in the frame allocator");
+		TEST_CASE_DESCRIBE(testStlAllocatorOverflow, "Containers that outgrow the frame get std::bad_alloc");
+		TEST_CASE_DESCRIBE(testCommit, "Frames only commit the pages they use");
+	}
+	void testAllocate()
+	{
+		FrameAllocator::get().StartUp(256);
+		char* a = reinterpret_cast<char*>(FrameAllocator::get().Allocate(3, 1));
+		char* b = reinterpret_cast<char*>(FrameAllocator::get().Allocate(16));
+		ASSERT_TEST_MESSAGE(a != 0 && b != 0, "Allocate returned 0 when there should be space left.");
+		ASSERT_TEST_MESSAGE((reinterpret_cast<size_t>(a) & 15) == 0, "Frame buffer isn't 16 byte aligned.");
+		ASSERT_TEST_MESSAGE(b == a + 16, "Allocate should bump to the next aligned address.");
+		ASSERT_TEST_MESSAGE(FrameAllocator::get().GetBytesUsed() == 32, "Incorrect number of bytes used.");
+		ASSERT_TEST_MESSAGE(FrameAllocator::get().Allocate(256) == 0, "Allocate should return 0 when the frame is full.");
+		ASSERT_TEST_MESSAGE(FrameAllocator::get().Allocate(224) == b + 16, "A failed Allocate shouldn't use any space.");
+		FrameAllocator::get().ShutDown();
+	}
+	void testMarkers()
+	{
+		FrameAllocator::get().StartUp(256);
+		FrameAllocator::get().Allocate(16);
+		FrameMarker marker = FrameAllocator::get().GetMarker();
+		void* a = FrameAllocator::get().Allocate(64);
+		FrameAllocator::get().FreeToMarker(marker);
+		ASSERT_TEST_MESSAGE(FrameAllocator::get().Allocate(64) == a, "FreeToMarker should free everything after the marker.");
+
+		void* b = 0;
+		{
+			ScopedFrameMarker scoped;
+			b = FrameAllocator::get().Allocate(32);
+			FrameAllocator::get().Allocate(32);
+		}
+		ASSERT_TEST_MESSAGE(FrameAllocator::get().Allocate(16) == b, "ScopedFrameMarker should free its scope's allocations.");
+		FrameAllocator::get().ShutDown();
+	}
+	void testBuffering()
+	{
+		for (unsigned int numFrames = 1; numFrames <= 3; numFrames++)
+		{
+			FrameAllocator::get().StartUp(64, numFrames);
+			int* first = reinterpret_cast<int*>(FrameAllocator::get().Allocate(sizeof(int)));
+			*first = 485;
+			for (unsigned int i = 1; i < numFrames; i++)
+			{
+				FrameAllocator::get().BeginFrame();
+				ASSERT_TEST_MESSAGE(FrameAllocator::get().Allocate(sizeof(int)) != first, "Frames in flight shouldn't share a buffer.");
+				ASSERT_EQUALS(485, *first);
+			}
+			FrameAllocator::get().BeginFrame();
+			ASSERT_TEST_MESSAGE(FrameAllocator::get().Allocate(sizeof(int)) == first, "Buffers should be reused in turn.");
+			ASSERT_TEST_MESSAGE(FrameAllocator::get().GetFrameNumber() == numFrames, "Incorrect frame number.");
+			FrameAllocator::get().ShutDown();
+		}
+	}
+	void testCommit()
+	{
+		FrameAllocator::get().StartUp(16 * 1024 * 1024);
+		ASSERT_TEST_MESSAGE(FrameAllocator::get().GetBytesCommitted() == 0, "Nothing should be committed before the first Allocate.");
+		char* a = reinterpret_cast<char*>(FrameAllocator::get().Allocate(100));
+		ASSERT_TEST_MESSAGE(a != 0, "Allocate returned 0 when there should be space left.");
+		memset(a, 1, 100);
+		size_t committed = FrameAllocator::get().GetBytesCommitted();
+		ASSERT_TEST_MESSAGE(committed >= 100 && committed < 16 * 1024 * 1024, "Only the pages used should be committed.");
+
+		// Past what's committed, and the next frame starts with nothing
+		char* b = reinterpret_cast<char*>(FrameAllocator::get().Allocate(committed));
+		ASSERT_TEST_MESSAGE(b != 0, "Allocate should commit more pages.");
+		memset(b, 1, committed);
+		FrameAllocator::get().BeginFrame();
+		ASSERT_TEST_MESSAGE(FrameAllocator::get().Allocate(16) != 0, "Allocate returned 0 in a fresh frame.");
+		ASSERT_TEST_MESSAGE(FrameAllocator::get().GetBytesCommitted() > committed, "The new frame should commit its own pages.");
+		FrameAllocator::get().ShutDown();
+	}
+	void testStlAllocator()
+	{
+		FrameAllocator::get().StartUp(4096);
+		{
+			std::vector<int, FrameStlAllocator<int> > values;
+			for (int i = 0; i < 100; i++)
+			{
+				values.push_back(i);
+			}
+			ASSERT_TEST_MESSAGE(FrameAllocator::get().GetBytesUsed() >= 100 * sizeof(int), "vector didn't allocate from the frame.");
+			for (int i = 0; i < 100; i++)
+			{
+				ASSERT_EQUALS(i, values[i]);
+			}
+		}
+		{
+			ScopedFrameMarker scoped;
+			FrameString handle = "PointLights[";
+			handle += '3';
+			handle += "].SpecularColor, long enough to not fit in place";
+			ASSERT_TEST_MESSAGE(strcmp(handle.c_str(), "PointLights[3].SpecularColor, long enough to not fit in place") == 0,
+				"FrameString has the wrong contents.");
+		}
+		FrameAllocator::get().ShutDown();
+	}
+	void testStlAllocatorOverflow()
+	{
+		FrameAllocator::get().StartUp(256);
+		bool bThrew = false;
+		try
+		{
+			std::vector<int, FrameStlAllocator<int> > values;
+			for (int i = 0; i < 1000; i++)
+			{
+				values.push_back(i);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			bThrew = true;
+		}
+		ASSERT_TEST_MESSAGE(bThrew, "vector should get std::bad_alloc when it outgrows the frame.");
+
+		// Under max_size, or basic_string throws length_error itself, but past what's left
+		bThrew = false;
+		FrameAllocator::get().BeginFrame();
+		FrameAllocator::get().Allocate(200);
+		try
+		{
+			FrameString handle(100, 'x');
+		}
+		catch (const std::bad_alloc&)
+		{
+			bThrew = true;
+		}
+		ASSERT_TEST_MESSAGE(bThrew, "FrameString should get std::bad_alloc when it outgrows the frame.");
+		FrameAllocator::get().ShutDown();
+	}
+};
+
+// Small object test classes, a base and a larger derived class
+class SmallObjectBase
+{
+public:
+	DECLARE_SMALL_OBJECT_NEW_DELETE();
+	SmallObjectBase() : m_Value(485) {}
+	virtual ~SmallObjectBase() {}
+	int m_Value;
+};
+
+class SmallObjectDerived : public SmallObjectBase
+{
+public:
+	char m_Data[100];
+};
+
+class SmallObjectAllocatorTest : public TestFixture<SmallObjectAllocatorTest>
+{
+public:
+	TEST_FIXTURE_DESCRIBE(SmallObjectAllocatorTest, "Testing Small Object Allocator...")
+	{
+		TEST_CASE_DESCRIBE(testSizeClasses, "Sizes go to the pool for their 16 byte class, big ones to the heap");
+		TEST_CASE_DESCRIBE(testNewDelete, "DECLARE_SMALL_OBJECT_NEW_DELETE pools classes, derived classes and arrays");
+		TEST_CASE_DESCRIBE(testGrowth, "Size class pools grow when they run out");
+	}
+	void testSizeClasses()
+	{
+		ASSERT_EQUALS(0u, SmallObjectAllocator::GetSizeClass(1));
+		ASSERT_EQUALS(0u, SmallObjectAllocator::GetSizeClass(16));
+		ASSERT_EQUALS(1u, SmallObjectAllocator::GetSizeClass(17));
+		ASSERT_EQUALS(kNumSmallObjectSizeClasses - 1, SmallObjectAllocator::GetSizeClass(kMaxSmallObjectSize));
+
+		SmallObjectAllocator::get().StartUp();
+		SmallObjectPoolBase* pPool = SmallObjectAllocator::get().GetPool(32);
+		ASSERT_TEST_MESSAGE(pPool != 0 && pPool == SmallObjectAllocator::get().GetPool(17), "17 and 32 bytes should share a size class.");
+		ASSERT_TEST_MESSAGE(pPool != SmallObjectAllocator::get().GetPool(33), "33 bytes should be in the next size class.");
+		ASSERT_TEST_MESSAGE(SmallObjectAllocator::get().GetPool(kMaxSmallObjectSize + 1) == 0, "Big allocations shouldn't use a pool.");
+
+		unsigned int numFree = pPool->GetNumBlocksFree();
+		void* a = SmallObjectAllocator::get().Allocate(24);
+		void* b = SmallObjectAllocator::get().Allocate(32);
+		ASSERT_TEST_MESSAGE(pPool->GetNumBlocksFree() == numFree - 2, "Allocations didn't come from the size class pool.");
+		ASSERT_TEST_MESSAGE(((reinterpret_cast<size_t>(a) | reinterpret_cast<size_t>(b)) & 15) == 0, "Allocations should be 16 byte aligned.");
+
+		void* big = SmallObjectAllocator::get().Allocate(1000);
+		ASSERT_TEST_MESSAGE(big != 0 && (reinterpret_cast<size_t>(big) & 15) == 0, "Big allocations should be 16 byte aligned.");
+		memset(big, 0, 1000);
+
+		SmallObjectAllocator::get().Free(a, 24);
+		SmallObjectAllocator::get().Free(b, 32);
+		SmallObjectAllocator::get().Free(big, 1000);
+		ASSERT_TEST_MESSAGE(pPool->GetNumBlocksFree() == numFree, "Free didn't return the blocks to their pool.");
+		SmallObjectAllocator::get().ShutDown();
+	}
+	void testNewDelete()
+	{
+		SmallObjectAllocator::get().StartUp();
+		SmallObjectPoolBase* pBasePool = SmallObjectAllocator::get().GetPool(sizeof(SmallObjectBase));
+		SmallObjectPoolBase* pDerivedPool = SmallObjectAllocator::get().GetPool(sizeof(SmallObjectDerived));
+		ASSERT_TEST_MESSAGE(pBasePool != pDerivedPool, "Test classes should be in different size classes.");
+		unsigned int baseFree = pBasePool->GetNumBlocksFree();
+		unsigned int derivedFree = pDerivedPool->GetNumBlocksFree();
+
+		SmallObjectBase* pBase = new SmallObjectBase();
+		SmallObjectBase* pDerived = new SmallObjectDerived();
+		ASSERT_EQUALS(485, pDerived->m_Value);
+		ASSERT_TEST_MESSAGE(pBasePool->GetNumBlocksFree() == baseFree - 1 && pDerivedPool->GetNumBlocksFree() == derivedFree - 1,
+			"new didn't use the size class pools.");
+
+		// Deleting through the base pointer still frees to the derived class's pool
+		delete pDerived;
+		delete pBase;
+		ASSERT_TEST_MESSAGE(pBasePool->GetNumBlocksFree() == baseFree && pDerivedPool->GetNumBlocksFree() == derivedFree,
+			"delete didn't return the blocks to the right pools.");
+
+		// A small array is pooled, a large one comes from the heap
+		SmallObjectBase* pArray = new SmallObjectBase[2];
+		ASSERT_EQUALS(485, pArray[1].m_Value);
+		SmallObjectBase* pBigArray = new SmallObjectBase[100];
+		ASSERT_EQUALS(485, pBigArray[99].m_Value);
+		delete[] pArray;
+		delete[] pBigArray;
+		SmallObjectAllocator::get().ShutDown();
+	}
+	void testGrowth()
+	{
+		SmallObjectAllocator::get().StartUp();
+		SmallObjectPoolBase* pPool = SmallObjectAllocator::get().GetPool(48);
+		ASSERT_TEST_MESSAGE(pPool->GetNumBlocks() == kSmallObjectChunkBlocks, "Pools should start with one chunk.");
+		std::vector<void*> blocks;
+		for (unsigned int i = 0; i < kSmallObjectChunkBlocks * 3; i++)
+		{
+			void* temp = SmallObjectAllocator::get().Allocate(48);
+			ASSERT_TEST_MESSAGE(temp != 0, "Allocate returned 0, the pool should have grown.");
+			blocks.push_back(temp);
+		}
+		ASSERT_TEST_MESSAGE(pPool->GetNumBlocks() == kSmallObjectChunkBlocks * 3, "Incorrect number of blocks.");
+		for (size_t i = 0; i < blocks.size(); i++)
+		{
+			SmallObjectAllocator::get().Free(blocks[i], 48);
+		}
+		ASSERT_TEST_MESSAGE(pPool->GetNumBlocksFree() == kSmallObjectChunkBlocks * 3, "Incorrect number of blocks remaining.");
+		SmallObjectAllocator::get().ShutDown();
+	}
+};
+
+typedef PoolAllocator<16, 8> StatsPool;
+
+// Finds StatsPool in the registry, returns false if it isn't registered
+bool FindStatsPool(PoolStats& stats)
+{
+	for (unsigned int i = 0; i < AllocStatsRegistry::get().GetNumPools(); i++)
+	{
+		if (AllocStatsRegistry::get().GetPoolStats(i, stats) && stats.m_szName && std::string(stats.m_szName) == "StatsPool")
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Collects the blocks from ForEachLiveBlock
+void CollectLiveBlock(void* pUser, const void* ptr, unsigned long long allocId, double age)
+{
+	std::vector<std::pair<const void*, unsigned long long> >* pBlocks =
+		static_cast<std::vector<std::pair<const void*, unsigned long long> >*>(pUser);
+	pBlocks->push_back(std::make_pair(ptr, allocId));
+}
+
+class AllocStatsTest : public TestFixture<AllocStatsTest>
+{
+public:
+	TEST_FIXTURE_DESCRIBE(AllocStatsTest, "Testing Allocator Stats...")
+	{
+		TEST_CASE_DESCRIBE(testRegistry, "Pools register between StartUp and ShutDown, and show up in the report");
+#if ALLOC_STATS
+		TEST_CASE_DESCRIBE(testCounters, "Peak, allocation, free and failure counts");
+		TEST_CASE_DESCRIBE(testLiveBlocks, "Live blocks are found in order with their allocation numbers");
+#endif
+	}
+	void testRegistry()
+	{
+		PoolStats stats;
+		StatsPool::get().SetStatsName("StatsPool");
+		StatsPool::get().StartUp();
+		std::string report;
+		AllocStatsRegistry::get().GetReport(report);
+		ASSERT_TEST_MESSAGE(!report.empty(), "The report should never be empty.");
+#if ALLOC_STATS
+		ASSERT_TEST_MESSAGE(FindStatsPool(stats), "StartUp should register the pool.");
+		ASSERT_TEST_MESSAGE(report.find("StatsPool") != std::string::npos, "The report is missing a registered pool.");
+		ASSERT_EQUALS(16, int(stats.m_BlockSize));
+		ASSERT_EQUALS(8, int(stats.m_NumBlocks));
+#endif
+		StatsPool::get().ShutDown();
+		ASSERT_TEST_MESSAGE(!FindStatsPool(stats), "ShutDown should unregister the pool.");
+	}
+#if ALLOC_STATS
+	void testCounters()
+	{
+		StatsPool::get().SetStatsName("StatsPool");
+		StatsPool::get().StartUp();
+		void* blocks[8];
+		for (int i = 0; i < 5; i++)
+		{
+			blocks[i] = StatsPool::get().Allocate(16);
+		}
+		StatsPool::get().Free(blocks[0]);
+		StatsPool::get().Free(blocks[1]);
+
+		PoolStats stats;
+		StatsPool::get().GetStats(stats);
+		ASSERT_EQUALS(3, int(stats.m_BlocksInUse));
+		ASSERT_EQUALS(5, int(stats.m_PeakBlocksInUse));
+		ASSERT_EQUALS(5, int(stats.m_NumAllocs));
+		ASSERT_EQUALS(2, int(stats.m_NumFrees));
+		ASSERT_EQUALS(0, int(stats.m_NumFailed));
+		ASSERT_TEST_MESSAGE(stats.m_AverageLifetime >= 0.0, "Average lifetime can't be negative.");
+
+		// Fill the pool, then one more fails
+		blocks[0] = StatsPool::get().Allocate(16);
+		blocks[1] = StatsPool::get().Allocate(16);
+		for (int i = 5; i < 8; i++)
+		{
+			blocks[i] = StatsPool::get().Allocate(16);
+		}
+		ASSERT_TEST_MESSAGE(StatsPool::get().Allocate(16) == 0, "Allocate should return 0 from a full pool.");
+		StatsPool::get().GetStats(stats);
+		ASSERT_EQUALS(8, int(stats.m_PeakBlocksInUse));
+		ASSERT_EQUALS(10, int(stats.m_NumAllocs));
+		ASSERT_EQUALS(1, int(stats.m_NumFailed));
+
+		for (int i = 0; i < 8; i++)
+		{
+			StatsPool::get().Free(blocks[i]);
+		}
+		StatsPool::get().GetStats(stats);
+		ASSERT_EQUALS(0, int(stats.m_BlocksInUse));
+		ASSERT_EQUALS(8, int(stats.m_PeakBlocksInUse));
+		ASSERT_EQUALS(10, int(stats.m_NumFrees));
+		StatsPool::get().ShutDown();
+
+		// StartUp begins counting again
+		StatsPool::get().StartUp();
+		StatsPool::get().GetStats(stats);
+		ASSERT_EQUALS(0, int(stats.m_PeakBlocksInUse));
+		ASSERT_EQUALS(0, int(stats.m_NumAllocs));
+		StatsPool::get().ShutDown();
+	}
+	void testLiveBlocks()
+	{
+		StatsPool::get().SetStatsName("StatsPool");
+		StatsPool::get().StartUp();
+		void* a = StatsPool::get().Allocate(16);
+		void* b = StatsPool::get().Allocate(16);
+		void* c = StatsPool::get().Allocate(16);
+		StatsPool::get().Free(b);
+
+		std::vector<std::pair<const void*, unsigned long long> > live;
+		StatsPool::get().ForEachLiveBlock(CollectLiveBlock, &live);
+		ASSERT_EQUALS(2, int(live.size()));
+		ASSERT_TEST_MESSAGE(live[0].first == a && live[0].second == 1, "First live block should be allocation #1.");
+		ASSERT_TEST_MESSAGE(live[1].first == c && live[1].second == 3, "Second live block should be allocation #3.");
+		ASSERT_EQUALS(2, int(AllocStatsRegistry::get().ReportLiveBlocks(&StatsPool::get())));
+
+		StatsPool::get().Free(a);
+		StatsPool::get().Free(c);
+		ASSERT_EQUALS(0, int(AllocStatsRegistry::get().ReportLiveBlocks(&StatsPool::get())));
+		StatsPool::get().ShutDown();
+	}
+#endif // ALLOC_STATS
+};
+
+class VirtualArenaTest : public TestFixture<VirtualArenaTest>
+{
+public:
+	TEST_FIXTURE_DESCRIBE(VirtualArenaTest, "Testing Virtual Arena...")
+	{
+		TEST_CASE_DESCRIBE(testReserveCommit, "Reserving commits nothing, Allocate commits pages as it goes");
+		TEST_CASE_DESCRIBE(testHugePages, "Huge page arenas work, or fall back to normal pages");
+	}
+	void testReserveCommit()
+	{
+		const size_t kReserve = 1024 * 1024;
+		VirtualArena arena;
+		ASSERT_TEST_MESSAGE(arena.Reserve(kReserve), "Couldn't reserve address space.");
+		ASSERT_TEST_MESSAGE(arena.GetBytesReserved() >= kReserve, "Reserved less than asked for.");
+		ASSERT_TEST_MESSAGE(arena.GetBytesCommitted() == 0, "Reserve shouldn't commit anything.");
+
+		char* a = reinterpret_cast<char*>(arena.Allocate(100));
+		ASSERT_TEST_MESSAGE(a == arena.GetBase() && (reinterpret_cast<size_t>(a) & 15) == 0, "First allocation should be at the aligned base.");
+		ASSERT_TEST_MESSAGE(arena.GetBytesCommitted() >= 100 && arena.GetBytesCommitted() < kReserve, "Only the pages used should be committed.");
+		memset(a, 1, 100);
+
+		char* b = reinterpret_cast<char*>(arena.Allocate(16, 64));
+		ASSERT_TEST_MESSAGE(b == a + 128, "Allocate should bump to the next aligned address.");
+
+		size_t rest = arena.GetBytesReserved() - arena.GetBytesUsed();
+		char* c = reinterpret_cast<char*>(arena.Allocate(rest, 1));
+		ASSERT_TEST_MESSAGE(c != 0 && arena.GetBytesCommitted() == arena.GetBytesReserved(), "Filling the arena should commit all of it.");
+		memset(c, 1, rest);
+		ASSERT_TEST_MESSAGE(arena.Allocate(1, 1) == 0, "Allocate should return 0 when the arena is full.");
+		ASSERT_TEST_MESSAGE(arena.Contains(c + rest - 1) && !arena.Contains(c + rest), "Contains should match the reserved range.");
+
+		arena.Reset();
+		ASSERT_TEST_MESSAGE(arena.GetBytesUsed() == 0 && arena.GetBytesCommitted() == arena.GetBytesReserved(), "Reset should keep the pages committed.");
+		ASSERT_TEST_MESSAGE(arena.Allocate(16) == a, "Reset should start over at the base.");
+
+		arena.Release();
+		ASSERT_TEST_MESSAGE(arena.GetBase() == 0 && arena.GetBytesReserved() == 0, "Release should forget the range.");
+	}
+	void testHugePages()
+	{
+		const size_t kReserve = 6 * 1024 * 1024;
+		const VirtualPageType types[] = { VM_PAGES_TRANSPARENT_HUGE, VM_PAGES_HUGE };
+		for (int i = 0; i < 2; i++)
+		{
+			VirtualArena arena;
+			ASSERT_TEST_MESSAGE(arena.Reserve(kReserve, types[i]), "Huge page arenas should fall back instead of failing.");
+			if (arena.GetPageType() != VM_PAGES_NORMAL)
+			{
+				ASSERT_TEST_MESSAGE(reinterpret_cast<size_t>(arena.GetBase()) % GetHugePageSize() == 0, "Huge page arenas should be huge page aligned.");
+			}
+			char* a = reinterpret_cast<char*>(arena.Allocate(kReserve - 1024 * 1024));
+			ASSERT_TEST_MESSAGE(a != 0, "Allocate returned 0 from a huge page arena.");
+			memset(a, 1, kReserve - 1024 * 1024);
+		}
+	}
+};
+
+typedef PoolResource<32, 64> SmallPoolResource;
+
+class MemoryResourceTest : public TestFixture<MemoryResourceTest>
+{
+public:
+	TEST_FIXTURE_DESCRIBE(MemoryResourceTest, "Testing Memory Resources...")
+	{
+		TEST_CASE_DESCRIBE(testPoolResource, "PoolResource uses the pool for what fits and upstream for the rest");
+		TEST_CASE_DESCRIBE(testSmallObjectSet, "A set on the small object resource takes its nodes from the pools");
+		TEST_CASE_DESCRIBE(testFrameResource, "Containers on the frame resource allocate from the frame");
+		TEST_CASE_DESCRIBE(testMonotonic, "MonotonicResource bumps through its arena, then goes upstream");
+		TEST_CASE_DESCRIBE(testAllocatorEquality, "Allocators are equal when their resources are");
+	}
+	void testPoolResource()
+	{
+		SmallPool::get().StartUp();
+		SmallPoolResource resource;
+		void* a = resource.allocate(24);
+		ASSERT_EQUALS(63, int(SmallPool::get().GetNumBlocksFree()));
+		void* b = resource.allocate(100);
+		void* c = resource.allocate(16, 64);
+		ASSERT_EQUALS(63, int(SmallPool::get().GetNumBlocksFree()));
+		ASSERT_TEST_MESSAGE((reinterpret_cast<size_t>(c) & 63) == 0, "Over-aligned allocations should be aligned.");
+		memset(b, 0, 100);
+		resource.deallocate(a, 24);
+		resource.deallocate(b, 100);
+		resource.deallocate(c, 16, 64);
+		ASSERT_EQUALS(64, int(SmallPool::get().GetNumBlocksFree()));
+		SmallPool::get().ShutDown();
+	}
+	void testSmallObjectSet()
+	{
+		SmallObjectAllocator::get().StartUp();
+		{
+			typedef std::set<int, std::less<int>, ResourceStlAllocator<int> > PooledSet;
+			PooledSet::allocator_type allocator(GetSmallObjectResource());
+			PooledSet values(allocator);
+			unsigned int numBlocks = 0;
+			for (unsigned int i = 0; i < kNumSmallObjectSizeClasses; i++)
+			{
+				SmallObjectPoolBase* pPool = SmallObjectAllocator::get().GetPool((i + 1) * kSmallObjectGranularity);
+				numBlocks += pPool->GetNumBlocks() - pPool->GetNumBlocksFree();
+			}
+			for (int i = 0; i < 100; i++)
+			{
+				values.insert(i);
+			}
+			unsigned int numBlocksAfter = 0;
+			for (unsigned int i = 0; i < kNumSmallObjectSizeClasses; i++)
+			{
+				SmallObjectPoolBase* pPool = SmallObjectAllocator::get().GetPool((i + 1) * kSmallObjectGranularity);
+				numBlocksAfter += pPool->GetNumBlocks() - pPool->GetNumBlocksFree();
+			}
+			ASSERT_EQUALS(100, int(numBlocksAfter - numBlocks));
+			ASSERT_EQUALS(100, int(values.size()));
+			ASSERT_EQUALS(99, *values.rbegin());
+		}
+		SmallObjectAllocator::get().ShutDown();
+	}
+	void testFrameResource()
+	{
+		FrameAllocator::get().StartUp(4096);
+		{
+			std::vector<int, ResourceStlAllocator<int> > values(GetFrameResource());
+			for (int i = 0; i < 100; i++)
+			{
+				values.push_back(i);
+			}
+			ASSERT_TEST_MESSAGE(FrameAllocator::get().GetBytesUsed() >= 100 * sizeof(int), "vector didn't allocate from the frame.");
+			ASSERT_EQUALS(42, values[42]);
+		}
+		FrameAllocator::get().ShutDown();
+	}
+	void testMonotonic()
+	{
+		MonotonicResource resource(64 * 1024);
+		char* a = reinterpret_cast<char*>(resource.allocate(10, 8));
+		char* b = reinterpret_cast<char*>(resource.allocate(8, 8));
+		ASSERT_TEST_MESSAGE(b == a + 16, "Allocations should be next to each other.");
+		resource.deallocate(b, 8, 8);
+		ASSERT_TEST_MESSAGE(resource.allocate(8, 8) == a + 24, "deallocate shouldn't give anything back.");
+
+		// Past the arena, memory comes from upstream until Release
+		void* c = resource.allocate(128 * 1024);
+		ASSERT_TEST_MESSAGE(c != 0, "Allocations past the arena should come from upstream.");
+		memset(c, 0, 128 * 1024);
+		ASSERT_TEST_MESSAGE(resource.GetUpstreamBytesUsed() == 128 * 1024, "Incorrect bytes from upstream.");
+		resource.Release();
+		ASSERT_TEST_MESSAGE(resource.GetBytesUsed() == 0 && resource.GetUpstreamBytesUsed() == 0, "Release should free everything.");
+		ASSERT_TEST_MESSAGE(resource.allocate(10, 8) == a, "Release should start over at the start of the arena.");
+
+		// A map whose nodes are all in the arena
+		{
+			typedef std::pair<const int, int> Entry;
+			ResourceStlAllocator<Entry> allocator(&resource);
+			std::map<int, int, std::less<int>, ResourceStlAllocator<Entry> > table(std::less<int>(), allocator);
+			for (int i = 0; i < 50; i++)
+			{
+				table[i] = i * 2;
+			}
+			ASSERT_EQUALS(98, table[49]);
+			ASSERT_TEST_MESSAGE(resource.GetUpstreamBytesUsed() == 0, "The map should fit in the arena.");
+		}
+	}
+	void testAllocatorEquality()
+	{
+		MonotonicResource first(4096);
+		MonotonicResource second(4096);
+		ResourceStlAllocator<int> a(&first);
+		ResourceStlAllocator<float> b(&first);
+		ResourceStlAllocator<int> c(&second);
+		ASSERT_TEST_MESSAGE(a == b, "Allocators on the same resource should be equal.");
+		ASSERT_TEST_MESSAGE(a != c, "Allocators on different monotonic resources shouldn't be equal.");
+		ASSERT_TEST_MESSAGE(ResourceStlAllocator<int>().GetResource() == GetDefaultResource(), "Default allocators should use the default resource.");
+
+		SmallPoolResource pool1;
+		SmallPoolResource pool2;
+		ASSERT_TEST_MESSAGE(pool1.is_equal(pool2), "PoolResources on the same pool should be equal.");
+	}
+};
+
+// Counts how many are alive, and can only be moved, like AnimComponent
+class SlotMapTestObject
+{
+public:
+	SlotMapTestObject(int value) : m_Value(value), m_Position(0.0f, 0.0f, 0.0f) { s_NumAlive++; }
+	SlotMapTestObject(SlotMapTestObject&& other) : m_Value(other.m_Value), m_Position(other.m_Position) { s_NumAlive++; other.m_Value = -1; }
+	~SlotMapTestObject() { s_NumAlive--; }
+
+	int m_Value;
+	// Makes the type need 16 byte alignment
+	FastVector3 m_Position;
+
+	static int s_NumAlive;
+private:
+	SlotMapTestObject(const SlotMapTestObject&);
+	SlotMapTestObject& operator=(const SlotMapTestObject&);
+};
+
+int SlotMapTestObject::s_NumAlive = 0;
+
+typedef SlotMap<SlotMapTestObject> TestSlotMap;
+
+class SlotMapTest : public TestFixture<SlotMapTest>
+{
+public:
+	TEST_FIXTURE_DESCRIBE(SlotMapTest, "Testing SlotMap...")
+	{
+		TEST_CASE_DESCRIBE(testInsertGet, "Insert returns handles that Get finds");
+		TEST_CASE_DESCRIBE(testErase, "Erase moves the last object into the hole");
+		TEST_CASE_DESCRIBE(testStaleHandles, "Erased handles go stale, even after their slot is reused");
+		TEST_CASE_DESCRIBE(testIteration, "Objects are packed in one aligned array");
+		TEST_CASE_DESCRIBE(testClear, "Clear destroys everything and stales every handle");
+	}
+	void testInsertGet()
+	{
+		TestSlotMap map;
+		TestSlotMap::Handle null;
+		ASSERT_TEST_MESSAGE(null.IsNull() && map.Get(null) == nullptr, "Default handles should be null.");
+
+		std::vector<TestSlotMap::Handle> handles;
+		for (int i = 0; i < 100; i++)
+		{
+			handles.push_back(map.Insert(i));
+		}
+		ASSERT_EQUALS(100, int(map.GetSize()));
+		ASSERT_EQUALS(100, SlotMapTestObject::s_NumAlive);
+		for (int i = 0; i < 100; i++)
+		{
+			ASSERT_TEST_MESSAGE(!handles[i].IsNull(), "Handles from Insert shouldn't be null.");
+			ASSERT_EQUALS(i, map.Get(handles[i])->m_Value);
+			ASSERT_TEST_MESSAGE(map.GetHandle(i) == handles[i], "GetHandle should match the handle from Insert.");
+		}
+	}
+	void testErase()
+	{
+		TestSlotMap map;
+		TestSlotMap::Handle handles[5];
+		for (int i = 0; i < 5; i++)
+		{
+			handles[i] = map.Insert(i);
+		}
+
+		// The last object moves into index 1
+		ASSERT_TEST_MESSAGE(map.Erase(handles[1]), "Erase should succeed.");
+		ASSERT_EQUALS(4, int(map.GetSize()));
+		ASSERT_EQUALS(4, SlotMapTestObject::s_NumAlive);
+		ASSERT_EQUALS(4, map[1].m_Value);
+		ASSERT_TEST_MESSAGE(map.GetHandle(1) == handles[4], "The moved object's slot should be fixed up.");
+		ASSERT_EQUALS(4, map.Get(handles[4])->m_Value);
+
+		// Erasing the last object doesn't move anything
+		map.Erase(handles[3]);
+		ASSERT_EQUALS(3, int(map.GetSize()));
+		ASSERT_EQUALS(0, map[0].m_Value);
+		ASSERT_EQUALS(4, map[1].m_Value);
+		ASSERT_EQUALS(2, map[2].m_Value);
+
+		ASSERT_TEST_MESSAGE(!map.Erase(handles[1]), "Erasing twice should fail.");
+		ASSERT_EQUALS(3, int(map.GetSize()));
+	}
+	void testStaleHandles()
+	{
+		TestSlotMap map;
+		TestSlotMap::Handle first = map.Insert(1);
+		map.Erase(first);
+		ASSERT_TEST_MESSAGE(!map.IsValid(first) && map.Get(first) == nullptr, "Erased handles should be stale.");
+
+		// The new object gets the same slot with a new generation
+		TestSlotMap::Handle second = map.Insert(2);
+		ASSERT_EQUALS(int(first.m_Index), int(second.m_Index));
+		ASSERT_TEST_MESSAGE(first != second, "Reused slots should have a new generation.");
+		ASSERT_TEST_MESSAGE(map.Get(first) == nullptr, "Stale handles shouldn't find the slot's new object.");
+		ASSERT_EQUALS(2, map.Get(second)->m_Value);
+
+		TestSlotMap::Handle outOfRange;
+		outOfRange.m_Index = 1000;
+		outOfRange.m_Generation = 1;
+		ASSERT_TEST_MESSAGE(map.Get(outOfRange) == nullptr, "Handles past the slots should be invalid.");
+	}
+	void testIteration()
+	{
+		TestSlotMap map;
+		for (int i = 0; i < 50; i++)
+		{
+			map.Insert(i);
+		}
+		for (int i = 0; i < 50; i += 2)
+		{
+			map.Erase(map.GetHandle(i / 2));
+		}
+		ASSERT_EQUALS(25, int(map.GetSize()));
+		ASSERT_TEST_MESSAGE(map.end() - map.begin() == 25, "The array should only hold live objects.");
+		ASSERT_TEST_MESSAGE((reinterpret_cast<size_t>(map.begin()) & 15) == 0, "The array should be 16 byte aligned.");
+
+		int sum = 0;
+		int count = 0;
+		for (SlotMapTestObject& object : map)
+		{
+			ASSERT_TEST_MESSAGE(object.m_Value >= 0, "Moved-from objects shouldn't be in the array.");
+			ASSERT_TEST_MESSAGE(map.Get(map.GetHandle(count)) == &object, "Every object's handle should find it.");
+			sum += object.m_Value;
+			count++;
+		}
+		ASSERT_EQUALS(25, count);
+
+		// Every handle still finds the same values
+		int handleSum = 0;
+		for (unsigned int i = 0; i < map.GetSize(); i++)
+		{
+			handleSum += map.Get(map.GetHandle(i))->m_Value;
+		}
+		ASSERT_EQUALS(sum, handleSum);
+	}
+	void testClear()
+	{
+		TestSlotMap map;
+		TestSlotMap::Handle a = map.Insert(1);
+		TestSlotMap::Handle b = map.Insert(2);
+		map.Clear();
+		ASSERT_TEST_MESSAGE(map.IsEmpty(), "Clear should empty the map.");
+		ASSERT_EQUALS(0, SlotMapTestObject::s_NumAlive);
+		ASSERT_TEST_MESSAGE(map.Get(a) == nullptr && map.Get(b) == nullptr, "Clear should stale every handle.");
+
+		TestSlotMap::Handle c = map.Insert(3);
+		ASSERT_EQUALS(3, map.Get(c)->m_Value);
+	}
+	void tearDown()
+	{
+		ASSERT_EQUALS(0, SlotMapTestObject::s_NumAlive);
+	}
+};
+
+// A singleton that's only created when asked, and counts how often that happens
+class SubsystemTestClass : public Singleton<SubsystemTestClass, SINGLETON_EXPLICIT>
+{
+	DECLARE_SINGLETON(SubsystemTestClass);
+public:
+	~SubsystemTestClass() { s_NumDestroyed++; }
+
+	int m_Value;
+
+	static int s_NumCreated;
+	static int s_NumDestroyed;
+protected:
+	SubsystemTestClass() : m_Value(0) { s_NumCreated++; }
+};
+
+int SubsystemTestClass::s_NumCreated = 0;
+int SubsystemTestClass::s_NumDestroyed = 0;
+
+class SubsystemTest : public TestFixture<SubsystemTest>
+{
+public:
+	TEST_FIXTURE_DESCRIBE(SubsystemTest, "Testing SubsystemRegistry...")
+	{
+		TEST_CASE_DESCRIBE(testStaticSingleton, "Singletons are created during static initialization");
+		TEST_CASE_DESCRIBE(testExplicitSingleton, "Explicit singletons only exist between Create and Destroy");
+		TEST_CASE_DESCRIBE(testOrder, "Subsystems start up in order and shut down in reverse");
+		TEST_CASE_DESCRIBE(testSingletonSubsystem, "Singleton subsystems are created before start up and destroyed after shut down");
+		TEST_CASE_DESCRIBE(testDestructor, "The registry shuts down whatever is still running when it goes away");
+	}
+	void testStaticSingleton()
+	{
+		ASSERT_TEST_MESSAGE(SingletonTestClass::IsCreated(), "Singleton should have been created before main.");
+		ASSERT_TEST_MESSAGE(&SingletonTestClass::get() == &SingletonTestClass::get(), "get() should always return the same instance.");
+
+		// Creating it again does nothing
+		int value = SingletonTestClass::get().GetValue();
+		SingletonTestClass::get().IncrementValue();
+		SingletonTestClass::Create();
+		ASSERT_EQUALS(value + 1, SingletonTestClass::get().GetValue());
+	}
+	void testExplicitSingleton()
+	{
+		int numCreated = SubsystemTestClass::s_NumCreated;
+		int numDestroyed = SubsystemTestClass::s_NumDestroyed;
+		ASSERT_TEST_MESSAGE(!SubsystemTestClass::IsCreated(), "Explicit singleton shouldn't exist before Create.");
+
+		SubsystemTestClass::Create();
+		ASSERT_TEST_MESSAGE(SubsystemTestClass::IsCreated(), "Create should construct the instance.");
+		ASSERT_EQUALS(numCreated + 1, SubsystemTestClass::s_NumCreated);
+		SubsystemTestClass* pInstance = &SubsystemTestClass::get();
+		pInstance->m_Value = 5;
+
+		// A second Create keeps the instance that's there
+		SubsystemTestClass::Create();
+		ASSERT_EQUALS(numCreated + 1, SubsystemTestClass::s_NumCreated);
+		ASSERT_EQUALS(5, SubsystemTestClass::get().m_Value);
+
+		SubsystemTestClass::Destroy();
+		ASSERT_TEST_MESSAGE(!SubsystemTestClass::IsCreated(), "Destroy should destroy the instance.");
+		ASSERT_EQUALS(numDestroyed + 1, SubsystemTestClass::s_NumDestroyed);
+		SubsystemTestClass::Destroy();
+		ASSERT_EQUALS(numDestroyed + 1, SubsystemTestClass::s_NumDestroyed);
+
+		// Created again, it's a new instance in the same place
+		SubsystemTestClass::Create();
+		ASSERT_TEST_MESSAGE(pInstance == &SubsystemTestClass::get(), "Instance should always be in the same static storage.");
+		ASSERT_EQUALS(0, SubsystemTestClass::get().m_Value);
+		SubsystemTestClass::Destroy();
+	}
+	void testOrder()
+	{
+		std::string log;
+		SubsystemRegistry subsystems;
+		subsystems.Add("A", [&log]() { log += 'a'; }, [&log]() { log += 'A'; });
+		subsystems.Add("B", [&log]() { log += 'b'; }, [&log]() { log += 'B'; });
+		subsystems.Add("Empty", SubsystemFunc(), SubsystemFunc());
+		subsystems.Add("C", [&log]() { log += 'c'; }, [&log]() { log += 'C'; });
+		ASSERT_EQUALS(4u, subsystems.GetNumSubsystems());
+		ASSERT_EQUALS("B", subsystems.GetName(1));
+		ASSERT_TEST_MESSAGE(!subsystems.IsStartedUp(), "Nothing should be started up yet.");
+
+		subsystems.StartUp();
+		ASSERT_TEST_MESSAGE(subsystems.IsStartedUp(), "Subsystems should be started up.");
+		ASSERT_EQUALS(std::string("abc"), log);
+
+		subsystems.ShutDown();
+		ASSERT_TEST_MESSAGE(!subsystems.IsStartedUp(), "Subsystems should be shut down.");
+		ASSERT_EQUALS(std::string("abcCBA"), log);
+
+		// Shutting down again does nothing
+		subsystems.ShutDown();
+		ASSERT_EQUALS(std::string("abcCBA"), log);
+	}
+	void testSingletonSubsystem()
+	{
+		bool bCreatedAtStartUp = false;
+		bool bCreatedAtShutDown = false;
+		int valueAtShutDown = 0;
+		SubsystemRegistry subsystems;
+		subsystems.Add<SubsystemTestClass>("SubsystemTestClass",
+			[&bCreatedAtStartUp]()
+			{
+				bCreatedAtStartUp = SubsystemTestClass::IsCreated();
+				SubsystemTestClass::get().m_Value = 7;
+			},
+			[&bCreatedAtShutDown, &valueAtShutDown]()
+			{
+				bCreatedAtShutDown = SubsystemTestClass::IsCreated();
+				valueAtShutDown = SubsystemTestClass::get().m_Value;
+			});
+		ASSERT_TEST_MESSAGE(!SubsystemTestClass::IsCreated(), "Adding the subsystem shouldn't create it.");
+
+		subsystems.StartUp();
+		ASSERT_TEST_MESSAGE(bCreatedAtStartUp, "Singleton should be created before it starts up.");
+		ASSERT_TEST_MESSAGE(SubsystemTestClass::IsCreated(), "Singleton should exist while it's running.");
+
+		subsystems.ShutDown();
+		ASSERT_TEST_MESSAGE(bCreatedAtShutDown, "Singleton should still exist while it shuts down.");
+		ASSERT_EQUALS(7, valueAtShutDown);
+		ASSERT_TEST_MESSAGE(!SubsystemTestClass::IsCreated(), "Singleton should be destroyed after it shuts down.");
+	}
+	void testDestructor()
+	{
+		std::string log;
+		{
+			SubsystemRegistry subsystems;
+			subsystems.Add("A", [&log]() { log += 'a'; }, [&log]() { log += 'A'; });
+		}
+		ASSERT_EQUALS(std::string(""), log);
+
+		{
+			SubsystemRegistry subsystems;
+			subsystems.Add("A", [&log]() { log += 'a'; }, [&log]() { log += 'A'; });
+			subsystems.Add("B", [&log]() { log += 'b'; }, [&log]() { log += 'B'; });
+			subsystems.StartUp();
+		}
+		ASSERT_EQUALS(std::string("abBA"), log);
+	}
+	void tearDown()
+	{
+		SubsystemTestClass::Destroy();
+	}
+};
+
 REGISTER_FIXTURE(FastVector3Test);
 REGISTER_FIXTURE(FastMatrix4Test);
-//REGISTER_FIXTURE(FastQuaternionTest);
+REGISTER_FIXTURE(FastQuaternionTest);
+REGISTER_FIXTURE(SoAMathTest);
+REGISTER_FIXTURE(BoundsTest);
+REGISTER_FIXTURE(DualQuaternionTest);
+REGISTER_FIXTURE(QuantizeTest);
 //REGISTER_FIXTURE(SlowVector3Test);
 //REGISTER_FIXTURE(SlowMatrix4Test);
 //REGISTER_FIXTURE(SlowQuaternionTest);
 //REGISTER_FIXTURE(SingletonTest);
+REGISTER_FIXTURE(VirtualArenaTest);
 REGISTER_FIXTURE(PoolAllocatorTest);
+REGISTER_FIXTURE(FrameAllocatorTest);
+REGISTER_FIXTURE(SmallObjectAllocatorTest);
+REGISTER_FIXTURE(AllocStatsTest);
+REGISTER_FIXTURE(MemoryResourceTest);
+REGISTER_FIXTURE(SlotMapTest);
+REGISTER_FIXTURE(SubsystemTest);
 } // namespace ITP485
 
 #endif // _UNITTESTS_HPP_
@@ -3,7 +3,9 @@
 // Globals
 float4x4 gWorld; // World Transform Matrix
 float4x4 gViewProj; // Combined View and Projection
-float4x4 gPalette[32]; // Matrix Palette
+// Same as MAX_PALETTE_JOINTS in AnimComponent.h, change both together
+#define MAX_PALETTE_JOINTS 32
+row_major float3x4 gPalette[MAX_PALETTE_JOINTS]; // Matrix Palette, 3 registers per joint (bottom row is always 0,0,0,1)
 texture DiffuseMapTexture;
 float4 AmbientColor;
 
@@ -38,13 +40,13 @@ VS_OUTPUT VS_TextureMap(VS_INPUT IN)
 	VS_OUTPUT OUT = (VS_OUTPUT)0;
 
 	// Calculate skinned position.
-	float4 vSkinPos = mul(gPalette[IN.jointIndices.x], float4(IN.vPos, 1.0f)) * IN.jointWeights.x;
+	float3 vSkinPos = mul(gPalette[IN.jointIndices.x], float4(IN.vPos, 1.0f)) * IN.jointWeights.x;
 	vSkinPos += mul(gPalette[IN.jointIndices.y], float4(IN.vPos, 1.0f)) * IN.jointWeights.y;
 	vSkinPos += mul(gPalette[IN.jointIndices.z], float4(IN.vPos, 1.0f)) * IN.jointWeights.z;
 	vSkinPos += mul(gPalette[IN.jointIndices.w], float4(IN.vPos, 1.0f)) * IN.jointWeights.w;
 	
 	// Apply world transform, then view/projection.
-	OUT.vPos = mul(gWorld, vSkinPos);
+	OUT.vPos = mul(gWorld, float4(vSkinPos, 1.0f));
 	OUT.vPos = mul(gViewProj, OUT.vPos);
 
 	// Set the output UV.
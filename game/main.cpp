@@ -2,8 +2,64 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include "../engine/graphics/GraphicsDevice.h"
+#include "../engine/graphics/MeshManager.h"
+#include "../engine/graphics/EffectManager.h"
+#include "../engine/components/AnimComponent.h"
 #include "../engine/game/GameWorld.h"
 #include "../engine/game/InputManager.h"
+#include "../engine/core/framealloc.h"
+#include "../engine/core/smallalloc.h"
+#include "../engine/core/allocstats.h"
+#include "../engine/core/subsystem.h"
+
+//-----------------------------------------------------------------------------
+// Name: AddSubsystems()
+// Desc: Adds every subsystem to the registry, in the order they start up.
+//       They shut down in reverse.
+//-----------------------------------------------------------------------------
+void AddSubsystems(ITP485::SubsystemRegistry& subsystems, HWND hWnd)
+{
+	// Double buffered scratch memory for per-frame temporaries
+	subsystems.Add<ITP485::FrameAllocator>("FrameAllocator",
+		[]() { ITP485::FrameAllocator::get().StartUp(1024 * 1024, 2); },
+		[]() { ITP485::FrameAllocator::get().ShutDown(); });
+
+	// Size class pools for game objects and components, before anything spawns
+	subsystems.Add<ITP485::SmallObjectAllocator>("SmallObjectAllocator",
+		[]() { ITP485::SmallObjectAllocator::get().StartUp(); },
+		[]() { ITP485::SmallObjectAllocator::get().ShutDown(); });
+
+	// The key frame pool adds chunks as needed, a long clip can easily use
+	// more key frames than one chunk holds
+	subsystems.Add<ITP485::KeyFramePool>("KeyFramePool",
+		[]()
+		{
+			ITP485::KeyFramePool::get().SetStatsName("KeyFramePool");
+			ITP485::KeyFramePool::get().StartUp(ITP485::kPoolNoLimit);
+		},
+		[]() { ITP485::KeyFramePool::get().ShutDown(); });
+
+	// The device comes before the meshes and effects, which release their
+	// D3D resources before it's released
+	subsystems.Add<ITP485::GraphicsDevice>("GraphicsDevice",
+		[hWnd]() { ITP485::GraphicsDevice::get().Setup(hWnd); },
+		[]() { ITP485::GraphicsDevice::get().Cleanup(); });
+	subsystems.Add<ITP485::MeshManager>("MeshManager",
+		[]() { ITP485::MeshManager::get().Setup(); },
+		[]() { ITP485::MeshManager::get().Cleanup(); });
+	subsystems.Add<ITP485::EffectManager>("EffectManager",
+		[]() { ITP485::EffectManager::get().Setup(); },
+		[]() { ITP485::EffectManager::get().Cleanup(); });
+
+	subsystems.Add<ITP485::InputManager>("InputManager",
+		[]() { ITP485::InputManager::get().Setup(); },
+		[]() { ITP485::InputManager::get().Cleanup(); });
+
+	// Last, so its game objects are gone before anything they use shuts down
+	subsystems.Add<ITP485::GameWorld>("GameWorld",
+		[]() { ITP485::GameWorld::get().Setup(); },
+		[]() { ITP485::GameWorld::get().Cleanup(); });
+}
 
 //-----------------------------------------------------------------------------
 // Name: MsgProc()
@@ -25,6 +81,14 @@ LRESULT WINAPI MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 			ITP485::GameWorld::get().SetPaused(wParam == WA_INACTIVE);
 			return 0;
 
+		case WM_KEYDOWN:
+			// F1 dumps the allocator stats to the debugger output, once per press
+			if (wParam == VK_F1 && !(lParam & (1 << 30)))
+			{
+				ITP485::AllocStatsRegistry::get().Dump();
+			}
+			break;
+
 		case WM_INPUT:
 		{
 			UINT dwSize = 40;
@@ -90,11 +154,11 @@ INT WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, INT)
 	// Registration function.
 	RegisterRawInputDevices(Rid, 2, sizeof(Rid[0]));
 
-	// Setup our GameWorld and GraphicsDevice singletons
-	ITP485::GraphicsDevice::get().Setup(hWnd);
-	ITP485::GameWorld::get().Setup();
+	// Start up every subsystem, then load the level into the GameWorld
+	ITP485::SubsystemRegistry subsystems;
+	AddSubsystems(subsystems, hWnd);
+	subsystems.StartUp();
 	ITP485::GameWorld::get().LoadLevel("level.ini");
-	ITP485::InputManager::get().Setup();
 
 	// Show the window
 	ShowWindow(hWnd, SW_SHOWDEFAULT);
@@ -118,6 +182,9 @@ INT WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, INT)
 		QueryPerformanceFrequency(&freq);
 		QueryPerformanceCounter(&before);
 
+		// Start on the next frame's scratch memory
+		ITP485::FrameAllocator::get().BeginFrame();
+
 		// Update the game world based on delta time
 		ITP485::GameWorld::get().Update(fElapsed);
 
@@ -140,10 +207,8 @@ INT WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, INT)
 		QueryPerformanceCounter(&after);
 	}
 
-	// Cleanup the GameWorld and GraphicsDevice singletons
-	ITP485::GameWorld::get().Cleanup();
-	ITP485::GraphicsDevice::get().Cleanup();
-	ITP485::InputManager::get().Cleanup();
+	// Shut down every subsystem, in reverse
+	subsystems.ShutDown();
 
 	UnregisterClass(L"ITP485 Game", wc.hInstance);
 	return 0;